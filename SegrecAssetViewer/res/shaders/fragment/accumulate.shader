@@ -0,0 +1,16 @@
+// fragment
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D source;
+// 0 adds a sample (gamma encoded by the scene shaders, averaged in linear), 1 shows the average
+uniform int present;
+
+void main()
+{
+	vec3 color = texture(source, TexCoords).rgb;
+	color = present == 1 ? pow(color, vec3(1.0/2.2)) : pow(color, vec3(2.2));
+	FragColor = vec4(color, 1.0);
+}
\ No newline at end of file
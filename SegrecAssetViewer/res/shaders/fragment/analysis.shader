@@ -0,0 +1,64 @@
+// fragment shader
+#version 330 core
+out vec4 FragColor;
+
+in vec2 FragTexCoords;
+noperspective in vec3 Barycentric;
+
+struct Material {
+	sampler2DArray diffuse;
+	float diffuseLayer;
+};
+
+uniform Material material;
+// AnalysisMode: 1 overdraw, 2 triangle density, 3 texel density, 4 draw cost
+uniform int analysisMode;
+// share of the most expensive mesh, draw cost only
+uniform float meshCost;
+
+// the same ramp as AnalysisView::HeatColor
+vec3 HeatColor(float t)
+{
+	vec3 ramp[5] = vec3[](vec3(0.0, 0.1, 0.9), vec3(0.0, 0.8, 0.9), vec3(0.1, 0.85, 0.1), vec3(0.95, 0.9, 0.0), vec3(0.95, 0.05, 0.0));
+	float position = clamp(t, 0.0, 1.0) * 4.0;
+	int index = min(int(position), 3);
+	return mix(ramp[index], ramp[index + 1], position - float(index));
+}
+
+void main()
+{
+	// every fragment adds one to the count
+	if (analysisMode == 1)
+	{
+		FragColor = vec4(1.0, 0.0, 0.0, 0.0);
+		return;
+	}
+
+	vec3 color;
+	if (analysisMode == 2)
+	{
+		// a triangle covers half of the barycentric plane, its pixel area is that over the determinant of the derivatives
+		vec2 dx = dFdx(Barycentric.xy);
+		vec2 dy = dFdy(Barycentric.xy);
+		float trianglesPerPixel = 2.0 * abs(dx.x * dy.y - dx.y * dy.x);
+		// 1/256 of a triangle per pixel and less is blue, a triangle per pixel and more is red
+		color = HeatColor((log2(max(trianglesPerPixel, 1.0e-6)) + 8.0) / 8.0);
+	}
+	else if (analysisMode == 3)
+	{
+		// the same footprint the GPU picks the mip level from, 1 texel per pixel is green
+		vec2 texels = FragTexCoords * vec2(textureSize(material.diffuse, 0).xy);
+		vec2 dx = dFdx(texels);
+		vec2 dy = dFdy(texels);
+		float level = 0.5 * log2(max(max(dot(dx, dx), dot(dy, dy)), 1.0e-8));
+		vec3 albedo = texture(material.diffuse, vec3(FragTexCoords, material.diffuseLayer)).rgb;
+		color = HeatColor((level + 3.0) / 6.0) * (0.6 + 0.4 * dot(albedo, vec3(0.299, 0.587, 0.114)));
+	}
+	else
+		color = HeatColor(meshCost);
+
+	// faint triangle edges keep the shape readable
+	float edge = min(min(Barycentric.x, Barycentric.y), Barycentric.z) / max(fwidth(min(min(Barycentric.x, Barycentric.y), Barycentric.z)), 1.0e-6);
+	color *= mix(0.75, 1.0, smoothstep(0.0, 1.0, edge));
+	FragColor = vec4(color, 1.0);
+}
\ No newline at end of file
@@ -2,14 +2,20 @@
 #version 330 core
 out vec4 FragColor;
 
-in vec4 FragPosLightSpace;
-in vec3 FragPos;
-in vec3 Normal;
-in vec2 TexCoords;
+in Vertex
+{
+	vec4 FragPosLightSpace;
+	vec3 FragPos;
+	vec3 Normal;
+	vec2 TexCoords;
+
+	vec3 TangentLightDir;
+	vec3 TangentViewPos;
+	vec3 TangentFragPos;
+	mat3 WorldTBN;
 
-in vec3 TangentLightDir;
-in vec3 TangentViewPos;
-in vec3 TangentFragPos;
+	noperspective vec3 EdgeDistance;
+};
 
 struct Light {
 	vec3 direction;
@@ -19,10 +25,16 @@ struct Light {
 	vec3 specular;
 };
 
+// textures come from the texture palette, every slot is a layer of a texture array page.
+// with PACKED_MATERIAL the roughness slot holds occlusion, roughness and metalness in r, g and b
+// and the normal slot a two channel map with the z of the normal reconstructed here
 struct Material {
-	sampler2D diffuse;
-	sampler2D roughness;
-	sampler2D normal;
+	sampler2DArray diffuse;
+	sampler2DArray roughness;
+	sampler2DArray normal;
+	float diffuseLayer;
+	float roughnessLayer;
+	float normalLayer;
 	float shininess;
 };
 
@@ -30,12 +42,114 @@ uniform Light light;
 uniform Material material;
 uniform sampler2D shadowMap;
 
+// wireframe overlay, 0 disables it
+uniform vec3 wire_color;
+uniform float wireWidth;
+
 // ImGui
 uniform float lightIntensity;
 uniform float ambientIntensity;
 uniform float specularIntensity;
 uniform int renderShadows;
 
+// image based lighting
+uniform int useIBL;
+uniform float environmentIntensity;
+uniform vec3 irradianceSH[9];
+uniform samplerCube prefilterMap;
+uniform sampler2D brdfLUT;
+uniform float prefilterMaxLod;
+
+// point and spot lights, sorted into the froxels of the view on the CPU (ClusteredLighting).
+// lightData has four texels per light, clusterLights the offset and count of every froxel's list in lightIndices
+uniform samplerBuffer lightData;
+uniform usamplerBuffer clusterLights;
+uniform usamplerBuffer lightIndices;
+uniform int lightCount;
+uniform vec3 clusterCounts;
+// near plane and depth slices per log unit
+uniform vec2 clusterDepth;
+
+// see CameraUniforms.h
+layout (std140) uniform Camera
+{
+	mat4 view;
+	mat4 projection;
+	vec3 viewPos;
+	vec2 viewportSize;
+};
+
+vec3 IrradianceSH(vec3 n)
+{
+	// coefficients come already convolved with the cosine lobe
+	vec3 result = irradianceSH[0] * 0.282095;
+	result += irradianceSH[1] * 0.488603 * n.y;
+	result += irradianceSH[2] * 0.488603 * n.z;
+	result += irradianceSH[3] * 0.488603 * n.x;
+	result += irradianceSH[4] * 1.092548 * n.x * n.y;
+	result += irradianceSH[5] * 1.092548 * n.y * n.z;
+	result += irradianceSH[6] * 0.315392 * (3.0 * n.z * n.z - 1.0);
+	result += irradianceSH[7] * 1.092548 * n.x * n.z;
+	result += irradianceSH[8] * 0.546274 * (n.x * n.x - n.y * n.y);
+	return max(result, vec3(0.0));
+}
+
+vec3 AmbientIBL(vec3 tangentNormal, vec3 albedo, float roughness, float metalness)
+{
+	vec3 N = normalize(WorldTBN * tangentNormal);
+	vec3 V = normalize(viewPos - FragPos);
+	vec3 R = reflect(-V, N);
+	float NdotV = max(dot(N, V), 0.0);
+
+	// split-sum specular, metals tint it with the albedo
+	vec3 F0 = mix(vec3(0.04), albedo, metalness);
+	vec3 F = F0 + (max(vec3(1.0 - roughness), F0) - F0) * pow(1.0 - NdotV, 5.0);
+	vec2 brdf = texture(brdfLUT, vec2(NdotV, roughness)).rg;
+	vec3 prefiltered = textureLod(prefilterMap, R, roughness * prefilterMaxLod).rgb;
+
+	vec3 diffuse = (1.0 - F) * (1.0 - metalness) * IrradianceSH(N) * albedo;
+	vec3 specular = prefiltered * (F * brdf.x + brdf.y);
+	return (diffuse + specular) * environmentIntensity;
+}
+
+vec3 ClusteredLights(vec3 tangentNormal, vec3 albedo, float roughness, float metalness)
+{
+	// the froxel from the fragment's position, so any viewport or offscreen target finds its own
+	vec4 viewPosition = view * vec4(FragPos, 1.0);
+	vec4 clip = projection * viewPosition;
+	ivec3 counts = ivec3(clusterCounts);
+	ivec2 tile = clamp(ivec2((clip.xy / clip.w * 0.5 + 0.5) * clusterCounts.xy), ivec2(0), counts.xy - 1);
+	int slice = clamp(int(log(max(-viewPosition.z, clusterDepth.x) / clusterDepth.x) * clusterDepth.y), 0, counts.z - 1);
+	uvec2 list = texelFetch(clusterLights, (slice * counts.y + tile.y) * counts.x + tile.x).rg;
+
+	vec3 N = normalize(WorldTBN * tangentNormal);
+	vec3 V = normalize(viewPos - FragPos);
+	vec3 result = vec3(0.0);
+	for (uint i = 0u; i < list.y; i++)
+	{
+		int light = int(texelFetch(lightIndices, int(list.x + i)).r) * 4;
+		vec4 positionRange = texelFetch(lightData, light);
+		vec4 colorType = texelFetch(lightData, light + 1);
+		vec4 spot = texelFetch(lightData, light + 2);
+
+		vec3 toLight = positionRange.xyz - FragPos;
+		float distanceSquared = dot(toLight, toLight);
+		vec3 L = toLight * inversesqrt(max(distanceSquared, 1e-8));
+		// inverse square falloff windowed to reach zero at the light's range
+		float ratio = distanceSquared / (positionRange.w * positionRange.w);
+		float window = clamp(1.0 - ratio * ratio, 0.0, 1.0);
+		float attenuation = window * window / (distanceSquared + 1.0);
+		if (colorType.w > 0.5)
+			attenuation *= smoothstep(spot.w, texelFetch(lightData, light + 3).r, dot(-L, spot.xyz));
+
+		vec3 H = normalize(L + V);
+		float diff = max(dot(N, L), 0.0);
+		float spec = pow(max(dot(N, H), 0.0), material.shininess) * specularIntensity * (1.0 - roughness);
+		result += colorType.rgb * attenuation * (diff * albedo * (1.0 - metalness) + spec);
+	}
+	return result;
+}
+
 float ShadowCalculation(vec4 fragPosLightSpace, vec3 normal, vec3 lightDir)
 {
 	// perform perspective divide
@@ -69,23 +183,41 @@ float ShadowCalculation(vec4 fragPosLightSpace, vec3 normal, vec3 lightDir)
 
 void main()
 {
-	// normal
-	vec3 normal = texture(material.normal, TexCoords).rgb;
+	// one fetch per map
+	vec3 albedo = texture(material.diffuse, vec3(TexCoords, material.diffuseLayer)).rgb;
+#ifdef PACKED_MATERIAL
+	vec3 orm = texture(material.roughness, vec3(TexCoords, material.roughnessLayer)).rgb;
+	float occlusion = orm.r;
+	float roughness = orm.g;
+	float metalness = orm.b;
+	vec2 normalXY = texture(material.normal, vec3(TexCoords, material.normalLayer)).rg * 2.0 - 1.0;
+	vec3 normal = normalize(vec3(normalXY, sqrt(max(1.0 - dot(normalXY, normalXY), 0.0))));
+#else
+	float occlusion = 1.0;
+	float roughness = texture(material.roughness, vec3(TexCoords, material.roughnessLayer)).r;
+	float metalness = 0.0;
+	vec3 normal = texture(material.normal, vec3(TexCoords, material.normalLayer)).rgb;
 	normal = normalize(normal * 2.0 - 1.0);
+#endif
 
 	// ambient
-	vec3 ambient = light.ambient * ambientIntensity * texture(material.diffuse, TexCoords).rgb;
+	vec3 ambient;
+	if (useIBL == 1)
+		ambient = ambientIntensity * AmbientIBL(normal, albedo, roughness, metalness);
+	else
+		ambient = light.ambient * ambientIntensity * albedo;
+	ambient *= occlusion;
 
 	// diffuse
 	vec3 lightDir = TangentLightDir;
 	float diff = max(dot(normal, lightDir), 0.0);
-	vec3 diffuse = light.diffuse * lightIntensity * diff * texture(material.diffuse, TexCoords).rgb;
+	vec3 diffuse = light.diffuse * lightIntensity * diff * albedo * (1.0 - metalness);
 
 	// specular
 	vec3 viewDir = normalize(TangentViewPos - TangentFragPos);
 	vec3 halfwayDir = normalize(lightDir + viewDir);
 	float spec = pow(max(dot(normal, halfwayDir), 0.0), material.shininess);
-	vec3 specularMap = vec3(1.0) - texture(material.roughness, TexCoords).rgb;
+	vec3 specularMap = vec3(1.0 - roughness);
 	vec3 specular = light.specular * specularIntensity * spec * specularMap;
 
 	// shadows
@@ -94,7 +226,14 @@ void main()
 	float shadow = renderShadows == 1 ? ShadowCalculation(FragPosLightSpace, worldNormal, worldLightDir) : 0.0;
  
     vec3 result = (ambient + (1.0 - shadow) * (diffuse + specular));
+	if (lightCount > 0)
+		result += ClusteredLights(normal, albedo, roughness, metalness);
 
 	result = pow(result, vec3(1.0/2.2));
+
+	// edges blend over about a pixel on each side
+	float edge = min(min(EdgeDistance.x, EdgeDistance.y), EdgeDistance.z);
+	float wire = wireWidth > 0.0 ? 1.0 - smoothstep(wireWidth * 0.5 - 0.5, wireWidth * 0.5 + 0.5, edge) : 0.0;
+	result = mix(result, wire_color, wire);
     FragColor = vec4(result, 1.0);
 }
\ No newline at end of file
@@ -0,0 +1,37 @@
+// fragment shader
+#version 330 core
+out vec4 FragColor;
+
+in vec3 FragPos;
+in vec3 Normal;
+in float Distance;
+
+// see CameraUniforms.h
+layout (std140) uniform Camera
+{
+	mat4 view;
+	mat4 projection;
+	vec3 viewPos;
+	vec2 viewportSize;
+};
+
+// distance at the saturated ends of the ramp, 0 draws everything in the neutral colour
+uniform float distanceRange;
+
+// the same ramp as GeometryDiff::DiffColor: blue inside the reference, light grey on it, red outside
+vec3 DiffColor(float t)
+{
+	vec3 neutral = vec3(0.85);
+	t = clamp(t, -1.0, 1.0);
+	return t < 0.0 ? mix(neutral, vec3(0.05, 0.25, 0.95), -t) : mix(neutral, vec3(0.95, 0.1, 0.05), t);
+}
+
+void main()
+{
+	vec3 color = DiffColor(distanceRange > 0.0 ? Distance / distanceRange : 0.0);
+	// headlight shading keeps the shape readable without changing the colours much
+	vec3 normal = normalize(Normal);
+	vec3 toCamera = normalize(viewPos - FragPos);
+	color *= 0.55 + 0.45 * abs(dot(normal, toCamera));
+	FragColor = vec4(color, 1.0);
+}
\ No newline at end of file
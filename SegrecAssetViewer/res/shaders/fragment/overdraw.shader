@@ -0,0 +1,26 @@
+// fragment shader
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+// fragments per pixel counted by the overdraw pass
+uniform sampler2D counts;
+// count at the red end of the ramp, a single layer is blue
+uniform float maxOverdraw;
+
+// the same ramp as AnalysisView::HeatColor
+vec3 HeatColor(float t)
+{
+	vec3 ramp[5] = vec3[](vec3(0.0, 0.1, 0.9), vec3(0.0, 0.8, 0.9), vec3(0.1, 0.85, 0.1), vec3(0.95, 0.9, 0.0), vec3(0.95, 0.05, 0.0));
+	float position = clamp(t, 0.0, 1.0) * 4.0;
+	int index = min(int(position), 3);
+	return mix(ramp[index], ramp[index + 1], position - float(index));
+}
+
+void main()
+{
+	float count = textureLod(counts, TexCoords, 0.0).r;
+	vec3 color = count < 0.5 ? vec3(0.02) : HeatColor((count - 1.0) / (maxOverdraw - 1.0));
+	FragColor = vec4(color, 1.0);
+}
\ No newline at end of file
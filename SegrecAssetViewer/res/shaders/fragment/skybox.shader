@@ -0,0 +1,16 @@
+// fragment shader
+#version 330 core
+out vec4 FragColor;
+
+in vec3 LocalPos;
+
+uniform samplerCube environmentMap;
+uniform float environmentIntensity;
+uniform float skyboxLod;
+
+void main()
+{
+	vec3 color = textureLod(environmentMap, LocalPos, skyboxLod).rgb * environmentIntensity;
+	color = pow(color, vec3(1.0/2.2));
+	FragColor = vec4(color, 1.0);
+}
\ No newline at end of file
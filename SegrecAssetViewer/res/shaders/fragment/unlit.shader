@@ -5,14 +5,15 @@ out vec4 FragColor;
 in vec2 TexCoords;
 
 struct Material {
-	sampler2D diffuse;
+	sampler2DArray diffuse;
+	float diffuseLayer;
 };
 
 uniform Material material;
 
 void main()
 {
-	vec3 color = texture(material.diffuse, TexCoords).rgb;
+	vec3 color = texture(material.diffuse, vec3(TexCoords, material.diffuseLayer)).rgb;
 	color = pow(color, vec3(1.0/2.2));
 	FragColor = vec4(color, 1.0);
 }
\ No newline at end of file
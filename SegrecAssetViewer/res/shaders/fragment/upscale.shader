@@ -0,0 +1,37 @@
+// fragment
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D source;
+// rendered part of the source texture and the size of one source texel, both in texture coordinates
+uniform vec2 sourceScale;
+uniform vec2 sourceTexel;
+uniform float sharpness;
+
+vec3 Sample(vec2 uv)
+{
+	// texels outside the rendered part are left from larger frames
+	return texture(source, clamp(uv, sourceTexel * 0.5, sourceScale - sourceTexel * 0.5)).rgb;
+}
+
+void main()
+{
+	// bilinear upscale followed by contrast adaptive sharpening: the neighbours get a negative weight that shrinks
+	// where the local contrast is already high, so edges get crisper without ringing
+	vec2 uv = TexCoords * sourceScale;
+	vec3 center = Sample(uv);
+	vec3 north = Sample(uv + vec2(0.0, sourceTexel.y));
+	vec3 south = Sample(uv - vec2(0.0, sourceTexel.y));
+	vec3 east = Sample(uv + vec2(sourceTexel.x, 0.0));
+	vec3 west = Sample(uv - vec2(sourceTexel.x, 0.0));
+
+	vec3 minimum = min(center, min(min(north, south), min(east, west)));
+	vec3 maximum = max(center, max(max(north, south), max(east, west)));
+	vec3 amplitude = sqrt(clamp(min(minimum, 1.0 - maximum) / max(maximum, vec3(1.0e-4)), 0.0, 1.0));
+	vec3 weight = -amplitude * (0.2 * sharpness);
+
+	vec3 result = (center + (north + south + east + west) * weight) / (1.0 + 4.0 * weight);
+	FragColor = vec4(clamp(result, 0.0, 1.0), 1.0);
+}
\ No newline at end of file
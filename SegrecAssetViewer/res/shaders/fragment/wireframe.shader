@@ -2,9 +2,17 @@
 #version 330 core
 out vec4 FragColor;
 
+noperspective in vec3 EdgeDistance;
+
 uniform vec3 wire_color;
+uniform float wireWidth;
 
 void main()
 {
-	FragColor = vec4(wire_color, 1.0);
+	// alpha to coverage turns the edge falloff into anti-aliasing
+	float edge = min(min(EdgeDistance.x, EdgeDistance.y), EdgeDistance.z);
+	float coverage = 1.0 - smoothstep(wireWidth * 0.5 - 0.5, wireWidth * 0.5 + 0.5, edge);
+	if (coverage <= 0.0)
+		discard;
+	FragColor = vec4(wire_color, coverage);
 }
\ No newline at end of file
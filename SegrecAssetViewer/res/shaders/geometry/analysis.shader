@@ -0,0 +1,24 @@
+// geometry shader
+#version 330 core
+layout (triangles) in;
+layout (triangle_strip, max_vertices = 3) out;
+
+in vec2 TexCoords[];
+
+out vec2 FragTexCoords;
+// the corners of every triangle get (1, 0, 0), (0, 1, 0) and (0, 0, 1). interpolated without perspective they are affine
+// in screen space, so their derivatives give the triangle's size in pixels
+noperspective out vec3 Barycentric;
+
+void main()
+{
+	for (int i = 0; i < 3; i++)
+	{
+		gl_Position = gl_in[i].gl_Position;
+		FragTexCoords = TexCoords[i];
+		Barycentric = vec3(0.0);
+		Barycentric[i] = 1.0;
+		EmitVertex();
+	}
+	EndPrimitive();
+}
\ No newline at end of file
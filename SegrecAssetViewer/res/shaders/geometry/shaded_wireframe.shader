@@ -0,0 +1,84 @@
+// geometry shader
+#version 330 core
+layout (triangles) in;
+layout (triangle_strip, max_vertices = 3) out;
+
+// passes the lit shader's outputs through and adds the pixel distances to the triangle edges
+in Vertex
+{
+	vec4 FragPosLightSpace;
+	vec3 FragPos;
+	vec3 Normal;
+	vec2 TexCoords;
+
+	vec3 TangentLightDir;
+	vec3 TangentViewPos;
+	vec3 TangentFragPos;
+	mat3 WorldTBN;
+
+	noperspective vec3 EdgeDistance;
+} vertices[];
+
+out Vertex
+{
+	vec4 FragPosLightSpace;
+	vec3 FragPos;
+	vec3 Normal;
+	vec2 TexCoords;
+
+	vec3 TangentLightDir;
+	vec3 TangentViewPos;
+	vec3 TangentFragPos;
+	mat3 WorldTBN;
+
+	noperspective vec3 EdgeDistance;
+};
+
+// see CameraUniforms.h
+layout (std140) uniform Camera
+{
+	mat4 view;
+	mat4 projection;
+	vec3 viewPos;
+	vec2 viewportSize;
+};
+
+vec3 CornerHeights()
+{
+	// triangles crossing the near plane can't be projected, they are drawn without edges
+	if (gl_in[0].gl_Position.w <= 0.0 || gl_in[1].gl_Position.w <= 0.0 || gl_in[2].gl_Position.w <= 0.0)
+		return vec3(1.0e6);
+
+	vec2 p0 = 0.5 * viewportSize * gl_in[0].gl_Position.xy / gl_in[0].gl_Position.w;
+	vec2 p1 = 0.5 * viewportSize * gl_in[1].gl_Position.xy / gl_in[1].gl_Position.w;
+	vec2 p2 = 0.5 * viewportSize * gl_in[2].gl_Position.xy / gl_in[2].gl_Position.w;
+	vec2 e0 = p2 - p1;
+	vec2 e1 = p2 - p0;
+	vec2 e2 = p1 - p0;
+	float area = abs(e1.x * e2.y - e1.y * e2.x);
+	return area / max(vec3(length(e0), length(e1), length(e2)), vec3(1.0e-6));
+}
+
+void EmitCorner(int i, vec3 edgeDistance)
+{
+	FragPosLightSpace = vertices[i].FragPosLightSpace;
+	FragPos = vertices[i].FragPos;
+	Normal = vertices[i].Normal;
+	TexCoords = vertices[i].TexCoords;
+	TangentLightDir = vertices[i].TangentLightDir;
+	TangentViewPos = vertices[i].TangentViewPos;
+	TangentFragPos = vertices[i].TangentFragPos;
+	WorldTBN = vertices[i].WorldTBN;
+	EdgeDistance = edgeDistance;
+	gl_Position = gl_in[i].gl_Position;
+	EmitVertex();
+}
+
+void main()
+{
+	vec3 heights = CornerHeights();
+	EmitCorner(0, vec3(heights.x, 0.0, 0.0));
+	EmitCorner(1, vec3(0.0, heights.y, 0.0));
+	EmitCorner(2, vec3(0.0, 0.0, heights.z));
+	EndPrimitive();
+}
\ No newline at end of file
@@ -7,22 +7,35 @@ layout (location = 2) in vec2 aTexCoords;
 layout (location = 3) in vec3 aTangent;
 layout (location = 4) in vec3 aBitangent;
 
-out vec4 FragPosLightSpace;
-out vec3 FragPos;
-out vec3 Normal;
-out vec2 TexCoords;
-
-out vec3 TangentLightDir;
-out vec3 TangentViewPos;
-out vec3 TangentFragPos;
+out Vertex
+{
+	vec4 FragPosLightSpace;
+	vec3 FragPos;
+	vec3 Normal;
+	vec2 TexCoords;
+
+	vec3 TangentLightDir;
+	vec3 TangentViewPos;
+	vec3 TangentFragPos;
+	mat3 WorldTBN;
+
+	// pixel distances to the triangle edges, only the wireframe geometry shader knows them
+	noperspective vec3 EdgeDistance;
+};
+
+// see CameraUniforms.h
+layout (std140) uniform Camera
+{
+	mat4 view;
+	mat4 projection;
+	vec3 viewPos;
+	vec2 viewportSize;
+};
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
 uniform mat4 lightSpaceMatrix;
 
 uniform vec3 lightDirection;
-uniform vec3 viewPos;
 
 void main()
 {
@@ -35,6 +48,7 @@ void main()
 	T = normalize(T - dot(T, N) * N);
 	vec3 B = cross(N, T);
 	Normal = N;
+	WorldTBN = mat3(T, B, N);
 
 	mat3 TBN = transpose(mat3(T, B, N));
 	TangentLightDir = TBN * normalize(-lightDirection);
@@ -42,5 +56,6 @@ void main()
 	TangentFragPos = TBN * FragPos;
 	
 	FragPosLightSpace = lightSpaceMatrix * vec4(FragPos, 1.0);
+	EdgeDistance = vec3(1.0e6);
 	gl_Position = projection * view * model * vec4(aPos, 1.0);
 }
\ No newline at end of file
@@ -0,0 +1,34 @@
+// vertex
+#version 330 core
+
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+
+out vec3 FragPos;
+out vec3 Normal;
+out float Distance;
+
+// see CameraUniforms.h
+layout (std140) uniform Camera
+{
+	mat4 view;
+	mat4 projection;
+	vec3 viewPos;
+	vec2 viewportSize;
+};
+
+uniform mat4 model;
+// signed distance of every vertex of the model, see GeometryDiff. the mesh's vertices start at vertexOffset,
+// gl_VertexID is the index of the mesh vertex being drawn
+uniform samplerBuffer distances;
+uniform int vertexOffset;
+// 0 without distances
+uniform float distanceRange;
+
+void main()
+{
+	Distance = distanceRange > 0.0 ? texelFetch(distances, vertexOffset + gl_VertexID).r : 0.0;
+	FragPos = vec3(model * vec4(aPos, 1.0));
+	Normal = mat3(transpose(inverse(model))) * aNormal;
+	gl_Position = projection * view * vec4(FragPos, 1.0);
+}
\ No newline at end of file
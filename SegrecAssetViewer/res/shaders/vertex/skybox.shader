@@ -0,0 +1,17 @@
+// vertex shader
+#version 330 core
+
+layout (location = 0) in vec3 aPos;
+
+out vec3 LocalPos;
+
+uniform mat4 projection;
+uniform mat4 view;
+
+void main()
+{
+	LocalPos = aPos;
+	vec4 position = projection * view * vec4(aPos, 1.0);
+	// depth of the far plane, the skybox stays behind everything
+	gl_Position = position.xyww;
+}
\ No newline at end of file
@@ -0,0 +1,138 @@
+#include "AllocationCounter.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#ifdef _MSC_VER
+#pragma comment(lib, "psapi.lib")
+#endif
+#endif
+
+namespace
+{
+	// plain integers, no constructor runs when a thread starts
+	thread_local uint64_t t_Allocations = 0;
+	thread_local uint64_t t_Bytes = 0;
+
+	void* CountedAllocate(std::size_t size)
+	{
+		t_Allocations++;
+		t_Bytes += size;
+		if (size == 0)
+			size = 1;
+		while (true)
+		{
+			void* memory = std::malloc(size);
+			if (memory)
+				return memory;
+			std::new_handler handler = std::get_new_handler();
+			if (!handler)
+				throw std::bad_alloc();
+			handler();
+		}
+	}
+}
+
+// the nothrow and aligned forms are left to the standard library, the nothrow ones call these
+void* operator new(std::size_t size)
+{
+	return CountedAllocate(size);
+}
+
+void* operator new[](std::size_t size)
+{
+	return CountedAllocate(size);
+}
+
+void operator delete(void* memory) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept
+{
+	std::free(memory);
+}
+
+uint64_t AllocationCounter::GetThreadAllocations()
+{
+	return t_Allocations;
+}
+
+uint64_t AllocationCounter::GetThreadBytes()
+{
+	return t_Bytes;
+}
+
+size_t AllocationCounter::GetPeakResidentBytes()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return counters.PeakWorkingSetSize;
+	return 0;
+#else
+	// VmHWM follows ResetPeakResidentBytes, getrusage's maximum doesn't
+	FILE* status = std::fopen("/proc/self/status", "r");
+	if (!status)
+		return 0;
+	size_t peak = 0;
+	char line[256];
+	while (std::fgets(line, sizeof(line), status))
+	{
+		unsigned long long kilobytes = 0;
+		if (std::strncmp(line, "VmHWM:", 6) == 0 && std::sscanf(line + 6, "%llu", &kilobytes) == 1)
+		{
+			peak = static_cast<size_t>(kilobytes) * 1024;
+			break;
+		}
+	}
+	std::fclose(status);
+	return peak;
+#endif
+}
+
+bool AllocationCounter::ResetPeakResidentBytes()
+{
+#ifdef _WIN32
+	return false;
+#else
+	FILE* clearRefs = std::fopen("/proc/self/clear_refs", "w");
+	if (!clearRefs)
+		return false;
+	bool reset = std::fputs("5", clearRefs) >= 0;
+	return std::fclose(clearRefs) == 0 && reset;
+#endif
+}
+
+AllocationScope::AllocationScope()
+	: m_StartAllocations(t_Allocations), m_StartBytes(t_Bytes)
+{
+}
+
+uint64_t AllocationScope::GetAllocations() const
+{
+	return t_Allocations - m_StartAllocations;
+}
+
+uint64_t AllocationScope::GetBytes() const
+{
+	return t_Bytes - m_StartBytes;
+}
@@ -0,0 +1,36 @@
+#ifndef ALLOCATIONCOUNTER_H
+#define ALLOCATIONCOUNTER_H
+
+#include <cstddef>
+#include <cstdint>
+
+// global operator new is replaced to count the heap allocations of every thread (a thread local increment per call).
+// used to measure what an import allocates, together with the peak resident set size of the process.
+class AllocationCounter
+{
+public:
+	// allocations and requested bytes of the calling thread since it started
+	static uint64_t GetThreadAllocations();
+	static uint64_t GetThreadBytes();
+
+	// largest resident set of the process so far, 0 where it can't be read
+	static size_t GetPeakResidentBytes();
+	// starts a new peak at the current resident set (Linux only), false where the peak can't be reset
+	static bool ResetPeakResidentBytes();
+};
+
+// allocations of the calling thread while the scope is alive. work handed to other threads is not counted
+class AllocationScope
+{
+public:
+	AllocationScope();
+
+	uint64_t GetAllocations() const;
+	uint64_t GetBytes() const;
+
+private:
+	uint64_t m_StartAllocations;
+	uint64_t m_StartBytes;
+};
+
+#endif // !ALLOCATIONCOUNTER_H
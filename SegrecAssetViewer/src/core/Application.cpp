@@ -15,10 +15,43 @@
 #include "Shader.h"
 #include "ViewerCamera.h"
 #include "Model.h"
-
+#include "Environment.h"
+#include "TexturePalette.h"
+#include "MemoryTracker.h"
+#include "GLResource.h"
+#include "ThreadPool.h"
+#include "AssetValidator.h"
+#include "AssetBrowser.h"
+#include "FrameCapture.h"
+#include "DynamicResolution.h"
+#include "ProgressiveAccumulator.h"
+#include "HotReloader.h"
+#include "ClusterFile.h"
+#include "ClusterStreamer.h"
+#include "SessionRecording.h"
+#include "FrameTimings.h"
+#include "CameraUniforms.h"
+#include "ClusteredLighting.h"
+#include "AnalysisView.h"
+#include "ResourceManifest.h"
+#include "UVInspector.h"
+#include "StartupTimeline.h"
+#include "GeometryDiff.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
 #include <iostream>
 #include <filesystem>
+#include <future>
+#include <memory>
+#include <random>
 #include <string>
+#include <vector>
 
 void error_callback(int error, const char* description);
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
@@ -30,23 +63,190 @@ void proccess_input(GLFWwindow* window);
 glm::vec3 GetLightDirection(float x, float y);
 void SetLitMode();
 void SetWireframeMode();
-unsigned int loadTexture(const char* path, bool gammaCorrection = false);
+// 8 bits per channel, decoded on the thread pool and uploaded on the render thread
+struct DecodedImage
+{
+	int width = 0, height = 0, channels = 0;
+	std::vector<unsigned char> pixels;
+};
+DecodedImage decodeImage(const char* path, int channels = 0);
+GLTexture uploadTexture(const DecodedImage& image, const char* name, bool gammaCorrection = false);
+int RunSoakTest(GLFWwindow* window, Shader& shader, const std::string& path, int cycles);
+int RunLoaderComparison(const std::string& path, int runs);
+int RunRayBenchmark(const std::string& path, int rays);
+int RunGeometryDiff(const std::string& path, const std::string& referencePath);
 
 // settings
 float wWidth = 1200.0f, wHeight = 800.0f;
 bool imgui_mouse_capture = false;
 bool imgui_keyboard_capture = false;
+// shading mode picked with the 1 and 2 keys (0 lit, 1 wireframe), switched by the frame loop like the mode buttons. -1 for none
+int key_shading_mode = -1;
 bool default_model = true;
+bool release_cpu_geometry = false;
+int soak_cycles = 0;
+int compare_loader_runs = 0;
+int ray_benchmark_rays = 0;
+std::string validate_directory;
+std::string browse_directory;
+ValidationSettings validation_settings;
+CaptureSettings capture_settings;
+// captures started from the command line close the viewer once written
+bool capture_and_exit = false;
+// 0 off, 1 rotates the asset, 2 rotates the light
+int turntable_mode = 0;
+// 0 renders at window resolution, otherwise the scene resolution follows this GPU frame time
+float target_frame_time = 0.0f;
+// converts the asset to a cluster file and exits
+std::string build_clusters_path;
+// GPU memory of the cluster pool when a .clusters file is opened
+int stream_budget_mb = 512;
+// compares the asset with this version of it, prints the distances and exits
+std::string diff_reference_path;
+ImportPreset import_preset = ImportPreset::FullQuality;
+// session recording and replay. a replay steps one recorded frame per drawn frame with a fixed timestep,
+// writes the CPU and GPU time of every frame as CSV and closes the viewer
+std::string record_path;
+std::string replay_path;
+std::string replay_csv_path;
+float replay_timestep = 1.0f / 60.0f;
+int replay_warmup_frames = 30;
+// exits with 1 when the replay's CPU or GPU p99 is above it, 0 disables the check
+float replay_max_p99 = 0.0f;
+bool hidden_window = false;
+// input callbacks leave the view alone while a replay drives it
+bool replaying = false;
 
 // camera
 ViewerCamera camera(glm::vec3(0.0f, 0.0f, 5.0f));
 
+// picking, requested by the mouse callback and traced in the render loop where the matrices are known
+bool pick_requested = false;
+bool pick_click = false;
+double pick_x = 0.0, pick_y = 0.0;
+
 // timing
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
 
 int main(int argc, char* argv[])
 {
+	// command line: [asset path] [--preset fast|full|skinned] [--release-cpu-geometry] [--soak <cycles>] [--compare-loaders <runs>] [--bench-rays <count>]
+	//               [--validate <directory> [--report-dir <directory>] [--max-triangles <count>] [--texel-density <min> <max>] [--incremental]]
+	//               [--browse <directory>]
+	//               [--capture <frames> [--capture-size <width> <height>] [--capture-format png|exr] [--capture-dir <directory>] [--turntable asset|light]]
+	//               [--target-frame-time <milliseconds>]
+	//               [--build-clusters <output .clusters>] [--stream-budget <megabytes>] [--diff <reference asset>]
+	//               [--record <session>] [--replay <session> [--replay-csv <file>] [--timestep <seconds>] [--replay-warmup <frames>]
+	//               [--max-p99 <milliseconds>] [--hidden]]
+	std::string asset_path;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string argument = argv[i];
+		if (argument == "--release-cpu-geometry")
+			release_cpu_geometry = true;
+		else if (argument == "--soak" && i + 1 < argc)
+			soak_cycles = std::max(std::atoi(argv[++i]), 1);
+		else if (argument == "--compare-loaders" && i + 1 < argc)
+			compare_loader_runs = std::max(std::atoi(argv[++i]), 1);
+		else if (argument == "--bench-rays" && i + 1 < argc)
+			ray_benchmark_rays = std::max(std::atoi(argv[++i]), 1);
+		else if (argument == "--validate" && i + 1 < argc)
+			validate_directory = argv[++i];
+		else if (argument == "--report-dir" && i + 1 < argc)
+			validation_settings.reportDirectory = argv[++i];
+		else if (argument == "--max-triangles" && i + 1 < argc)
+			validation_settings.maxTriangles = static_cast<unsigned int>(std::max(std::atoi(argv[++i]), 0));
+		else if (argument == "--texel-density" && i + 2 < argc)
+		{
+			validation_settings.minTexelDensity = static_cast<float>(std::atof(argv[++i]));
+			validation_settings.maxTexelDensity = static_cast<float>(std::atof(argv[++i]));
+		}
+		else if (argument == "--incremental")
+			validation_settings.incremental = true;
+		else if (argument == "--browse" && i + 1 < argc)
+		{
+			// absolute before the working directory moves to the executable
+			std::error_code error;
+			browse_directory = std::filesystem::absolute(argv[++i], error).string();
+		}
+		else if (argument == "--capture" && i + 1 < argc)
+		{
+			capture_settings.frameCount = std::max(std::atoi(argv[++i]), 1);
+			capture_and_exit = true;
+		}
+		else if (argument == "--capture-size" && i + 2 < argc)
+		{
+			capture_settings.width = std::atoi(argv[++i]);
+			capture_settings.height = std::atoi(argv[++i]);
+		}
+		else if (argument == "--capture-format" && i + 1 < argc)
+			capture_settings.format = std::string(argv[++i]) == "exr" ? CaptureFormat::Exr : CaptureFormat::Png;
+		else if (argument == "--capture-dir" && i + 1 < argc)
+		{
+			std::error_code error;
+			capture_settings.directory = std::filesystem::absolute(argv[++i], error).string();
+		}
+		else if (argument == "--turntable" && i + 1 < argc)
+		{
+			std::string mode = argv[++i];
+			turntable_mode = mode == "asset" ? 1 : mode == "light" ? 2 : 0;
+		}
+		else if (argument == "--target-frame-time" && i + 1 < argc)
+			target_frame_time = std::max(static_cast<float>(std::atof(argv[++i])), 0.0f);
+		else if (argument == "--build-clusters" && i + 1 < argc)
+			build_clusters_path = argv[++i];
+		else if (argument == "--stream-budget" && i + 1 < argc)
+			stream_budget_mb = std::max(std::atoi(argv[++i]), 16);
+		else if (argument == "--diff" && i + 1 < argc)
+			diff_reference_path = argv[++i];
+		else if ((argument == "--record" || argument == "--replay" || argument == "--replay-csv") && i + 1 < argc)
+		{
+			std::error_code error;
+			std::string path = std::filesystem::absolute(argv[++i], error).string();
+			(argument == "--record" ? record_path : argument == "--replay" ? replay_path : replay_csv_path) = path;
+		}
+		else if (argument == "--timestep" && i + 1 < argc)
+			replay_timestep = std::max(static_cast<float>(std::atof(argv[++i])), 0.0f);
+		else if (argument == "--replay-warmup" && i + 1 < argc)
+			replay_warmup_frames = std::max(std::atoi(argv[++i]), 0);
+		else if (argument == "--max-p99" && i + 1 < argc)
+			replay_max_p99 = std::max(static_cast<float>(std::atof(argv[++i])), 0.0f);
+		else if (argument == "--hidden")
+			hidden_window = true;
+		else if (argument == "--preset" && i + 1 < argc)
+		{
+			if (!ParseImportPreset(argv[++i], import_preset))
+				std::cerr << "Unknown import preset: " << argv[i] << " (fast, full, skinned)" << std::endl;
+		}
+		else if (asset_path.empty())
+			asset_path = argument;
+	}
+
+	// headless, runs before the working directory changes so relative paths stay relative to the caller
+	if (!validate_directory.empty())
+		return AssetValidator(validation_settings).Run(validate_directory) > 0 ? 1 : 0;
+	if (!build_clusters_path.empty())
+	{
+		if (asset_path.empty())
+		{
+			std::cerr << "--build-clusters needs an asset path" << std::endl;
+			return 1;
+		}
+		auto start = std::chrono::steady_clock::now();
+		Model model(asset_path, false, ModelLoader::Auto, import_preset, ModelStorage::CpuOnly);
+		if (!model.errorMessage.empty())
+			return 1;
+		unsigned int triangles = model.GetIndexCount() / 3;
+		if (!ClusterFile::Build(model, build_clusters_path))
+			return 1;
+		std::cout << "Wrote " << triangles << " triangles of " << model.meshes.size() << " meshes to " << build_clusters_path << " in "
+			<< std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() << " s" << std::endl;
+		return 0;
+	}
+	if (!diff_reference_path.empty())
+		return RunGeometryDiff(asset_path, diff_reference_path);
+
 	try {
 		std::filesystem::path exeDir = std::filesystem::path(argv[0]).parent_path();
 		std::filesystem::current_path(exeDir);
@@ -55,6 +255,21 @@ int main(int argc, char* argv[])
 		std::cerr << "Nelze nastavit pracovn adres: " << e.what() << std::endl;
 	}
 
+	// UI images decode on the thread pool while the window comes up, they are uploaded once they are ready
+	auto decode_image = [](const char* name)
+	{
+		const ImageResource* resource = ResourceManifest::FindImage(name);
+		std::string path = resource ? resource->path : "";
+		return ThreadPool::Get().Submit([path]() { return decodeImage(path.c_str(), 4); });
+	};
+	std::future<DecodedImage> window_icon_decode = decode_image("window icon");
+	// lit, wireframe and unlit toolbar buttons, text buttons are shown until they are uploaded
+	const char* icon_names[3] = { "lit button", "wireframe button", "unlit button" };
+	std::future<DecodedImage> icon_decodes[3];
+	GLTexture icons[3];
+	for (int i = 0; i < 3; i++)
+		icon_decodes[i] = decode_image(icon_names[i]);
+
 	glfwSetErrorCallback(error_callback);
 	
 	if (!glfwInit())
@@ -64,6 +279,9 @@ int main(int argc, char* argv[])
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 	glfwWindowHint(GLFW_SAMPLES, 4);
+	// benchmarks can run without showing anything, GL still needs a context and the window provides it
+	if (hidden_window)
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
 
 	GLFWwindow* window = glfwCreateWindow(wWidth, wHeight, "Segrec Asset Viewer", NULL, NULL);
 	if (!window)
@@ -79,16 +297,9 @@ int main(int argc, char* argv[])
 	glfwSetMouseButtonCallback(window, mouse_button_callback);
 
 	glfwMakeContextCurrent(window);
-	glfwSwapInterval(1);
-
-	// setting window icon
-	GLFWimage images[1];
-	images[0].pixels = stbi_load("res/icons/segrec_logo_s.png", &images[0].width, &images[0].height, 0, 4);
-	if (images[0].pixels)
-	{
-		glfwSetWindowIcon(window, 1, images);
-		stbi_image_free(images[0].pixels);
-	}
+	// command line captures run as fast as the encoders keep up, replays aren't held back by vsync either
+	glfwSwapInterval(capture_and_exit || !replay_path.empty() ? 0 : 1);
+	StartupTimeline::Get().Mark("window created");
 
 	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
 		std::cerr << "Error: Failed to initialize glad" << std::endl;
@@ -98,10 +309,26 @@ int main(int argc, char* argv[])
 	glEnable(GL_MULTISAMPLE);
 	glEnable(GL_CULL_FACE);
 
-	Shader shader("res/shaders/vertex/default.shader", "res/shaders/fragment/default.shader");
-	Shader depthShader("res/shaders/vertex/depth.shader", "res/shaders/fragment/depth.shader");
-	Shader wireframeShader("res/shaders/vertex/wireframe.shader", "res/shaders/fragment/wireframe.shader");
-	Shader unlitShader("res/shaders/vertex/unlit.shader", "res/shaders/fragment/unlit.shader");
+	StartupTimeline::Get().Mark("GL loaded");
+
+	// nothing is compiled here, a shader compiles the first time a frame uses it
+	Shader shader(ResourceManifest::FindShader("lit"));
+	Shader depthShader(ResourceManifest::FindShader("depth"));
+	Shader wireframeShader(ResourceManifest::FindShader("wireframe"));
+	Shader shadedWireframeShader(ResourceManifest::FindShader("shaded wireframe"));
+	// swapped in for the two lit shaders above once the packed maps are decoded
+	Shader packedShader(ResourceManifest::FindShader("packed lit"));
+	Shader packedShadedWireframeShader(ResourceManifest::FindShader("packed shaded wireframe"));
+	Shader unlitShader(ResourceManifest::FindShader("unlit"));
+	Shader skyboxShader(ResourceManifest::FindShader("skybox"));
+	Shader upscaleShader(ResourceManifest::FindShader("upscale"));
+	Shader accumulateShader(ResourceManifest::FindShader("accumulate"));
+	Shader analysisShader(ResourceManifest::FindShader("analysis"));
+	Shader overdrawShader(ResourceManifest::FindShader("overdraw"));
+	Shader differenceShader(ResourceManifest::FindShader("difference"));
+	// the ones nothing has drawn with yet are compiled one per frame after the first, switching modes later doesn't stall
+	Shader* const warm_up_shaders[] = { &shader, &depthShader, &wireframeShader, &shadedWireframeShader, &unlitShader, &skyboxShader,
+		&packedShader, &packedShadedWireframeShader, &accumulateShader, &upscaleShader, &analysisShader, &overdrawShader, &differenceShader };
 	
 	Shader* current_shader = &shader;
 
@@ -117,11 +344,10 @@ int main(int argc, char* argv[])
 	};
 
 	// filling buffers with data and sending to shader
-	unsigned int VAO, VBO;
-	glGenVertexArrays(1, &VAO);
-	glGenBuffers(1, &VBO);
-	glBindVertexArray(VAO);
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	GLVertexArray VAO = GLVertexArray::Create();
+	GLBuffer VBO = GLBuffer::Create();
+	glBindVertexArray(VAO.Get());
+	glBindBuffer(GL_ARRAY_BUFFER, VBO.Get());
 	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), &vertices, GL_STATIC_DRAW);
 	glEnableVertexAttribArray(0);
 	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 14 * sizeof(float), (void*)0);
@@ -137,38 +363,79 @@ int main(int argc, char* argv[])
 	glBindVertexArray(0);
 
 	// loading assets
-	Model barrel("res/assets/A_ApetrolBarrel_UE.fbx");
-	Model* current_model = &barrel;
-
-	if (argc > 1)
+	if (asset_path.empty())
+		asset_path = "res/assets/A_ApetrolBarrel_UE.fbx";
+	else
 	{
-		current_model = new Model(argv[1]);
-		std::cout << argv[1] << std::endl;
+		std::cout << asset_path << std::endl;
 		default_model = false;
 	}
+	// captures, replays and the command line modes need everything from their first frame on
+	bool load_up_front = capture_and_exit || !replay_path.empty() || soak_cycles > 0 || compare_loader_runs > 0 || ray_benchmark_rays > 0;
+	// the asset is imported on the thread pool while the viewer already draws, an empty model stands in until it is uploaded.
+	// .clusters files only read their table and open GL buffers, they are opened right here
+	std::unique_ptr<Model> current_model;
+	// counts every model swapped in (load, startup upload, hot reload), a new model can get the old one's address.
+	// 0 stands for none
+	unsigned int model_generation = 1;
+	// the mesh hashes the hot reloader compares against are made by the job too, from the CPU copy
+	struct StartupImport
+	{
+		std::unique_ptr<Model> model;
+		std::vector<uint64_t> hashes;
+	};
+	std::future<StartupImport> startup_import;
+	// why the startup import failed, shown until another asset or a reload replaces the empty model
+	std::string startup_error;
+	if (!load_up_front && !ClusterFile::CanLoad(asset_path))
+	{
+		current_model = std::make_unique<Model>();
+		std::string path = asset_path;
+		ImportPreset preset = import_preset;
+		startup_import = ThreadPool::Get().Submit([path, preset]()
+		{
+			StartupImport result;
+			result.model = std::make_unique<Model>(path, false, ModelLoader::Auto, preset, ModelStorage::CpuOnly);
+			if (result.model->errorMessage.empty())
+				result.hashes = result.model->ComputeMeshHashes();
+			return result;
+		});
+	}
+	else
+	{
+		// geometry is uploaded, the system memory copy is dropped once the hot reloader has hashed it
+		current_model = std::make_unique<Model>(asset_path, false, ModelLoader::Auto, import_preset);
+		StartupTimeline::Get().Mark("asset " + current_model->fileName, current_model->loadMilliseconds);
+	}
 
 	// textures
-	unsigned int stone_floor_diffuse = loadTexture("res/textures/stone_floor.jpg", true);
-	unsigned int stone_floor_roughness = loadTexture("res/textures/stone_floor_roughness.jpg");
-	unsigned int apetrol_diffuse = loadTexture("res/textures/T_ApetrolBarrel_diff_1k.jpg", true);
-	unsigned int apetrol_roughness = loadTexture("res/textures/T_ApetrolBarrel_rough_1k.jpg");
-	unsigned int apetrol_normal = loadTexture("res/textures/T_ApetrolBarrel_normal_gl_1k.jpg");
-	unsigned int debug_diffuse = loadTexture("res/textures/tex_DebugUVTiles.png", true);
-	unsigned int default_roughness = loadTexture("res/textures/T_DefaultRoughness.jpg");
-	unsigned int empty_normal = loadTexture("res/textures/T_EmptyNormal.jpg");
-	unsigned int lit_icon = loadTexture("res/icons/lit_button_icon.png");
-	unsigned int wireframe_icon = loadTexture("res/icons/wireframe_button_icon.png");
-	unsigned int unlit_icon = loadTexture("res/icons/unlit_button_icon.png");
+	// material textures are entries of the texture palette, decoded in parallel and packed into texture arrays. they are
+	// uploaded over the first frames, until then the plane and the asset are drawn without them
+	std::unique_ptr<TexturePalette> palette = std::make_unique<TexturePalette>();
+	auto add_texture = [&palette](const char* name, bool resident)
+	{
+		const ImageResource* resource = ResourceManifest::FindTexture(name);
+		return palette->Add(resource ? resource->path : "", resource && resource->srgb, resident);
+	};
+	// the floor is always drawn, the maps an asset falls back to are added below and decoded once it uses them
+	int stone_floor_diffuse = add_texture("stone floor diffuse", true);
+	int stone_floor_roughness = add_texture("stone floor roughness", true);
+	int empty_normal = add_texture("empty normal", true);
+	const int startup_textures[] = { stone_floor_diffuse, stone_floor_roughness, empty_normal };
+	bool startup_textures_resident = false;
+	if (load_up_front)
+		palette->Flush();
+	// the rest of the folder is only listed, the palette grid decodes the thumbnails of the rows it shows
+	palette->AddDirectory("res/textures");
+	StartupTimeline::Get().Mark("resources queued");
 
 	// shadows
 	// -------
 	const unsigned int SHADOW_WIDTH = 4096, SHADOW_HEIGHT = 4096;
-	unsigned int depthMapFBO;
-	glGenFramebuffers(1, &depthMapFBO);
+	GLFramebuffer depthMapFBO = GLFramebuffer::Create();
 	// create depth texture
-	unsigned int depthMap;
-	glGenTextures(1, &depthMap);
-	glBindTexture(GL_TEXTURE_2D, depthMap);
+	GLTexture depthMap = GLTexture::Create();
+	glBindTexture(GL_TEXTURE_2D, depthMap.Get());
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, SHADOW_WIDTH, SHADOW_HEIGHT, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
@@ -177,27 +444,75 @@ int main(int argc, char* argv[])
 	float borderColor[] = { 1.0, 1.0, 1.0, 1.0 };
 	glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
 	// attach depth texture as FBO's depth buffer
-	glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthMap, 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO.Get());
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthMap.Get(), 0);
 	glDrawBuffer(GL_NONE);
 	glReadBuffer(GL_NONE);
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	MemoryTracker::Get().Register(MemoryCategory::RenderTarget, "shadow map", 0, MemoryTracker::TextureBytes(SHADOW_WIDTH, SHADOW_HEIGHT, 4, false));
+	// color + depth/stencil, 4 samples each
+	int framebuffer_memory_id = MemoryTracker::Get().Register(MemoryCategory::RenderTarget, "default framebuffer (MSAA 4x)", 0, 0);
+
+	// shader configuration, the lit shader with wireframe overlay takes the same settings. applied when they are compiled,
+	// the light direction and everything else the UI changes is set every frame
+	for (Shader* lit_shader : { &shader, &shadedWireframeShader, &packedShader, &packedShadedWireframeShader })
+	{
+		lit_shader->SetInitializer([](const Shader& lit)
+		{
+			lit.SetInt("material.diffuse", 0);
+			lit.SetInt("material.roughness", 1);
+			lit.SetInt("material.normal", 2);
+			lit.SetInt("shadowMap", 3);
+			lit.SetInt("prefilterMap", 4);
+			lit.SetInt("brdfLUT", 5);
+			lit.SetInt("lightData", 6);
+			lit.SetInt("clusterLights", 7);
+			lit.SetInt("lightIndices", 8);
+			lit.SetFloat("material.shininess", 64);
+			lit.SetVec3("light.ambient", 0.1f, 0.1f, 0.1f);
+			lit.SetVec3("light.diffuse", 1.0f, 1.0f, 1.0f);
+			lit.SetVec3("light.specular", 0.3f, 0.3f, 0.3f);
+		});
+	}
 
-	// shader configuration
-	shader.Use();
-	shader.SetInt("material.diffuse", 0);
-	shader.SetInt("material.roughness", 1);
-	shader.SetInt("material.normal", 2);
-	shader.SetInt("shadowMap", 3);
-	shader.SetFloat("material.shininess", 64);
+	// environment (skybox + IBL), baked in the background
+	std::unique_ptr<Environment> environment = std::make_unique<Environment>();
+	// point and spot lights next to the directional one, sorted into froxels of the view every frame
+	std::unique_ptr<ClusteredLighting> lights = std::make_unique<ClusteredLighting>();
 
 	// light
 	glm::vec3 light_direction = glm::vec3(0.5f, -1.0f, -0.5f);
-	shader.SetVec3("light.direction", light_direction);
-	shader.SetVec3("lightDirection", light_direction);
-	shader.SetVec3("light.ambient", 0.1f, 0.1f, 0.1f);
-	shader.SetVec3("light.diffuse", 1.0f, 1.0f, 1.0f);
-	shader.SetVec3("light.specular", 0.3f, 0.3f, 0.3f);
+
+	// view, projection, camera position and viewport size of the scene shaders come from one uniform buffer,
+	// a frame uploads the cameras of all its viewports at once
+	CameraUniforms camera_uniforms;
+	for (Shader* scene_shader : { &shader, &shadedWireframeShader, &packedShader, &packedShadedWireframeShader, &wireframeShader, &unlitShader, &analysisShader,
+		&differenceShader })
+		scene_shader->BindUniformBlock("Camera", CameraUniforms::BINDING);
+	analysisShader.SetInitializer([](const Shader& analysis) { analysis.SetInt("material.diffuse", 0); });
+	camera_uniforms.Set({ camera.GetViewMatrix(), glm::perspective(glm::radians(camera.GetFOV()), wWidth / wHeight, 0.1f, 100.0f),
+		camera.m_Position, glm::vec2(wWidth, wHeight) });
+
+	// command line modes run instead of the viewer
+	if (soak_cycles > 0 || compare_loader_runs > 0 || ray_benchmark_rays > 0)
+	{
+		int result = 0;
+		if (soak_cycles > 0)
+			result = RunSoakTest(window, shader, asset_path, soak_cycles);
+		else if (compare_loader_runs > 0)
+			result = RunLoaderComparison(asset_path, compare_loader_runs);
+		else
+			result = RunRayBenchmark(asset_path, ray_benchmark_rays);
+
+		current_model.reset();
+		environment.reset();
+		palette.reset();
+		GLDeletionQueue::Get().Shutdown();
+
+		glfwDestroyWindow(window);
+		glfwTerminate();
+		return result;
+	}
 
 	// ImGui inizialization
     IMGUI_CHECKVERSION();
@@ -207,6 +522,7 @@ int main(int argc, char* argv[])
     ImGui_ImplOpenGL3_Init((char*)glGetString(330));
 
 	ImGuiIO& io = ImGui::GetIO();
+	StartupTimeline::Get().Mark("ImGui initialized");
 
 	// ImGui variables
 	// ---------------
@@ -219,23 +535,72 @@ int main(int argc, char* argv[])
 	static char normal_path_buffer[512];
 	std::string normal_map_path;
 
-	unsigned int diffuse_map;
-	unsigned int roughness_map;
-	unsigned int normal_map;
+	// palette entries of the diffuse, roughness and normal slot, a requested map replaces the bound one once it is resident
+	int material_maps[3];
+	int requested_maps[3];
+	const bool material_map_srgb[3] = { true, false, false };
+	const char* material_map_names[3] = { "Diffuse", "Roughness", "Normal" };
+	int palette_slot = 0;
+	static char palette_directory_buffer[512];
 
 	if (!default_model)
 	{
-		diffuse_map = debug_diffuse;
-		roughness_map = default_roughness;
-		normal_map = empty_normal;
+		material_maps[0] = add_texture("debug diffuse", false);
+		material_maps[1] = add_texture("default roughness", false);
+		material_maps[2] = empty_normal;
 	}
 	else
 	{
-		diffuse_map = apetrol_diffuse;
-		roughness_map = apetrol_roughness;
-		normal_map = apetrol_normal;
+		material_maps[0] = add_texture("barrel diffuse", false);
+		material_maps[1] = add_texture("barrel roughness", false);
+		material_maps[2] = add_texture("barrel normal", false);
+	}
+	for (int i = 0; i < 3; i++)
+		requested_maps[i] = material_maps[i];
+
+	// maps the asset's materials reference, the first of each slot over all meshes. the maps above stand in for missing or
+	// unreadable ones. embedded images are added under the asset path and their name in the file
+	const int fallback_maps[3] = { material_maps[0], material_maps[1], material_maps[2] };
+	int model_maps[3] = { material_maps[0], material_maps[1], material_maps[2] };
+	auto request_model_maps = [&](const Model& model, bool keep_picked)
+	{
+		const TextureType slot_types[3] = { TextureType::Diffuse, TextureType::Roughness, TextureType::Normal };
+		for (int i = 0; i < 3; i++)
+		{
+			int map = fallback_maps[i];
+			for (const Texture& texture : model.textures_loaded)
+			{
+				if (texture.type != slot_types[i])
+					continue;
+				if (texture.embedded)
+					map = palette->AddEmbedded(model.directory + '/' + model.fileName + ": " + texture.path, texture.embedded, material_map_srgb[i]);
+				else
+					map = palette->Add(model.directory + '/' + texture.path, material_map_srgb[i]);
+				break;
+			}
+			// a fallback is decoded the first time an asset needs it
+			palette->MakeResident(map);
+			// a map picked by hand stays over a reload of the same asset
+			if (!keep_picked || requested_maps[i] == model_maps[i])
+				requested_maps[i] = map;
+			model_maps[i] = map;
+		}
+	};
+	if (!startup_import.valid())
+	{
+		request_model_maps(*current_model, false);
+		if (load_up_front)
+			palette->Flush();
 	}
 
+	// roughness with occlusion and metalness packed next to it (ORM) and normals reduced to two channels, built by the palette
+	// decode workers. packed_from holds the roughness and normal entries the packed maps were made from
+	bool pack_materials = true;
+	int packed_maps[2] = { -1, -1 };
+	int packed_from[2] = { -1, -1 };
+	bool packed_active = false;
+	const int packed_floor[2] = { palette->AddPackedOrm(stone_floor_roughness), palette->AddPackedNormal(empty_normal) };
+
 	// light
 	float light_intensity = 1.0f;
 	float ambient_intensity = 1.0f;
@@ -244,20 +609,363 @@ int main(int argc, char* argv[])
 	float light_color[3] = { 1.0f, 1.0f, 1.0f };
 	bool render_shadows = true;
 	float light_rotation[2] = { 45.0f, 45.0f };
+	int selected_light = 0;
+	int scatter_light_count = 256;
+	// scattered over the plane from a fixed seed, the same count always gives the same lights to compare frame times with
+	auto scatter_lights = [&lights](int count)
+	{
+		std::mt19937 random(count);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+		std::vector<SceneLight>& scene_lights = lights->GetLights();
+		for (int i = 0; i < count; i++)
+		{
+			SceneLight light;
+			light.type = i % 4 == 3 ? LightType::Spot : LightType::Point;
+			light.position = glm::vec3(unit(random) * 10.0f - 5.0f, 0.1f + unit(random) * 1.9f, unit(random) * 10.0f - 5.0f);
+			ImGui::ColorConvertHSVtoRGB(unit(random), 0.7f, 1.0f, light.color.r, light.color.g, light.color.b);
+			light.intensity = 2.0f;
+			light.range = 0.75f + unit(random) * 1.25f;
+			if (light.type == LightType::Spot)
+				light.range *= 2.0f;
+			scene_lights.push_back(light);
+		}
+	};
+
+	// environment
+	static char environment_path_buffer[512];
+	std::vector<std::string> recent_environments;
+	bool use_ibl = true;
+	bool show_skybox = true;
+	float environment_intensity = 1.0f;
+	float skybox_blur = 0.0f;
 
 	// asset
 	float asset_translation[3] = { 0.0f, 0.0f, 0.0f };
 	float asset_rotation[3] = { 0.0f, 0.0f, 0.0f };
 	float uniform_scale = 1.0f;
+	const char* preset_names[static_cast<int>(ImportPreset::Count)];
+	for (int i = 0; i < static_cast<int>(ImportPreset::Count); i++)
+		preset_names[i] = GetImportSettings(static_cast<ImportPreset>(i)).name;
+	// vertex counts of the asset per preset, filled as the presets get loaded
+	struct PresetStats
+	{
+		bool loaded = false;
+		unsigned int importedVertices = 0, vertices = 0;
+		double milliseconds = 0.0;
+		uint64_t allocations = 0;
+		size_t peakResidentBytes = 0;
+	};
+	PresetStats preset_stats[static_cast<int>(ImportPreset::Count)];
+	auto record_preset_stats = [&preset_stats](const Model& model)
+	{
+		PresetStats& stats = preset_stats[static_cast<int>(model.preset)];
+		stats.loaded = true;
+		stats.importedVertices = model.importedVertexCount;
+		stats.vertices = model.GetVertexCount();
+		stats.milliseconds = model.loadMilliseconds;
+		stats.allocations = model.importAllocations;
+		stats.peakResidentBytes = model.peakResidentBytes;
+	};
+	if (!startup_import.valid())
+		record_preset_stats(*current_model);
+	// the other presets are imported once just for their numbers, without GL and one after another on the pool so their
+	// timings and peaks don't overlap. the numbers are dropped when another asset, or another version of it, is loaded
+	std::vector<ImportPreset> preset_queue;
+	std::future<std::unique_ptr<Model>> preset_import;
+	std::string preset_stats_asset = asset_path;
+	auto start_preset_import = [&]()
+	{
+		if (preset_import.valid() || preset_queue.empty())
+			return;
+		std::string path = asset_path;
+		ImportPreset preset = preset_queue.front();
+		preset_queue.erase(preset_queue.begin());
+		preset_import = ThreadPool::Get().Submit([path, preset]()
+		{
+			return std::make_unique<Model>(path, false, ModelLoader::Auto, preset, ModelStorage::CpuOnly);
+		});
+	};
+	auto reset_preset_stats = [&]()
+	{
+		for (PresetStats& stats : preset_stats)
+			stats = PresetStats();
+		preset_queue.clear();
+		preset_import = std::future<std::unique_ptr<Model>>();
+		preset_stats_asset = asset_path;
+	};
 
 	// editor
 	float background_color[3] = { 0.05, 0.05, 0.05f};
 	float wire_color[3] = { 0.9f, 0.9f, 0.9f };
+	float wire_width = 1.0f;
+	bool wireframe_overlay = false;
 	bool render_plane = true;
+	// 2-4 viewports next to each other, each with its own shading mode and camera. they share the frame's shadow map and geometry
+	bool split_view = false;
+	int split_count = 2;
+	const char* split_shading_names[] = { "Lit", "Wireframe", "Unlit" };
+	const char* split_camera_names[] = { "Main", "Front", "Right", "Top" };
+	int split_shading[4] = { 0, 1, 2, 0 };
+	int split_camera[4] = { 0, 1, 2, 3 };
+	// drawn instead of the shading mode while set, with a legend of what the colours mean
+	std::unique_ptr<AnalysisView> analysis_view = std::make_unique<AnalysisView>();
+	AnalysisMode analysis_mode = AnalysisMode::None;
+	float max_overdraw = 8.0f;
+	// signed distances of the asset's vertices to another version of it, shown by the Difference analysis mode
+	std::unique_ptr<GeometryDiff> geometry_diff = std::make_unique<GeometryDiff>();
+	static char diff_path_buffer[512];
+	// distance at the saturated ends of the ramp
+	float diff_range = 0.0f;
+	bool show_memory_panel = false;
+	// UV layout of one mesh with overlaps, flipped triangles and texel density, analysed again when any input changes
+	std::unique_ptr<UVInspector> uv_inspector = std::make_unique<UVInspector>();
+	bool show_uv_inspector = false;
+	int uv_mesh = 0;
+	UVOverlayMode uv_overlay_mode = UVOverlayMode::Islands;
+	unsigned int uv_analyzed_generation = 0;
+	int uv_analyzed_mesh = -1;
+	int uv_analyzed_size = 0;
+	UVOverlayMode uv_analyzed_mode = UVOverlayMode::Islands;
+	// project library, indexed in the background once a folder is opened
+	std::unique_ptr<AssetBrowser> asset_browser = std::make_unique<AssetBrowser>();
+	bool show_asset_browser = !browse_directory.empty();
+	if (!browse_directory.empty())
+		asset_browser->Open(browse_directory);
+	// offscreen captures, a turntable advances by a fixed angle per captured frame
+	std::unique_ptr<FrameCapture> capture = std::make_unique<FrameCapture>();
+	const char* turntable_names[] = { "Off", "Rotate asset", "Rotate light" };
+	int capture_size[2] = { capture_settings.width, capture_settings.height };
+	int capture_format = static_cast<int>(capture_settings.format);
+	float turntable_light_start = light_rotation[1];
+	auto capture_start = std::chrono::steady_clock::now();
+	auto start_capture = [&]()
+	{
+		capture_settings.width = capture_size[0];
+		capture_settings.height = capture_size[1];
+		capture_settings.format = static_cast<CaptureFormat>(capture_format);
+		capture_settings.frameCount = std::max(capture_settings.frameCount, 0);
+		turntable_light_start = light_rotation[1];
+		capture_start = std::chrono::steady_clock::now();
+		return capture->Start(capture_settings);
+	};
+	if (capture_and_exit && !start_capture())
+		glfwSetWindowShouldClose(window, true);
+	// the scene resolution follows GPU timings, ImGui stays at window resolution
+	std::unique_ptr<DynamicResolution> dynamic_resolution = std::make_unique<DynamicResolution>();
+	float upscale_sharpness = 0.5f;
+	if (target_frame_time > 0.0f)
+	{
+		dynamic_resolution->SetTargetFrameMilliseconds(target_frame_time);
+		dynamic_resolution->SetEnabled(true);
+	}
+	target_frame_time = dynamic_resolution->GetTargetFrameMilliseconds();
+	// idle views converge to a supersampled image with soft shadows
+	std::unique_ptr<ProgressiveAccumulator> accumulator = std::make_unique<ProgressiveAccumulator>();
+	int accumulation_samples = accumulator->GetMaxSamples();
+	float light_size = 1.5f;
+	accumulator->SetLightSize(light_size);
+	int stream_budget_edit = stream_budget_mb;
+	// the native glTF loader fills GL buffers directly, such models start without a CPU copy
+	bool keep_cpu_geometry = !release_cpu_geometry && (startup_import.valid() || current_model->HasCpuData());
+	// edits saved from other tools show up without reloading by hand, the startup import is watched once it is uploaded
+	std::unique_ptr<HotReloader> hot_reloader = std::make_unique<HotReloader>();
+	if (!startup_import.valid())
+	{
+		hot_reloader->WatchAsset(*current_model, asset_path, ModelLoader::Auto, import_preset);
+		if (!keep_cpu_geometry)
+			current_model->ReleaseCpuData();
+	}
+	// picked triangle and measurement points, kept in model space so they follow the asset transform
+	bool measure_mode = false;
+	bool has_pick = false;
+	RayHit picked_hit;
+	std::vector<glm::vec3> measure_points;
+
+	auto load_asset = [&]()
+	{
+		has_pick = false;
+		measure_points.clear();
+		accumulator->Reset();
+		// a startup import still running is dropped, its result would be outdated
+		startup_import = std::future<StartupImport>();
+		startup_error.clear();
+		// the old model's GL objects are deleted once the frames using them are done
+		current_model = std::make_unique<Model>(asset_path, false, ModelLoader::Auto, import_preset);
+		model_generation++;
+		// hashed while the CPU copy is still there
+		hot_reloader->WatchAsset(*current_model, asset_path, ModelLoader::Auto, import_preset);
+		if (!keep_cpu_geometry)
+			current_model->ReleaseCpuData();
+		keep_cpu_geometry = current_model->HasCpuData();
+		request_model_maps(*current_model, false);
+		if (asset_path != preset_stats_asset)
+			reset_preset_stats();
+		record_preset_stats(*current_model);
+	};
+
+	// sessions: the recorder writes the state every frame is drawn with, a replay assigns it back
+	std::unique_ptr<SessionRecorder> session_recorder = std::make_unique<SessionRecorder>();
+	static char session_path_buffer[512] = "session.rec";
+	// what the recording last saw, an event is written when it changes
+	std::string recorded_asset, recorded_preset;
+	int recorded_maps[3] = { -1, -1, -1 };
+	auto start_recording = [&](const std::string& path)
+	{
+		recorded_asset.clear();
+		recorded_preset.clear();
+		for (int i = 0; i < 3; i++)
+			recorded_maps[i] = -1;
+		if (!session_recorder->Start(path))
+			std::cout << "ERROR::SESSION::OPEN_FAILED " << path << std::endl;
+	};
+	auto capture_session_frame = [&]()
+	{
+		SessionFrame frame;
+		frame.deltaTime = deltaTime;
+		camera.GetOrbit(frame.cameraYaw, frame.cameraPitch, frame.cameraRadius);
+		frame.lightRotation[0] = light_rotation[0];
+		frame.lightRotation[1] = light_rotation[1];
+		frame.lightIntensity = light_intensity;
+		frame.ambientIntensity = ambient_intensity;
+		frame.specularIntensity = specular_intensity;
+		frame.shininess = shininess;
+		for (int i = 0; i < 3; i++)
+		{
+			frame.lightColor[i] = light_color[i];
+			frame.assetTranslation[i] = asset_translation[i];
+			frame.assetRotation[i] = asset_rotation[i];
+		}
+		frame.environmentIntensity = environment_intensity;
+		frame.uniformScale = uniform_scale;
+		frame.shadingMode = current_shader == &wireframeShader ? 1 : current_shader == &unlitShader ? 2 : 0;
+		frame.flags = (wireframe_overlay ? SessionFrame::WireframeOverlay : 0) | (render_plane ? SessionFrame::RenderPlane : 0)
+			| (render_shadows ? SessionFrame::RenderShadows : 0) | (use_ibl ? SessionFrame::ImageBasedLighting : 0)
+			| (show_skybox ? SessionFrame::Skybox : 0) | (pack_materials ? SessionFrame::PackedMaterials : 0);
+
+		std::string preset_id = GetImportSettings(import_preset).id;
+		if (asset_path != recorded_asset || preset_id != recorded_preset)
+		{
+			frame.assetPath = recorded_asset = asset_path;
+			frame.assetPreset = recorded_preset = preset_id;
+		}
+		for (int i = 0; i < 3; i++)
+		{
+			if (requested_maps[i] != recorded_maps[i])
+			{
+				recorded_maps[i] = requested_maps[i];
+				frame.materialMaps[i] = palette->GetEntry(requested_maps[i]).path;
+			}
+		}
+		return frame;
+	};
+	auto apply_session_frame = [&](const SessionFrame& frame, bool events)
+	{
+		if (events)
+		{
+			ImportPreset preset = import_preset;
+			if (!frame.assetPath.empty() && (!ParseImportPreset(frame.assetPreset, preset) || frame.assetPath != asset_path || preset != import_preset))
+			{
+				asset_path = frame.assetPath;
+				import_preset = preset;
+				load_asset();
+			}
+			// decoded right away, a replay doesn't depend on how fast the workers are
+			for (int i = 0; i < 3; i++)
+			{
+				if (!frame.materialMaps[i].empty())
+				{
+					requested_maps[i] = palette->Add(frame.materialMaps[i], material_map_srgb[i]);
+					palette->MakeResident(requested_maps[i]);
+					palette->Flush();
+				}
+			}
+		}
+
+		camera.SetOrbit(frame.cameraYaw, frame.cameraPitch, frame.cameraRadius);
+		light_rotation[0] = frame.lightRotation[0];
+		light_rotation[1] = frame.lightRotation[1];
+		light_intensity = frame.lightIntensity;
+		ambient_intensity = frame.ambientIntensity;
+		specular_intensity = frame.specularIntensity;
+		shininess = frame.shininess;
+		for (int i = 0; i < 3; i++)
+		{
+			light_color[i] = frame.lightColor[i];
+			asset_translation[i] = frame.assetTranslation[i];
+			asset_rotation[i] = frame.assetRotation[i];
+		}
+		environment_intensity = frame.environmentIntensity;
+		uniform_scale = frame.uniformScale;
+		wireframe_overlay = (frame.flags & SessionFrame::WireframeOverlay) != 0;
+		render_plane = (frame.flags & SessionFrame::RenderPlane) != 0;
+		render_shadows = (frame.flags & SessionFrame::RenderShadows) != 0;
+		use_ibl = (frame.flags & SessionFrame::ImageBasedLighting) != 0;
+		show_skybox = (frame.flags & SessionFrame::Skybox) != 0;
+		pack_materials = (frame.flags & SessionFrame::PackedMaterials) != 0;
+
+		// the same switches as the mode buttons, only when the mode changes
+		bool overlay_shader = current_shader == &shadedWireframeShader || current_shader == &packedShadedWireframeShader;
+		bool lit_shader = overlay_shader || current_shader == &shader || current_shader == &packedShader;
+		if (frame.shadingMode == 1 && current_shader != &wireframeShader)
+		{
+			SetWireframeMode();
+			current_shader = &wireframeShader;
+		}
+		else if (frame.shadingMode == 2 && current_shader != &unlitShader)
+		{
+			SetLitMode();
+			current_shader = &unlitShader;
+		}
+		else if (frame.shadingMode == 0 && (!lit_shader || overlay_shader != wireframe_overlay))
+		{
+			SetLitMode();
+			current_shader = wireframe_overlay ? &shadedWireframeShader : &shader;
+		}
+	};
+
+	SessionReplay session_replay;
+	FrameTimings replay_timings;
+	size_t replay_frame = 0;
+	// recorded frame whose events were applied, they happen once even while the first frame is held for the warm-up
+	size_t replay_events_frame = static_cast<size_t>(-1);
+	int replay_warmup_left = replay_warmup_frames;
+	uint64_t replay_first_gpu_frame = 0;
+	int exit_code = 0;
+	if (!replay_path.empty())
+	{
+		std::string error;
+		if (session_replay.Load(replay_path, error))
+		{
+			// nothing that changes the picture over time on its own: no refinement and no reloads
+			replaying = true;
+			accumulator->SetEnabled(false);
+			hot_reloader->SetEnabled(false);
+			replay_timings.Reserve(session_replay.GetFrameCount());
+			if (replay_csv_path.empty())
+				replay_csv_path = std::filesystem::path(replay_path).replace_extension(".csv").string();
+			std::cout << "replay: " << replay_path << ", " << session_replay.GetFrameCount() << " frames, "
+				<< replay_timestep * 1000.0f << " ms timestep" << std::endl;
+		}
+		else
+		{
+			std::cout << "ERROR::SESSION::" << error << std::endl;
+			exit_code = 1;
+			glfwSetWindowShouldClose(window, true);
+		}
+	}
+	else if (!record_path.empty())
+		start_recording(record_path);
 
 	// render loop
 	while (!glfwWindowShouldClose(window))
 	{
+		auto frame_start = std::chrono::steady_clock::now();
+		dynamic_resolution->BeginFrame();
+		// GPU timings come back a few frames late and are filled into the frames they belong to
+		if (replaying && replay_frame > 0 && dynamic_resolution->GetGpuTimingFrame() >= static_cast<int64_t>(replay_first_gpu_frame))
+			replay_timings.SetGpu(static_cast<size_t>(dynamic_resolution->GetGpuTimingFrame() - replay_first_gpu_frame),
+				dynamic_resolution->GetGpuFrameMilliseconds());
+
 		// refreshing buffers
 		glClearColor(background_color[0], background_color[1], background_color[2], 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -276,21 +984,226 @@ int main(int argc, char* argv[])
 		deltaTime = currentFrame - lastFrame;
 		lastFrame = currentFrame;
 
+		if (replaying)
+			deltaTime = replay_timestep;
+
 		// input
 		proccess_input(window);
+		if (key_shading_mode == 0)
+		{
+			analysis_mode = AnalysisMode::None;
+			SetLitMode();
+			current_shader = wireframe_overlay ? &shadedWireframeShader : &shader;
+		}
+		else if (key_shading_mode == 1)
+		{
+			analysis_mode = AnalysisMode::None;
+			SetWireframeMode();
+			current_shader = &wireframeShader;
+		}
+		key_shading_mode = -1;
+
+		// a replay holds its first frame for the warm-up, then draws one recorded frame per frame
+		bool replay_timed = false;
+		if (replaying)
+		{
+			if (replay_warmup_left > 0)
+				replay_warmup_left--;
+			else
+			{
+				if (replay_frame == 0)
+					replay_first_gpu_frame = dynamic_resolution->GetFrameCount() - 1;
+				replay_timed = true;
+			}
+			apply_session_frame(session_replay.GetFrame(replay_frame), replay_events_frame != replay_frame);
+			replay_events_frame = replay_frame;
+		}
+		else if (session_recorder->IsRecording())
+			session_recorder->Record(capture_session_frame());
+
+		// environment bakes finished in the background
+		environment->Update();
+		MemoryTracker::Get().Update(framebuffer_memory_id, 0, MemoryTracker::TextureBytes(static_cast<int>(wWidth), static_cast<int>(wHeight), 8 * 4, false));
+
+		// palette uploads are spread over frames, swapping a map is just a different entry
+		palette->Update();
+		if (!startup_textures_resident && !startup_import.valid() && std::all_of(std::begin(startup_textures), std::end(startup_textures),
+			[&palette](int entry) { return palette->IsResident(entry); }) && std::all_of(std::begin(requested_maps), std::end(requested_maps),
+			[&palette](int entry) { return palette->IsResident(entry); }))
+		{
+			startup_textures_resident = true;
+			StartupTimeline::Get().Mark("material textures resident");
+		}
+		// UI images arrive from the pool
+		if (window_icon_decode.valid() && window_icon_decode.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+		{
+			DecodedImage image = window_icon_decode.get();
+			if (!image.pixels.empty())
+			{
+				GLFWimage icon = { image.width, image.height, image.pixels.data() };
+				glfwSetWindowIcon(window, 1, &icon);
+			}
+		}
+		for (int i = 0; i < 3; i++)
+		{
+			if (!icon_decodes[i].valid() || icon_decodes[i].wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+				continue;
+			icons[i] = uploadTexture(icon_decodes[i].get(), icon_names[i]);
+			if (std::none_of(std::begin(icon_decodes), std::end(icon_decodes), [](const std::future<DecodedImage>& decode) { return decode.valid(); }))
+				StartupTimeline::Get().Mark("icons uploaded");
+		}
+		// the startup import is uploaded once the pool has it, the empty model drawn until now gives nothing to reuse
+		if (startup_import.valid() && startup_import.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+		{
+			StartupImport imported = startup_import.get();
+			if (!imported.model->errorMessage.empty())
+			{
+				// the empty model stays, the file is still watched so fixing it brings the asset in
+				startup_error = imported.model->errorMessage;
+				std::cout << "ERROR::STARTUP::IMPORT_FAILED " << asset_path << ": " << startup_error << std::endl;
+				hot_reloader->WatchAsset(*current_model, asset_path, ModelLoader::Auto, import_preset);
+			}
+			else
+			{
+				auto upload_start = std::chrono::steady_clock::now();
+				imported.model->AdoptGpuData(*current_model, {}, {});
+				double upload_milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - upload_start).count();
+				current_model = std::move(imported.model);
+				model_generation++;
+				hot_reloader->WatchAsset(*current_model, asset_path, ModelLoader::Auto, import_preset, &imported.hashes);
+				if (!keep_cpu_geometry)
+					current_model->ReleaseCpuData();
+				keep_cpu_geometry = current_model->HasCpuData();
+				// the import kept its texture references and embedded images, the palette decodes them on the pool
+				request_model_maps(*current_model, false);
+				if (asset_path != preset_stats_asset)
+					reset_preset_stats();
+				record_preset_stats(*current_model);
+				accumulator->Reset();
+				StartupTimeline::Get().Mark("asset " + current_model->fileName + " imported", current_model->loadMilliseconds);
+				StartupTimeline::Get().Mark("asset uploaded", upload_milliseconds);
+			}
+		}
+		asset_browser->Update();
+		uv_inspector->Update();
+		// a new comparison saturates at its 99th percentile, the few vertices beyond stand out as the saturated ones
+		if (geometry_diff->Update())
+		{
+			const GeometryDiff::Stats& diff_stats = geometry_diff->GetStats();
+			diff_range = diff_stats.p99 > 0.0f ? diff_stats.p99 : diff_stats.maxDistance;
+		}
+		capture->Update();
+		if (hot_reloader->Update(current_model, *palette))
+		{
+			startup_error.clear();
+			model_generation++;
+			has_pick = false;
+			measure_points.clear();
+			accumulator->Reset();
+			if (!keep_cpu_geometry)
+				current_model->ReleaseCpuData();
+			request_model_maps(*current_model, true);
+			reset_preset_stats();
+			record_preset_stats(*current_model);
+		}
+		if (preset_import.valid() && preset_import.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+		{
+			std::unique_ptr<Model> compared = preset_import.get();
+			if (compared->errorMessage.empty())
+				record_preset_stats(*compared);
+			start_preset_import();
+		}
+		for (int i = 0; i < 3; i++)
+		{
+			if (requested_maps[i] == model_maps[i] && palette->GetEntry(model_maps[i]).state == TexturePalette::EntryState::Failed)
+			{
+				requested_maps[i] = model_maps[i] = fallback_maps[i];
+				palette->MakeResident(fallback_maps[i]);
+			}
+			if (requested_maps[i] != material_maps[i] && palette->IsResident(requested_maps[i]))
+			{
+				material_maps[i] = requested_maps[i];
+				accumulator->Reset();
+			}
+		}
+		// packed from the maps actually bound, a fallback nobody uses yet is not decoded for it
+		if (pack_materials && (packed_from[0] != material_maps[1] || packed_from[1] != material_maps[2])
+			&& palette->IsResident(material_maps[1]) && palette->IsResident(material_maps[2]))
+		{
+			packed_from[0] = material_maps[1];
+			packed_from[1] = material_maps[2];
+			packed_maps[0] = palette->AddPackedOrm(material_maps[1]);
+			packed_maps[1] = palette->AddPackedNormal(material_maps[2]);
+		}
+		// the unpacked maps stay bound until all packed ones are resident
+		bool packed_ready = pack_materials && packed_maps[0] >= 0 && palette->IsResident(packed_maps[0]) && palette->IsResident(packed_maps[1])
+			&& palette->IsResident(packed_floor[0]) && palette->IsResident(packed_floor[1]);
+		if (current_shader == &shader || current_shader == &packedShader)
+			current_shader = packed_ready ? &packedShader : &shader;
+		else if (current_shader == &shadedWireframeShader || current_shader == &packedShadedWireframeShader)
+			current_shader = packed_ready ? &packedShadedWireframeShader : &shadedWireframeShader;
+		bool packed_shader = current_shader == &packedShader || current_shader == &packedShadedWireframeShader;
+		if (packed_shader != packed_active)
+		{
+			packed_active = packed_shader;
+			accumulator->Reset();
+		}
+
+		// turntable angle of the frame about to be captured
+		bool capturing = capture->IsCapturing();
+		float turntable_angle = 0.0f;
+		if (capturing && turntable_mode != 0)
+		{
+			int frames = capture->GetSettings().frameCount;
+			float angle = (frames > 0 ? 360.0f / frames : 1.0f) * capture->GetCapturedFrames();
+			if (turntable_mode == 1)
+				turntable_angle = angle;
+			else
+				light_rotation[1] = std::fmod(turntable_light_start + angle + 540.0f, 360.0f) - 180.0f;
+		}
 
 		// render
-		current_shader->Use();
-		current_shader->SetVec3("viewPos", camera.m_Position);
+		// split view draws over the whole window, captures keep the single view
+		bool split = split_view && !capturing;
+		bool analysis = analysis_mode != AnalysisMode::None && !capturing && !split;
 
 		// matrices
 		glm::mat4 model = glm::mat4(1.0f);
-		glm::mat4 projection = glm::perspective(glm::radians(camera.GetFOV()), wWidth / wHeight, 0.1f, 100.0f);
+		glm::mat4 projection = glm::perspective(glm::radians(camera.GetFOV()), capturing ? capture->GetAspect() : wWidth / wHeight, 0.1f, 100.0f);
 		glm::mat4 view = camera.GetViewMatrix();
+		// the asset's transform, the same in the shadow and the scene pass
+		glm::mat4 asset_model = glm::mat4(1.0f);
+		asset_model = glm::translate(asset_model, glm::vec3(0.0f, -0.5f, 0.0f));
+		asset_model = glm::translate(asset_model, glm::vec3(asset_translation[0], asset_translation[1], asset_translation[2]));
+		asset_model = glm::rotate(asset_model, glm::radians(turntable_angle), glm::vec3(0.0f, 1.0f, 0.0f));
+		asset_model = glm::rotate(asset_model, glm::radians(90.0f), glm::vec3(-1.0f, 0.0f, 0.0f));
+		asset_model = glm::rotate(asset_model, glm::radians(asset_rotation[0]), glm::vec3(1.0f, 0.0f, 0.0f));
+		asset_model = glm::rotate(asset_model, glm::radians(asset_rotation[1]), glm::vec3(0.0f, 1.0f, 0.0f));
+		asset_model = glm::rotate(asset_model, glm::radians(asset_rotation[2]), glm::vec3(0.0f, 0.0f, 1.0f));
+		asset_model = glm::scale(asset_model, glm::vec3(uniform_scale));
+		light_direction = GetLightDirection(light_rotation[0], light_rotation[1]);
 
-		current_shader->SetMat4("model", model);
-		current_shader->SetMat4("view", view);
-		current_shader->SetMat4("projection", projection);
+		// streamed assets page their clusters in and out for this view, the shadow pass draws the same set
+		ClusterStreamer* streamer = current_model->GetStreamer();
+		if (streamer)
+		{
+			streamer->SetBudget(static_cast<size_t>(stream_budget_mb) * 1024 * 1024);
+			streamer->Update(projection * view * asset_model, glm::vec3(glm::inverse(view * asset_model)[3]));
+		}
+
+		// a still view is refined over frames from jittered samples, any change goes back to the normal path
+		bool interacting = ImGui::IsAnyItemActive() || ImGui::IsMouseDown(ImGuiMouseButton_Left) || ImGui::IsMouseDown(ImGuiMouseButton_Right)
+			|| ImGui::IsMouseDown(ImGuiMouseButton_Middle) || environment->IsLoading() || capturing || split || analysis
+			|| (streamer && streamer->GetStats().loading > 0);
+		accumulator->Update(view, projection, asset_model, light_direction, interacting, static_cast<int>(wWidth), static_cast<int>(wHeight));
+		bool accumulating = !capturing && accumulator->IsActive();
+		// once converged the average is only shown again, nothing is drawn
+		bool draw_scene = !(accumulating && accumulator->IsConverged());
+		if (accumulating && draw_scene)
+		{
+			projection = accumulator->JitterProjection(projection);
+			light_direction = accumulator->JitterLight(light_direction);
+		}
 
 		// rendering depth to texture
 		// --------------------------
@@ -305,91 +1218,328 @@ int main(int argc, char* argv[])
 		depthShader.SetMat4("lightSpaceMatrix", lightSpaceMatrix);
 		depthShader.SetMat4("model", model);
 		glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
-		glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
+		glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO.Get());
 		glClear(GL_DEPTH_BUFFER_BIT);
 		// render scene
-		if (render_plane)
+		if (render_plane && draw_scene)
 		{
-			glBindVertexArray(VAO);
+			glBindVertexArray(VAO.Get());
 			model = glm::mat4(1.0f);
 			depthShader.SetMat4("model", model);
 			glDrawArrays(GL_TRIANGLES, 0, 6);
 		}
 
-		model = glm::mat4(1.0f);
-		model = glm::translate(model, glm::vec3(0.0f, -0.5f, 0.0f));
-		model = glm::translate(model, glm::vec3(asset_translation[0], asset_translation[1], asset_translation[2]));
-		model = glm::rotate(model, glm::radians(90.0f), glm::vec3(-1.0f, 0.0f, 0.0f));
-		model = glm::rotate(model, glm::radians(asset_rotation[0]), glm::vec3(1.0f, 0.0f, 0.0f));
-		model = glm::rotate(model, glm::radians(asset_rotation[1]), glm::vec3(0.0f, 1.0f, 0.0f));
-		model = glm::rotate(model, glm::radians(asset_rotation[2]), glm::vec3(0.0f, 0.0f, 1.0f));
-		model = glm::scale(model, glm::vec3(uniform_scale));
+		model = asset_model;
 		depthShader.SetMat4("model", model);
-		current_model->Draw(shader);
+		if (draw_scene)
+			current_model->Draw(shader);
 
 		glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
 		// rendering scene
 		// ---------------
 
-		// reset viewport
-		glViewport(0, 0, wWidth, wHeight);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		// reset viewport, captures and scaled scenes are drawn into their own targets
+		bool scaled = !capturing && !accumulating && !split && !analysis && dynamic_resolution->IsEnabled();
+		if (capturing)
+			capture->BeginFrame();
+		else if (accumulating)
+		{
+			if (draw_scene)
+				accumulator->BeginSample();
+		}
+		else if (scaled)
+			dynamic_resolution->BeginScene(static_cast<int>(wWidth), static_cast<int>(wHeight));
+		else
+		{
+			glViewport(0, 0, wWidth, wHeight);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		}
 
-		current_shader->Use();
-		current_shader->SetMat4("lightSpaceMatrix", lightSpaceMatrix);
+		// light, shadow and environment settings only change per frame, every shader drawn with is set up once
+		auto setup_scene_shader = [&](Shader& scene_shader)
+		{
+			scene_shader.Use();
+			scene_shader.SetMat4("lightSpaceMatrix", lightSpaceMatrix);
+
+			scene_shader.SetFloat("lightIntensity", light_intensity);
+			scene_shader.SetFloat("ambientIntensity", ambient_intensity);
+			scene_shader.SetFloat("specularIntensity", specular_intensity);
+			scene_shader.SetFloat("material.shininess", shininess);
+			scene_shader.SetVec3("light.diffuse", light_color[0], light_color[1], light_color[2]);
+			scene_shader.SetInt("renderShadows", render_shadows);
+
+			scene_shader.SetVec3("light.direction", light_direction);
+			scene_shader.SetVec3("lightDirection", light_direction);
+			scene_shader.SetVec3("wire_color", wire_color[0], wire_color[1], wire_color[2]);
+
+			environment->Apply(scene_shader, 4, 5, use_ibl, environment_intensity);
+			lights->Apply(scene_shader, 6);
+		};
+		// the plane and the asset, seen through the bound range of the camera buffer
+		auto draw_scene_view = [&](Shader& scene_shader)
+		{
+			scene_shader.Use();
+			bool packed = &scene_shader == &packedShader || &scene_shader == &packedShadedWireframeShader;
 
-		current_shader->SetFloat("lightIntensity", light_intensity);
-		current_shader->SetFloat("ambientIntensity", ambient_intensity);
-		current_shader->SetFloat("specularIntensity", specular_intensity);
-		current_shader->SetFloat("material.shininess", shininess);
-		current_shader->SetVec3("light.diffuse", light_color[0], light_color[1], light_color[2]);
-		current_shader->SetInt("renderShadows", render_shadows);
+			glActiveTexture(GL_TEXTURE3);
+			glBindTexture(GL_TEXTURE_2D, depthMap.Get());
 
-		light_direction = GetLightDirection(light_rotation[0], light_rotation[1]);
-		current_shader->SetVec3("light.direction", light_direction);
-		current_shader->SetVec3("lightDirection", light_direction);
-		current_shader->SetVec3("wire_color", wire_color[0], wire_color[1], wire_color[2]);
+			if (packed)
+				palette->BindMaterial(scene_shader, stone_floor_diffuse, packed_floor[0], packed_floor[1]);
+			else
+				palette->BindMaterial(scene_shader, stone_floor_diffuse, stone_floor_roughness, empty_normal);
+
+			if (render_plane && draw_scene)
+			{
+				glBindVertexArray(VAO.Get());
+				scene_shader.SetMat4("model", glm::mat4(1.0f));
+				// the overlay is meant for the asset, the plane keeps its edges in wireframe mode only
+				scene_shader.SetFloat("wireWidth", &scene_shader == &wireframeShader ? wire_width : 0.0f);
+				glDrawArrays(GL_TRIANGLES, 0, 6);
+			}
+
+			if (packed)
+				palette->BindMaterial(scene_shader, material_maps[0], packed_maps[0], packed_maps[1]);
+			else
+				palette->BindMaterial(scene_shader, material_maps[0], material_maps[1], material_maps[2]);
+			scene_shader.SetFloat("wireWidth", wire_width);
+
+			scene_shader.SetMat4("model", asset_model);
+			if (draw_scene)
+				current_model->Draw(scene_shader);
+		};
+		// the same plane and asset through the analysis shader, overdraw counts into its own target and is shown as a heat map
+		auto draw_analysis_view = [&]()
+		{
+			SetLitMode();
+			// the difference heat map has its own shader and leaves out the plane, which has nothing to compare
+			if (analysis_mode == AnalysisMode::Difference)
+			{
+				differenceShader.Use();
+				differenceShader.SetMat4("model", asset_model);
+				geometry_diff->Apply(differenceShader, 0, geometry_diff->Matches(*current_model, model_generation) ? diff_range : 0.0f);
+				for (size_t i = 0; i < current_model->meshes.size(); i++)
+				{
+					geometry_diff->SetMesh(differenceShader, i);
+					current_model->meshes[i].Draw(differenceShader);
+				}
+				if (current_shader == &wireframeShader)
+					SetWireframeMode();
+				return;
+			}
+			if (analysis_mode == AnalysisMode::Overdraw)
+				analysis_view->BeginOverdraw(static_cast<int>(wWidth), static_cast<int>(wHeight));
+			analysisShader.Use();
+			analysisShader.SetInt("analysisMode", static_cast<int>(analysis_mode));
+			analysisShader.SetFloat("meshCost", 0.0f);
+
+			palette->BindMaterial(analysisShader, stone_floor_diffuse, stone_floor_roughness, empty_normal);
+			if (render_plane)
+			{
+				glBindVertexArray(VAO.Get());
+				analysisShader.SetMat4("model", glm::mat4(1.0f));
+				glDrawArrays(GL_TRIANGLES, 0, 6);
+			}
 
-		glActiveTexture(GL_TEXTURE3);
-		glBindTexture(GL_TEXTURE_2D, depthMap);
+			palette->BindMaterial(analysisShader, material_maps[0], material_maps[1], material_maps[2]);
+			analysisShader.SetMat4("model", asset_model);
+			if (analysis_mode == AnalysisMode::DrawCost && !current_model->meshes.empty())
+			{
+				unsigned int most_triangles = 1;
+				for (const Mesh& mesh : current_model->meshes)
+					most_triangles = std::max(most_triangles, mesh.GetIndexCount() / 3);
+				for (Mesh& mesh : current_model->meshes)
+				{
+					analysisShader.SetFloat("meshCost", static_cast<float>(mesh.GetIndexCount() / 3) / most_triangles);
+					mesh.Draw(analysisShader);
+				}
+			}
+			else
+				current_model->Draw(analysisShader);
 
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, stone_floor_diffuse);
-		glActiveTexture(GL_TEXTURE1);
-		glBindTexture(GL_TEXTURE_2D, stone_floor_roughness);
-		glActiveTexture(GL_TEXTURE2);
-		glBindTexture(GL_TEXTURE_2D, empty_normal);
+			if (analysis_mode == AnalysisMode::Overdraw)
+				analysis_view->EndOverdraw(overdrawShader, max_overdraw);
+			if (current_shader == &wireframeShader)
+				SetWireframeMode();
+		};
 
-		if (render_plane)
+		if (!split)
 		{
-			glBindVertexArray(VAO);
-			model = glm::mat4(1.0f);
-			current_shader->SetMat4("model", model);
-			glDrawArrays(GL_TRIANGLES, 0, 6);
+			glm::vec2 viewport_size(wWidth, wHeight);
+			if (capturing)
+				viewport_size = glm::vec2(static_cast<float>(capture->GetSettings().width), static_cast<float>(capture->GetSettings().height));
+			else if (scaled)
+				viewport_size = glm::vec2(static_cast<float>(dynamic_resolution->GetRenderWidth()), static_cast<float>(dynamic_resolution->GetRenderHeight()));
+			camera_uniforms.Set({ view, projection, camera.m_Position, viewport_size });
+			if (analysis)
+				draw_analysis_view();
+			else
+			{
+				lights->Update(view, projection);
+				setup_scene_shader(*current_shader);
+				draw_scene_view(*current_shader);
+			}
+		}
+		else
+		{
+			// the viewports tile the window left of the settings panel, 2 or 3 in a row or 2x2
+			int columns = split_count == 4 ? 2 : split_count;
+			int rows = split_count == 4 ? 2 : 1;
+			float cell_width = std::max(wWidth - 425.0f, static_cast<float>(columns)) / columns;
+			float cell_height = wHeight / rows;
+			float orbit_yaw, orbit_pitch, orbit_radius;
+			camera.GetOrbit(orbit_yaw, orbit_pitch, orbit_radius);
+
+			struct SplitViewport
+			{
+				int x = 0, y = 0, width = 1, height = 1;
+				glm::mat4 view, projection;
+				Shader* shader = nullptr;
+				int camera = 0;
+			};
+			SplitViewport viewports[4];
+			camera_uniforms.Clear();
+			for (int i = 0; i < split_count; i++)
+			{
+				SplitViewport& viewport = viewports[i];
+				int column = i % columns, row = i / columns;
+				viewport.x = static_cast<int>(column * cell_width);
+				viewport.width = std::max(static_cast<int>((column + 1) * cell_width) - viewport.x, 1);
+				// GL counts rows from the bottom, the first row is the top one
+				viewport.y = static_cast<int>(wHeight - (row + 1) * cell_height);
+				viewport.height = std::max(static_cast<int>(wHeight - row * cell_height) - viewport.y, 1);
+
+				// the fixed views orbit the origin at the main camera's distance
+				glm::vec3 position = camera.m_Position;
+				viewport.view = view;
+				if (split_camera[i] != 0)
+				{
+					const glm::vec3 directions[3] = { glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f) };
+					position = directions[split_camera[i] - 1] * orbit_radius;
+					viewport.view = glm::lookAt(position, glm::vec3(0.0f), split_camera[i] == 3 ? glm::vec3(0.0f, 0.0f, -1.0f) : glm::vec3(0.0f, 1.0f, 0.0f));
+				}
+				viewport.projection = glm::perspective(glm::radians(camera.GetFOV()), static_cast<float>(viewport.width) / viewport.height, 0.1f, 100.0f);
+				viewport.camera = camera_uniforms.Add({ viewport.view, viewport.projection, position, glm::vec2(viewport.width, viewport.height) });
+
+				if (split_shading[i] == 1)
+					viewport.shader = &wireframeShader;
+				else if (split_shading[i] == 2)
+					viewport.shader = &unlitShader;
+				else if (packed_ready)
+					viewport.shader = wireframe_overlay ? &packedShadedWireframeShader : &packedShader;
+				else
+					viewport.shader = wireframe_overlay ? &shadedWireframeShader : &shader;
+			}
+			// one upload for all cameras, and each shader gets its light settings once however many viewports use it
+			camera_uniforms.Upload();
+			Shader* prepared[4] = {};
+			int prepared_count = 0;
+			for (int i = 0; i < split_count; i++)
+			{
+				if (std::find(prepared, prepared + prepared_count, viewports[i].shader) != prepared + prepared_count)
+					continue;
+				setup_scene_shader(*viewports[i].shader);
+				prepared[prepared_count++] = viewports[i].shader;
+			}
+
+			glEnable(GL_SCISSOR_TEST);
+			for (int i = 0; i < split_count; i++)
+			{
+				const SplitViewport& viewport = viewports[i];
+				glViewport(viewport.x, viewport.y, viewport.width, viewport.height);
+				glScissor(viewport.x, viewport.y, viewport.width, viewport.height);
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+				if (viewport.shader == &wireframeShader)
+					SetWireframeMode();
+				else
+					SetLitMode();
+
+				camera_uniforms.Bind(viewport.camera);
+				// the froxel grid follows this viewport's projection, its depth slicing is set again for the shader
+				lights->Update(viewport.view, viewport.projection);
+				viewport.shader->Use();
+				lights->Apply(*viewport.shader, 6);
+				draw_scene_view(*viewport.shader);
+				if (show_skybox && draw_scene)
+					environment->DrawSkybox(skyboxShader, viewport.view, viewport.projection, environment_intensity, skybox_blur);
+
+				std::string label = std::string(split_camera_names[split_camera[i]]) + ", " + split_shading_names[split_shading[i]];
+				ImGui::GetBackgroundDrawList()->AddText(ImVec2(viewport.x + 8.0f, wHeight - viewport.y - 24.0f),
+					IM_COL32(255, 255, 255, 200), label.c_str());
+			}
+			glDisable(GL_SCISSOR_TEST);
+
+			// back to the state of the mode buttons
+			if (current_shader == &wireframeShader)
+				SetWireframeMode();
+			else
+				SetLitMode();
+			glViewport(0, 0, wWidth, wHeight);
+		}
+
+		// the cursor ray is moved into model space and traced against the picking BVHs
+		glm::mat4 model_to_clip = projection * view * asset_model;
+		// the window shows a capture letterboxed and split view several cameras, clicks don't map onto them
+		if (capturing || split)
+			pick_requested = false;
+		if (pick_requested)
+		{
+			pick_requested = false;
+			glm::vec2 ndc(2.0f * static_cast<float>(pick_x) / wWidth - 1.0f, 1.0f - 2.0f * static_cast<float>(pick_y) / wHeight);
+			glm::mat4 clip_to_model = glm::inverse(model_to_clip);
+			glm::vec4 near_point = clip_to_model * glm::vec4(ndc, -1.0f, 1.0f);
+			glm::vec4 far_point = clip_to_model * glm::vec4(ndc, 1.0f, 1.0f);
+			glm::vec3 ray_origin = glm::vec3(near_point) / near_point.w;
+			glm::vec3 ray_direction = glm::vec3(far_point) / far_point.w - ray_origin;
+			has_pick = current_model->Raycast(ray_origin, ray_direction, picked_hit);
+			if (has_pick && measure_mode)
+			{
+				if (measure_points.size() == 2)
+					measure_points.clear();
+				measure_points.push_back(picked_hit.position);
+			}
+		}
+
+		// picked triangle and measurement drawn over the scene
+		auto to_screen = [&](const glm::vec3& point, ImVec2& screen)
+		{
+			glm::vec4 clip = model_to_clip * glm::vec4(point, 1.0f);
+			if (clip.w <= 0.0f || capturing || split)
+				return false;
+			screen = ImVec2((clip.x / clip.w * 0.5f + 0.5f) * wWidth, (0.5f - clip.y / clip.w * 0.5f) * wHeight);
+			return true;
+		};
+		ImDrawList* overlay = ImGui::GetBackgroundDrawList();
+		ImVec2 corners[3];
+		if (has_pick && to_screen(picked_hit.vertices[0], corners[0]) && to_screen(picked_hit.vertices[1], corners[1]) && to_screen(picked_hit.vertices[2], corners[2]))
+			overlay->AddPolyline(corners, 3, IM_COL32(255, 190, 0, 255), ImDrawFlags_Closed, 2.0f);
+		ImVec2 measure_screen[2];
+		bool measure_visible[2] = { false, false };
+		for (size_t i = 0; i < measure_points.size(); i++)
+		{
+			measure_visible[i] = to_screen(measure_points[i], measure_screen[i]);
+			if (measure_visible[i])
+				overlay->AddCircleFilled(measure_screen[i], 4.0f, IM_COL32(0, 200, 255, 255));
+		}
+		if (measure_visible[0] && measure_visible[1])
+			overlay->AddLine(measure_screen[0], measure_screen[1], IM_COL32(0, 200, 255, 255), 2.0f);
+
+		if (show_skybox && draw_scene && !split && !analysis)
+			environment->DrawSkybox(skyboxShader, view, projection, environment_intensity, skybox_blur);
+
+		// starts the readback and shows the captured frame in the window
+		if (capturing)
+			capture->EndFrame(static_cast<int>(wWidth), static_cast<int>(wHeight));
+		else if (accumulating)
+		{
+			if (draw_scene)
+				accumulator->EndSample(accumulateShader);
+			accumulator->Present(accumulateShader);
 		}
+		else if (scaled)
+			dynamic_resolution->EndScene(upscaleShader);
 
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, diffuse_map);
-		glActiveTexture(GL_TEXTURE1);
-		glBindTexture(GL_TEXTURE_2D, roughness_map);
-		glActiveTexture(GL_TEXTURE2);
-		glBindTexture(GL_TEXTURE_2D, normal_map);
-
-		model = glm::mat4(1.0f);
-		model = glm::translate(model, glm::vec3(0.0f, -0.5f, 0.0f));
-		model = glm::translate(model, glm::vec3(asset_translation[0], asset_translation[1], asset_translation[2]));
-		model = glm::rotate(model, glm::radians(90.0f), glm::vec3(-1.0f, 0.0f, 0.0f));
-		model = glm::rotate(model, glm::radians(asset_rotation[0]), glm::vec3(1.0f, 0.0f, 0.0f));
-		model = glm::rotate(model, glm::radians(asset_rotation[1]), glm::vec3(0.0f, 1.0f, 0.0f));
-		model = glm::rotate(model, glm::radians(asset_rotation[2]), glm::vec3(0.0f, 0.0f, 1.0f));
-		model = glm::scale(model, glm::vec3(uniform_scale));
-		current_shader->SetMat4("model", model);
-		current_model->Draw(*current_shader);
-
-		ImTextureRef ref_button_lit((ImTextureID)(intptr_t)lit_icon);
-		ImTextureRef ref_button_wireframe((ImTextureID)(intptr_t)wireframe_icon);
-		ImTextureRef ref_button_unlit((ImTextureID)(intptr_t)unlit_icon);
 		ImVec4 wireframe_icon_tint = ImVec4(1.0f - background_color[0], 1.0f - background_color[1], 1.0f - background_color[2], 1);
 
 		{
@@ -402,18 +1552,32 @@ int main(int argc, char* argv[])
 			ImGui::PushStyleColor(ImGuiCol_Button, ImVec4(0, 0, 0, 0));
 			ImGui::PushStyleColor(ImGuiCol_ButtonHovered, ImVec4(0, 0, 0, 0));
 			ImGui::PushStyleColor(ImGuiCol_ButtonActive, ImVec4(0, 0, 0, 0));
-			if (ImGui::ImageButton("button_lit", ref_button_lit, ImVec2(32, 32)))
+			// text until the icon is uploaded
+			auto mode_button = [&](const char* id, const char* label, const GLTexture& icon)
+			{
+				if (icon)
+					return ImGui::ImageButton(id, ImTextureRef((ImTextureID)(intptr_t)icon.Get()), ImVec2(32, 32));
+				ImGui::PushStyleColor(ImGuiCol_Text, wireframe_icon_tint);
+				ImGui::PushID(id);
+				bool pressed = ImGui::Button(label, ImVec2(0, 38));
+				ImGui::PopID();
+				ImGui::PopStyleColor();
+				return pressed;
+			};
+			if (mode_button("button_lit", "Lit", icons[0]))
 			{
+				analysis_mode = AnalysisMode::None;
 				SetLitMode();
-				current_shader = &shader;
+				current_shader = wireframe_overlay ? &shadedWireframeShader : &shader;
 			}
 			if (ImGui::IsItemHovered())
 			{
 				cursor = ImGuiMouseCursor_Hand;
 			}
 			ImGui::SameLine();
-			if (ImGui::ImageButton("button_wireframe", ref_button_wireframe, ImVec2(32, 32)))
+			if (mode_button("button_wireframe", "Wireframe", icons[1]))
 			{
+				analysis_mode = AnalysisMode::None;
 				SetWireframeMode();
 				current_shader = &wireframeShader;
 			}
@@ -422,8 +1586,9 @@ int main(int argc, char* argv[])
 				cursor = ImGuiMouseCursor_Hand;
 			}
 			ImGui::SameLine();
-			if (ImGui::ImageButton("button_unlit", ref_button_unlit, ImVec2(32, 32)))
+			if (mode_button("button_unlit", "Unlit", icons[2]))
 			{
+				analysis_mode = AnalysisMode::None;
 				SetLitMode();
 				current_shader = &unlitShader;
 			}
@@ -432,10 +1597,147 @@ int main(int argc, char* argv[])
 				cursor = ImGuiMouseCursor_Hand;
 			}
 
+			// analysis modes replace the shading mode until they are clicked again or a mode above is picked
+			for (int mode = 1; mode < static_cast<int>(AnalysisMode::Count); mode++)
+			{
+				ImGui::SameLine();
+				bool active = static_cast<int>(analysis_mode) == mode;
+				ImGui::PushStyleColor(ImGuiCol_Text, active ? ImVec4(1.0f, 0.75f, 0.0f, 1.0f) : wireframe_icon_tint);
+				if (ImGui::Button(GetAnalysisModeName(static_cast<AnalysisMode>(mode)), ImVec2(0, 38)))
+					analysis_mode = active ? AnalysisMode::None : static_cast<AnalysisMode>(mode);
+				ImGui::PopStyleColor();
+				if (ImGui::IsItemHovered())
+					cursor = ImGuiMouseCursor_Hand;
+			}
+
 			ImGui::PopStyleColor(3);
 
 			ImGui::End();
 		}
+
+		// legend of the analysis mode: the colour ramp and the numbers behind it
+		if (analysis)
+		{
+			ImGui::SetNextWindowPos(ImVec2(10.0f, wHeight - 10.0f), ImGuiCond_Always, ImVec2(0.0f, 1.0f));
+			ImGui::Begin("##analysis_legend", nullptr, ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoTitleBar | ImGuiWindowFlags_NoResize
+				| ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoCollapse);
+			ImGui::Text("%s", GetAnalysisModeName(analysis_mode));
+
+			const float ramp_width = 260.0f;
+			auto draw_ramp = [ramp_width](const char* low, const char* middle, const char* high, glm::vec3 (*color)(float) = AnalysisView::HeatColor)
+			{
+				ImDrawList* draw_list = ImGui::GetWindowDrawList();
+				ImVec2 origin = ImGui::GetCursorScreenPos();
+				const int steps = 32;
+				for (int i = 0; i < steps; i++)
+				{
+					glm::vec3 left = color(static_cast<float>(i) / steps);
+					glm::vec3 right = color(static_cast<float>(i + 1) / steps);
+					ImU32 left_color = ImGui::ColorConvertFloat4ToU32(ImVec4(left.r, left.g, left.b, 1.0f));
+					ImU32 right_color = ImGui::ColorConvertFloat4ToU32(ImVec4(right.r, right.g, right.b, 1.0f));
+					draw_list->AddRectFilledMultiColor(ImVec2(origin.x + ramp_width * i / steps, origin.y),
+						ImVec2(origin.x + ramp_width * (i + 1) / steps, origin.y + 14.0f), left_color, right_color, right_color, left_color);
+				}
+				ImGui::Dummy(ImVec2(ramp_width, 14.0f));
+				float line_start = ImGui::GetCursorPosX();
+				ImGui::Text("%s", low);
+				ImGui::SameLine(line_start + (ramp_width - ImGui::CalcTextSize(middle).x) * 0.5f);
+				ImGui::Text("%s", middle);
+				ImGui::SameLine(line_start + ramp_width - ImGui::CalcTextSize(high).x);
+				ImGui::Text("%s", high);
+			};
+
+			unsigned int asset_triangles = current_model->GetIndexCount() / 3;
+			if (streamer)
+				asset_triangles = static_cast<unsigned int>(streamer->GetStats().drawnTriangles);
+			if (analysis_mode == AnalysisMode::Overdraw)
+			{
+				std::string middle = std::to_string(static_cast<int>((1.0f + max_overdraw) * 0.5f)) + "x";
+				std::string high = std::to_string(static_cast<int>(max_overdraw)) + "x+";
+				draw_ramp("1x", middle.c_str(), high.c_str());
+				ImGui::SetNextItemWidth(ramp_width);
+				ImGui::SliderFloat("##max_overdraw", &max_overdraw, 2.0f, 32.0f, "red at %.0f layers");
+				ImGui::Text("%.2f fragments per window pixel", analysis_view->GetAverageOverdraw());
+			}
+			else if (analysis_mode == AnalysisMode::TriangleDensity)
+			{
+				draw_ramp("1/256", "1/16", "1+ per pixel");
+				ImGui::Text("%u triangles, %u vertices", asset_triangles, current_model->GetVertexCount());
+				ImGui::TextDisabled("red triangles are pixel sized, a LOD or less tessellation helps");
+			}
+			else if (analysis_mode == AnalysisMode::TexelDensity)
+			{
+				draw_ramp("1/8", "1 texel", "8+ per pixel");
+				ImGui::TextDisabled("blue is magnified (blurry), red is minified (larger than needed here)");
+			}
+			else if (analysis_mode == AnalysisMode::DrawCost)
+			{
+				draw_ramp("0%", "50%", "100% of largest");
+				const std::vector<Mesh>& meshes = current_model->meshes;
+				ImGui::Text("%zu meshes (draw calls), %u triangles", meshes.size(), asset_triangles);
+				// the most expensive meshes, by triangles
+				std::vector<size_t> order(meshes.size());
+				for (size_t i = 0; i < order.size(); i++)
+					order[i] = i;
+				size_t shown = std::min<size_t>(order.size(), 5);
+				std::partial_sort(order.begin(), order.begin() + shown, order.end(),
+					[&meshes](size_t a, size_t b) { return meshes[a].GetIndexCount() > meshes[b].GetIndexCount(); });
+				unsigned int most_triangles = shown > 0 ? std::max(meshes[order[0]].GetIndexCount() / 3, 1u) : 1;
+				for (size_t i = 0; i < shown; i++)
+				{
+					const Mesh& mesh = meshes[order[i]];
+					unsigned int triangles = mesh.GetIndexCount() / 3;
+					glm::vec3 color = AnalysisView::HeatColor(static_cast<float>(triangles) / most_triangles);
+					ImGui::ColorButton(("##mesh_cost" + std::to_string(i)).c_str(), ImVec4(color.r, color.g, color.b, 1.0f),
+						ImGuiColorEditFlags_NoTooltip, ImVec2(12, 12));
+					ImGui::SameLine();
+					ImGui::Text("%s  %u triangles (%.1f%%)", mesh.name.empty() ? "(unnamed)" : mesh.name.c_str(), triangles,
+						asset_triangles > 0 ? 100.0f * triangles / asset_triangles : 0.0f);
+				}
+			}
+			else if (analysis_mode == AnalysisMode::Difference)
+			{
+				// the ramp runs from -range (inside the reference) to +range
+				char low[32], high[32];
+				std::snprintf(low, sizeof(low), "-%.3g", diff_range);
+				std::snprintf(high, sizeof(high), "+%.3g", diff_range);
+				draw_ramp(low, "0", high, [](float t) { return GeometryDiff::DiffColor(t * 2.0f - 1.0f); });
+
+				ImGui::SetNextItemWidth(ramp_width - ImGui::CalcTextSize("Compare").x - ImGui::GetStyle().FramePadding.x * 2.0f
+					- ImGui::GetStyle().ItemSpacing.x);
+				bool compare = ImGui::InputTextWithHint("##diff_reference", "reference asset path", diff_path_buffer, sizeof(diff_path_buffer),
+					ImGuiInputTextFlags_EnterReturnsTrue);
+				ImGui::SameLine();
+				compare |= ImGui::Button("Compare");
+				if (compare && diff_path_buffer[0] != '\0' && !current_model->meshes.empty())
+					geometry_diff->Start(*current_model, model_generation, diff_path_buffer, import_preset);
+
+				if (geometry_diff->IsBusy())
+					ImGui::Text("Comparing...");
+				else if (!geometry_diff->GetError().empty())
+					ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "%s", geometry_diff->GetError().c_str());
+				if (geometry_diff->HasResult() && !geometry_diff->Matches(*current_model, model_generation))
+					ImGui::TextDisabled("the asset changed since the comparison, compare again");
+				else if (geometry_diff->HasResult())
+				{
+					const GeometryDiff::Stats& diff_stats = geometry_diff->GetStats();
+					float diagonal = std::max(diff_stats.referenceDiagonal, 1e-6f);
+					ImGui::SetNextItemWidth(ramp_width);
+					ImGui::SliderFloat("##diff_range", &diff_range, diagonal * 1e-6f, std::max(diff_stats.maxDistance, diagonal * 0.1f),
+						"saturated at %.4g", ImGuiSliderFlags_Logarithmic);
+					ImGui::Text("%s", std::filesystem::path(geometry_diff->GetReferencePath()).filename().string().c_str());
+					ImGui::Text("Hausdorff %.4g (%.3f%% of the reference size)", diff_stats.hausdorff, 100.0f * diff_stats.hausdorff / diagonal);
+					ImGui::Text("to the reference: max %.4g, mean %.4g, RMS %.4g", diff_stats.maxDistance, diff_stats.meanDistance, diff_stats.rmsDistance);
+					ImGui::Text("p50 %.4g  p95 %.4g  p99 %.4g", diff_stats.p50, diff_stats.p95, diff_stats.p99);
+					ImGui::Text("from the reference: max %.4g, mean %.4g", diff_stats.reverseMaxDistance, diff_stats.reverseMeanDistance);
+					ImGui::Text("%.1f%% of the vertices unchanged", 100.0f * diff_stats.unchanged);
+					ImGui::TextDisabled("%zu against %zu triangles, BVHs %.0f ms, queries %.0f ms", diff_stats.triangles, diff_stats.referenceTriangles,
+						diff_stats.buildMilliseconds, diff_stats.queryMilliseconds);
+				}
+				ImGui::TextDisabled("blue is inside the reference, red is outside");
+			}
+			ImGui::End();
+		}
 		// ImGui window
 		{
 			float windowWidth = 425.0f;  // ka panelu
@@ -452,16 +1754,8 @@ int main(int argc, char* argv[])
 
 				if (newPath != diffuse_map_path)
 				{
-					unsigned int newTexture = loadTexture(newPath.c_str(), true);
-					if (newTexture != 0)
-					{
-						// uvolni starou texturu, pokud existuje
-						if (diffuse_map != 0)
-							glDeleteTextures(1, &diffuse_map);
-
-						diffuse_map = newTexture;
-						diffuse_map_path = newPath;
-					}
+					requested_maps[0] = palette->Add(newPath, true);
+					diffuse_map_path = newPath;
 				}
 			}
 			if (ImGui::InputText("Roughness map path", roughness_path_buffer, sizeof(roughness_path_buffer), ImGuiInputTextFlags_EnterReturnsTrue))
@@ -470,15 +1764,8 @@ int main(int argc, char* argv[])
 
 				if (newPath != roughness_map_path)
 				{
-					unsigned int newTexture = loadTexture(newPath.c_str(), false);
-					if (newTexture != 0)
-					{
-						if (roughness_map != 0)
-							glDeleteTextures(1, &roughness_map);
-
-						roughness_map = newTexture;
-						roughness_map_path = newPath;
-					}
+					requested_maps[1] = palette->Add(newPath, false);
+					roughness_map_path = newPath;
 				}
 			}
 			if (ImGui::InputText("Normal map path", normal_path_buffer, sizeof(normal_path_buffer), ImGuiInputTextFlags_EnterReturnsTrue))
@@ -487,20 +1774,36 @@ int main(int argc, char* argv[])
 
 				if (newPath != normal_map_path)
 				{
-					unsigned int newTexture = loadTexture(newPath.c_str(), false);
-					if (newTexture != 0)
-					{
-						if (normal_map != 0)
-							glDeleteTextures(1, &normal_map);
-
-						normal_map = newTexture;
-						normal_map_path = newPath;
-					}
+					requested_maps[2] = palette->Add(newPath, false);
+					normal_map_path = newPath;
 				}
 			}
 
 			ImGui::Text("");
 
+			ImGui::Text("Texture palette");
+			for (int i = 0; i < 3; i++)
+			{
+				if (i > 0)
+					ImGui::SameLine();
+				ImGui::RadioButton(material_map_names[i], &palette_slot, i);
+			}
+			if (ImGui::InputText("Add folder", palette_directory_buffer, sizeof(palette_directory_buffer), ImGuiInputTextFlags_EnterReturnsTrue))
+				palette->AddDirectory(palette_directory_buffer);
+
+			ImGui::BeginChild("palette_grid", ImVec2(0, 180), ImGuiChildFlags_Borders);
+			int picked = palette->DrawGrid(requested_maps[palette_slot], 48.0f);
+			if (picked >= 0)
+			{
+				// the slot decides the colour space, a texture picked for the other one is loaded again in that space
+				const TexturePalette::Entry& entry = palette->GetEntry(picked);
+				requested_maps[palette_slot] = entry.srgb == material_map_srgb[palette_slot] ? picked : palette->Add(entry.path, material_map_srgb[palette_slot]);
+				palette->MakeResident(requested_maps[palette_slot]);
+			}
+			ImGui::EndChild();
+
+			ImGui::Text("");
+
 			ImGui::Text("Light");
 			ImGui::SliderFloat("Intensity", &light_intensity, 0.0f, 3.0f, "%.2f");
 			ImGui::SliderFloat("Ambient intensity", &ambient_intensity, 0.0f, 3.0f, "%.2f");
@@ -512,20 +1815,346 @@ int main(int argc, char* argv[])
 			ImGui::SetCursorPosX(265);
 			ImGui::Checkbox("Shadows", &render_shadows);
 
+			// point and spot lights, any change restarts the refinement
+			std::vector<SceneLight>& scene_lights = lights->GetLights();
+			bool lights_changed = false;
+			if (ImGui::Button("Add point light"))
+			{
+				SceneLight light;
+				light.position = glm::vec3(0.0f, 1.5f, 1.0f);
+				light.range = 3.0f;
+				scene_lights.push_back(light);
+				selected_light = static_cast<int>(scene_lights.size()) - 1;
+				lights_changed = true;
+			}
+			ImGui::SameLine();
+			if (ImGui::Button("Add spot light"))
+			{
+				SceneLight light;
+				light.type = LightType::Spot;
+				light.position = glm::vec3(0.0f, 3.0f, 0.0f);
+				light.range = 5.0f;
+				light.intensity = 4.0f;
+				scene_lights.push_back(light);
+				selected_light = static_cast<int>(scene_lights.size()) - 1;
+				lights_changed = true;
+			}
+			ImGui::SameLine();
+			if (ImGui::Button("Clear lights"))
+			{
+				scene_lights.clear();
+				lights_changed = true;
+			}
+			ImGui::SetNextItemWidth(150);
+			ImGui::SliderInt("##scatter_light_count", &scatter_light_count, 16, 1024);
+			ImGui::SameLine();
+			if (ImGui::Button("Scatter lights"))
+			{
+				scatter_lights(scatter_light_count);
+				lights_changed = true;
+			}
+			if (!scene_lights.empty())
+			{
+				selected_light = std::clamp(selected_light, 0, static_cast<int>(scene_lights.size()) - 1);
+				ImGui::SliderInt("Selected light", &selected_light, 0, static_cast<int>(scene_lights.size()) - 1);
+				selected_light = std::clamp(selected_light, 0, static_cast<int>(scene_lights.size()) - 1);
+				SceneLight& light = scene_lights[selected_light];
+				lights_changed |= ImGui::DragFloat3("Position", &light.position[0], 0.05f);
+				lights_changed |= ImGui::ColorEdit3("Light color", &light.color[0]);
+				lights_changed |= ImGui::SliderFloat("Light intensity", &light.intensity, 0.0f, 20.0f, "%.2f");
+				lights_changed |= ImGui::SliderFloat("Range", &light.range, 0.1f, 20.0f, "%.2f");
+				if (light.type == LightType::Spot)
+				{
+					lights_changed |= ImGui::SliderFloat3("Direction", &light.direction[0], -1.0f, 1.0f, "%.2f");
+					lights_changed |= ImGui::SliderFloat("Inner angle", &light.innerAngle, 0.0f, light.outerAngle, "%.1f");
+					lights_changed |= ImGui::SliderFloat("Outer angle", &light.outerAngle, 1.0f, 89.0f, "%.1f");
+				}
+				if (ImGui::Button("Remove light"))
+				{
+					scene_lights.erase(scene_lights.begin() + selected_light);
+					lights_changed = true;
+				}
+				const ClusteredLighting::Stats& light_stats = lights->GetStats();
+				ImGui::Text("%zu lights, %zu in view, %zu froxel entries (max %zu), %.2f ms", light_stats.lights, light_stats.visible,
+					light_stats.assignments, light_stats.maxPerCluster, light_stats.buildMilliseconds);
+			}
+			if (lights_changed)
+				accumulator->Reset();
+
+			ImGui::Text("");
+
+			ImGui::Text("Environment");
+			if (ImGui::InputText("HDR environment path", environment_path_buffer, sizeof(environment_path_buffer), ImGuiInputTextFlags_EnterReturnsTrue))
+			{
+				std::string newPath = environment_path_buffer;
+				if (std::filesystem::exists(newPath))
+				{
+					environment->Load(newPath);
+					if (std::find(recent_environments.begin(), recent_environments.end(), newPath) == recent_environments.end())
+						recent_environments.push_back(newPath);
+				}
+				else
+					std::cerr << "Environment not found: " << newPath << std::endl;
+			}
+			// baked environments come from the disk cache, switching between them is instant
+			if (!recent_environments.empty() && ImGui::BeginCombo("Recent", environment->GetPath().c_str()))
+			{
+				for (const std::string& path : recent_environments)
+				{
+					if (ImGui::Selectable(path.c_str(), path == environment->GetPath()))
+						environment->Load(path);
+				}
+				ImGui::EndCombo();
+			}
+			if (environment->IsLoading())
+				ImGui::Text("Baking environment...");
+			ImGui::SliderFloat("Environment intensity", &environment_intensity, 0.0f, 3.0f, "%.2f");
+			ImGui::SliderFloat("Skybox blur", &skybox_blur, 0.0f, 1.0f, "%.2f");
+			ImGui::Checkbox("Image based lighting", &use_ibl);
+			ImGui::SameLine();
+			ImGui::SetCursorPosX(265);
+			ImGui::Checkbox("Skybox", &show_skybox);
+
 			ImGui::Text("");
 
 			ImGui::Text("Asset");
 			ImGui::DragFloat3("Translation", &asset_translation[0], 0.01f, -10.0f, 10.0f, "%.2f");
 			ImGui::DragFloat3("Rotation", &asset_rotation[0], 0.25f, -180.0f, 180.0f, "%.2f");
 			ImGui::DragFloat("Scale", &uniform_scale, 0.01f, 0.1f, 10.0f, "%.2f");
+			int preset_index = static_cast<int>(import_preset);
+			if (ImGui::Combo("Import preset", &preset_index, preset_names, static_cast<int>(ImportPreset::Count)))
+			{
+				import_preset = static_cast<ImportPreset>(preset_index);
+				load_asset();
+			}
+			if (ImGui::Button("Compare presets"))
+			{
+				preset_queue.clear();
+				for (int i = 0; i < static_cast<int>(ImportPreset::Count); i++)
+				{
+					if (i != preset_index)
+						preset_queue.push_back(static_cast<ImportPreset>(i));
+				}
+				start_preset_import();
+			}
+			if (preset_import.valid())
+			{
+				ImGui::SameLine();
+				ImGui::TextUnformatted("Importing...");
+			}
+			if (ImGui::BeginTable("import_presets", 6, ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders))
+			{
+				ImGui::TableSetupColumn("Preset");
+				ImGui::TableSetupColumn("Imported");
+				ImGui::TableSetupColumn("Welded");
+				ImGui::TableSetupColumn("Load ms");
+				ImGui::TableSetupColumn("Allocations");
+				ImGui::TableSetupColumn("Peak RSS");
+				ImGui::TableHeadersRow();
+				for (int i = 0; i < static_cast<int>(ImportPreset::Count); i++)
+				{
+					ImGui::TableNextRow();
+					ImGui::TableSetColumnIndex(0);
+					ImGui::TextUnformatted(preset_names[i]);
+					if (!preset_stats[i].loaded)
+						continue;
+					ImGui::TableSetColumnIndex(1);
+					ImGui::Text("%u", preset_stats[i].importedVertices);
+					ImGui::TableSetColumnIndex(2);
+					ImGui::Text("%u", preset_stats[i].vertices);
+					ImGui::TableSetColumnIndex(3);
+					ImGui::Text("%.1f", preset_stats[i].milliseconds);
+					ImGui::TableSetColumnIndex(4);
+					ImGui::Text("%llu", static_cast<unsigned long long>(preset_stats[i].allocations));
+					ImGui::TableSetColumnIndex(5);
+					ImGui::TextUnformatted(preset_stats[i].peakResidentBytes > 0 ? MemoryTracker::FormatBytes(preset_stats[i].peakResidentBytes).c_str() : "-");
+				}
+				ImGui::EndTable();
+			}
+			if (current_model->IsPickingReady())
+				ImGui::Text("Shift + click to pick (BVH built in %.1f ms)", current_model->GetBVHBuildMilliseconds());
+			else
+				ImGui::Text("Building picking BVH...");
+			ImGui::Checkbox("Measure", &measure_mode);
+			ImGui::SameLine();
+			if (ImGui::Button("Clear picks"))
+			{
+				has_pick = false;
+				measure_points.clear();
+			}
+			if (has_pick)
+			{
+				glm::vec3 world = glm::vec3(model * glm::vec4(picked_hit.position, 1.0f));
+				ImGui::Text("Mesh %u (%s), triangle %u", picked_hit.mesh, current_model->meshes[picked_hit.mesh].name.c_str(), picked_hit.triangle);
+				ImGui::Text("Position %.4f, %.4f, %.4f", world.x, world.y, world.z);
+			}
+			if (measure_points.size() == 2)
+			{
+				// measured after the asset transform, in scene units
+				glm::vec3 first = glm::vec3(model * glm::vec4(measure_points[0], 1.0f));
+				glm::vec3 second = glm::vec3(model * glm::vec4(measure_points[1], 1.0f));
+				ImGui::Text("Distance %.4f", glm::distance(first, second));
+			}
+			else if (measure_mode)
+				ImGui::Text("Pick the %s point", measure_points.empty() ? "first" : "second");
+
+			ImGui::Text("");
+
+			ImGui::Text("Capture");
+			ImGui::BeginDisabled(capture->IsCapturing());
+			ImGui::InputInt2("Resolution", capture_size);
+			ImGui::Combo("Format", &capture_format, "PNG\0EXR (linear half float)\0");
+			ImGui::InputInt("Frames (0 = until stopped)", &capture_settings.frameCount);
+			ImGui::Combo("Turntable", &turntable_mode, turntable_names, 3);
+			ImGui::EndDisabled();
+			if (capture->IsCapturing())
+			{
+				if (ImGui::Button("Stop capture"))
+					capture->Stop();
+			}
+			else if (ImGui::Button("Start capture"))
+				start_capture();
+			if (capture->GetCapturedFrames() > 0)
+			{
+				ImGui::SameLine();
+				ImGui::Text("%d captured, %d written, %d encoding (%.1f ms each)", capture->GetCapturedFrames(), capture->GetWrittenFrames(),
+					capture->GetEncodesInFlight(), capture->GetAverageEncodeMilliseconds());
+				ImGui::TextWrapped("%s", capture->GetOutputDirectory().c_str());
+			}
 
 			ImGui::Text("");
 
 			ImGui::Text("Editor");
 			ImGui::ColorEdit3("Background color", &background_color[0]);
 			ImGui::ColorEdit3("Wireframe mesh color", &wire_color[0]);
+			ImGui::SliderFloat("Wireframe width", &wire_width, 0.5f, 4.0f, "%.1f px");
+			if (ImGui::Checkbox("Wireframe overlay", &wireframe_overlay) && (current_shader == &shader || current_shader == &shadedWireframeShader
+				|| current_shader == &packedShader || current_shader == &packedShadedWireframeShader))
+				current_shader = wireframe_overlay ? &shadedWireframeShader : &shader;
+			ImGui::SameLine();
 			ImGui::SetCursorPosX(265);
 			ImGui::Checkbox("Render plane", &render_plane);
+			ImGui::Checkbox("Split view", &split_view);
+			if (split_view)
+			{
+				ImGui::SameLine();
+				ImGui::SetCursorPosX(265);
+				ImGui::SetNextItemWidth(120);
+				ImGui::SliderInt("Viewports", &split_count, 2, 4);
+				split_count = std::clamp(split_count, 2, 4);
+				for (int i = 0; i < split_count; i++)
+				{
+					ImGui::PushID(i);
+					ImGui::SetNextItemWidth(120);
+					ImGui::Combo("##split_camera", &split_camera[i], split_camera_names, IM_ARRAYSIZE(split_camera_names));
+					ImGui::SameLine();
+					ImGui::SetNextItemWidth(120);
+					ImGui::Combo("##split_shading", &split_shading[i], split_shading_names, IM_ARRAYSIZE(split_shading_names));
+					ImGui::SameLine();
+					ImGui::Text("Viewport %d", i + 1);
+					ImGui::PopID();
+				}
+			}
+			if (ImGui::Checkbox("Keep CPU geometry", &keep_cpu_geometry))
+			{
+				// released geometry is read back from the GL buffers
+				if (keep_cpu_geometry)
+					current_model->EnsureCpuData();
+				else
+					current_model->ReleaseCpuData();
+			}
+			ImGui::SameLine();
+			ImGui::SetCursorPosX(265);
+			ImGui::Checkbox("Memory panel", &show_memory_panel);
+			ImGui::SetCursorPosX(265);
+			ImGui::Checkbox("Asset browser", &show_asset_browser);
+			ImGui::Checkbox("Packed material maps", &pack_materials);
+			if (pack_materials && !packed_ready)
+			{
+				ImGui::SameLine();
+				ImGui::Text("(packing)");
+			}
+			ImGui::SameLine();
+			ImGui::SetCursorPosX(265);
+			ImGui::Checkbox("UV inspector", &show_uv_inspector);
+			bool dynamic_resolution_enabled = dynamic_resolution->IsEnabled();
+			if (ImGui::Checkbox("Dynamic resolution", &dynamic_resolution_enabled))
+				dynamic_resolution->SetEnabled(dynamic_resolution_enabled);
+			if (dynamic_resolution_enabled)
+			{
+				if (ImGui::SliderFloat("Target frame time", &target_frame_time, 4.0f, 50.0f, "%.1f ms"))
+					dynamic_resolution->SetTargetFrameMilliseconds(target_frame_time);
+				if (ImGui::SliderFloat("Upscale sharpness", &upscale_sharpness, 0.0f, 1.0f, "%.2f"))
+					dynamic_resolution->SetSharpness(upscale_sharpness);
+				ImGui::Text("Scale %.0f%% (%dx%d), GPU %.1f ms frame, %.1f ms scene", dynamic_resolution->GetScale() * 100.0f,
+					dynamic_resolution->GetRenderWidth(), dynamic_resolution->GetRenderHeight(),
+					dynamic_resolution->GetGpuFrameMilliseconds(), dynamic_resolution->GetGpuSceneMilliseconds());
+			}
+			else
+				ImGui::Text("GPU %.1f ms frame", dynamic_resolution->GetGpuFrameMilliseconds());
+			bool accumulation_enabled = accumulator->IsEnabled();
+			if (ImGui::Checkbox("Progressive refinement", &accumulation_enabled))
+				accumulator->SetEnabled(accumulation_enabled);
+			if (accumulation_enabled)
+			{
+				if (ImGui::SliderInt("Samples", &accumulation_samples, 16, 1024))
+					accumulator->SetMaxSamples(accumulation_samples);
+				if (ImGui::SliderFloat("Light size", &light_size, 0.0f, 5.0f, "%.2f deg"))
+					accumulator->SetLightSize(light_size);
+				ImGui::Text("%d / %d samples", accumulator->GetSampleCount(), accumulator->GetMaxSamples());
+			}
+			// fetched again, the asset may have been replaced above
+			if (ClusterStreamer* shown_streamer = current_model->GetStreamer())
+			{
+				// applied on release, a new budget pages everything in again
+				ImGui::SliderInt("Streaming budget", &stream_budget_edit, 64, 4096, "%d MB");
+				if (ImGui::IsItemDeactivatedAfterEdit())
+					stream_budget_mb = stream_budget_edit;
+				const ClusterStreamer::Stats& stream_stats = shown_streamer->GetStats();
+				ImGui::Text("Clusters: %zu visible, %zu drawn, %zu / %zu slots resident, %zu loading", stream_stats.visible, stream_stats.drawn,
+					stream_stats.resident, stream_stats.slots, stream_stats.loading);
+				ImGui::Text("%.2f M triangles drawn, %.1f MB uploaded, %llu page-ins, %llu evictions, %.2f ms",
+					stream_stats.drawnTriangles / 1.0e6, stream_stats.uploadedBytes / (1024.0 * 1024.0),
+					static_cast<unsigned long long>(stream_stats.pageIns), static_cast<unsigned long long>(stream_stats.evictions), stream_stats.updateMilliseconds);
+			}
+			bool hot_reload = hot_reloader->IsEnabled();
+			if (ImGui::Checkbox("Hot reload", &hot_reload))
+				hot_reloader->SetEnabled(hot_reload);
+			if (!hot_reloader->GetStatus().empty())
+			{
+				ImGui::SameLine();
+				ImGui::TextUnformatted(hot_reloader->GetStatus().c_str());
+			}
+			ImGui::InputText("Session file", session_path_buffer, sizeof(session_path_buffer));
+			if (!session_recorder->IsRecording())
+			{
+				if (ImGui::Button("Record session") && !replaying)
+					start_recording(session_path_buffer);
+			}
+			else
+			{
+				if (ImGui::Button("Stop recording"))
+					session_recorder->Stop();
+				ImGui::SameLine();
+				ImGui::Text("%zu frames to %s", session_recorder->GetFrameCount(), session_recorder->GetPath().c_str());
+			}
+			if (replaying)
+				ImGui::Text("Replaying frame %zu / %zu", replay_frame, session_replay.GetFrameCount());
+			if (ImGui::Button("Reload asset"))
+				load_asset();
+			ImGui::SameLine();
+			ImGui::Text("GL objects: %d live, %d queued for deletion", GLDeletionQueue::Get().GetLiveCount(),
+				static_cast<int>(GLDeletionQueue::Get().GetPendingCount()));
+			if (startup_import.valid())
+				ImGui::Text("Importing %s...", std::filesystem::path(asset_path).filename().string().c_str());
+			else if (!startup_error.empty())
+				ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "Import of %s failed: %s", std::filesystem::path(asset_path).filename().string().c_str(), startup_error.c_str());
+			ImGui::Text("%s: %u vertices, %u triangles, %s in %.1f ms", current_model->fileName.c_str(), current_model->GetVertexCount(),
+				current_model->GetIndexCount() / 3, current_model->loaderName.c_str(), current_model->loadMilliseconds);
+			ImGui::Text("Import: %llu allocations (%s), peak resident %s", static_cast<unsigned long long>(current_model->importAllocations),
+				MemoryTracker::FormatBytes(static_cast<size_t>(current_model->importAllocatedBytes)).c_str(),
+				current_model->peakResidentBytes > 0 ? MemoryTracker::FormatBytes(current_model->peakResidentBytes).c_str() : "n/a");
+			ImGui::Text("Startup: first frame after %.0f ms", StartupTimeline::Get().GetTimeToFirstFrame());
 
 
 			// test
@@ -535,15 +2164,153 @@ int main(int argc, char* argv[])
 			ImGui::End();
 		}
 
+		if (show_memory_panel)
+			MemoryTracker::Get().DrawUI(&show_memory_panel);
+
+		if (show_uv_inspector)
+		{
+			ImGui::SetNextWindowSize(ImVec2(540.0f, 760.0f), ImGuiCond_FirstUseEver);
+			if (ImGui::Begin("UV inspector", &show_uv_inspector))
+			{
+				std::vector<Mesh>& uv_meshes = current_model->meshes;
+				if (uv_meshes.empty())
+					ImGui::TextUnformatted(startup_import.valid() ? "Importing..." : "No meshes to inspect (streamed assets have no UV data here)");
+				else
+				{
+					uv_mesh = std::clamp(uv_mesh, 0, static_cast<int>(uv_meshes.size()) - 1);
+					if (ImGui::BeginCombo("Mesh", uv_meshes[uv_mesh].name.c_str()))
+					{
+						for (int i = 0; i < static_cast<int>(uv_meshes.size()); i++)
+						{
+							ImGui::PushID(i);
+							if (ImGui::Selectable(uv_meshes[i].name.c_str(), i == uv_mesh))
+								uv_mesh = i;
+							ImGui::PopID();
+						}
+						ImGui::EndCombo();
+					}
+					const char* uv_overlay_names[] = { GetUVOverlayModeName(UVOverlayMode::Islands), GetUVOverlayModeName(UVOverlayMode::TexelDensity) };
+					int overlay = static_cast<int>(uv_overlay_mode);
+					if (ImGui::Combo("Overlay", &overlay, uv_overlay_names, IM_ARRAYSIZE(uv_overlay_names)))
+						uv_overlay_mode = static_cast<UVOverlayMode>(overlay);
+
+					// texel density is measured against the diffuse map the asset is drawn with
+					const TexturePalette::Entry& uv_diffuse = palette->GetEntry(material_maps[0]);
+					int uv_texture_size = std::max(uv_diffuse.width, uv_diffuse.height);
+					if (uv_texture_size <= 0)
+						uv_texture_size = 1024;
+					if (uv_analyzed_generation != model_generation || uv_analyzed_mesh != uv_mesh || uv_analyzed_size != uv_texture_size
+						|| uv_analyzed_mode != uv_overlay_mode)
+					{
+						uv_analyzed_generation = model_generation;
+						uv_analyzed_mesh = uv_mesh;
+						uv_analyzed_size = uv_texture_size;
+						uv_analyzed_mode = uv_overlay_mode;
+						uv_inspector->Analyze(uv_meshes[uv_mesh], uv_texture_size, uv_overlay_mode);
+					}
+
+					if (uv_inspector->HasResult())
+					{
+						const UVInspector::Stats& uv_stats = uv_inspector->GetStats();
+						ImGui::Text("%zu triangles, %zu islands, %.1f%% of the 0-1 square used", uv_stats.triangles, uv_stats.islands,
+							uv_stats.coverage * 100.0f);
+						ImGui::TextColored(ImVec4(0.95f, 0.3f, 0.3f, 1.0f), "%zu overlapping triangles, %.1f%% of the square covered more than once",
+							uv_stats.overlappingTriangles, uv_stats.overlapCoverage * 100.0f);
+						ImGui::TextColored(ImVec4(0.9f, 0.4f, 0.9f, 1.0f), "%zu flipped", uv_stats.flippedTriangles);
+						ImGui::SameLine(0.0f, 0.0f);
+						ImGui::Text(", %zu without UV area, %zu reaching outside 0-1", uv_stats.degenerateTriangles, uv_stats.outsideTriangles);
+						ImGui::Text("Texels per unit at %d px: median %.1f (p10 %.1f, p90 %.1f), min %.1f, max %.1f, area weighted mean %.1f",
+							uv_stats.textureSize, uv_stats.densityMedian, uv_stats.densityP10, uv_stats.densityP90, uv_stats.densityMin,
+							uv_stats.densityMax, uv_stats.densityMean);
+						ImGui::Text("Analysed in %.1f ms%s", uv_stats.milliseconds, uv_inspector->IsBusy() ? ", updating..." : "");
+					}
+					else
+						ImGui::TextUnformatted("Analysing...");
+
+					ImVec2 uv_available = ImGui::GetContentRegionAvail();
+					uv_inspector->Draw(std::max(std::min(uv_available.x, uv_available.y), 64.0f));
+				}
+			}
+			ImGui::End();
+		}
+
+		std::string browsed_asset;
+		if (show_asset_browser && asset_browser->Draw(&show_asset_browser, browsed_asset))
+		{
+			asset_path = browsed_asset;
+			load_asset();
+		}
+
 		ImGui::SetMouseCursor(cursor);
 		ImGui::Render();
 		ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+		dynamic_resolution->EndFrame();
 
 		// swap buffers and poll events
 		glfwSwapBuffers(window);
 		glfwPollEvents();
+		StartupTimeline::Get().FirstFrame();
+		// one shader per frame, the first frame only compiled what it drew with
+		for (Shader* warm_up_shader : warm_up_shaders)
+		{
+			if (!warm_up_shader->IsCompiled())
+			{
+				warm_up_shader->EnsureCompiled();
+				break;
+			}
+		}
+
+		// objects released this frame are deleted once the GPU is past it
+		GLDeletionQueue::Get().EndFrame();
+
+		if (replay_timed)
+		{
+			replay_timings.AddFrame(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frame_start).count());
+			if (++replay_frame == session_replay.GetFrameCount())
+			{
+				// the last few frames have no GPU time yet and are left out of the GPU numbers
+				replaying = false;
+				if (!replay_timings.WriteCsv(replay_csv_path))
+					std::cout << "ERROR::SESSION::WRITE_FAILED " << replay_csv_path << std::endl;
+				std::cout << "replay: " << replay_timings.GetFrameCount() << " frames, timings in " << replay_csv_path << std::endl
+					<< replay_timings.FormatSummary();
+				if (replay_max_p99 > 0.0f)
+				{
+					double cpu_p99 = replay_timings.SummarizeCpu().p99, gpu_p99 = replay_timings.SummarizeGpu().p99;
+					bool passed = cpu_p99 <= replay_max_p99 && gpu_p99 <= replay_max_p99;
+					std::cout << "replay: p99 budget " << replay_max_p99 << " ms " << (passed ? "PASSED" : "FAILED") << std::endl;
+					exit_code = passed ? 0 : 1;
+				}
+				glfwSetWindowShouldClose(window, true);
+			}
+		}
+
+		// command line captures close the viewer once the last frame is on disk
+		if (capture_and_exit && !capture->IsBusy())
+		{
+			double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - capture_start).count();
+			std::cout << "Captured " << capture->GetWrittenFrames() << " frames to " << capture->GetOutputDirectory() << " in " << seconds << " s ("
+				<< capture->GetWrittenFrames() / std::max(seconds, 0.001) << " frames/s, " << capture->GetFailedFrames() << " failed, "
+				<< capture->GetAverageEncodeMilliseconds() << " ms encode per frame)" << std::endl;
+			capture_and_exit = false;
+			glfwSetWindowShouldClose(window, true);
+		}
 	}
 
+	session_recorder.reset();
+	hot_reloader.reset();
+	current_model.reset();
+	environment.reset();
+	palette.reset();
+	asset_browser.reset();
+	// frames still in flight are written before the context goes away
+	capture.reset();
+	dynamic_resolution.reset();
+	accumulator.reset();
+	// waits for a comparison still running
+	geometry_diff.reset();
+	GLDeletionQueue::Get().Shutdown();
+
 	ImGui_ImplOpenGL3_Shutdown();
 	ImGui_ImplGlfw_Shutdown();
 	ImGui::DestroyContext();
@@ -551,7 +2318,7 @@ int main(int argc, char* argv[])
 	glfwDestroyWindow(window);
 
 	glfwTerminate();
-	return 0;
+	return exit_code;
 }
 
 void error_callback(int error, const char* description)
@@ -566,17 +2333,11 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
 		if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
 			glfwSetWindowShouldClose(window, true);
 
-		// polygon mode
+		// shading mode
 		if (key == GLFW_KEY_1 && action == GLFW_PRESS)
-		{
-			glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-			glEnable(GL_CULL_FACE);
-		}
+			key_shading_mode = 0;
 		if (key == GLFW_KEY_2 && action == GLFW_PRESS)
-		{
-			glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-			glDisable(GL_CULL_FACE);
-		}
+			key_shading_mode = 1;
 
 		// antialiasing
 		if (key == GLFW_KEY_3 && action == GLFW_PRESS)
@@ -595,20 +2356,30 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 
 void cursor_pos_callback(GLFWwindow* window, double xpos, double ypos)
 {
-	camera.CursorMovement(xpos, ypos);
+	if (!replaying)
+		camera.CursorMovement(xpos, ypos);
 }
 
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
 {
-	if (!imgui_mouse_capture)
+	if (!imgui_mouse_capture && !replaying)
 		camera.ProcessMouseScroll(yoffset);
 }
 
 void mouse_button_callback(GLFWwindow* window, int button, int action, int mods)
 {
-	if (!imgui_mouse_capture)
+	if (!imgui_mouse_capture && !replaying)
 	{
-		if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS)
+		if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS && (mods & GLFW_MOD_SHIFT))
+		{
+			// shift + click picks instead of orbiting
+			glfwGetCursorPos(window, &pick_x, &pick_y);
+			pick_requested = true;
+			pick_click = true;
+		}
+		else if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_RELEASE && pick_click)
+			pick_click = false;
+		else if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS)
 		{
 			camera.SetFocus(true);
 			glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
@@ -645,28 +2416,48 @@ void SetLitMode()
 {
 	glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 	glEnable(GL_CULL_FACE);
+	glDisable(GL_SAMPLE_ALPHA_TO_COVERAGE);
 }
 
 void SetWireframeMode()
 {
-	glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+	// triangles stay filled, the shader discards everything but their edges (GL_LINE is slow on dense meshes)
+	glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 	glDisable(GL_CULL_FACE);
+	glEnable(GL_SAMPLE_ALPHA_TO_COVERAGE);
+}
+
+DecodedImage decodeImage(const char* path, int channels)
+{
+	DecodedImage image;
+	int fileChannels = 0;
+	unsigned char* data = stbi_load(path, &image.width, &image.height, &fileChannels, channels);
+	if (!data)
+	{
+		std::cerr << "Failed to load texture " << path << std::endl;
+		return DecodedImage();
+	}
+
+	image.channels = channels ? channels : fileChannels;
+	image.pixels.assign(data, data + static_cast<size_t>(image.width) * image.height * image.channels);
+	stbi_image_free(data);
+	return image;
 }
 
-unsigned int loadTexture(const char* path, bool gammaCorrection)
+GLTexture uploadTexture(const DecodedImage& image, const char* name, bool gammaCorrection)
 {
-	unsigned int texture;
-	glGenTextures(1, &texture);
-	glBindTexture(GL_TEXTURE_2D, texture);
+	if (image.pixels.empty())
+		return GLTexture();
+
+	GLTexture texture = GLTexture::Create();
+	glBindTexture(GL_TEXTURE_2D, texture.Get());
 
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-	int width, height, nrChannels;
-	unsigned char* data = stbi_load(path, &width, &height, &nrChannels, 0);
-
+	int nrChannels = image.channels;
 	int dataFormat = GL_RGB;
 	int internalFormat = GL_RGB;
 	if (nrChannels == 1)
@@ -684,18 +2475,264 @@ unsigned int loadTexture(const char* path, bool gammaCorrection)
 		internalFormat = gammaCorrection ? GL_SRGB_ALPHA : GL_RGBA;
 	}
 
-	if (data)
+	// rows of 1 and 3 channel images aren't 4 byte aligned
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, image.width, image.height, 0, dataFormat, GL_UNSIGNED_BYTE, image.pixels.data());
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glGenerateMipmap(GL_TEXTURE_2D);
+	MemoryTracker::Get().Register(MemoryCategory::Texture, name, 0, MemoryTracker::TextureBytes(image.width, image.height, nrChannels == 3 ? 4 : nrChannels, true));
+
+	return texture;
+}
+int RunSoakTest(GLFWwindow* window, Shader& shader, const std::string& path, int cycles)
+{
+	// loads, draws and drops the asset over and over, after the first cycle the tracked memory
+	// and the number of live GL objects have to stay where they are
+	GLDeletionQueue& queue = GLDeletionQueue::Get();
+	MemoryTracker& tracker = MemoryTracker::Get();
+	int report_interval = std::max(cycles / 10, 1);
+	int baseline_objects = 0;
+	size_t baseline_cpu = 0, baseline_gpu = 0;
+
+	std::cout << "soak: " << path << ", " << cycles << " cycles" << std::endl;
+	int cycle = 1;
+	for (; cycle <= cycles && !glfwWindowShouldClose(window); cycle++)
+	{
+		{
+			std::unique_ptr<Model> model = std::make_unique<Model>(path, false, ModelLoader::Auto, import_preset);
+			if (release_cpu_geometry)
+				model->ReleaseCpuData();
+
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			shader.Use();
+			shader.SetMat4("model", glm::mat4(1.0f));
+			model->Draw(shader);
+			glfwSwapBuffers(window);
+			glfwPollEvents();
+		}
+		// the model's objects wait behind the fence of the frame that drew it
+		queue.EndFrame();
+
+		if (cycle == 1)
+		{
+			queue.Flush();
+			baseline_objects = queue.GetLiveCount();
+			baseline_cpu = tracker.GetTotalCpuBytes();
+			baseline_gpu = tracker.GetTotalGpuBytes();
+		}
+
+		if (cycle % report_interval == 0 || cycle == cycles)
+		{
+			std::cout << "soak: cycle " << cycle << "  GL objects " << queue.GetLiveCount() << " (" << queue.GetPendingCount() << " queued)"
+				<< "  CPU " << MemoryTracker::FormatBytes(tracker.GetTotalCpuBytes())
+				<< "  GPU " << MemoryTracker::FormatBytes(tracker.GetTotalGpuBytes()) << std::endl;
+		}
+	}
+
+	queue.Flush();
+	int leaked_objects = queue.GetLiveCount() - baseline_objects;
+	size_t leaked_gpu = tracker.GetTotalGpuBytes() > baseline_gpu ? tracker.GetTotalGpuBytes() - baseline_gpu : 0;
+	bool stable = leaked_objects == 0 && tracker.GetTotalCpuBytes() == baseline_cpu && tracker.GetTotalGpuBytes() == baseline_gpu;
+	std::cout << "soak: " << (cycle - 1) << " cycles, " << leaked_objects << " GL objects and "
+		<< MemoryTracker::FormatBytes(leaked_gpu) << " of GPU memory left over: "
+		<< (stable ? "PASSED" : "FAILED") << std::endl;
+	return stable ? 0 : 1;
+}
+
+int RunLoaderComparison(const std::string& path, int runs)
+{
+	// the same file through the native glTF path and through Assimp, glFinish makes the GL upload part of the time
+	struct LoaderRun
 	{
-		glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, dataFormat, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
+		const char* name;
+		ModelLoader loader;
+		std::vector<double> milliseconds;
+		std::string used;
+		size_t meshes = 0;
+		unsigned int vertices = 0, triangles = 0;
+	};
+	LoaderRun loaders[2] = { { "auto", ModelLoader::Auto }, { "assimp", ModelLoader::Assimp } };
+
+	std::cout << "comparing loaders: " << path << ", " << runs << " runs each" << std::endl;
+	for (LoaderRun& run : loaders)
+	{
+		for (int i = 0; i < runs; i++)
+		{
+			glFinish();
+			auto start = std::chrono::steady_clock::now();
+			{
+				Model model(path, false, run.loader, import_preset);
+				glFinish();
+				run.milliseconds.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+				run.used = model.loaderName;
+				run.meshes = model.meshes.size();
+				run.vertices = model.GetVertexCount();
+				run.triangles = model.GetIndexCount() / 3;
+			}
+			GLDeletionQueue::Get().Flush();
+		}
+		std::sort(run.milliseconds.begin(), run.milliseconds.end());
 	}
-	else
+
+	std::printf("%-8s %-14s %8s %10s %10s %10s %10s\n", "mode", "loader", "meshes", "vertices", "triangles", "min ms", "median ms");
+	for (const LoaderRun& run : loaders)
 	{
-		std::cerr << "Failed to load texture" << std::endl;
-		return 0;
+		std::printf("%-8s %-14s %8zu %10u %10u %10.2f %10.2f\n", run.name, run.used.c_str(), run.meshes, run.vertices, run.triangles,
+			run.milliseconds.front(), run.milliseconds[run.milliseconds.size() / 2]);
 	}
+	return loaders[0].meshes > 0 ? 0 : 1;
+}
 
-	stbi_image_free(data);
+int RunRayBenchmark(const std::string& path, int rays)
+{
+	// rays from a sphere around the asset towards random points inside its bounds
+	Model model(path, false, ModelLoader::Auto, import_preset);
+	model.WaitForPicking();
 
-	return texture;
-}
\ No newline at end of file
+	size_t triangles = 0, nodes = 0, bytes = 0;
+	glm::vec3 bounds_min(FLT_MAX), bounds_max(-FLT_MAX);
+	for (const MeshBVH& bvh : model.GetBVHs())
+	{
+		if (bvh.IsEmpty())
+			continue;
+		triangles += bvh.GetTriangleCount();
+		nodes += bvh.GetNodeCount();
+		bytes += bvh.GetMemoryBytes();
+		bounds_min = glm::min(bounds_min, bvh.GetBoundsMin());
+		bounds_max = glm::max(bounds_max, bvh.GetBoundsMax());
+	}
+	if (triangles == 0)
+	{
+		std::cout << "ERROR::BENCHMARK::NO_TRIANGLES " << path << std::endl;
+		return 1;
+	}
+	std::printf("%s: %zu meshes, %zu triangles, %zu BVH nodes, %s, built in %.1f ms\n", model.fileName.c_str(), model.meshes.size(),
+		triangles, nodes, MemoryTracker::FormatBytes(bytes).c_str(), model.GetBVHBuildMilliseconds());
+
+	struct Ray
+	{
+		glm::vec3 origin;
+		glm::vec3 direction;
+	};
+	std::vector<Ray> ray_list(rays);
+	glm::vec3 center = (bounds_min + bounds_max) * 0.5f;
+	glm::vec3 half_size = (bounds_max - bounds_min) * 0.5f;
+	float radius = std::max(glm::length(half_size), 1e-3f) * 2.0f;
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+	for (Ray& ray : ray_list)
+	{
+		glm::vec3 on_sphere;
+		do
+			on_sphere = glm::vec3(uniform(random), uniform(random), uniform(random));
+		while (glm::dot(on_sphere, on_sphere) > 1.0f || glm::dot(on_sphere, on_sphere) < 1e-4f);
+		ray.origin = center + glm::normalize(on_sphere) * radius;
+		glm::vec3 target = center + half_size * glm::vec3(uniform(random), uniform(random), uniform(random));
+		ray.direction = target - ray.origin;
+	}
+
+	auto trace = [&](size_t begin, size_t end)
+	{
+		size_t hits = 0;
+		for (size_t i = begin; i < end; i++)
+		{
+			RayHit hit;
+			if (model.Raycast(ray_list[i].origin, ray_list[i].direction, hit))
+				hits++;
+		}
+		return hits;
+	};
+
+	auto start = std::chrono::steady_clock::now();
+	size_t hits = trace(0, ray_list.size());
+	double single_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	std::atomic<size_t> parallel_hits(0);
+	start = std::chrono::steady_clock::now();
+	ThreadPool::Get().ParallelFor(0, ray_list.size(), 4096, [&](size_t begin, size_t end)
+	{
+		parallel_hits += trace(begin, end);
+	});
+	double parallel_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	std::printf("%-10s %8s %14s %8s\n", "threads", "rays", "Mrays/s", "hit %");
+	std::printf("%-10d %8d %14.2f %8.1f\n", 1, rays, rays / std::max(single_seconds, 1e-9) * 1e-6, 100.0 * hits / rays);
+	std::printf("%-10u %8d %14.2f %8.1f\n", ThreadPool::Get().GetThreadCount() + 1, rays, rays / std::max(parallel_seconds, 1e-9) * 1e-6,
+		100.0 * parallel_hits.load() / rays);
+
+	// the traversal has to find the same closest hit as testing every triangle
+	int checked = std::min(rays, 2000);
+	int mismatches = 0;
+	for (int i = 0; i < checked; i++)
+	{
+		RayHit traversed, reference;
+		bool traversed_hit = model.Raycast(ray_list[i].origin, ray_list[i].direction, traversed);
+		bool reference_hit = false;
+		float closest = FLT_MAX;
+		for (const MeshBVH& bvh : model.GetBVHs())
+		{
+			if (bvh.IntersectBruteForce(ray_list[i].origin, ray_list[i].direction, 0.0f, closest, reference))
+			{
+				reference_hit = true;
+				closest = reference.distance;
+			}
+		}
+		if (traversed_hit != reference_hit || (traversed_hit && std::abs(traversed.distance - closest) > 1e-5f * std::max(1.0f, closest)))
+			mismatches++;
+	}
+	std::cout << "brute force check: " << checked << " rays, " << mismatches << " mismatches" << std::endl;
+	return mismatches == 0 ? 0 : 1;
+}
+
+int RunGeometryDiff(const std::string& path, const std::string& referencePath)
+{
+	if (path.empty())
+	{
+		std::cerr << "--diff needs an asset path" << std::endl;
+		return 1;
+	}
+
+	// both versions import at once, the reference on the pool
+	auto start = std::chrono::steady_clock::now();
+	std::future<std::unique_ptr<Model>> reference_import = ThreadPool::Get().Submit([referencePath]()
+	{
+		return std::make_unique<Model>(referencePath, false, ModelLoader::Auto, import_preset, ModelStorage::CpuOnly);
+	});
+	Model model(path, false, ModelLoader::Auto, import_preset, ModelStorage::CpuOnly);
+	std::unique_ptr<Model> reference = reference_import.get();
+	if (!model.errorMessage.empty() || !reference->errorMessage.empty())
+		return 1;
+	double import_milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	GeometryDiff::Result result = GeometryDiff::Compute(GeometryDiff::FromModel(model), GeometryDiff::FromModel(*reference));
+	if (!result.error.empty())
+	{
+		std::cout << "ERROR::GEOMETRY_DIFF::" << result.error << std::endl;
+		return 1;
+	}
+
+	// numbers only, one "name value" pair per line for scripts. distances are in model units
+	const GeometryDiff::Stats& stats = result.stats;
+	std::printf("vertices %zu\n", stats.vertices);
+	std::printf("triangles %zu\n", stats.triangles);
+	std::printf("reference_vertices %zu\n", stats.referenceVertices);
+	std::printf("reference_triangles %zu\n", stats.referenceTriangles);
+	std::printf("reference_diagonal %.9g\n", stats.referenceDiagonal);
+	std::printf("hausdorff %.9g\n", stats.hausdorff);
+	std::printf("max %.9g\n", stats.maxDistance);
+	std::printf("mean %.9g\n", stats.meanDistance);
+	std::printf("rms %.9g\n", stats.rmsDistance);
+	std::printf("p50 %.9g\n", stats.p50);
+	std::printf("p95 %.9g\n", stats.p95);
+	std::printf("p99 %.9g\n", stats.p99);
+	std::printf("signed_min %.9g\n", stats.minSigned);
+	std::printf("signed_max %.9g\n", stats.maxSigned);
+	std::printf("signed_mean %.9g\n", stats.meanSigned);
+	std::printf("reverse_max %.9g\n", stats.reverseMaxDistance);
+	std::printf("reverse_mean %.9g\n", stats.reverseMeanDistance);
+	std::printf("unchanged %.6f\n", stats.unchanged);
+	std::printf("import_ms %.1f\n", import_milliseconds);
+	std::printf("bvh_ms %.1f\n", stats.buildMilliseconds);
+	std::printf("query_ms %.1f\n", stats.queryMilliseconds);
+	return 0;
+}
@@ -0,0 +1,632 @@
+#include "AssetValidator.h"
+
+#include "Json.h"
+#include "Model.h"
+#include "ThreadPool.h"
+
+#include <assimp/Importer.hpp>
+#include <stb_image.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+	enum class Severity
+	{
+		Ok,
+		Warning,
+		Error
+	};
+
+	const char* SEVERITY_NAMES[] = { "ok", "warning", "error" };
+	// part of the fingerprint, bumped when the checks change so old reports are not reused
+	const uint64_t REPORT_VERSION = 1;
+	const size_t PROGRESS_STEP = 500;
+	// triangles with less area than this fraction of the squared mesh diagonal count as degenerate
+	const float DEGENERATE_AREA = 1e-9f;
+
+	struct TextureReport
+	{
+		// as referenced by the material
+		std::string path;
+		std::string type;
+		bool embedded = false;
+		bool found = false;
+		int width = 0;
+		int height = 0;
+	};
+
+	struct Issue
+	{
+		Severity severity;
+		std::string message;
+	};
+
+	struct AssetReport
+	{
+		// relative to the validated directory, with forward slashes
+		std::string path;
+		std::string loader;
+		double loadMilliseconds = 0.0;
+		// heap allocations of the thread that imported the asset
+		uint64_t importAllocations = 0;
+		size_t meshes = 0;
+		size_t vertices = 0;
+		size_t triangles = 0;
+		size_t degenerateTriangles = 0;
+		size_t meshesWithoutUVs = 0;
+		size_t nonManifoldEdges = 0;
+		size_t boundaryEdges = 0;
+		size_t missingTextures = 0;
+		// over the meshes with UVs and a diffuse map of known size, 0 when there are none
+		float texelDensityMin = 0.0f;
+		float texelDensityMax = 0.0f;
+		float texelDensityAverage = 0.0f;
+		std::vector<TextureReport> textures;
+		std::vector<Issue> issues;
+		Severity status = Severity::Ok;
+		uint64_t fingerprint = 0;
+		bool reused = false;
+
+		void AddIssue(Severity severity, const std::string& message)
+		{
+			issues.push_back({ severity, message });
+			status = std::max(status, severity);
+		}
+	};
+
+	struct MeshStats
+	{
+		size_t degenerateTriangles = 0;
+		size_t nonManifoldEdges = 0;
+		size_t boundaryEdges = 0;
+		double worldArea = 0.0;
+		double uvArea = 0.0;
+	};
+
+	struct PositionKey
+	{
+		uint32_t bits[3];
+
+		bool operator==(const PositionKey& other) const
+		{
+			return bits[0] == other.bits[0] && bits[1] == other.bits[1] && bits[2] == other.bits[2];
+		}
+	};
+
+	struct PositionKeyHash
+	{
+		size_t operator()(const PositionKey& key) const
+		{
+			uint64_t hash = 0xCBF29CE484222325ull;
+			for (uint32_t bits : key.bits)
+			{
+				hash ^= bits;
+				hash *= 0x9E3779B97F4A7C15ull;
+			}
+			return static_cast<size_t>(hash ^ (hash >> 32));
+		}
+	};
+
+	// topology is checked on positions, vertices split at UV seams or hard edges still share their edges
+	void AnalyzeMesh(const Mesh& mesh, MeshStats& stats)
+	{
+		const std::vector<Vertex>& vertices = mesh.vertices;
+		const std::vector<unsigned int>& indices = mesh.indices;
+
+		std::vector<uint32_t> canonical(vertices.size());
+		std::unordered_map<PositionKey, uint32_t, PositionKeyHash> positions;
+		positions.reserve(vertices.size());
+		glm::vec3 boundsMin(FLT_MAX), boundsMax(-FLT_MAX);
+		for (size_t i = 0; i < vertices.size(); i++)
+		{
+			PositionKey key;
+			for (int axis = 0; axis < 3; axis++)
+			{
+				// + 0.0f folds -0 into 0
+				float value = vertices[i].Position[axis] + 0.0f;
+				std::memcpy(&key.bits[axis], &value, sizeof(float));
+			}
+			canonical[i] = positions.emplace(key, static_cast<uint32_t>(i)).first->second;
+			boundsMin = glm::min(boundsMin, vertices[i].Position);
+			boundsMax = glm::max(boundsMax, vertices[i].Position);
+		}
+		glm::vec3 diagonal = boundsMax - boundsMin;
+		float degenerateArea = DEGENERATE_AREA * glm::dot(diagonal, diagonal);
+
+		std::vector<uint64_t> edges;
+		edges.reserve(indices.size());
+		for (size_t t = 0; t + 2 < indices.size(); t += 3)
+		{
+			unsigned int corners[3] = { indices[t], indices[t + 1], indices[t + 2] };
+			if (corners[0] >= vertices.size() || corners[1] >= vertices.size() || corners[2] >= vertices.size())
+			{
+				stats.degenerateTriangles++;
+				continue;
+			}
+
+			uint32_t a = canonical[corners[0]], b = canonical[corners[1]], c = canonical[corners[2]];
+			const Vertex& v0 = vertices[corners[0]];
+			const Vertex& v1 = vertices[corners[1]];
+			const Vertex& v2 = vertices[corners[2]];
+			float area = 0.5f * glm::length(glm::cross(v1.Position - v0.Position, v2.Position - v0.Position));
+			if (a == b || b == c || a == c || !(area > degenerateArea))
+			{
+				stats.degenerateTriangles++;
+				continue;
+			}
+
+			glm::vec2 uv1 = v1.TexCoords - v0.TexCoords;
+			glm::vec2 uv2 = v2.TexCoords - v0.TexCoords;
+			stats.worldArea += area;
+			stats.uvArea += 0.5 * std::fabs(static_cast<double>(uv1.x) * uv2.y - static_cast<double>(uv1.y) * uv2.x);
+
+			uint32_t triangle[3] = { a, b, c };
+			for (int e = 0; e < 3; e++)
+			{
+				uint64_t first = triangle[e], second = triangle[(e + 1) % 3];
+				edges.push_back(std::min(first, second) << 32 | std::max(first, second));
+			}
+		}
+
+		// an edge shared by one triangle is open, by more than two it is non-manifold
+		std::sort(edges.begin(), edges.end());
+		for (size_t i = 0; i < edges.size();)
+		{
+			size_t run = i + 1;
+			while (run < edges.size() && edges[run] == edges[i])
+				run++;
+			if (run - i == 1)
+				stats.boundaryEdges++;
+			else if (run - i > 2)
+				stats.nonManifoldEdges++;
+			i = run;
+		}
+	}
+
+	void HashValue(uint64_t& hash, uint64_t value)
+	{
+		for (int i = 0; i < 8; i++)
+		{
+			hash ^= (value >> (i * 8)) & 0xFF;
+			hash *= 0x100000001B3ull;
+		}
+	}
+
+	void HashFile(uint64_t& hash, const fs::path& path)
+	{
+		std::error_code error;
+		bool exists = fs::is_regular_file(path, error);
+		HashValue(hash, exists ? 1 : 0);
+		if (!exists)
+			return;
+		HashValue(hash, static_cast<uint64_t>(fs::file_size(path, error)));
+		HashValue(hash, static_cast<uint64_t>(fs::last_write_time(path, error).time_since_epoch().count()));
+	}
+
+	// changes when the asset, one of its textures or the thresholds change
+	uint64_t Fingerprint(const fs::path& asset, const AssetReport& report, const ValidationSettings& settings)
+	{
+		uint64_t hash = 0xCBF29CE484222325ull;
+		HashValue(hash, REPORT_VERSION);
+		HashFile(hash, asset);
+		for (const TextureReport& texture : report.textures)
+		{
+			if (!texture.embedded)
+				HashFile(hash, asset.parent_path() / texture.path);
+		}
+
+		uint32_t densityBits[2];
+		std::memcpy(&densityBits[0], &settings.minTexelDensity, sizeof(float));
+		std::memcpy(&densityBits[1], &settings.maxTexelDensity, sizeof(float));
+		HashValue(hash, settings.maxTriangles);
+		HashValue(hash, (static_cast<uint64_t>(densityBits[0]) << 32) | densityBits[1]);
+		return hash;
+	}
+
+	void CheckTextures(const Model& model, AssetReport& report)
+	{
+		for (const Texture& texture : model.textures_loaded)
+		{
+			TextureReport entry;
+			entry.path = texture.path;
+			entry.type = GetTextureTypeName(texture.type);
+			// "*N", or a file name the importer found among the textures stored inside the file
+			entry.embedded = texture.embedded || (!texture.path.empty() && texture.path[0] == '*');
+			if (entry.embedded)
+				entry.found = true;
+			else
+			{
+				// resolved the same way the texture palette is given the model's maps
+				std::string file = model.directory + '/' + texture.path;
+				int components;
+				if (stbi_info(file.c_str(), &entry.width, &entry.height, &components))
+					entry.found = true;
+				else
+				{
+					std::error_code error;
+					entry.found = fs::is_regular_file(file, error);
+					if (entry.found)
+						report.AddIssue(Severity::Warning, "texture " + texture.path + " is not a readable image");
+				}
+			}
+
+			if (!entry.found)
+			{
+				report.missingTextures++;
+				report.AddIssue(Severity::Error, "missing texture " + texture.path);
+			}
+			report.textures.push_back(entry);
+		}
+	}
+
+	void AnalyzeModel(const Model& model, const ValidationSettings& settings, AssetReport& report)
+	{
+		report.loader = model.loaderName;
+		report.loadMilliseconds = model.loadMilliseconds;
+		report.importAllocations = model.importAllocations;
+		report.meshes = model.meshes.size();
+		if (!model.errorMessage.empty())
+		{
+			report.AddIssue(Severity::Error, "import failed: " + model.errorMessage);
+			return;
+		}
+
+		CheckTextures(model, report);
+
+		double densitySum = 0.0, densityWeight = 0.0;
+		for (const Mesh& mesh : model.meshes)
+		{
+			report.vertices += mesh.vertices.size();
+			report.triangles += mesh.indices.size() / 3;
+
+			MeshStats stats;
+			AnalyzeMesh(mesh, stats);
+			report.degenerateTriangles += stats.degenerateTriangles;
+			report.nonManifoldEdges += stats.nonManifoldEdges;
+			report.boundaryEdges += stats.boundaryEdges;
+			if (stats.worldArea > 0.0 && stats.uvArea <= 0.0)
+			{
+				report.meshesWithoutUVs++;
+				continue;
+			}
+
+			// texels per unit of the mesh's diffuse map, sqrt(uv area * texels / surface area)
+			const TextureReport* diffuse = nullptr;
+			for (const Texture& texture : mesh.textures)
+			{
+				if (texture.type != TextureType::Diffuse)
+					continue;
+				for (const TextureReport& entry : report.textures)
+				{
+					if (entry.path == texture.path && entry.width > 0)
+						diffuse = &entry;
+				}
+				break;
+			}
+			if (!diffuse || stats.worldArea <= 0.0)
+				continue;
+
+			float density = static_cast<float>(std::sqrt(stats.uvArea * diffuse->width * diffuse->height / stats.worldArea));
+			report.texelDensityMin = densityWeight == 0.0 ? density : std::min(report.texelDensityMin, density);
+			report.texelDensityMax = std::max(report.texelDensityMax, density);
+			densitySum += density * stats.worldArea;
+			densityWeight += stats.worldArea;
+		}
+		if (densityWeight > 0.0)
+			report.texelDensityAverage = static_cast<float>(densitySum / densityWeight);
+
+		if (report.triangles == 0)
+			report.AddIssue(Severity::Error, "no triangles");
+		if (settings.maxTriangles > 0 && report.triangles > settings.maxTriangles)
+			report.AddIssue(Severity::Error, std::to_string(report.triangles) + " triangles, the budget is " + std::to_string(settings.maxTriangles));
+		if (report.degenerateTriangles > 0)
+			report.AddIssue(Severity::Warning, std::to_string(report.degenerateTriangles) + " degenerate triangles");
+		if (report.meshesWithoutUVs > 0)
+			report.AddIssue(Severity::Warning, std::to_string(report.meshesWithoutUVs) + " meshes without UVs");
+		if (report.nonManifoldEdges > 0)
+			report.AddIssue(Severity::Warning, std::to_string(report.nonManifoldEdges) + " non-manifold edges");
+		if (densityWeight > 0.0 && settings.minTexelDensity > 0.0f && report.texelDensityMin < settings.minTexelDensity)
+			report.AddIssue(Severity::Warning, "texel density " + std::to_string(report.texelDensityMin) + " is below " + std::to_string(settings.minTexelDensity));
+		if (densityWeight > 0.0 && settings.maxTexelDensity > 0.0f && report.texelDensityMax > settings.maxTexelDensity)
+			report.AddIssue(Severity::Warning, "texel density " + std::to_string(report.texelDensityMax) + " is above " + std::to_string(settings.maxTexelDensity));
+	}
+
+	std::string FormatFingerprint(uint64_t fingerprint)
+	{
+		char text[17];
+		std::snprintf(text, sizeof(text), "%016llx", static_cast<unsigned long long>(fingerprint));
+		return text;
+	}
+
+	std::string ToJson(const AssetReport& report)
+	{
+		std::ostringstream out;
+		out << "{\n";
+		out << "  \"path\": " << JsonValue::Quote(report.path) << ",\n";
+		out << "  \"status\": \"" << SEVERITY_NAMES[static_cast<int>(report.status)] << "\",\n";
+		out << "  \"fingerprint\": \"" << FormatFingerprint(report.fingerprint) << "\",\n";
+		out << "  \"loader\": " << JsonValue::Quote(report.loader) << ",\n";
+		out << "  \"loadMilliseconds\": " << report.loadMilliseconds << ",\n";
+		out << "  \"importAllocations\": " << report.importAllocations << ",\n";
+		out << "  \"meshes\": " << report.meshes << ",\n";
+		out << "  \"vertices\": " << report.vertices << ",\n";
+		out << "  \"triangles\": " << report.triangles << ",\n";
+		out << "  \"degenerateTriangles\": " << report.degenerateTriangles << ",\n";
+		out << "  \"meshesWithoutUVs\": " << report.meshesWithoutUVs << ",\n";
+		out << "  \"nonManifoldEdges\": " << report.nonManifoldEdges << ",\n";
+		out << "  \"boundaryEdges\": " << report.boundaryEdges << ",\n";
+		out << "  \"missingTextures\": " << report.missingTextures << ",\n";
+		out << "  \"texelDensity\": { \"min\": " << report.texelDensityMin << ", \"average\": " << report.texelDensityAverage
+			<< ", \"max\": " << report.texelDensityMax << " },\n";
+
+		out << "  \"textures\": [";
+		for (size_t i = 0; i < report.textures.size(); i++)
+		{
+			const TextureReport& texture = report.textures[i];
+			out << (i > 0 ? "," : "") << "\n    { \"path\": " << JsonValue::Quote(texture.path) << ", \"type\": " << JsonValue::Quote(texture.type)
+				<< ", \"embedded\": " << (texture.embedded ? "true" : "false") << ", \"found\": " << (texture.found ? "true" : "false")
+				<< ", \"width\": " << texture.width << ", \"height\": " << texture.height << " }";
+		}
+		out << (report.textures.empty() ? "],\n" : "\n  ],\n");
+
+		out << "  \"issues\": [";
+		for (size_t i = 0; i < report.issues.size(); i++)
+		{
+			out << (i > 0 ? "," : "") << "\n    { \"severity\": \"" << SEVERITY_NAMES[static_cast<int>(report.issues[i].severity)]
+				<< "\", \"message\": " << JsonValue::Quote(report.issues[i].message) << " }";
+		}
+		out << (report.issues.empty() ? "]\n" : "\n  ]\n");
+		out << "}\n";
+		return out.str();
+	}
+
+	bool ParseSeverity(const std::string& name, Severity& severity)
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			if (name == SEVERITY_NAMES[i])
+			{
+				severity = static_cast<Severity>(i);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// reads a report written by ToJson, false if it is missing fields or from an older layout
+	bool FromJson(const JsonValue& json, AssetReport& report)
+	{
+		if (!json.IsObject() || !json["fingerprint"].IsString() || !ParseSeverity(json["status"].AsString(), report.status))
+			return false;
+
+		report.path = json["path"].AsString();
+		report.fingerprint = std::strtoull(json["fingerprint"].AsString().c_str(), nullptr, 16);
+		report.loader = json["loader"].AsString();
+		report.loadMilliseconds = json["loadMilliseconds"].AsNumber();
+		report.importAllocations = static_cast<uint64_t>(json["importAllocations"].AsNumber());
+		report.meshes = static_cast<size_t>(json["meshes"].AsNumber());
+		report.vertices = static_cast<size_t>(json["vertices"].AsNumber());
+		report.triangles = static_cast<size_t>(json["triangles"].AsNumber());
+		report.degenerateTriangles = static_cast<size_t>(json["degenerateTriangles"].AsNumber());
+		report.meshesWithoutUVs = static_cast<size_t>(json["meshesWithoutUVs"].AsNumber());
+		report.nonManifoldEdges = static_cast<size_t>(json["nonManifoldEdges"].AsNumber());
+		report.boundaryEdges = static_cast<size_t>(json["boundaryEdges"].AsNumber());
+		report.missingTextures = static_cast<size_t>(json["missingTextures"].AsNumber());
+		const JsonValue& density = json["texelDensity"];
+		report.texelDensityMin = static_cast<float>(density["min"].AsNumber());
+		report.texelDensityAverage = static_cast<float>(density["average"].AsNumber());
+		report.texelDensityMax = static_cast<float>(density["max"].AsNumber());
+
+		const JsonValue& textures = json["textures"];
+		for (size_t i = 0; i < textures.Size(); i++)
+		{
+			TextureReport texture;
+			texture.path = textures[i]["path"].AsString();
+			texture.type = textures[i]["type"].AsString();
+			texture.embedded = textures[i]["embedded"].AsBool();
+			texture.found = textures[i]["found"].AsBool();
+			texture.width = textures[i]["width"].AsInt();
+			texture.height = textures[i]["height"].AsInt();
+			report.textures.push_back(texture);
+		}
+
+		const JsonValue& issues = json["issues"];
+		for (size_t i = 0; i < issues.Size(); i++)
+		{
+			Issue issue;
+			if (!ParseSeverity(issues[i]["severity"].AsString(), issue.severity))
+				return false;
+			issue.message = issues[i]["message"].AsString();
+			report.issues.push_back(issue);
+		}
+		return true;
+	}
+
+	bool ReadFile(const fs::path& path, std::string& contents)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (!file)
+			return false;
+		std::ostringstream stream;
+		stream << file.rdbuf();
+		contents = stream.str();
+		return true;
+	}
+
+	bool WriteFile(const fs::path& path, const std::string& contents)
+	{
+		std::error_code error;
+		fs::create_directories(path.parent_path(), error);
+		std::ofstream file(path, std::ios::binary);
+		file << contents;
+		return static_cast<bool>(file);
+	}
+
+	std::string CsvField(const std::string& text)
+	{
+		if (text.find_first_of(",\"\n") == std::string::npos)
+			return text;
+		std::string out = "\"";
+		for (char c : text)
+			out += c == '"' ? std::string("\"\"") : std::string(1, c);
+		return out + "\"";
+	}
+
+	AssetReport ValidateAsset(const fs::path& root, const fs::path& asset, const fs::path& reportDirectory, const ValidationSettings& settings)
+	{
+		AssetReport report;
+		report.path = fs::relative(asset, root).generic_string();
+		fs::path reportPath = reportDirectory / (report.path + ".json");
+
+		if (settings.incremental)
+		{
+			std::string contents;
+			JsonValue json;
+			std::string error;
+			AssetReport previous;
+			if (ReadFile(reportPath, contents) && JsonValue::Parse(contents.data(), contents.size(), json, error) && FromJson(json, previous) &&
+				previous.fingerprint == Fingerprint(asset, previous, settings))
+			{
+				previous.path = report.path;
+				previous.reused = true;
+				return previous;
+			}
+		}
+
+		// the fast preset skips Assimp's cleanup steps, which would remove the degenerate triangles before they are counted.
+		// Assimp is used for glTF too because the native loader does not read materials
+		Model model(asset.generic_string(), false, ModelLoader::Assimp, ImportPreset::FastPreview, ModelStorage::CpuOnly);
+		AnalyzeModel(model, settings, report);
+		report.fingerprint = Fingerprint(asset, report, settings);
+		if (!WriteFile(reportPath, ToJson(report)))
+			std::cout << "ERROR::VALIDATOR::REPORT_NOT_WRITTEN " << reportPath.generic_string() << std::endl;
+		return report;
+	}
+
+	bool IsAssetFile(const fs::path& path, const Assimp::Importer& importer)
+	{
+		std::string extension = path.extension().string();
+		if (extension.empty())
+			return false;
+		std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+		return importer.IsExtensionSupported(extension);
+	}
+}
+
+AssetValidator::AssetValidator(const ValidationSettings& settings)
+	: m_Settings(settings)
+{
+}
+
+int AssetValidator::Run(const std::string& directory)
+{
+	std::error_code error;
+	fs::path root = fs::weakly_canonical(directory, error);
+	if (error || !fs::is_directory(root, error))
+	{
+		std::cout << "ERROR::VALIDATOR::NOT_A_DIRECTORY " << directory << std::endl;
+		return 1;
+	}
+	fs::path reportDirectory = fs::weakly_canonical(m_Settings.reportDirectory, error);
+	fs::create_directories(reportDirectory, error);
+
+	auto start = std::chrono::steady_clock::now();
+	std::vector<fs::path> assets;
+	{
+		// one importer just for the extension list
+		Assimp::Importer importer;
+		for (fs::recursive_directory_iterator it(root, fs::directory_options::skip_permission_denied, error), end; it != end; it.increment(error))
+		{
+			// reports written into the validated tree are not assets
+			if (it->is_directory(error) && fs::equivalent(it->path(), reportDirectory, error))
+			{
+				it.disable_recursion_pending();
+				continue;
+			}
+			if (it->is_regular_file(error) && IsAssetFile(it->path(), importer))
+				assets.push_back(it->path());
+		}
+	}
+	std::sort(assets.begin(), assets.end());
+	std::cout << "validating " << assets.size() << " assets in " << root.generic_string() << std::endl;
+
+	std::vector<AssetReport> reports(assets.size());
+	std::atomic<size_t> finished(0);
+	std::mutex outputMutex;
+	ThreadPool::Get().ParallelFor(0, assets.size(), 1, [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			reports[i] = ValidateAsset(root, assets[i], reportDirectory, m_Settings);
+			size_t count = ++finished;
+			if (count % PROGRESS_STEP == 0)
+			{
+				std::lock_guard<std::mutex> lock(outputMutex);
+				std::cout << "  " << count << " / " << assets.size() << std::endl;
+			}
+		}
+	});
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	size_t counts[3] = { 0, 0, 0 };
+	size_t reused = 0;
+	std::ostringstream csv;
+	csv << "path,status,loader,load_ms,import_allocations,meshes,vertices,triangles,degenerate_triangles,meshes_without_uvs,non_manifold_edges,boundary_edges,"
+		"textures,missing_textures,texel_density_min,texel_density_average,texel_density_max,issues\n";
+	std::ostringstream assetsJson;
+	for (size_t i = 0; i < reports.size(); i++)
+	{
+		const AssetReport& report = reports[i];
+		counts[static_cast<int>(report.status)]++;
+		reused += report.reused ? 1 : 0;
+
+		std::string issues;
+		for (const Issue& issue : report.issues)
+			issues += (issues.empty() ? "" : "; ") + issue.message;
+		csv << CsvField(report.path) << ',' << SEVERITY_NAMES[static_cast<int>(report.status)] << ',' << CsvField(report.loader) << ','
+			<< report.loadMilliseconds << ',' << report.importAllocations << ',' << report.meshes << ',' << report.vertices << ',' << report.triangles << ','
+			<< report.degenerateTriangles << ',' << report.meshesWithoutUVs << ',' << report.nonManifoldEdges << ',' << report.boundaryEdges << ','
+			<< report.textures.size() << ',' << report.missingTextures << ',' << report.texelDensityMin << ',' << report.texelDensityAverage << ','
+			<< report.texelDensityMax << ',' << CsvField(issues) << '\n';
+
+		assetsJson << (i > 0 ? ",\n" : "\n") << "    { \"path\": " << JsonValue::Quote(report.path) << ", \"status\": \""
+			<< SEVERITY_NAMES[static_cast<int>(report.status)] << "\", \"triangles\": " << report.triangles << ", \"issues\": " << report.issues.size() << " }";
+	}
+
+	std::ostringstream summary;
+	summary << "{\n";
+	summary << "  \"directory\": " << JsonValue::Quote(root.generic_string()) << ",\n";
+	summary << "  \"seconds\": " << seconds << ",\n";
+	summary << "  \"assets\": " << reports.size() << ",\n";
+	summary << "  \"reused\": " << reused << ",\n";
+	summary << "  \"ok\": " << counts[0] << ",\n";
+	summary << "  \"warnings\": " << counts[1] << ",\n";
+	summary << "  \"errors\": " << counts[2] << ",\n";
+	summary << "  \"reports\": [" << assetsJson.str() << (reports.empty() ? "]\n" : "\n  ]\n");
+	summary << "}\n";
+	WriteFile(reportDirectory / "summary.json", summary.str());
+	WriteFile(reportDirectory / "summary.csv", csv.str());
+
+	std::printf("validated %zu assets in %.1f s (%zu reused): %zu ok, %zu with warnings, %zu with errors\n", reports.size(), seconds, reused,
+		counts[0], counts[1], counts[2]);
+	std::cout << "reports: " << reportDirectory.generic_string() << std::endl;
+	return static_cast<int>(counts[2]);
+}
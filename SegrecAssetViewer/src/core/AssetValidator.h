@@ -0,0 +1,35 @@
+#ifndef ASSETVALIDATOR_H
+#define ASSETVALIDATOR_H
+
+#include <string>
+
+struct ValidationSettings
+{
+	// reports mirror the asset directory layout below this directory
+	std::string reportDirectory = "validation";
+	// 0 disables the limit
+	unsigned int maxTriangles = 0;
+	// texels per scene unit of the diffuse map, 0 disables the check
+	float minTexelDensity = 0.0f;
+	float maxTexelDensity = 0.0f;
+	// reuses reports whose asset and texture files did not change since they were written
+	bool incremental = false;
+};
+
+// headless checks that used to be done by hand in the viewer: triangle budget, missing UVs, degenerate triangles,
+// non-manifold edges, texel density and missing texture files.
+// assets are imported through Model without GL, one per pool job, so a directory is processed on all cores.
+// every asset gets a JSON report, the run writes summary.json and summary.csv next to them.
+class AssetValidator
+{
+public:
+	explicit AssetValidator(const ValidationSettings& settings);
+
+	// returns the number of assets with errors
+	int Run(const std::string& directory);
+
+private:
+	ValidationSettings m_Settings;
+};
+
+#endif // !ASSETVALIDATOR_H
@@ -0,0 +1,256 @@
+#include "DirectoryWatcher.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <cerrno>
+#endif
+
+namespace
+{
+#ifndef _WIN32
+	const uint32_t WATCH_MASK = IN_CREATE | IN_DELETE | IN_CLOSE_WRITE | IN_ATTRIB | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR;
+	// the thread checks for Stop this often while nothing happens
+	const int POLL_TIMEOUT_MS = 250;
+#endif
+}
+
+DirectoryWatcher::~DirectoryWatcher()
+{
+	Stop();
+}
+
+bool DirectoryWatcher::Start(const std::string& directory, bool recursive)
+{
+	Stop();
+
+	m_Root = directory;
+	m_Recursive = recursive;
+	m_Stopping = false;
+	m_Overflowed = false;
+	m_Changes.clear();
+
+#ifdef _WIN32
+	HANDLE handle = CreateFileW(std::filesystem::path(directory).wstring().c_str(), FILE_LIST_DIRECTORY,
+		FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+	if (handle == INVALID_HANDLE_VALUE)
+	{
+		std::cout << "ERROR::WATCHER::OPEN_FAILED " << directory << std::endl;
+		return false;
+	}
+	m_Directory = handle;
+	m_StopEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+#else
+	m_Inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (m_Inotify < 0)
+	{
+		std::cout << "ERROR::WATCHER::INOTIFY_INIT_FAILED " << directory << std::endl;
+		return false;
+	}
+#endif
+
+	m_Running = true;
+	m_Thread = std::thread(&DirectoryWatcher::Run, this);
+	return true;
+}
+
+void DirectoryWatcher::Stop()
+{
+	if (!m_Running)
+		return;
+
+	m_Stopping = true;
+#ifdef _WIN32
+	SetEvent(m_StopEvent);
+#endif
+	m_Thread.join();
+	m_Running = false;
+
+#ifdef _WIN32
+	CloseHandle(m_Directory);
+	CloseHandle(m_StopEvent);
+	m_Directory = nullptr;
+	m_StopEvent = nullptr;
+#else
+	close(m_Inotify);
+	m_Inotify = -1;
+	m_Watches.clear();
+#endif
+}
+
+bool DirectoryWatcher::IsRunning() const
+{
+	return m_Running;
+}
+
+void DirectoryWatcher::Poll(std::vector<std::string>& changedPaths, bool& overflowed)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		changedPaths.swap(m_Changes);
+		m_Changes.clear();
+		overflowed = m_Overflowed;
+		m_Overflowed = false;
+	}
+	// saving a file usually produces several events for it
+	std::sort(changedPaths.begin(), changedPaths.end());
+	changedPaths.erase(std::unique(changedPaths.begin(), changedPaths.end()), changedPaths.end());
+}
+
+void DirectoryWatcher::Push(const std::string& path)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	m_Changes.push_back(path);
+}
+
+#ifdef _WIN32
+
+void DirectoryWatcher::Run()
+{
+	OVERLAPPED overlapped = {};
+	overlapped.hEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+	// DWORD aligned as ReadDirectoryChangesW requires, 64 KB is the limit for network shares
+	std::vector<DWORD> buffer(16384);
+	const DWORD filter = FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME | FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_LAST_WRITE;
+
+	while (!m_Stopping)
+	{
+		ResetEvent(overlapped.hEvent);
+		if (!ReadDirectoryChangesW(m_Directory, buffer.data(), static_cast<DWORD>(buffer.size() * sizeof(DWORD)), m_Recursive ? TRUE : FALSE, filter, nullptr, &overlapped, nullptr))
+		{
+			std::cout << "ERROR::WATCHER::READ_FAILED " << m_Root << std::endl;
+			break;
+		}
+
+		HANDLE handles[2] = { overlapped.hEvent, m_StopEvent };
+		DWORD wait = WaitForMultipleObjects(2, handles, FALSE, INFINITE);
+		DWORD bytes = 0;
+		if (wait != WAIT_OBJECT_0)
+		{
+			CancelIo(m_Directory);
+			GetOverlappedResult(m_Directory, &overlapped, &bytes, TRUE);
+			break;
+		}
+		if (!GetOverlappedResult(m_Directory, &overlapped, &bytes, FALSE) || bytes == 0)
+		{
+			// the buffer overflowed, the individual changes are gone
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Overflowed = true;
+			continue;
+		}
+
+		const unsigned char* data = reinterpret_cast<const unsigned char*>(buffer.data());
+		while (true)
+		{
+			const FILE_NOTIFY_INFORMATION* info = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(data);
+			std::wstring name(info->FileName, info->FileNameLength / sizeof(WCHAR));
+			Push(std::filesystem::path(name).generic_string());
+			if (info->NextEntryOffset == 0)
+				break;
+			data += info->NextEntryOffset;
+		}
+	}
+
+	CloseHandle(overlapped.hEvent);
+}
+
+#else
+
+void DirectoryWatcher::AddWatches(const std::string& relative)
+{
+	namespace fs = std::filesystem;
+
+	// inotify is not recursive, every directory of the tree gets a watch
+	std::vector<std::string> directories = { relative };
+	std::error_code error;
+	fs::path start = relative.empty() ? fs::path(m_Root) : fs::path(m_Root) / relative;
+	if (m_Recursive)
+	{
+		for (fs::recursive_directory_iterator it(start, fs::directory_options::skip_permission_denied, error), end; !error && it != end; it.increment(error))
+		{
+			if (!it->is_directory(error) || it->is_symlink(error))
+				continue;
+			// hidden directories (.git, .svn) change constantly and never hold assets
+			if (it->path().filename().string()[0] == '.')
+			{
+				it.disable_recursion_pending();
+				continue;
+			}
+			directories.push_back(fs::relative(it->path(), m_Root, error).generic_string());
+		}
+	}
+
+	for (const std::string& directory : directories)
+	{
+		std::string full = directory.empty() ? m_Root : m_Root + "/" + directory;
+		int watch = inotify_add_watch(m_Inotify, full.c_str(), WATCH_MASK);
+		if (watch < 0)
+		{
+			// usually fs.inotify.max_user_watches, changes below this directory go unnoticed
+			std::cout << "ERROR::WATCHER::ADD_WATCH_FAILED " << full << (errno == ENOSPC ? " (watch limit reached)" : "") << std::endl;
+			continue;
+		}
+		m_Watches[watch] = directory;
+	}
+}
+
+void DirectoryWatcher::Run()
+{
+	// walking a large tree takes a while, it is done here so Start returns right away
+	AddWatches("");
+	if (m_Watches.empty())
+		return;
+
+	alignas(inotify_event) char buffer[64 * 1024];
+
+	while (!m_Stopping)
+	{
+		pollfd descriptor = { m_Inotify, POLLIN, 0 };
+		if (poll(&descriptor, 1, POLL_TIMEOUT_MS) <= 0)
+			continue;
+
+		ssize_t length = read(m_Inotify, buffer, sizeof(buffer));
+		if (length <= 0)
+			continue;
+
+		for (char* data = buffer; data < buffer + length; )
+		{
+			const inotify_event* event = reinterpret_cast<const inotify_event*>(data);
+			data += sizeof(inotify_event) + event->len;
+
+			if (event->mask & IN_Q_OVERFLOW)
+			{
+				std::lock_guard<std::mutex> lock(m_Mutex);
+				m_Overflowed = true;
+				continue;
+			}
+			if (event->mask & IN_IGNORED)
+			{
+				m_Watches.erase(event->wd);
+				continue;
+			}
+
+			auto watch = m_Watches.find(event->wd);
+			if (watch == m_Watches.end() || event->len == 0 || event->name[0] == '.')
+				continue;
+
+			std::string path = watch->second.empty() ? std::string(event->name) : watch->second + "/" + event->name;
+			// files can land in a new directory before its watch exists, the directory itself is reported so the caller rescans it
+			if (m_Recursive && (event->mask & IN_ISDIR) && (event->mask & (IN_CREATE | IN_MOVED_TO)))
+				AddWatches(path);
+			Push(path);
+		}
+	}
+}
+
+#endif
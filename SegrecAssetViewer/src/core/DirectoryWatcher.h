@@ -0,0 +1,58 @@
+#ifndef DIRECTORYWATCHER_H
+#define DIRECTORYWATCHER_H
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// reports files and directories created, changed, renamed or deleted anywhere below a directory (hidden directories are skipped on Linux).
+// inotify on Linux (one watch per directory, added as directories appear), ReadDirectoryChangesW on Windows.
+// events are collected on a thread of its own and picked up with Poll, duplicates within one poll are merged.
+class DirectoryWatcher
+{
+public:
+	DirectoryWatcher() = default;
+	~DirectoryWatcher();
+
+	DirectoryWatcher(const DirectoryWatcher&) = delete;
+	DirectoryWatcher& operator=(const DirectoryWatcher&) = delete;
+
+	// recursive = false only reports the entries directly inside the directory
+	bool Start(const std::string& directory, bool recursive = true);
+	void Stop();
+	bool IsRunning() const;
+
+	// paths relative to the watched directory with '/' separators. overflowed is set when events were lost
+	// (kernel queue full), the caller has to rescan everything then
+	void Poll(std::vector<std::string>& changedPaths, bool& overflowed);
+
+private:
+	void Run();
+	void Push(const std::string& path);
+
+private:
+	std::string m_Root;
+	bool m_Recursive = true;
+	std::thread m_Thread;
+	std::atomic<bool> m_Stopping{ false };
+	bool m_Running = false;
+
+	std::mutex m_Mutex;
+	std::vector<std::string> m_Changes;
+	bool m_Overflowed = false;
+
+#ifdef _WIN32
+	void* m_Directory = nullptr;
+	void* m_StopEvent = nullptr;
+#else
+	int m_Inotify = -1;
+	// watch descriptor -> directory relative to the root ("" for the root itself)
+	std::unordered_map<int, std::string> m_Watches;
+	void AddWatches(const std::string& relative);
+#endif
+};
+
+#endif // !DIRECTORYWATCHER_H
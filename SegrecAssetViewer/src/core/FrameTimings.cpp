@@ -0,0 +1,107 @@
+#include "FrameTimings.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+
+void FrameTimings::Reserve(size_t frames)
+{
+	m_Cpu.reserve(frames);
+	m_Gpu.reserve(frames);
+}
+
+void FrameTimings::AddFrame(double cpuMilliseconds)
+{
+	m_Cpu.push_back(cpuMilliseconds);
+	m_Gpu.push_back(-1.0);
+}
+
+void FrameTimings::SetGpu(size_t frame, double gpuMilliseconds)
+{
+	if (frame < m_Gpu.size())
+		m_Gpu[frame] = gpuMilliseconds;
+}
+
+size_t FrameTimings::GetFrameCount() const
+{
+	return m_Cpu.size();
+}
+
+FrameTimings::Summary FrameTimings::SummarizeCpu() const
+{
+	return Summarize(m_Cpu);
+}
+
+FrameTimings::Summary FrameTimings::SummarizeGpu() const
+{
+	std::vector<double> known;
+	known.reserve(m_Gpu.size());
+	for (double gpu : m_Gpu)
+	{
+		if (gpu >= 0.0)
+			known.push_back(gpu);
+	}
+	return Summarize(std::move(known));
+}
+
+FrameTimings::Summary FrameTimings::Summarize(std::vector<double> values)
+{
+	Summary summary;
+	summary.frames = values.size();
+	if (values.empty())
+		return summary;
+
+	std::sort(values.begin(), values.end());
+	double sum = 0.0;
+	for (double value : values)
+		sum += value;
+	summary.mean = sum / values.size();
+	// nearest rank, p99 of 100 frames is the second slowest
+	auto percentile = [&values](double p)
+	{
+		size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * values.size()));
+		return values[std::min(std::max(rank, size_t(1)), values.size()) - 1];
+	};
+	summary.p50 = percentile(50.0);
+	summary.p90 = percentile(90.0);
+	summary.p95 = percentile(95.0);
+	summary.p99 = percentile(99.0);
+	summary.max = values.back();
+	return summary;
+}
+
+bool FrameTimings::WriteCsv(const std::string& path) const
+{
+	std::ofstream file(path, std::ios::trunc);
+	if (!file)
+		return false;
+
+	file << "frame,cpu_ms,gpu_ms\n";
+	char line[96];
+	for (size_t i = 0; i < m_Cpu.size(); i++)
+	{
+		if (m_Gpu[i] >= 0.0)
+			std::snprintf(line, sizeof(line), "%zu,%.4f,%.4f\n", i, m_Cpu[i], m_Gpu[i]);
+		else
+			std::snprintf(line, sizeof(line), "%zu,%.4f,\n", i, m_Cpu[i]);
+		file << line;
+	}
+	return static_cast<bool>(file);
+}
+
+std::string FrameTimings::FormatSummary() const
+{
+	std::string text;
+	char line[256];
+	const char* names[2] = { "cpu", "gpu" };
+	const Summary summaries[2] = { SummarizeCpu(), SummarizeGpu() };
+	for (int i = 0; i < 2; i++)
+	{
+		const Summary& summary = summaries[i];
+		std::snprintf(line, sizeof(line), "%s: %zu frames, mean %.2f ms, p50 %.2f, p90 %.2f, p95 %.2f, p99 %.2f, max %.2f\n", names[i],
+			summary.frames, summary.mean, summary.p50, summary.p90, summary.p95, summary.p99, summary.max);
+		text += line;
+	}
+	return text;
+}
@@ -0,0 +1,46 @@
+#ifndef FRAMETIMINGS_H
+#define FRAMETIMINGS_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// CPU and GPU time of every frame of a benchmark run, written as CSV with percentiles on top
+class FrameTimings
+{
+public:
+	struct Summary
+	{
+		size_t frames = 0;
+		double mean = 0.0;
+		double p50 = 0.0;
+		double p90 = 0.0;
+		double p95 = 0.0;
+		double p99 = 0.0;
+		double max = 0.0;
+	};
+
+	void Reserve(size_t frames);
+	void AddFrame(double cpuMilliseconds);
+	// GPU times arrive a few frames late, frames that never got one are left out of the GPU summary
+	void SetGpu(size_t frame, double gpuMilliseconds);
+	size_t GetFrameCount() const;
+
+	Summary SummarizeCpu() const;
+	Summary SummarizeGpu() const;
+
+	// frame,cpu_ms,gpu_ms with an empty gpu_ms where it is missing
+	bool WriteCsv(const std::string& path) const;
+	// two lines, CPU and GPU
+	std::string FormatSummary() const;
+
+private:
+	static Summary Summarize(std::vector<double> values);
+
+private:
+	std::vector<double> m_Cpu;
+	// negative while unknown
+	std::vector<double> m_Gpu;
+};
+
+#endif // !FRAMETIMINGS_H
@@ -0,0 +1,141 @@
+#include "ImageKernels.h"
+
+#include "Simd.h"
+
+#include <algorithm>
+#include <cstring>
+
+void ImageKernels::DownsampleHalf(const unsigned char* src, int width, int height, int channels,
+	std::vector<unsigned char>& dst, int& dstWidth, int& dstHeight)
+{
+	dstWidth = std::max(width / 2, 1);
+	dstHeight = std::max(height / 2, 1);
+	dst.resize(static_cast<size_t>(dstWidth) * dstHeight * channels);
+
+	for (int y = 0; y < dstHeight; y++)
+	{
+		const unsigned char* row0 = src + static_cast<size_t>(std::min(y * 2, height - 1)) * width * channels;
+		const unsigned char* row1 = src + static_cast<size_t>(std::min(y * 2 + 1, height - 1)) * width * channels;
+		unsigned char* out = &dst[static_cast<size_t>(y) * dstWidth * channels];
+		int x = 0;
+
+#if SIMD_SSE2
+		if (channels == 4)
+		{
+			// 8 source pixels of both rows -> 4 output pixels
+			for (; x + 4 <= dstWidth && (x + 4) * 2 <= width; x += 4)
+			{
+				const unsigned char* a = row0 + x * 8;
+				const unsigned char* b = row1 + x * 8;
+				__m128i v0 = _mm_avg_epu8(_mm_loadu_si128((const __m128i*)a), _mm_loadu_si128((const __m128i*)b));
+				__m128i v1 = _mm_avg_epu8(_mm_loadu_si128((const __m128i*)(a + 16)), _mm_loadu_si128((const __m128i*)(b + 16)));
+				__m128 f0 = _mm_castsi128_ps(v0);
+				__m128 f1 = _mm_castsi128_ps(v1);
+				__m128i even = _mm_castps_si128(_mm_shuffle_ps(f0, f1, _MM_SHUFFLE(2, 0, 2, 0)));
+				__m128i odd = _mm_castps_si128(_mm_shuffle_ps(f0, f1, _MM_SHUFFLE(3, 1, 3, 1)));
+				_mm_storeu_si128((__m128i*)(out + x * 4), _mm_avg_epu8(even, odd));
+			}
+		}
+		else if (channels == 1)
+		{
+			// 16 source pixels of both rows -> 8 output pixels
+			const __m128i lowBytes = _mm_set1_epi16(0x00FF);
+			for (; x + 8 <= dstWidth && (x + 8) * 2 <= width; x += 8)
+			{
+				__m128i v = _mm_avg_epu8(_mm_loadu_si128((const __m128i*)(row0 + x * 2)), _mm_loadu_si128((const __m128i*)(row1 + x * 2)));
+				__m128i even = _mm_and_si128(v, lowBytes);
+				__m128i odd = _mm_srli_epi16(v, 8);
+				__m128i result = _mm_avg_epu16(even, odd);
+				_mm_storel_epi64((__m128i*)(out + x), _mm_packus_epi16(result, result));
+			}
+		}
+#endif
+		for (; x < dstWidth; x++)
+		{
+			int x0 = std::min(x * 2, width - 1);
+			int x1 = std::min(x * 2 + 1, width - 1);
+			for (int c = 0; c < channels; c++)
+			{
+				int sum = row0[x0 * channels + c] + row0[x1 * channels + c] + row1[x0 * channels + c] + row1[x1 * channels + c];
+				out[x * channels + c] = static_cast<unsigned char>((sum + 2) / 4);
+			}
+		}
+	}
+}
+
+void ImageKernels::MakeThumbnail(const unsigned char* src, int width, int height, int channels, int size, std::vector<unsigned char>& dst)
+{
+	// halve until the image fits, the intermediate levels ping-pong between two buffers
+	std::vector<unsigned char> levels[2];
+	const unsigned char* current = src;
+	int w = width, h = height, index = 0;
+	while (w > size || h > size)
+	{
+		int nextWidth, nextHeight;
+		DownsampleHalf(current, w, h, channels, levels[index], nextWidth, nextHeight);
+		current = levels[index].data();
+		w = nextWidth;
+		h = nextHeight;
+		index ^= 1;
+	}
+
+	dst.assign(static_cast<size_t>(size) * size * 4, 0);
+	int offsetX = (size - w) / 2;
+	int offsetY = (size - h) / 2;
+	for (int y = 0; y < h; y++)
+	{
+		unsigned char* out = &dst[(static_cast<size_t>(y + offsetY) * size + offsetX) * 4];
+		const unsigned char* in = current + static_cast<size_t>(y) * w * channels;
+		if (channels == 4)
+		{
+			std::memcpy(out, in, static_cast<size_t>(w) * 4);
+			continue;
+		}
+		for (int x = 0; x < w; x++)
+		{
+			out[x * 4 + 0] = out[x * 4 + 1] = out[x * 4 + 2] = in[x];
+			out[x * 4 + 3] = 255;
+		}
+	}
+}
+
+void ImageKernels::CopyChannel(const unsigned char* src, int srcChannel, unsigned char* dst, int dstChannel, size_t pixelCount)
+{
+	size_t i = 0;
+#if SIMD_SSE2
+	// every pixel is a 32-bit lane, the channel is shifted into place and merged under a byte mask
+	const __m128i mask = _mm_set1_epi32(static_cast<int>(0xFFu << (dstChannel * 8)));
+	const __m128i leftShift = _mm_cvtsi32_si128(std::max(dstChannel - srcChannel, 0) * 8);
+	const __m128i rightShift = _mm_cvtsi32_si128(std::max(srcChannel - dstChannel, 0) * 8);
+	for (; i + 4 <= pixelCount; i += 4)
+	{
+		__m128i s = _mm_loadu_si128((const __m128i*)(src + i * 4));
+		s = _mm_srl_epi32(_mm_sll_epi32(s, leftShift), rightShift);
+		__m128i d = _mm_loadu_si128((const __m128i*)(dst + i * 4));
+		_mm_storeu_si128((__m128i*)(dst + i * 4), _mm_or_si128(_mm_andnot_si128(mask, d), _mm_and_si128(s, mask)));
+	}
+#endif
+	for (; i < pixelCount; i++)
+		dst[i * 4 + dstChannel] = src[i * 4 + srcChannel];
+}
+
+void ImageKernels::PackNormalXY(const unsigned char* src, unsigned char* dst, size_t pixelCount)
+{
+	size_t i = 0;
+#if SIMD_SSE2
+	// the low 16 bits of each pixel are x and y. sign extending them lets the signed pack keep the bits as they are
+	for (; i + 8 <= pixelCount; i += 8)
+	{
+		__m128i a = _mm_loadu_si128((const __m128i*)(src + i * 4));
+		__m128i b = _mm_loadu_si128((const __m128i*)(src + i * 4 + 16));
+		a = _mm_srai_epi32(_mm_slli_epi32(a, 16), 16);
+		b = _mm_srai_epi32(_mm_slli_epi32(b, 16), 16);
+		_mm_storeu_si128((__m128i*)(dst + i * 2), _mm_packs_epi32(a, b));
+	}
+#endif
+	for (; i < pixelCount; i++)
+	{
+		dst[i * 2 + 0] = src[i * 4 + 0];
+		dst[i * 2 + 1] = src[i * 4 + 1];
+	}
+}
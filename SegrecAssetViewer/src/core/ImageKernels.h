@@ -0,0 +1,25 @@
+#ifndef IMAGEKERNELS_H
+#define IMAGEKERNELS_H
+
+#include <cstddef>
+#include <vector>
+
+// 8-bit image helpers used by the texture palette, SSE2 with a scalar tail/fallback.
+// images are loaded as 1 (grey) or 4 (RGBA) channels, two-channel images only come out of PackNormalXY.
+class ImageKernels
+{
+public:
+	// 2x2 box filter, the result has the size of the next mip level (floor, at least 1)
+	static void DownsampleHalf(const unsigned char* src, int width, int height, int channels,
+		std::vector<unsigned char>& dst, int& dstWidth, int& dstHeight);
+
+	// fits the image into a size x size RGBA cell (aspect kept, centred, transparent border)
+	static void MakeThumbnail(const unsigned char* src, int width, int height, int channels, int size, std::vector<unsigned char>& dst);
+
+	// copies one channel of an RGBA image into a channel of another RGBA image of the same size, the other channels of dst stay
+	static void CopyChannel(const unsigned char* src, int srcChannel, unsigned char* dst, int dstChannel, size_t pixelCount);
+	// keeps the x and y of RGBA normals, the shader rebuilds z. dst holds 2 bytes per pixel
+	static void PackNormalXY(const unsigned char* src, unsigned char* dst, size_t pixelCount);
+};
+
+#endif // !IMAGEKERNELS_H
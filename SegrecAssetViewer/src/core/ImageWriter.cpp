@@ -0,0 +1,512 @@
+#include "ImageWriter.h"
+
+#include "ThreadPool.h"
+
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+	const int HASH_BITS = 15;
+	const int WINDOW_SIZE = 32768;
+	const int MIN_MATCH = 3;
+	const int MAX_MATCH = 258;
+	// PNG rows are filtered and deflated in strips of about this many bytes, one pool job each
+	const size_t STRIP_BYTES = 256 * 1024;
+	// scanlines per block of EXR's ZIP compression
+	const int EXR_BLOCK_LINES = 16;
+
+	const uint16_t LENGTH_BASE[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	const uint8_t LENGTH_EXTRA[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	const uint16_t DISTANCE_BASE[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073,
+		4097, 6145, 8193, 12289, 16385, 24577 };
+	const uint8_t DISTANCE_EXTRA[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+	// deflate writes bits LSB first, Huffman codes MSB first
+	uint32_t ReverseBits(uint32_t code, int length)
+	{
+		uint32_t result = 0;
+		for (int i = 0; i < length; i++)
+		{
+			result = (result << 1) | (code & 1);
+			code >>= 1;
+		}
+		return result;
+	}
+
+	// fixed Huffman code of every literal/length symbol (RFC 1951 3.2.6), already bit reversed
+	struct FixedCodes
+	{
+		uint16_t literalCode[288];
+		uint8_t literalLength[288];
+		uint16_t distanceCode[30];
+		// match length 3..258 -> length symbol index 0..28
+		uint8_t lengthIndex[MAX_MATCH + 1];
+
+		FixedCodes()
+		{
+			for (int symbol = 0; symbol < 288; symbol++)
+			{
+				uint32_t code;
+				int length;
+				if (symbol < 144)      { code = 0x30 + symbol;          length = 8; }
+				else if (symbol < 256) { code = 0x190 + symbol - 144;   length = 9; }
+				else if (symbol < 280) { code = symbol - 256;           length = 7; }
+				else                   { code = 0xC0 + symbol - 280;    length = 8; }
+				literalCode[symbol] = static_cast<uint16_t>(ReverseBits(code, length));
+				literalLength[symbol] = static_cast<uint8_t>(length);
+			}
+			for (int symbol = 0; symbol < 30; symbol++)
+				distanceCode[symbol] = static_cast<uint16_t>(ReverseBits(symbol, 5));
+			for (int length = MIN_MATCH, index = 0; length <= MAX_MATCH; length++)
+			{
+				while (index < 28 && LENGTH_BASE[index + 1] <= length)
+					index++;
+				lengthIndex[length] = static_cast<uint8_t>(index);
+			}
+		}
+	};
+
+	const FixedCodes& GetFixedCodes()
+	{
+		static const FixedCodes codes;
+		return codes;
+	}
+
+	class BitWriter
+	{
+	public:
+		explicit BitWriter(std::vector<unsigned char>& out) : m_Out(out) {}
+
+		void Put(uint32_t value, int count)
+		{
+			m_Bits |= static_cast<uint64_t>(value) << m_Count;
+			m_Count += count;
+			while (m_Count >= 8)
+			{
+				m_Out.push_back(static_cast<unsigned char>(m_Bits));
+				m_Bits >>= 8;
+				m_Count -= 8;
+			}
+		}
+
+		void Align()
+		{
+			if (m_Count > 0)
+				m_Out.push_back(static_cast<unsigned char>(m_Bits));
+			m_Bits = 0;
+			m_Count = 0;
+		}
+
+	private:
+		std::vector<unsigned char>& m_Out;
+		uint64_t m_Bits = 0;
+		int m_Count = 0;
+	};
+
+	// one fixed Huffman block over the data, no references before its start so blocks can be made in parallel.
+	// a block that is not final ends with an empty stored block, which byte aligns it for the next one
+	void Deflate(const unsigned char* data, size_t size, bool final, std::vector<unsigned char>& out)
+	{
+		const FixedCodes& codes = GetFixedCodes();
+		BitWriter writer(out);
+		writer.Put(final ? 1 : 0, 1);
+		writer.Put(1, 2);
+
+		std::vector<int32_t> head(static_cast<size_t>(1) << HASH_BITS, -1);
+		auto hash = [data](size_t position)
+		{
+			uint32_t value = (static_cast<uint32_t>(data[position]) << 16) | (static_cast<uint32_t>(data[position + 1]) << 8) | data[position + 2];
+			return (value * 2654435761u) >> (32 - HASH_BITS);
+		};
+
+		size_t i = 0;
+		while (i < size)
+		{
+			int matchLength = 0;
+			size_t matchDistance = 0;
+			if (i + MIN_MATCH <= size)
+			{
+				uint32_t h = hash(i);
+				int32_t candidate = head[h];
+				head[h] = static_cast<int32_t>(i);
+				if (candidate >= 0 && i - candidate <= WINDOW_SIZE)
+				{
+					size_t limit = std::min<size_t>(MAX_MATCH, size - i);
+					size_t length = 0;
+					while (length < limit && data[candidate + length] == data[i + length])
+						length++;
+					if (length >= MIN_MATCH)
+					{
+						matchLength = static_cast<int>(length);
+						matchDistance = i - candidate;
+					}
+				}
+			}
+
+			if (matchLength == 0)
+			{
+				writer.Put(codes.literalCode[data[i]], codes.literalLength[data[i]]);
+				i++;
+				continue;
+			}
+
+			int lengthIndex = codes.lengthIndex[matchLength];
+			int symbol = 257 + lengthIndex;
+			writer.Put(codes.literalCode[symbol], codes.literalLength[symbol]);
+			if (LENGTH_EXTRA[lengthIndex] > 0)
+				writer.Put(matchLength - LENGTH_BASE[lengthIndex], LENGTH_EXTRA[lengthIndex]);
+
+			int distanceIndex = 29;
+			while (DISTANCE_BASE[distanceIndex] > matchDistance)
+				distanceIndex--;
+			writer.Put(codes.distanceCode[distanceIndex], 5);
+			if (DISTANCE_EXTRA[distanceIndex] > 0)
+				writer.Put(static_cast<uint32_t>(matchDistance - DISTANCE_BASE[distanceIndex]), DISTANCE_EXTRA[distanceIndex]);
+
+			// the positions inside the match are hashed too, long runs of flat colour compress much better that way
+			for (size_t j = i + 1; j < i + matchLength && j + MIN_MATCH <= size; j++)
+				head[hash(j)] = static_cast<int32_t>(j);
+			i += matchLength;
+		}
+
+		writer.Put(codes.literalCode[256], codes.literalLength[256]);
+		if (!final)
+		{
+			writer.Put(0, 3);
+			writer.Align();
+			const unsigned char emptyStored[4] = { 0x00, 0x00, 0xFF, 0xFF };
+			out.insert(out.end(), emptyStored, emptyStored + 4);
+		}
+		else
+			writer.Align();
+	}
+
+	uint32_t Adler32(const unsigned char* data, size_t size, uint32_t adler = 1)
+	{
+		uint32_t a = adler & 0xFFFF, b = adler >> 16;
+		while (size > 0)
+		{
+			// largest run before the sums can overflow 32 bits
+			size_t chunk = std::min<size_t>(size, 5552);
+			size -= chunk;
+			for (size_t i = 0; i < chunk; i++)
+			{
+				a += *data++;
+				b += a;
+			}
+			a %= 65521;
+			b %= 65521;
+		}
+		return (b << 16) | a;
+	}
+
+	uint32_t Crc32(const unsigned char* data, size_t size, uint32_t crc = 0)
+	{
+		static const std::vector<uint32_t> table = []()
+		{
+			std::vector<uint32_t> values(256);
+			for (uint32_t n = 0; n < 256; n++)
+			{
+				uint32_t c = n;
+				for (int k = 0; k < 8; k++)
+					c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+				values[n] = c;
+			}
+			return values;
+		}();
+
+		crc = ~crc;
+		for (size_t i = 0; i < size; i++)
+			crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+		return ~crc;
+	}
+
+	void PutBigEndian(std::vector<unsigned char>& out, uint32_t value)
+	{
+		out.push_back(static_cast<unsigned char>(value >> 24));
+		out.push_back(static_cast<unsigned char>(value >> 16));
+		out.push_back(static_cast<unsigned char>(value >> 8));
+		out.push_back(static_cast<unsigned char>(value));
+	}
+
+	// zlib stream (RFC 1950) of a single deflate block
+	void ZlibCompress(const unsigned char* data, size_t size, std::vector<unsigned char>& out)
+	{
+		out.push_back(0x78);
+		out.push_back(0x01);
+		Deflate(data, size, true, out);
+		PutBigEndian(out, Adler32(data, size));
+	}
+
+	void WriteChunk(std::ofstream& file, const char type[4], const unsigned char* data, size_t size)
+	{
+		std::vector<unsigned char> header;
+		PutBigEndian(header, static_cast<uint32_t>(size));
+		header.insert(header.end(), type, type + 4);
+		uint32_t crc = Crc32(reinterpret_cast<const unsigned char*>(type), 4);
+		crc = Crc32(data, size, crc);
+
+		std::vector<unsigned char> footer;
+		PutBigEndian(footer, crc);
+		file.write(reinterpret_cast<const char*>(header.data()), header.size());
+		file.write(reinterpret_cast<const char*>(data), size);
+		file.write(reinterpret_cast<const char*>(footer.data()), footer.size());
+	}
+
+	unsigned char Paeth(int a, int b, int c)
+	{
+		int p = a + b - c;
+		int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+		if (pa <= pb && pa <= pc)
+			return static_cast<unsigned char>(a);
+		return static_cast<unsigned char>(pb <= pc ? b : c);
+	}
+
+	// picks the PNG filter with the smallest sum of absolute (signed) residuals, the usual heuristic.
+	// every filter gets its own loop, those vectorize, one loop with a switch per byte does not
+	void FilterRow(const unsigned char* row, const unsigned char* previous, size_t rowBytes, int channels, unsigned char* out, std::vector<unsigned char>& scratch)
+	{
+		scratch.assign(rowBytes * 6, 0);
+		// a missing previous row (first row) reads as zeros
+		const unsigned char* up = previous ? previous : &scratch[rowBytes * 5];
+		unsigned char* filtered[5];
+		for (int filter = 0; filter < 5; filter++)
+			filtered[filter] = &scratch[rowBytes * filter];
+
+		size_t c = static_cast<size_t>(channels);
+		for (size_t i = 0; i < rowBytes; i++)
+			filtered[0][i] = row[i];
+		for (size_t i = 0; i < c; i++)
+		{
+			filtered[1][i] = row[i];
+			filtered[2][i] = static_cast<unsigned char>(row[i] - up[i]);
+			filtered[3][i] = static_cast<unsigned char>(row[i] - up[i] / 2);
+			filtered[4][i] = static_cast<unsigned char>(row[i] - up[i]);
+		}
+		for (size_t i = c; i < rowBytes; i++)
+			filtered[1][i] = static_cast<unsigned char>(row[i] - row[i - c]);
+		for (size_t i = c; i < rowBytes; i++)
+			filtered[2][i] = static_cast<unsigned char>(row[i] - up[i]);
+		for (size_t i = c; i < rowBytes; i++)
+			filtered[3][i] = static_cast<unsigned char>(row[i] - ((row[i - c] + up[i]) >> 1));
+		for (size_t i = c; i < rowBytes; i++)
+			filtered[4][i] = static_cast<unsigned char>(row[i] - Paeth(row[i - c], up[i], up[i - c]));
+
+		uint64_t bestCost = UINT64_MAX;
+		int bestFilter = 0;
+		for (int filter = 0; filter < 5; filter++)
+		{
+			uint64_t cost = 0;
+			for (size_t i = 0; i < rowBytes; i++)
+				cost += static_cast<uint64_t>(std::abs(static_cast<int>(static_cast<signed char>(filtered[filter][i]))));
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestFilter = filter;
+			}
+		}
+
+		out[0] = static_cast<unsigned char>(bestFilter);
+		std::memcpy(out + 1, filtered[bestFilter], rowBytes);
+	}
+
+	// OpenEXR's ZIP preprocessing: bytes split into two halves, then delta coded
+	void ExrPredict(const unsigned char* raw, size_t size, std::vector<unsigned char>& out)
+	{
+		out.resize(size);
+		unsigned char* first = out.data();
+		unsigned char* second = out.data() + (size + 1) / 2;
+		for (size_t i = 0; i < size; i++)
+		{
+			if (i % 2 == 0)
+				*first++ = raw[i];
+			else
+				*second++ = raw[i];
+		}
+		int previous = out[0];
+		for (size_t i = 1; i < size; i++)
+		{
+			int value = out[i];
+			out[i] = static_cast<unsigned char>(value - previous + (128 + 256));
+			previous = value;
+		}
+	}
+
+	void PutLittleEndian(std::vector<unsigned char>& out, uint32_t value)
+	{
+		for (int i = 0; i < 4; i++)
+			out.push_back(static_cast<unsigned char>(value >> (i * 8)));
+	}
+
+	void PutAttribute(std::vector<unsigned char>& out, const char* name, const char* type, const std::vector<unsigned char>& value)
+	{
+		out.insert(out.end(), name, name + std::strlen(name) + 1);
+		out.insert(out.end(), type, type + std::strlen(type) + 1);
+		PutLittleEndian(out, static_cast<uint32_t>(value.size()));
+		out.insert(out.end(), value.begin(), value.end());
+	}
+}
+
+bool ImageWriter::WritePng(const std::string& path, int width, int height, int channels, const unsigned char* pixels, bool flipVertically)
+{
+	if (width <= 0 || height <= 0 || (channels != 3 && channels != 4))
+		return false;
+
+	size_t rowBytes = static_cast<size_t>(width) * channels;
+	int rowsPerStrip = static_cast<int>(std::max<size_t>(1, STRIP_BYTES / rowBytes));
+	int stripCount = (height + rowsPerStrip - 1) / rowsPerStrip;
+	auto sourceRow = [&](int y) { return pixels + static_cast<size_t>(flipVertically ? height - 1 - y : y) * rowBytes; };
+
+	// filtered rows of every strip are deflated on their own, the zlib checksum runs over all of them afterwards
+	std::vector<unsigned char> filtered(static_cast<size_t>(height) * (rowBytes + 1));
+	std::vector<std::vector<unsigned char>> strips(stripCount);
+	ThreadPool::Get().ParallelFor(0, stripCount, 1, [&](size_t begin, size_t end)
+	{
+		std::vector<unsigned char> scratch;
+		for (size_t strip = begin; strip < end; strip++)
+		{
+			int firstRow = static_cast<int>(strip) * rowsPerStrip;
+			int lastRow = std::min(height, firstRow + rowsPerStrip);
+			for (int y = firstRow; y < lastRow; y++)
+				FilterRow(sourceRow(y), y > 0 ? sourceRow(y - 1) : nullptr, rowBytes, channels, &filtered[static_cast<size_t>(y) * (rowBytes + 1)], scratch);
+
+			const unsigned char* stripData = &filtered[static_cast<size_t>(firstRow) * (rowBytes + 1)];
+			Deflate(stripData, static_cast<size_t>(lastRow - firstRow) * (rowBytes + 1), strip + 1 == static_cast<size_t>(stripCount), strips[strip]);
+		}
+	});
+
+	std::vector<unsigned char> compressed = { 0x78, 0x01 };
+	for (const std::vector<unsigned char>& strip : strips)
+		compressed.insert(compressed.end(), strip.begin(), strip.end());
+	PutBigEndian(compressed, Adler32(filtered.data(), filtered.size()));
+
+	std::ofstream file(path, std::ios::binary);
+	if (!file)
+	{
+		std::cout << "ERROR::IMAGE::NOT_WRITABLE: " << path << std::endl;
+		return false;
+	}
+
+	const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	file.write(reinterpret_cast<const char*>(signature), sizeof(signature));
+	std::vector<unsigned char> header;
+	PutBigEndian(header, static_cast<uint32_t>(width));
+	PutBigEndian(header, static_cast<uint32_t>(height));
+	// 8 bits, RGB or RGBA, deflate, adaptive filtering, no interlace
+	const unsigned char format[5] = { 8, static_cast<unsigned char>(channels == 4 ? 6 : 2), 0, 0, 0 };
+	header.insert(header.end(), format, format + 5);
+	WriteChunk(file, "IHDR", header.data(), header.size());
+	WriteChunk(file, "IDAT", compressed.data(), compressed.size());
+	WriteChunk(file, "IEND", nullptr, 0);
+	return static_cast<bool>(file);
+}
+
+bool ImageWriter::WriteExr(const std::string& path, int width, int height, const float* rgb, bool flipVertically)
+{
+	if (width <= 0 || height <= 0)
+		return false;
+
+	std::vector<unsigned char> header = { 0x76, 0x2F, 0x31, 0x01, 2, 0, 0, 0 };
+
+	// channels are stored in alphabetical order, all half float, no subsampling
+	std::vector<unsigned char> channels;
+	for (const char* name : { "B", "G", "R" })
+	{
+		channels.push_back(static_cast<unsigned char>(name[0]));
+		channels.push_back(0);
+		PutLittleEndian(channels, 1);
+		PutLittleEndian(channels, 0);
+		PutLittleEndian(channels, 1);
+		PutLittleEndian(channels, 1);
+	}
+	channels.push_back(0);
+	PutAttribute(header, "channels", "chlist", channels);
+	PutAttribute(header, "compression", "compression", { 3 });
+	std::vector<unsigned char> window;
+	for (uint32_t value : { 0u, 0u, static_cast<uint32_t>(width - 1), static_cast<uint32_t>(height - 1) })
+		PutLittleEndian(window, value);
+	PutAttribute(header, "dataWindow", "box2i", window);
+	PutAttribute(header, "displayWindow", "box2i", window);
+	PutAttribute(header, "lineOrder", "lineOrder", { 0 });
+	std::vector<unsigned char> one, zero;
+	float oneValue = 1.0f, zeroValue = 0.0f;
+	uint32_t oneBits, zeroBits;
+	std::memcpy(&oneBits, &oneValue, 4);
+	std::memcpy(&zeroBits, &zeroValue, 4);
+	PutLittleEndian(one, oneBits);
+	PutLittleEndian(zero, zeroBits);
+	PutAttribute(header, "pixelAspectRatio", "float", one);
+	std::vector<unsigned char> center = zero;
+	center.insert(center.end(), zero.begin(), zero.end());
+	PutAttribute(header, "screenWindowCenter", "v2f", center);
+	PutAttribute(header, "screenWindowWidth", "float", one);
+	header.push_back(0);
+
+	int blockCount = (height + EXR_BLOCK_LINES - 1) / EXR_BLOCK_LINES;
+	std::vector<std::vector<unsigned char>> blocks(blockCount);
+	ThreadPool::Get().ParallelFor(0, blockCount, 1, [&](size_t begin, size_t end)
+	{
+		std::vector<unsigned char> raw, predicted;
+		for (size_t block = begin; block < end; block++)
+		{
+			int firstLine = static_cast<int>(block) * EXR_BLOCK_LINES;
+			int lastLine = std::min(height, firstLine + EXR_BLOCK_LINES);
+			raw.clear();
+			for (int y = firstLine; y < lastLine; y++)
+			{
+				const float* row = rgb + static_cast<size_t>(flipVertically ? height - 1 - y : y) * width * 3;
+				for (int channel = 2; channel >= 0; channel--)
+				{
+					for (int x = 0; x < width; x++)
+					{
+						uint16_t half = glm::packHalf1x16(row[x * 3 + channel]);
+						raw.push_back(static_cast<unsigned char>(half));
+						raw.push_back(static_cast<unsigned char>(half >> 8));
+					}
+				}
+			}
+
+			ExrPredict(raw.data(), raw.size(), predicted);
+			std::vector<unsigned char> compressed;
+			ZlibCompress(predicted.data(), predicted.size(), compressed);
+			// a block that does not shrink is stored as is, readers tell by the size
+			const std::vector<unsigned char>& data = compressed.size() < raw.size() ? compressed : raw;
+
+			std::vector<unsigned char>& out = blocks[block];
+			PutLittleEndian(out, static_cast<uint32_t>(firstLine));
+			PutLittleEndian(out, static_cast<uint32_t>(data.size()));
+			out.insert(out.end(), data.begin(), data.end());
+		}
+	});
+
+	std::ofstream file(path, std::ios::binary);
+	if (!file)
+	{
+		std::cout << "ERROR::IMAGE::NOT_WRITABLE: " << path << std::endl;
+		return false;
+	}
+
+	// offset table: file position of every block
+	std::vector<unsigned char> offsets;
+	uint64_t position = header.size() + static_cast<uint64_t>(blockCount) * 8;
+	for (const std::vector<unsigned char>& block : blocks)
+	{
+		PutLittleEndian(offsets, static_cast<uint32_t>(position));
+		PutLittleEndian(offsets, static_cast<uint32_t>(position >> 32));
+		position += block.size();
+	}
+
+	file.write(reinterpret_cast<const char*>(header.data()), header.size());
+	file.write(reinterpret_cast<const char*>(offsets.data()), offsets.size());
+	for (const std::vector<unsigned char>& block : blocks)
+		file.write(reinterpret_cast<const char*>(block.data()), block.size());
+	return static_cast<bool>(file);
+}
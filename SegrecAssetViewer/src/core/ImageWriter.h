@@ -0,0 +1,19 @@
+#ifndef IMAGEWRITER_H
+#define IMAGEWRITER_H
+
+#include <string>
+
+// image encoders for captures. both formats are compressed in strips on the thread pool (safe to call from a pool job),
+// deflate uses fixed Huffman codes and a single-probe match finder: a lot faster than zlib's defaults, somewhat larger files.
+// rows are given top to bottom unless flipVertically is set (data read back from GL).
+class ImageWriter
+{
+public:
+	// 8-bit RGB (3 channels) or RGBA (4 channels)
+	static bool WritePng(const std::string& path, int width, int height, int channels, const unsigned char* pixels, bool flipVertically);
+
+	// half float RGB with ZIP compression, the input is linear float RGB
+	static bool WriteExr(const std::string& path, int width, int height, const float* rgb, bool flipVertically);
+};
+
+#endif // !IMAGEWRITER_H
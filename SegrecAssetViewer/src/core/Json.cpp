@@ -0,0 +1,404 @@
+#include "Json.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace
+{
+	const int MAX_DEPTH = 256;
+
+	const JsonValue& NullValue()
+	{
+		static const JsonValue value;
+		return value;
+	}
+
+	void AppendUtf8(std::string& out, unsigned int codepoint)
+	{
+		if (codepoint < 0x80)
+			out += static_cast<char>(codepoint);
+		else if (codepoint < 0x800)
+		{
+			out += static_cast<char>(0xC0 | (codepoint >> 6));
+			out += static_cast<char>(0x80 | (codepoint & 0x3F));
+		}
+		else if (codepoint < 0x10000)
+		{
+			out += static_cast<char>(0xE0 | (codepoint >> 12));
+			out += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+			out += static_cast<char>(0x80 | (codepoint & 0x3F));
+		}
+		else
+		{
+			out += static_cast<char>(0xF0 | (codepoint >> 18));
+			out += static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F));
+			out += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+			out += static_cast<char>(0x80 | (codepoint & 0x3F));
+		}
+	}
+}
+
+// recursive descent over the raw text, values are built in place
+class JsonParser
+{
+public:
+	JsonParser(const char* text, size_t length)
+		: m_Text(text), m_End(text + length), m_Current(text)
+	{
+	}
+
+	bool ParseDocument(JsonValue& out)
+	{
+		SkipWhitespace();
+		if (!ParseValue(out, 0))
+			return false;
+		SkipWhitespace();
+		if (m_Current != m_End)
+			return Fail("unexpected data after the document");
+		return true;
+	}
+
+	const std::string& GetError() const { return m_Error; }
+
+private:
+	bool ParseValue(JsonValue& out, int depth)
+	{
+		if (depth > MAX_DEPTH)
+			return Fail("nesting too deep");
+		if (m_Current == m_End)
+			return Fail("unexpected end");
+
+		switch (*m_Current)
+		{
+		case '{': return ParseObject(out, depth);
+		case '[': return ParseArray(out, depth);
+		case '"':
+			out.m_Type = JsonValue::Type::String;
+			return ParseString(out.m_String);
+		case 't': return ParseLiteral("true", out, JsonValue::Type::Bool, true);
+		case 'f': return ParseLiteral("false", out, JsonValue::Type::Bool, false);
+		case 'n': return ParseLiteral("null", out, JsonValue::Type::Null, false);
+		default: return ParseNumber(out);
+		}
+	}
+
+	bool ParseObject(JsonValue& out, int depth)
+	{
+		out.m_Type = JsonValue::Type::Object;
+		m_Current++;
+		SkipWhitespace();
+		if (Consume('}'))
+			return true;
+
+		while (true)
+		{
+			SkipWhitespace();
+			if (m_Current == m_End || *m_Current != '"')
+				return Fail("expected a member name");
+
+			out.m_Members.emplace_back();
+			if (!ParseString(out.m_Members.back().first))
+				return false;
+			SkipWhitespace();
+			if (!Consume(':'))
+				return Fail("expected ':'");
+			SkipWhitespace();
+			if (!ParseValue(out.m_Members.back().second, depth + 1))
+				return false;
+			SkipWhitespace();
+			if (Consume('}'))
+				return true;
+			if (!Consume(','))
+				return Fail("expected ',' or '}'");
+		}
+	}
+
+	bool ParseArray(JsonValue& out, int depth)
+	{
+		out.m_Type = JsonValue::Type::Array;
+		m_Current++;
+		SkipWhitespace();
+		if (Consume(']'))
+			return true;
+
+		while (true)
+		{
+			SkipWhitespace();
+			out.m_Array.emplace_back();
+			if (!ParseValue(out.m_Array.back(), depth + 1))
+				return false;
+			SkipWhitespace();
+			if (Consume(']'))
+				return true;
+			if (!Consume(','))
+				return Fail("expected ',' or ']'");
+		}
+	}
+
+	bool ParseString(std::string& out)
+	{
+		m_Current++;
+		while (m_Current != m_End)
+		{
+			char c = *m_Current++;
+			if (c == '"')
+				return true;
+			if (c != '\\')
+			{
+				out += c;
+				continue;
+			}
+
+			if (m_Current == m_End)
+				break;
+			char escape = *m_Current++;
+			switch (escape)
+			{
+			case '"': out += '"'; break;
+			case '\\': out += '\\'; break;
+			case '/': out += '/'; break;
+			case 'b': out += '\b'; break;
+			case 'f': out += '\f'; break;
+			case 'n': out += '\n'; break;
+			case 'r': out += '\r'; break;
+			case 't': out += '\t'; break;
+			case 'u':
+			{
+				unsigned int codepoint;
+				if (!ParseHex4(codepoint))
+					return Fail("invalid \\u escape");
+				// surrogate pair
+				if (codepoint >= 0xD800 && codepoint < 0xDC00 && m_End - m_Current >= 6 && m_Current[0] == '\\' && m_Current[1] == 'u')
+				{
+					m_Current += 2;
+					unsigned int low;
+					if (!ParseHex4(low) || low < 0xDC00 || low >= 0xE000)
+						return Fail("invalid surrogate pair");
+					codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (low - 0xDC00);
+				}
+				AppendUtf8(out, codepoint);
+				break;
+			}
+			default:
+				return Fail("invalid escape");
+			}
+		}
+		return Fail("unterminated string");
+	}
+
+	bool ParseHex4(unsigned int& out)
+	{
+		if (m_End - m_Current < 4)
+			return false;
+		out = 0;
+		for (int i = 0; i < 4; i++)
+		{
+			char c = *m_Current++;
+			out <<= 4;
+			if (c >= '0' && c <= '9')
+				out |= c - '0';
+			else if (c >= 'a' && c <= 'f')
+				out |= c - 'a' + 10;
+			else if (c >= 'A' && c <= 'F')
+				out |= c - 'A' + 10;
+			else
+				return false;
+		}
+		return true;
+	}
+
+	bool ParseNumber(JsonValue& out)
+	{
+		// the text is not terminated, strtod gets a bounded copy
+		char buffer[64];
+		size_t length = 0;
+		while (m_Current + length != m_End && length < sizeof(buffer) - 1 && std::strchr("+-0123456789.eE", m_Current[length]) && m_Current[length] != '\0')
+		{
+			buffer[length] = m_Current[length];
+			length++;
+		}
+		buffer[length] = '\0';
+
+		char* end = nullptr;
+		double value = std::strtod(buffer, &end);
+		if (length == 0 || end != buffer + length)
+			return Fail("invalid value");
+
+		out.m_Type = JsonValue::Type::Number;
+		out.m_Number = value;
+		m_Current += length;
+		return true;
+	}
+
+	bool ParseLiteral(const char* literal, JsonValue& out, JsonValue::Type type, bool value)
+	{
+		size_t length = std::strlen(literal);
+		if (static_cast<size_t>(m_End - m_Current) < length || std::strncmp(m_Current, literal, length) != 0)
+			return Fail("invalid value");
+
+		out.m_Type = type;
+		out.m_Bool = value;
+		m_Current += length;
+		return true;
+	}
+
+	void SkipWhitespace()
+	{
+		while (m_Current != m_End && (*m_Current == ' ' || *m_Current == '\t' || *m_Current == '\n' || *m_Current == '\r'))
+			m_Current++;
+	}
+
+	bool Consume(char c)
+	{
+		if (m_Current == m_End || *m_Current != c)
+			return false;
+		m_Current++;
+		return true;
+	}
+
+	bool Fail(const char* message)
+	{
+		if (m_Error.empty())
+			m_Error = std::string(message) + " at offset " + std::to_string(m_Current - m_Text);
+		return false;
+	}
+
+private:
+	const char* m_Text;
+	const char* m_End;
+	const char* m_Current;
+	std::string m_Error;
+};
+
+bool JsonValue::Parse(const char* text, size_t length, JsonValue& out, std::string& error)
+{
+	out = JsonValue();
+	JsonParser parser(text, length);
+	if (parser.ParseDocument(out))
+		return true;
+
+	error = parser.GetError();
+	out = JsonValue();
+	return false;
+}
+
+std::string JsonValue::Quote(const std::string& text)
+{
+	std::string out = "\"";
+	for (char c : text)
+	{
+		switch (c)
+		{
+		case '"': out += "\\\""; break;
+		case '\\': out += "\\\\"; break;
+		case '\n': out += "\\n"; break;
+		case '\r': out += "\\r"; break;
+		case '\t': out += "\\t"; break;
+		default:
+			if (static_cast<unsigned char>(c) < 0x20)
+			{
+				char escape[8];
+				std::snprintf(escape, sizeof(escape), "\\u%04x", c);
+				out += escape;
+			}
+			else
+				out += c;
+		}
+	}
+	return out + "\"";
+}
+
+JsonValue::Type JsonValue::GetType() const
+{
+	return m_Type;
+}
+
+bool JsonValue::IsNull() const
+{
+	return m_Type == Type::Null;
+}
+
+bool JsonValue::IsNumber() const
+{
+	return m_Type == Type::Number;
+}
+
+bool JsonValue::IsString() const
+{
+	return m_Type == Type::String;
+}
+
+bool JsonValue::IsArray() const
+{
+	return m_Type == Type::Array;
+}
+
+bool JsonValue::IsObject() const
+{
+	return m_Type == Type::Object;
+}
+
+double JsonValue::AsNumber(double fallback) const
+{
+	return m_Type == Type::Number ? m_Number : fallback;
+}
+
+int JsonValue::AsInt(int fallback) const
+{
+	// out of range numbers would be undefined as int
+	if (m_Type != Type::Number || !(m_Number >= -2147483648.0 && m_Number <= 2147483647.0))
+		return fallback;
+	return static_cast<int>(m_Number);
+}
+
+bool JsonValue::AsBool(bool fallback) const
+{
+	return m_Type == Type::Bool ? m_Bool : fallback;
+}
+
+const std::string& JsonValue::AsString() const
+{
+	return m_String;
+}
+
+size_t JsonValue::Size() const
+{
+	if (m_Type == Type::Array)
+		return m_Array.size();
+	if (m_Type == Type::Object)
+		return m_Members.size();
+	return 0;
+}
+
+const JsonValue& JsonValue::operator[](size_t index) const
+{
+	if (m_Type != Type::Array || index >= m_Array.size())
+		return NullValue();
+	return m_Array[index];
+}
+
+const JsonValue& JsonValue::operator[](const char* key) const
+{
+	for (const auto& member : m_Members)
+	{
+		if (member.first == key)
+			return member.second;
+	}
+	return NullValue();
+}
+
+bool JsonValue::Has(const char* key) const
+{
+	for (const auto& member : m_Members)
+	{
+		if (member.first == key)
+			return true;
+	}
+	return false;
+}
+
+const std::vector<std::pair<std::string, JsonValue>>& JsonValue::GetMembers() const
+{
+	return m_Members;
+}
@@ -0,0 +1,58 @@
+#ifndef JSON_H
+#define JSON_H
+
+#include <string>
+#include <utility>
+#include <vector>
+
+// small read-only JSON document, enough for glTF headers and the viewer's own config files.
+// missing members and out of range elements return a shared null value, so lookups can be chained.
+class JsonValue
+{
+public:
+	enum class Type
+	{
+		Null,
+		Bool,
+		Number,
+		String,
+		Array,
+		Object
+	};
+
+	// parses text of the given length (no terminator needed), on failure error holds the message with the offset
+	static bool Parse(const char* text, size_t length, JsonValue& out, std::string& error);
+	// escapes a string for writing JSON, quotes included
+	static std::string Quote(const std::string& text);
+
+	Type GetType() const;
+	bool IsNull() const;
+	bool IsNumber() const;
+	bool IsString() const;
+	bool IsArray() const;
+	bool IsObject() const;
+
+	double AsNumber(double fallback = 0.0) const;
+	int AsInt(int fallback = 0) const;
+	bool AsBool(bool fallback = false) const;
+	const std::string& AsString() const;
+
+	// element count of arrays, member count of objects
+	size_t Size() const;
+	const JsonValue& operator[](size_t index) const;
+	const JsonValue& operator[](const char* key) const;
+	bool Has(const char* key) const;
+	const std::vector<std::pair<std::string, JsonValue>>& GetMembers() const;
+
+private:
+	friend class JsonParser;
+
+	Type m_Type = Type::Null;
+	bool m_Bool = false;
+	double m_Number = 0.0;
+	std::string m_String;
+	std::vector<JsonValue> m_Array;
+	std::vector<std::pair<std::string, JsonValue>> m_Members;
+};
+
+#endif // !JSON_H
@@ -0,0 +1,163 @@
+#include "MemoryTracker.h"
+
+#include <imgui/imgui.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+namespace
+{
+	const char* CATEGORY_NAMES[] = { "Meshes", "Textures", "Render targets", "Environment", "Picking BVHs" };
+}
+
+MemoryTracker& MemoryTracker::Get()
+{
+	static MemoryTracker tracker;
+	return tracker;
+}
+
+int MemoryTracker::Register(MemoryCategory category, const std::string& name, size_t cpuBytes, size_t gpuBytes)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	int id = m_NextId++;
+	m_Allocations[id] = Allocation{ category, name, cpuBytes, gpuBytes };
+	return id;
+}
+
+void MemoryTracker::Update(int id, size_t cpuBytes, size_t gpuBytes)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	auto found = m_Allocations.find(id);
+	if (found == m_Allocations.end())
+		return;
+
+	found->second.cpuBytes = cpuBytes;
+	found->second.gpuBytes = gpuBytes;
+}
+
+void MemoryTracker::Unregister(int id)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	m_Allocations.erase(id);
+}
+
+size_t MemoryTracker::GetTotalCpuBytes() const
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	size_t total = 0;
+	for (const auto& allocation : m_Allocations)
+		total += allocation.second.cpuBytes;
+	return total;
+}
+
+size_t MemoryTracker::GetTotalGpuBytes() const
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	size_t total = 0;
+	for (const auto& allocation : m_Allocations)
+		total += allocation.second.gpuBytes;
+	return total;
+}
+
+void MemoryTracker::DrawUI(bool* open)
+{
+	// copy under the lock, loader threads may register while the table is drawn
+	std::vector<Allocation> allocations;
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		allocations.reserve(m_Allocations.size());
+		for (const auto& allocation : m_Allocations)
+			allocations.push_back(allocation.second);
+	}
+	std::sort(allocations.begin(), allocations.end(), [](const Allocation& a, const Allocation& b)
+	{
+		return a.cpuBytes + a.gpuBytes > b.cpuBytes + b.gpuBytes;
+	});
+
+	ImGui::SetNextWindowSize(ImVec2(420, 400), ImGuiCond_FirstUseEver);
+	if (!ImGui::Begin("Memory", open))
+	{
+		ImGui::End();
+		return;
+	}
+
+	size_t totalCpu = 0, totalGpu = 0;
+	for (const Allocation& allocation : allocations)
+	{
+		totalCpu += allocation.cpuBytes;
+		totalGpu += allocation.gpuBytes;
+	}
+	ImGui::Text("CPU %s   GPU %s (estimated)", FormatBytes(totalCpu).c_str(), FormatBytes(totalGpu).c_str());
+
+	for (int category = 0; category < static_cast<int>(MemoryCategory::Count); category++)
+	{
+		size_t categoryCpu = 0, categoryGpu = 0;
+		int count = 0;
+		for (const Allocation& allocation : allocations)
+		{
+			if (static_cast<int>(allocation.category) != category)
+				continue;
+			categoryCpu += allocation.cpuBytes;
+			categoryGpu += allocation.gpuBytes;
+			count++;
+		}
+
+		char header[128];
+		std::snprintf(header, sizeof(header), "%s (%d)  CPU %s  GPU %s###%s", CATEGORY_NAMES[category], count,
+			FormatBytes(categoryCpu).c_str(), FormatBytes(categoryGpu).c_str(), CATEGORY_NAMES[category]);
+		if (!ImGui::CollapsingHeader(header))
+			continue;
+
+		if (ImGui::BeginTable(CATEGORY_NAMES[category], 3, ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders | ImGuiTableFlags_ScrollY, ImVec2(0, 180)))
+		{
+			ImGui::TableSetupColumn("Name");
+			ImGui::TableSetupColumn("CPU", ImGuiTableColumnFlags_WidthFixed, 80.0f);
+			ImGui::TableSetupColumn("GPU", ImGuiTableColumnFlags_WidthFixed, 80.0f);
+			ImGui::TableHeadersRow();
+			for (const Allocation& allocation : allocations)
+			{
+				if (static_cast<int>(allocation.category) != category)
+					continue;
+				ImGui::TableNextRow();
+				ImGui::TableSetColumnIndex(0);
+				ImGui::TextUnformatted(allocation.name.c_str());
+				ImGui::TableSetColumnIndex(1);
+				ImGui::TextUnformatted(FormatBytes(allocation.cpuBytes).c_str());
+				ImGui::TableSetColumnIndex(2);
+				ImGui::TextUnformatted(FormatBytes(allocation.gpuBytes).c_str());
+			}
+			ImGui::EndTable();
+		}
+	}
+
+	ImGui::End();
+}
+
+size_t MemoryTracker::TextureBytes(int width, int height, int bytesPerTexel, bool mipmapped)
+{
+	size_t bytes = 0;
+	while (true)
+	{
+		bytes += static_cast<size_t>(width) * height * bytesPerTexel;
+		if (!mipmapped || (width == 1 && height == 1))
+			break;
+		width = std::max(width / 2, 1);
+		height = std::max(height / 2, 1);
+	}
+	return bytes;
+}
+
+std::string MemoryTracker::FormatBytes(size_t bytes)
+{
+	char text[32];
+	if (bytes >= 1024ull * 1024 * 1024)
+		std::snprintf(text, sizeof(text), "%.2f GB", bytes / (1024.0 * 1024.0 * 1024.0));
+	else if (bytes >= 1024 * 1024)
+		std::snprintf(text, sizeof(text), "%.1f MB", bytes / (1024.0 * 1024.0));
+	else if (bytes >= 1024)
+		std::snprintf(text, sizeof(text), "%.1f KB", bytes / 1024.0);
+	else
+		std::snprintf(text, sizeof(text), "%zu B", bytes);
+	return text;
+}
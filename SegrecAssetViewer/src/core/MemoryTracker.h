@@ -0,0 +1,57 @@
+#ifndef MEMORYTRACKER_H
+#define MEMORYTRACKER_H
+
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+enum class MemoryCategory
+{
+	Mesh,
+	Texture,
+	RenderTarget,
+	Environment,
+	Picking,
+	Count
+};
+
+// attributes CPU and GPU bytes to meshes, textures and render targets.
+// GPU sizes are estimates from the internal format, drivers may pad or compress.
+class MemoryTracker
+{
+public:
+	static MemoryTracker& Get();
+
+	// returns an id used to update or remove the allocation later
+	int Register(MemoryCategory category, const std::string& name, size_t cpuBytes, size_t gpuBytes);
+	void Update(int id, size_t cpuBytes, size_t gpuBytes);
+	void Unregister(int id);
+
+	size_t GetTotalCpuBytes() const;
+	size_t GetTotalGpuBytes() const;
+
+	// ImGui window with one table per category
+	void DrawUI(bool* open);
+
+	// size of a 2D image with all mip levels
+	static size_t TextureBytes(int width, int height, int bytesPerTexel, bool mipmapped);
+	static std::string FormatBytes(size_t bytes);
+
+private:
+	MemoryTracker() = default;
+
+	struct Allocation
+	{
+		MemoryCategory category;
+		std::string name;
+		size_t cpuBytes;
+		size_t gpuBytes;
+	};
+
+	mutable std::mutex m_Mutex;
+	std::unordered_map<int, Allocation> m_Allocations;
+	int m_NextId = 0;
+};
+
+#endif // !MEMORYTRACKER_H
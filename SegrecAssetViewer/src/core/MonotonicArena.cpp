@@ -0,0 +1,74 @@
+#include "MonotonicArena.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <new>
+
+MonotonicArena::MonotonicArena(size_t blockBytes)
+	: m_BlockBytes(std::max<size_t>(blockBytes, 4096))
+{
+}
+
+MonotonicArena::~MonotonicArena()
+{
+	for (const Block& block : m_Blocks)
+		::operator delete(block.data);
+}
+
+void MonotonicArena::Reset()
+{
+	m_Current = 0;
+	m_Offset = 0;
+	m_Used = 0;
+}
+
+size_t MonotonicArena::GetUsedBytes() const
+{
+	return m_Used;
+}
+
+size_t MonotonicArena::GetCapacityBytes() const
+{
+	size_t capacity = 0;
+	for (const Block& block : m_Blocks)
+		capacity += block.size;
+	return capacity;
+}
+
+void* MonotonicArena::do_allocate(size_t bytes, size_t alignment)
+{
+	// the current block first, then the ones kept from before the last Reset, then a new one
+	for (; m_Current < m_Blocks.size(); m_Current++, m_Offset = 0)
+	{
+		const Block& block = m_Blocks[m_Current];
+		uintptr_t address = reinterpret_cast<uintptr_t>(block.data) + m_Offset;
+		size_t padding = (alignment - address % alignment) % alignment;
+		if (m_Offset + padding + bytes <= block.size)
+		{
+			m_Offset += padding + bytes;
+			m_Used += bytes;
+			return block.data + m_Offset - bytes;
+		}
+	}
+
+	// a request larger than a block gets a block of its own size
+	Block block;
+	block.size = std::max(m_BlockBytes, bytes + alignment);
+	block.data = static_cast<unsigned char*>(::operator new(block.size));
+	m_Blocks.push_back(block);
+	m_Current = m_Blocks.size() - 1;
+	uintptr_t address = reinterpret_cast<uintptr_t>(block.data);
+	size_t padding = (alignment - address % alignment) % alignment;
+	m_Offset = padding + bytes;
+	m_Used += bytes;
+	return block.data + padding;
+}
+
+void MonotonicArena::do_deallocate(void*, size_t, size_t)
+{
+}
+
+bool MonotonicArena::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+{
+	return this == &other;
+}
@@ -0,0 +1,46 @@
+#ifndef MONOTONICARENA_H
+#define MONOTONICARENA_H
+
+#include <cstddef>
+#include <memory_resource>
+#include <vector>
+
+// bump allocator for short lived temporaries, used through std::pmr containers. deallocation does nothing,
+// Reset forgets everything at once and keeps the blocks, so a loop that resets once per iteration stops allocating
+// after the first few rounds. not thread safe, containers using it may be read and written by workers but only
+// grow on the owning thread
+class MonotonicArena : public std::pmr::memory_resource
+{
+public:
+	explicit MonotonicArena(size_t blockBytes = 1024 * 1024);
+	~MonotonicArena() override;
+
+	MonotonicArena(const MonotonicArena&) = delete;
+	MonotonicArena& operator=(const MonotonicArena&) = delete;
+
+	void Reset();
+
+	// bytes handed out since the last Reset and bytes held in blocks
+	size_t GetUsedBytes() const;
+	size_t GetCapacityBytes() const;
+
+private:
+	void* do_allocate(size_t bytes, size_t alignment) override;
+	void do_deallocate(void* memory, size_t bytes, size_t alignment) override;
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+	struct Block
+	{
+		unsigned char* data;
+		size_t size;
+	};
+
+	size_t m_BlockBytes;
+	std::vector<Block> m_Blocks;
+	// block being filled and the first free byte in it
+	size_t m_Current = 0;
+	size_t m_Offset = 0;
+	size_t m_Used = 0;
+};
+
+#endif // !MONOTONICARENA_H
@@ -0,0 +1,196 @@
+#include "SessionRecording.h"
+
+#include <cstdio>
+#include <sstream>
+
+namespace
+{
+	// SEGREC_SESSION <version>, then one line per frame and event:
+	//   a <preset> <path>    asset loaded before the next frame
+	//   m <slot> <path>      texture requested for a material slot before the next frame
+	//   f <values>           a frame, in the order of WriteFrame
+	const char* HEADER = "SEGREC_SESSION";
+	const int VERSION = 1;
+
+	void WriteFloats(std::string& line, const float* values, int count)
+	{
+		char buffer[32];
+		for (int i = 0; i < count; i++)
+		{
+			// 9 significant digits read back to the same float
+			std::snprintf(buffer, sizeof(buffer), " %.9g", values[i]);
+			line += buffer;
+		}
+	}
+
+	std::string WriteFrame(const SessionFrame& frame)
+	{
+		std::string line = "f";
+		const float view[4] = { frame.deltaTime, frame.cameraYaw, frame.cameraPitch, frame.cameraRadius };
+		const float light[6] = { frame.lightRotation[0], frame.lightRotation[1], frame.lightIntensity, frame.ambientIntensity,
+			frame.specularIntensity, frame.shininess };
+		WriteFloats(line, view, 4);
+		WriteFloats(line, light, 6);
+		WriteFloats(line, frame.lightColor, 3);
+		WriteFloats(line, &frame.environmentIntensity, 1);
+		WriteFloats(line, frame.assetTranslation, 3);
+		WriteFloats(line, frame.assetRotation, 3);
+		WriteFloats(line, &frame.uniformScale, 1);
+		line += " " + std::to_string(frame.shadingMode) + " " + std::to_string(frame.flags);
+		return line;
+	}
+
+	bool ReadFrame(std::istringstream& in, SessionFrame& frame)
+	{
+		in >> frame.deltaTime >> frame.cameraYaw >> frame.cameraPitch >> frame.cameraRadius
+			>> frame.lightRotation[0] >> frame.lightRotation[1] >> frame.lightIntensity >> frame.ambientIntensity
+			>> frame.specularIntensity >> frame.shininess
+			>> frame.lightColor[0] >> frame.lightColor[1] >> frame.lightColor[2] >> frame.environmentIntensity
+			>> frame.assetTranslation[0] >> frame.assetTranslation[1] >> frame.assetTranslation[2]
+			>> frame.assetRotation[0] >> frame.assetRotation[1] >> frame.assetRotation[2] >> frame.uniformScale
+			>> frame.shadingMode >> frame.flags;
+		return !in.fail();
+	}
+
+	// the rest of the line after one separating space, paths may contain spaces
+	std::string ReadRest(std::istringstream& in)
+	{
+		std::string rest;
+		if (in.peek() == ' ')
+			in.get();
+		std::getline(in, rest);
+		return rest;
+	}
+}
+
+bool SessionRecorder::Start(const std::string& path)
+{
+	Stop();
+	m_File.open(path, std::ios::trunc);
+	if (!m_File)
+		return false;
+	m_Path = path;
+	m_Frames = 0;
+	m_File << HEADER << ' ' << VERSION << '\n';
+	return true;
+}
+
+void SessionRecorder::Stop()
+{
+	if (m_File.is_open())
+		m_File.close();
+}
+
+bool SessionRecorder::IsRecording() const
+{
+	return m_File.is_open();
+}
+
+void SessionRecorder::Record(const SessionFrame& frame)
+{
+	if (!m_File.is_open())
+		return;
+
+	if (!frame.assetPath.empty())
+		m_File << "a " << frame.assetPreset << ' ' << frame.assetPath << '\n';
+	for (int slot = 0; slot < 3; slot++)
+	{
+		if (!frame.materialMaps[slot].empty())
+			m_File << "m " << slot << ' ' << frame.materialMaps[slot] << '\n';
+	}
+	m_File << WriteFrame(frame) << '\n';
+	m_File.flush();
+	m_Frames++;
+}
+
+size_t SessionRecorder::GetFrameCount() const
+{
+	return m_Frames;
+}
+
+const std::string& SessionRecorder::GetPath() const
+{
+	return m_Path;
+}
+
+bool SessionReplay::Load(const std::string& path, std::string& error)
+{
+	m_Frames.clear();
+	std::ifstream file(path);
+	if (!file)
+	{
+		error = "can't open " + path;
+		return false;
+	}
+
+	std::string line;
+	std::string header;
+	int version = 0;
+	if (!std::getline(file, line) || !(std::istringstream(line) >> header >> version) || header != HEADER || version != VERSION)
+	{
+		error = path + " is not a session recording";
+		return false;
+	}
+
+	// events are collected into the frame that follows them
+	SessionFrame next;
+	size_t lineNumber = 1;
+	while (std::getline(file, line))
+	{
+		lineNumber++;
+		if (line.empty())
+			continue;
+		std::istringstream in(line);
+		std::string kind;
+		in >> kind;
+		bool valid = true;
+		if (kind == "a")
+		{
+			in >> next.assetPreset;
+			next.assetPath = ReadRest(in);
+			valid = !in.fail() && !next.assetPath.empty();
+		}
+		else if (kind == "m")
+		{
+			int slot = -1;
+			in >> slot;
+			valid = !in.fail() && slot >= 0 && slot < 3;
+			if (valid)
+				next.materialMaps[slot] = ReadRest(in);
+		}
+		else if (kind == "f")
+		{
+			valid = ReadFrame(in, next);
+			if (valid)
+			{
+				m_Frames.push_back(next);
+				next = SessionFrame();
+			}
+		}
+		else
+			valid = false;
+
+		if (!valid)
+		{
+			error = path + ":" + std::to_string(lineNumber) + ": malformed line";
+			m_Frames.clear();
+			return false;
+		}
+	}
+	if (m_Frames.empty())
+	{
+		error = path + " has no frames";
+		return false;
+	}
+	return true;
+}
+
+size_t SessionReplay::GetFrameCount() const
+{
+	return m_Frames.size();
+}
+
+const SessionFrame& SessionReplay::GetFrame(size_t frame) const
+{
+	return m_Frames[frame];
+}
@@ -0,0 +1,73 @@
+#ifndef SESSIONRECORDING_H
+#define SESSIONRECORDING_H
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+// viewer state of one frame. sessions record the state rather than raw input events: the camera, light and panel values
+// are written once per frame, loads and texture swaps as events before the frame they first show in. replaying only
+// assigns values, so a session draws the same frames on every build no matter how long each one took
+struct SessionFrame
+{
+	enum Flags
+	{
+		WireframeOverlay = 1 << 0,
+		RenderPlane = 1 << 1,
+		RenderShadows = 1 << 2,
+		ImageBasedLighting = 1 << 3,
+		Skybox = 1 << 4,
+		PackedMaterials = 1 << 5
+	};
+
+	// seconds the frame took while recording, replays use a fixed step instead
+	float deltaTime = 0.0f;
+	float cameraYaw = 0.0f, cameraPitch = 0.0f, cameraRadius = 0.0f;
+	float lightRotation[2] = {};
+	float lightIntensity = 0.0f, ambientIntensity = 0.0f, specularIntensity = 0.0f, shininess = 0.0f;
+	float lightColor[3] = {};
+	float environmentIntensity = 0.0f;
+	float assetTranslation[3] = {};
+	float assetRotation[3] = {};
+	float uniformScale = 1.0f;
+	// 0 lit, 1 wireframe, 2 unlit
+	int shadingMode = 0;
+	int flags = 0;
+
+	// events, empty when nothing happened: the asset loaded with its import preset id, texture paths requested per material slot
+	std::string assetPath;
+	std::string assetPreset;
+	std::string materialMaps[3];
+};
+
+// writes frames to a text file as they come, a crash keeps everything up to the last frame
+class SessionRecorder
+{
+public:
+	bool Start(const std::string& path);
+	void Stop();
+	bool IsRecording() const;
+
+	void Record(const SessionFrame& frame);
+	size_t GetFrameCount() const;
+	const std::string& GetPath() const;
+
+private:
+	std::ofstream m_File;
+	std::string m_Path;
+	size_t m_Frames = 0;
+};
+
+class SessionReplay
+{
+public:
+	bool Load(const std::string& path, std::string& error);
+
+	size_t GetFrameCount() const;
+	const SessionFrame& GetFrame(size_t frame) const;
+
+private:
+	std::vector<SessionFrame> m_Frames;
+};
+
+#endif // !SESSIONRECORDING_H
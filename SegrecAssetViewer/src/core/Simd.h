@@ -0,0 +1,13 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+// SSE2 is part of every x64 target, 32-bit builds get it with /arch:SSE2 (or -msse2).
+// kernels test SIMD_SSE2 and keep a scalar path for everything else.
+#if defined(_M_X64) || defined(__x86_64__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define SIMD_SSE2 1
+#include <emmintrin.h>
+#else
+#define SIMD_SSE2 0
+#endif
+
+#endif // !SIMD_H
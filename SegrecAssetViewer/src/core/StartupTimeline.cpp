@@ -0,0 +1,70 @@
+#include "StartupTimeline.h"
+
+#include <chrono>
+#include <cstdio>
+
+namespace
+{
+	// taken during static initialization, before main and the window
+	const std::chrono::steady_clock::time_point PROCESS_START = std::chrono::steady_clock::now();
+}
+
+StartupTimeline& StartupTimeline::Get()
+{
+	static StartupTimeline timeline;
+	return timeline;
+}
+
+void StartupTimeline::Mark(const std::string& name, double duration)
+{
+	Step step;
+	step.name = name;
+	step.milliseconds = GetMilliseconds();
+	step.duration = duration;
+	m_Steps.push_back(step);
+	if (HasFirstFrame())
+		Print(step, true);
+}
+
+void StartupTimeline::FirstFrame()
+{
+	if (HasFirstFrame())
+		return;
+
+	m_FirstFrame = GetMilliseconds();
+	for (const Step& step : m_Steps)
+		Print(step, false);
+	std::printf("startup: %8.1f ms  first frame (time to first frame)\n", m_FirstFrame);
+	std::fflush(stdout);
+}
+
+bool StartupTimeline::HasFirstFrame() const
+{
+	return m_FirstFrame > 0.0;
+}
+
+double StartupTimeline::GetTimeToFirstFrame() const
+{
+	return m_FirstFrame;
+}
+
+double StartupTimeline::GetMilliseconds() const
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - PROCESS_START).count();
+}
+
+const std::vector<StartupTimeline::Step>& StartupTimeline::GetSteps() const
+{
+	return m_Steps;
+}
+
+void StartupTimeline::Print(const Step& step, bool afterFirstFrame)
+{
+	// background work finishing after the first frame is marked with a +
+	const char* prefix = afterFirstFrame ? "+" : " ";
+	if (step.duration >= 0.0)
+		std::printf("startup: %s%7.1f ms  %s (%.1f ms)\n", prefix, step.milliseconds, step.name.c_str(), step.duration);
+	else
+		std::printf("startup: %s%7.1f ms  %s\n", prefix, step.milliseconds, step.name.c_str());
+	std::fflush(stdout);
+}
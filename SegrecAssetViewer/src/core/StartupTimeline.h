@@ -0,0 +1,44 @@
+#ifndef STARTUPTIMELINE_H
+#define STARTUPTIMELINE_H
+
+#include <string>
+#include <vector>
+
+// what happened between process start and the first frame, and what finished in the background after it.
+// steps are kept until the first frame is shown and printed together with the time to first frame, later steps are
+// printed as they are marked. render thread only
+class StartupTimeline
+{
+public:
+	struct Step
+	{
+		std::string name;
+		// since process start
+		double milliseconds = 0.0;
+		// how long the step itself took, negative when it is only a point in time
+		double duration = -1.0;
+	};
+
+	static StartupTimeline& Get();
+
+	void Mark(const std::string& name, double duration = -1.0);
+	// call right after the first buffer swap, prints the timeline so far
+	void FirstFrame();
+	bool HasFirstFrame() const;
+	// 0 before the first frame
+	double GetTimeToFirstFrame() const;
+	// since process start
+	double GetMilliseconds() const;
+	const std::vector<Step>& GetSteps() const;
+
+private:
+	StartupTimeline() = default;
+
+	static void Print(const Step& step, bool afterFirstFrame);
+
+private:
+	std::vector<Step> m_Steps;
+	double m_FirstFrame = 0.0;
+};
+
+#endif // !STARTUPTIMELINE_H
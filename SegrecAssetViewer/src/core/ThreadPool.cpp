@@ -0,0 +1,117 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(unsigned int threadCount)
+{
+	if (threadCount == 0)
+	{
+		unsigned int hardware = std::thread::hardware_concurrency();
+		threadCount = hardware > 1 ? hardware - 1 : 1;
+	}
+
+	m_Workers.reserve(threadCount);
+	for (unsigned int i = 0; i < threadCount; i++)
+		m_Workers.emplace_back(&ThreadPool::WorkerLoop, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Stopping = true;
+	}
+	m_Condition.notify_all();
+
+	for (std::thread& worker : m_Workers)
+		worker.join();
+}
+
+ThreadPool& ThreadPool::Get()
+{
+	static ThreadPool pool;
+	return pool;
+}
+
+unsigned int ThreadPool::GetThreadCount() const
+{
+	return static_cast<unsigned int>(m_Workers.size());
+}
+
+void ThreadPool::ParallelFor(size_t begin, size_t end, size_t grain, const std::function<void(size_t, size_t)>& fn)
+{
+	if (begin >= end)
+		return;
+
+	grain = std::max<size_t>(grain, 1);
+	size_t count = end - begin;
+	size_t chunkCount = (count + grain - 1) / grain;
+	if (chunkCount == 1 || m_Workers.empty())
+	{
+		fn(begin, end);
+		return;
+	}
+
+	// helpers hold the state by shared pointer, a helper that starts after the loop is done
+	// finds no chunk left and leaves without touching fn
+	struct State
+	{
+		std::atomic<size_t> next{ 0 };
+		std::atomic<int> active{ 0 };
+		std::mutex mutex;
+		std::condition_variable done;
+	};
+	auto state = std::make_shared<State>();
+
+	auto work = [state, begin, end, grain, chunkCount, &fn]()
+	{
+		state->active.fetch_add(1);
+		for (size_t chunk = state->next.fetch_add(1); chunk < chunkCount; chunk = state->next.fetch_add(1))
+		{
+			size_t chunkBegin = begin + chunk * grain;
+			fn(chunkBegin, std::min(chunkBegin + grain, end));
+		}
+		if (state->active.fetch_sub(1) == 1)
+		{
+			std::lock_guard<std::mutex> lock(state->mutex);
+			state->done.notify_all();
+		}
+	};
+
+	size_t helpers = std::min<size_t>(m_Workers.size(), chunkCount - 1);
+	for (size_t i = 0; i < helpers; i++)
+		Enqueue(work);
+
+	// the calling thread takes chunks as well and then waits for helpers still inside a chunk
+	work();
+
+	std::unique_lock<std::mutex> lock(state->mutex);
+	state->done.wait(lock, [&state]() { return state->active.load() == 0; });
+}
+
+void ThreadPool::Enqueue(std::function<void()> job)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Jobs.push_back(std::move(job));
+	}
+	m_Condition.notify_one();
+}
+
+void ThreadPool::WorkerLoop()
+{
+	while (true)
+	{
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_Condition.wait(lock, [this]() { return m_Stopping || !m_Jobs.empty(); });
+			if (m_Stopping && m_Jobs.empty())
+				return;
+
+			job = std::move(m_Jobs.front());
+			m_Jobs.pop_front();
+		}
+		job();
+	}
+}
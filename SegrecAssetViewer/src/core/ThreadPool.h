@@ -0,0 +1,58 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+class ThreadPool
+{
+public:
+	// threadCount == 0 uses every hardware thread but one (that one is left to the render loop)
+	explicit ThreadPool(unsigned int threadCount = 0);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	// shared pool used by the importers, IBL precomputation and everything else running in the background
+	static ThreadPool& Get();
+
+	unsigned int GetThreadCount() const;
+
+	// queues a job, the returned future holds its result
+	template<typename F>
+	auto Submit(F&& job) -> std::future<std::invoke_result_t<std::decay_t<F>>>
+	{
+		using Result = std::invoke_result_t<std::decay_t<F>>;
+		auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(job));
+		std::future<Result> result = task->get_future();
+		Enqueue([task]() { (*task)(); });
+		return result;
+	}
+
+	// splits [begin, end) into chunks of at least 'grain' items and runs fn(chunkBegin, chunkEnd) on them.
+	// the calling thread works on chunks too, so it is safe to call from inside a pool job.
+	void ParallelFor(size_t begin, size_t end, size_t grain, const std::function<void(size_t, size_t)>& fn);
+
+private:
+	void Enqueue(std::function<void()> job);
+	void WorkerLoop();
+
+private:
+	std::vector<std::thread> m_Workers;
+	std::deque<std::function<void()>> m_Jobs;
+	std::mutex m_Mutex;
+	std::condition_variable m_Condition;
+	bool m_Stopping = false;
+};
+
+#endif // !THREADPOOL_H
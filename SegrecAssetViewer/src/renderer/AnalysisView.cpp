@@ -0,0 +1,160 @@
+#include "AnalysisView.h"
+
+#include "MemoryTracker.h"
+
+#include <algorithm>
+#include <cmath>
+
+const char* GetAnalysisModeName(AnalysisMode mode)
+{
+	switch (mode)
+	{
+	case AnalysisMode::Overdraw:
+		return "Overdraw";
+	case AnalysisMode::TriangleDensity:
+		return "Triangle density";
+	case AnalysisMode::TexelDensity:
+		return "Texel density";
+	case AnalysisMode::DrawCost:
+		return "Draw cost";
+	case AnalysisMode::Difference:
+		return "Difference";
+	default:
+		return "None";
+	}
+}
+
+AnalysisView::AnalysisView()
+{
+	m_EmptyVertexArray = GLVertexArray::Create();
+}
+
+AnalysisView::~AnalysisView()
+{
+	for (Readback& readback : m_Readbacks)
+	{
+		if (readback.fence)
+			glDeleteSync(readback.fence);
+	}
+	if (m_MemoryId >= 0)
+		MemoryTracker::Get().Unregister(m_MemoryId);
+}
+
+void AnalysisView::CreateTarget(int width, int height)
+{
+	m_Width = width;
+	m_Height = height;
+	m_TopLevel = static_cast<int>(std::floor(std::log2(static_cast<float>(std::max(width, height)))));
+
+	// 16-bit float counts are exact far beyond any overdraw worth showing, and blendable everywhere
+	m_CountTexture = GLTexture::Create();
+	glBindTexture(GL_TEXTURE_2D, m_CountTexture.Get());
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R16F, width, height, 0, GL_RED, GL_FLOAT, nullptr);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glGenerateMipmap(GL_TEXTURE_2D);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	m_Framebuffer = GLFramebuffer::Create();
+	glBindFramebuffer(GL_FRAMEBUFFER, m_Framebuffer.Get());
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_CountTexture.Get(), 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	if (m_MemoryId >= 0)
+		MemoryTracker::Get().Unregister(m_MemoryId);
+	m_MemoryId = MemoryTracker::Get().Register(MemoryCategory::RenderTarget, "overdraw counts", 0, MemoryTracker::TextureBytes(width, height, 2, true));
+}
+
+void AnalysisView::BeginOverdraw(int width, int height)
+{
+	width = std::max(width, 1);
+	height = std::max(height, 1);
+	if (!m_Framebuffer || width != m_Width || height != m_Height)
+		CreateTarget(width, height);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, m_Framebuffer.Get());
+	glViewport(0, 0, m_Width, m_Height);
+	const float zero[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	glClearBufferfv(GL_COLOR, 0, zero);
+
+	m_DepthTest = glIsEnabled(GL_DEPTH_TEST);
+	m_Blend = glIsEnabled(GL_BLEND);
+	glDisable(GL_DEPTH_TEST);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_ONE, GL_ONE);
+}
+
+void AnalysisView::EndOverdraw(const Shader& heatShader, float maxOverdraw)
+{
+	if (!m_Blend)
+		glDisable(GL_BLEND);
+
+	// the 1x1 mip is the average count over the window
+	CollectReadbacks();
+	glBindTexture(GL_TEXTURE_2D, m_CountTexture.Get());
+	glGenerateMipmap(GL_TEXTURE_2D);
+	Readback& readback = m_Readbacks[m_ReadbackIndex];
+	if (!readback.fence)
+	{
+		if (!readback.buffer)
+		{
+			readback.buffer = GLBuffer::Create();
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer.Get());
+			glBufferData(GL_PIXEL_PACK_BUFFER, sizeof(float), nullptr, GL_STREAM_READ);
+		}
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer.Get());
+		glGetTexImage(GL_TEXTURE_2D, m_TopLevel, GL_RED, GL_FLOAT, nullptr);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		m_ReadbackIndex = (m_ReadbackIndex + 1) % READBACK_COUNT;
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(0, 0, m_Width, m_Height);
+	heatShader.Use();
+	heatShader.SetInt("counts", 0);
+	heatShader.SetFloat("maxOverdraw", std::max(maxOverdraw, 2.0f));
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, m_CountTexture.Get());
+	glDepthMask(GL_FALSE);
+	glBindVertexArray(m_EmptyVertexArray.Get());
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glBindVertexArray(0);
+	glDepthMask(GL_TRUE);
+	if (m_DepthTest)
+		glEnable(GL_DEPTH_TEST);
+}
+
+void AnalysisView::CollectReadbacks()
+{
+	for (Readback& readback : m_Readbacks)
+	{
+		if (!readback.fence || glClientWaitSync(readback.fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+			continue;
+
+		glDeleteSync(readback.fence);
+		readback.fence = nullptr;
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer.Get());
+		const void* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, sizeof(float), GL_MAP_READ_BIT);
+		if (mapped)
+		{
+			m_AverageOverdraw = *static_cast<const float*>(mapped);
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		}
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	}
+}
+
+float AnalysisView::GetAverageOverdraw() const
+{
+	return m_AverageOverdraw;
+}
+
+glm::vec3 AnalysisView::HeatColor(float t)
+{
+	const glm::vec3 ramp[5] = { glm::vec3(0.0f, 0.1f, 0.9f), glm::vec3(0.0f, 0.8f, 0.9f), glm::vec3(0.1f, 0.85f, 0.1f),
+		glm::vec3(0.95f, 0.9f, 0.0f), glm::vec3(0.95f, 0.05f, 0.0f) };
+	float position = std::clamp(t, 0.0f, 1.0f) * 4.0f;
+	int index = std::min(static_cast<int>(position), 3);
+	return glm::mix(ramp[index], ramp[index + 1], position - index);
+}
@@ -0,0 +1,80 @@
+#ifndef ANALYSISVIEW_H
+#define ANALYSISVIEW_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "GLResource.h"
+#include "Shader.h"
+
+enum class AnalysisMode : int
+{
+	None,
+	// fragments rasterized per pixel, depth test off
+	Overdraw,
+	// triangles per pixel from the screen-space derivatives of barycentrics
+	TriangleDensity,
+	// diffuse texels per pixel, i.e. the mip level the GPU samples
+	TexelDensity,
+	// every mesh coloured by its share of the triangles
+	DrawCost,
+	// signed distance of every vertex to a reference version of the asset, see GeometryDiff
+	Difference,
+	Count
+};
+
+const char* GetAnalysisModeName(AnalysisMode mode);
+
+// GPU side of the analysis view modes, drawn with the analysis shader instead of the lit one.
+// overdraw adds one per fragment into a float target that is shown as a heat map afterwards. its average over the window
+// comes from the target's 1x1 mip, read back without waiting a few frames later
+class AnalysisView
+{
+public:
+	AnalysisView();
+	~AnalysisView();
+
+	AnalysisView(const AnalysisView&) = delete;
+	AnalysisView& operator=(const AnalysisView&) = delete;
+
+	// binds the count target at window size with additive blending and no depth test
+	void BeginOverdraw(int width, int height);
+	// restores the state, starts the readback and draws the heat map into the default framebuffer.
+	// maxOverdraw is the count at the hot end of the ramp
+	void EndOverdraw(const Shader& heatShader, float maxOverdraw);
+	// fragments per window pixel, a few frames old
+	float GetAverageOverdraw() const;
+
+	// ramp of the analysis shaders (blue, cyan, green, yellow, red) for t in [0, 1], legends use it
+	static glm::vec3 HeatColor(float t);
+
+private:
+	void CreateTarget(int width, int height);
+	void CollectReadbacks();
+
+private:
+	static const int READBACK_COUNT = 3;
+
+	struct Readback
+	{
+		GLBuffer buffer;
+		GLsync fence = nullptr;
+	};
+
+	GLFramebuffer m_Framebuffer;
+	GLTexture m_CountTexture;
+	int m_Width = 0;
+	int m_Height = 0;
+	int m_TopLevel = 0;
+	GLVertexArray m_EmptyVertexArray;
+	int m_MemoryId = -1;
+
+	Readback m_Readbacks[READBACK_COUNT];
+	int m_ReadbackIndex = 0;
+	float m_AverageOverdraw = 0.0f;
+
+	GLboolean m_DepthTest = GL_TRUE;
+	GLboolean m_Blend = GL_FALSE;
+};
+
+#endif // !ANALYSISVIEW_H
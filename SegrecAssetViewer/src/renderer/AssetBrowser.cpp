@@ -0,0 +1,1007 @@
+#include "AssetBrowser.h"
+
+#include "MemoryTracker.h"
+#include "Model.h"
+#include "ThreadPool.h"
+
+#include <imgui/imgui.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+	const int THUMBNAIL_SIZE = 64;
+	const int ATLAS_SIZE = 1024;
+	const int THUMBNAILS_PER_ROW = ATLAS_SIZE / THUMBNAIL_SIZE;
+	const int ATLAS_SLOTS = THUMBNAILS_PER_ROW * THUMBNAILS_PER_ROW;
+	// thumbnails are rasterized at twice the size and filtered down
+	const int RASTER_SIZE = THUMBNAIL_SIZE * 2;
+	const size_t THUMBNAIL_BYTES = static_cast<size_t>(THUMBNAIL_SIZE) * THUMBNAIL_SIZE * 4;
+
+	const char CACHE_DIRECTORY[] = "cache/browser";
+	const char INDEX_MAGIC[4] = { 'S', 'A', 'B', 'I' };
+	const uint32_t INDEX_VERSION = 1;
+	// part of the thumbnail file name, bumped when the renderer changes
+	const uint32_t THUMBNAIL_VERSION = 1;
+
+	const int MAX_THUMBNAIL_LOADS = 8;
+	// the index is written when indexing goes idle, during long runs at most this often
+	const std::chrono::seconds INDEX_SAVE_INTERVAL(10);
+	const float ROW_HEIGHT = 40.0f;
+
+	uint64_t HashBytes(const void* data, size_t size, uint64_t hash = 14695981039346656037ull)
+	{
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	std::string HashToFileName(const std::string& directory, uint64_t hash, const char* extension)
+	{
+		std::ostringstream name;
+		name << directory << '/' << std::hex << std::setw(16) << std::setfill('0') << hash << extension;
+		return name.str();
+	}
+
+	std::string GetIndexPath(const std::string& root)
+	{
+		return HashToFileName(CACHE_DIRECTORY, HashBytes(root.data(), root.size()), ".index");
+	}
+
+	// keyed by path, size and modification time, a changed file gets a new thumbnail file instead of overwriting the old one
+	std::string GetThumbnailPath(const std::string& root, const AssetBrowser::Entry& entry)
+	{
+		std::string key = root + '/' + entry.path;
+		uint64_t hash = HashBytes(key.data(), key.size());
+		hash = HashBytes(&entry.size, sizeof(entry.size), hash);
+		hash = HashBytes(&entry.modified, sizeof(entry.modified), hash);
+		hash = HashBytes(&THUMBNAIL_VERSION, sizeof(THUMBNAIL_VERSION), hash);
+		return HashToFileName(std::string(CACHE_DIRECTORY) + "/thumbnails", hash, ".rgba");
+	}
+
+	std::string ToLower(std::string text)
+	{
+		std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+		return text;
+	}
+
+	bool HasAssetExtension(const std::unordered_set<std::string>& extensions, const std::string& path)
+	{
+		size_t dot = path.find_last_of('.');
+		if (dot == std::string::npos || path.find('/', dot) != std::string::npos)
+			return false;
+		return extensions.count(ToLower(path.substr(dot))) > 0;
+	}
+
+	// any component starting with a dot, .git and friends are never listed
+	bool IsHiddenPath(const std::string& path)
+	{
+		return !path.empty() && (path[0] == '.' || path.find("/.") != std::string::npos);
+	}
+
+	bool StatFile(const fs::path& path, uint64_t& size, int64_t& modified)
+	{
+		std::error_code error;
+		if (!fs::is_regular_file(path, error))
+			return false;
+		size = static_cast<uint64_t>(fs::file_size(path, error));
+		modified = static_cast<int64_t>(fs::last_write_time(path, error).time_since_epoch().count());
+		return !error;
+	}
+
+	std::string FormatSize(uint64_t bytes)
+	{
+		char text[32];
+		if (bytes >= 1024ull * 1024ull)
+			std::snprintf(text, sizeof(text), "%.1f MB", bytes / (1024.0 * 1024.0));
+		else
+			std::snprintf(text, sizeof(text), "%.1f KB", bytes / 1024.0);
+		return text;
+	}
+
+	// flat shaded three-quarter view of the whole model, rasterized on the CPU so thumbnails can be made on worker threads
+	bool RenderThumbnail(const Model& model, std::vector<unsigned char>& pixels)
+	{
+		glm::vec3 boundsMin(FLT_MAX), boundsMax(-FLT_MAX);
+		for (const Mesh& mesh : model.meshes)
+		{
+			for (const Vertex& vertex : mesh.vertices)
+			{
+				const glm::vec3& p = vertex.Position;
+				if (!std::isfinite(p.x) || !std::isfinite(p.y) || !std::isfinite(p.z))
+					continue;
+				for (int axis = 0; axis < 3; axis++)
+				{
+					boundsMin[axis] = std::min(boundsMin[axis], p[axis]);
+					boundsMax[axis] = std::max(boundsMax[axis], p[axis]);
+				}
+			}
+		}
+		if (boundsMin.x > boundsMax.x)
+			return false;
+
+		glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+		float radius = glm::length(boundsMax - boundsMin) * 0.5f;
+		if (!(radius > 0.0f) || !std::isfinite(radius))
+			radius = 1.0f;
+
+		glm::vec3 forward = glm::normalize(glm::vec3(-1.0f, -0.7f, -1.2f));
+		glm::vec3 right = glm::normalize(glm::cross(forward, glm::vec3(0.0f, 1.0f, 0.0f)));
+		glm::vec3 up = glm::cross(right, forward);
+		glm::vec3 light = glm::normalize(-forward + up * 0.6f + right * 0.3f);
+		float scale = RASTER_SIZE * 0.5f * 0.92f / radius;
+
+		auto project = [&](const glm::vec3& p)
+		{
+			glm::vec3 d = p - center;
+			return glm::vec3(RASTER_SIZE * 0.5f + glm::dot(d, right) * scale, RASTER_SIZE * 0.5f - glm::dot(d, up) * scale, glm::dot(d, forward));
+		};
+		auto edge = [](const glm::vec3& a, const glm::vec3& b, float x, float y)
+		{
+			return (b.x - a.x) * (y - a.y) - (b.y - a.y) * (x - a.x);
+		};
+
+		std::vector<float> depth(static_cast<size_t>(RASTER_SIZE) * RASTER_SIZE, FLT_MAX);
+		std::vector<float> shade(depth.size(), 0.0f);
+		for (const Mesh& mesh : model.meshes)
+		{
+			size_t vertexCount = mesh.vertices.size();
+			size_t cornerCount = mesh.indices.empty() ? vertexCount : mesh.indices.size();
+			for (size_t corner = 0; corner + 2 < cornerCount; corner += 3)
+			{
+				size_t ids[3];
+				for (int k = 0; k < 3; k++)
+					ids[k] = mesh.indices.empty() ? corner + k : mesh.indices[corner + k];
+				if (ids[0] >= vertexCount || ids[1] >= vertexCount || ids[2] >= vertexCount)
+					continue;
+
+				const glm::vec3& p0 = mesh.vertices[ids[0]].Position;
+				const glm::vec3& p1 = mesh.vertices[ids[1]].Position;
+				const glm::vec3& p2 = mesh.vertices[ids[2]].Position;
+				glm::vec3 a = project(p0), b = project(p1), c = project(p2);
+				float area = edge(a, b, c.x, c.y);
+				if (!(std::fabs(area) > 1e-8f))
+					continue;
+
+				glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+				float length = glm::length(normal);
+				if (!(length > 0.0f) || !std::isfinite(length))
+					continue;
+				// both sides lit, imported winding is not reliable
+				float intensity = 0.2f + 0.8f * std::fabs(glm::dot(normal / length, light));
+
+				int x0 = std::max(0, static_cast<int>(std::floor(std::min({ a.x, b.x, c.x }))));
+				int x1 = std::min(RASTER_SIZE - 1, static_cast<int>(std::ceil(std::max({ a.x, b.x, c.x }))));
+				int y0 = std::max(0, static_cast<int>(std::floor(std::min({ a.y, b.y, c.y }))));
+				int y1 = std::min(RASTER_SIZE - 1, static_cast<int>(std::ceil(std::max({ a.y, b.y, c.y }))));
+				float inverseArea = 1.0f / area;
+				for (int y = y0; y <= y1; y++)
+				{
+					for (int x = x0; x <= x1; x++)
+					{
+						float px = x + 0.5f, py = y + 0.5f;
+						float w0 = edge(b, c, px, py) * inverseArea;
+						float w1 = edge(c, a, px, py) * inverseArea;
+						float w2 = 1.0f - w0 - w1;
+						if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f)
+							continue;
+
+						float z = w0 * a.z + w1 * b.z + w2 * c.z;
+						size_t texel = static_cast<size_t>(y) * RASTER_SIZE + x;
+						if (z < depth[texel])
+						{
+							depth[texel] = z;
+							shade[texel] = intensity;
+						}
+					}
+				}
+			}
+		}
+
+		const float color[3] = { 0.78f, 0.80f, 0.84f };
+		pixels.assign(THUMBNAIL_BYTES, 0);
+		for (int y = 0; y < THUMBNAIL_SIZE; y++)
+		{
+			for (int x = 0; x < THUMBNAIL_SIZE; x++)
+			{
+				int covered = 0;
+				float sum = 0.0f;
+				for (int s = 0; s < 4; s++)
+				{
+					size_t texel = static_cast<size_t>(y * 2 + s / 2) * RASTER_SIZE + x * 2 + s % 2;
+					if (depth[texel] != FLT_MAX)
+					{
+						covered++;
+						sum += shade[texel];
+					}
+				}
+				if (covered == 0)
+					continue;
+
+				unsigned char* out = &pixels[(static_cast<size_t>(y) * THUMBNAIL_SIZE + x) * 4];
+				for (int channel = 0; channel < 3; channel++)
+					out[channel] = static_cast<unsigned char>(std::min(255.0f, color[channel] * sum / covered * 255.0f));
+				out[3] = static_cast<unsigned char>(covered * 255 / 4);
+			}
+		}
+		return true;
+	}
+}
+
+AssetBrowser::AssetBrowser()
+	: m_SlotOwners(ATLAS_SLOTS, -1), m_SlotLastUsed(ATLAS_SLOTS, 0)
+{
+	// "*.3ds;*.obj;..." -> ".3ds", ".obj", the set is copied into scan jobs so they do not need an importer
+	std::string list;
+	Assimp::Importer().GetExtensionList(list);
+	std::stringstream stream(list);
+	std::string item;
+	while (std::getline(stream, item, ';'))
+	{
+		if (item.size() > 2 && item[0] == '*')
+			m_Extensions.insert(ToLower(item.substr(1)));
+	}
+	m_LastIndexSave = std::chrono::steady_clock::now();
+}
+
+AssetBrowser::~AssetBrowser()
+{
+	m_Watcher.Stop();
+
+	// scan, import and thumbnail jobs post their results back to this object
+	{
+		std::unique_lock<std::mutex> lock(m_ResultMutex);
+		m_ResultCondition.wait(lock, [this]() { return m_InFlight == 0; });
+	}
+
+	if (m_IndexDirty && !m_Root.empty())
+		WriteIndex(GetIndexPath(m_Root), m_Root, m_Entries);
+	if (m_MemoryId >= 0)
+		MemoryTracker::Get().Unregister(m_MemoryId);
+}
+
+void AssetBrowser::Open(const std::string& directory)
+{
+	std::error_code error;
+	fs::path root = fs::weakly_canonical(fs::absolute(directory, error), error);
+	if (error || !fs::is_directory(root, error))
+	{
+		std::cout << "ERROR::BROWSER::NOT_A_DIRECTORY " << directory << std::endl;
+		return;
+	}
+	std::string rootString = root.generic_string();
+	if (rootString == m_Root)
+		return;
+
+	if (m_IndexDirty && !m_Root.empty())
+		QueueIndexSave();
+
+	// jobs of the previous root still finish, their results are dropped by generation
+	m_Generation++;
+	m_Watcher.Stop();
+	m_Root = rootString;
+	std::snprintf(m_RootBuffer, sizeof(m_RootBuffer), "%s", m_Root.c_str());
+	m_Entries.clear();
+	m_IndexDirty = false;
+	m_Scanning = false;
+	m_RescanRequested = false;
+	m_SelectedPath.clear();
+	RebuildLookup();
+
+	m_Watcher.Start(m_Root);
+	QueueScan();
+}
+
+const std::string& AssetBrowser::GetRoot() const
+{
+	return m_Root;
+}
+
+void AssetBrowser::Update()
+{
+	m_Frame++;
+	if (m_Root.empty())
+		return;
+
+	std::vector<std::string> changedPaths;
+	bool overflowed = false;
+	m_Watcher.Poll(changedPaths, overflowed);
+	if (overflowed)
+		QueueScan();
+	else if (!changedPaths.empty())
+		ApplyChanges(changedPaths);
+
+	std::deque<ScanResult> scans;
+	std::deque<ImportResult> imports;
+	std::deque<ThumbnailResult> thumbnails;
+	{
+		std::lock_guard<std::mutex> lock(m_ResultMutex);
+		scans.swap(m_ScanResults);
+		imports.swap(m_ImportResults);
+		thumbnails.swap(m_ThumbnailResults);
+	}
+
+	for (ScanResult& scan : scans)
+		ApplyScan(scan);
+
+	for (ImportResult& result : imports)
+	{
+		m_ImportsInFlight--;
+		if (result.generation != m_Generation)
+			continue;
+
+		auto found = m_Lookup.find(result.entry.path);
+		if (found == m_Lookup.end())
+			continue;
+		// the file changed while it was imported, the change already queued it again
+		Entry& entry = m_Entries[found->second];
+		if (entry.state != EntryState::Indexing || entry.size != result.entry.size || entry.modified != result.entry.modified)
+			continue;
+
+		int slot = entry.thumbnailSlot;
+		entry = result.entry;
+		entry.thumbnailSlot = slot;
+		m_IndexedCount++;
+		m_IndexDirty = true;
+		if (!result.thumbnail.empty() && std::find(m_Visible.begin(), m_Visible.end(), found->second) != m_Visible.end())
+			UploadThumbnail(entry, result.thumbnail);
+	}
+
+	for (ThumbnailResult& result : thumbnails)
+	{
+		m_ThumbnailLoadsInFlight--;
+		if (result.generation != m_Generation)
+			continue;
+
+		auto found = m_Lookup.find(result.path);
+		if (found == m_Lookup.end())
+			continue;
+		Entry& entry = m_Entries[found->second];
+		entry.thumbnailLoading = false;
+		if (entry.modified != result.modified)
+			continue;
+		if (result.pixels.size() != THUMBNAIL_BYTES)
+		{
+			// the cached thumbnail is gone, the asset is imported again to recreate it
+			if (entry.state == EntryState::Indexed)
+			{
+				entry.state = EntryState::Unindexed;
+				entry.hasThumbnail = false;
+				m_IndexedCount--;
+				m_BackgroundCursor = 0;
+			}
+			continue;
+		}
+		UploadThumbnail(entry, result.pixels);
+	}
+
+	// visible rows first. the background keeps two imports per worker queued, enough to hide the frame
+	// between a result and the next job while the pool queue stays short for everything else
+	int threads = static_cast<int>(ThreadPool::Get().GetThreadCount());
+	int backgroundLimit = std::max(2, threads * 2);
+	int visibleLimit = backgroundLimit + threads;
+	for (int index : m_Visible)
+	{
+		Entry& entry = m_Entries[index];
+		if (entry.state == EntryState::Unindexed && m_ImportsInFlight < visibleLimit)
+			QueueImport(entry);
+		else if (entry.state == EntryState::Indexed && entry.hasThumbnail && entry.thumbnailSlot < 0 && !entry.thumbnailLoading
+			&& m_ThumbnailLoadsInFlight < MAX_THUMBNAIL_LOADS)
+			QueueThumbnailLoad(entry);
+	}
+	while (!m_Scanning && m_ImportsInFlight < backgroundLimit && m_BackgroundCursor < m_Entries.size())
+	{
+		Entry& entry = m_Entries[m_BackgroundCursor++];
+		if (entry.state == EntryState::Unindexed)
+			QueueImport(entry);
+	}
+
+	auto now = std::chrono::steady_clock::now();
+	if (m_IndexDirty && !m_Scanning && (m_ImportsInFlight == 0 || now - m_LastIndexSave > INDEX_SAVE_INTERVAL))
+		QueueIndexSave();
+}
+
+bool AssetBrowser::Draw(bool* open, std::string& openedPath)
+{
+	bool opened = false;
+	ImGui::SetNextWindowSize(ImVec2(560, 620), ImGuiCond_FirstUseEver);
+	if (!ImGui::Begin("Asset browser", open))
+	{
+		ImGui::End();
+		return false;
+	}
+
+	if (ImGui::InputText("Project folder", m_RootBuffer, sizeof(m_RootBuffer), ImGuiInputTextFlags_EnterReturnsTrue))
+		Open(m_RootBuffer);
+	ImGui::Text("%zu assets, %zu indexed%s%s", m_Entries.size(), m_IndexedCount, m_Scanning ? ", scanning..." : "",
+		!m_Root.empty() && !m_Watcher.IsRunning() ? ", not watching for changes" : "");
+	if (ImGui::InputTextWithHint("##filter", "Filter", m_FilterBuffer, sizeof(m_FilterBuffer)))
+	{
+		m_Filter = ToLower(m_FilterBuffer);
+		m_FilterDirty = true;
+	}
+	if (m_FilterDirty)
+		UpdateFilter();
+
+	m_Visible.clear();
+	ImGuiTableFlags flags = ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV | ImGuiTableFlags_ScrollY | ImGuiTableFlags_Resizable;
+	if (ImGui::BeginTable("assets", 4, flags))
+	{
+		ImGui::TableSetupScrollFreeze(0, 1);
+		ImGui::TableSetupColumn("##thumbnail", ImGuiTableColumnFlags_WidthFixed, ROW_HEIGHT);
+		ImGui::TableSetupColumn("Asset", ImGuiTableColumnFlags_WidthStretch);
+		ImGui::TableSetupColumn("Triangles", ImGuiTableColumnFlags_WidthFixed, 80.0f);
+		ImGui::TableSetupColumn("Size", ImGuiTableColumnFlags_WidthFixed, 70.0f);
+		ImGui::TableHeadersRow();
+
+		// only the visible rows are submitted, 50k entries cost the same as a screenful
+		ImGuiListClipper clipper;
+		clipper.Begin(static_cast<int>(m_Filtered.size()), ROW_HEIGHT + ImGui::GetStyle().CellPadding.y * 2.0f);
+		while (clipper.Step())
+		{
+			for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++)
+			{
+				int index = m_Filtered[row];
+				const Entry& entry = m_Entries[index];
+				m_Visible.push_back(index);
+
+				ImGui::TableNextRow(ImGuiTableRowFlags_None, ROW_HEIGHT);
+				ImGui::PushID(index);
+
+				ImGui::TableSetColumnIndex(0);
+				if (entry.thumbnailSlot >= 0)
+				{
+					float cellUV = static_cast<float>(THUMBNAIL_SIZE) / ATLAS_SIZE;
+					ImVec2 uv0((entry.thumbnailSlot % THUMBNAILS_PER_ROW) * cellUV, (entry.thumbnailSlot / THUMBNAILS_PER_ROW) * cellUV);
+					ImVec2 uv1(uv0.x + cellUV, uv0.y + cellUV);
+					ImGui::Image(ImTextureRef((ImTextureID)(intptr_t)m_Atlas.Get()), ImVec2(ROW_HEIGHT, ROW_HEIGHT), uv0, uv1);
+					m_SlotLastUsed[entry.thumbnailSlot] = m_Frame;
+				}
+				else
+					ImGui::Dummy(ImVec2(ROW_HEIGHT, ROW_HEIGHT));
+
+				ImGui::TableSetColumnIndex(1);
+				if (ImGui::Selectable(entry.path.c_str(), entry.path == m_SelectedPath,
+					ImGuiSelectableFlags_SpanAllColumns | ImGuiSelectableFlags_AllowDoubleClick, ImVec2(0, ROW_HEIGHT)))
+				{
+					m_SelectedPath = entry.path;
+					if (ImGui::IsMouseDoubleClicked(ImGuiMouseButton_Left))
+					{
+						openedPath = m_Root + "/" + entry.path;
+						opened = true;
+					}
+				}
+				if (ImGui::IsItemHovered() && entry.state == EntryState::Indexed)
+					ImGui::SetTooltip("%s\n%u meshes, %u vertices, %u triangles\n%u textures, imported in %.1f ms", entry.path.c_str(),
+						entry.meshes, entry.vertices, entry.triangles, entry.textures, entry.loadMilliseconds);
+
+				ImGui::TableSetColumnIndex(2);
+				if (entry.state == EntryState::Indexed)
+					ImGui::Text("%u", entry.triangles);
+				else
+					ImGui::TextDisabled("%s", entry.state == EntryState::Failed ? "failed" : "...");
+
+				ImGui::TableSetColumnIndex(3);
+				ImGui::TextUnformatted(FormatSize(entry.size).c_str());
+
+				ImGui::PopID();
+			}
+		}
+		clipper.End();
+		ImGui::EndTable();
+	}
+
+	ImGui::End();
+	return opened;
+}
+
+size_t AssetBrowser::GetEntryCount() const
+{
+	return m_Entries.size();
+}
+
+size_t AssetBrowser::GetIndexedCount() const
+{
+	return m_IndexedCount;
+}
+
+bool AssetBrowser::IsScanning() const
+{
+	return m_Scanning;
+}
+
+void AssetBrowser::QueueScan()
+{
+	if (m_Scanning)
+	{
+		m_RescanRequested = true;
+		return;
+	}
+	m_Scanning = true;
+	{
+		std::lock_guard<std::mutex> lock(m_ResultMutex);
+		m_InFlight++;
+	}
+
+	int generation = m_Generation;
+	std::string root = m_Root;
+	std::unordered_set<std::string> extensions = m_Extensions;
+	// the cached index fills the list while the directory is walked
+	bool readIndex = m_Entries.empty();
+	ThreadPool::Get().Submit([this, generation, root, extensions, readIndex]()
+	{
+		if (readIndex)
+		{
+			ScanResult cached;
+			cached.generation = generation;
+			cached.fromCache = true;
+			cached.entries = ReadIndex(GetIndexPath(root), root);
+			if (!cached.entries.empty())
+			{
+				std::lock_guard<std::mutex> lock(m_ResultMutex);
+				m_ScanResults.push_back(std::move(cached));
+			}
+		}
+
+		ScanResult result;
+		result.generation = generation;
+		std::error_code error;
+		for (fs::recursive_directory_iterator it(root, fs::directory_options::skip_permission_denied, error), end; !error && it != end; it.increment(error))
+		{
+			std::string name = it->path().filename().string();
+			if (!name.empty() && name[0] == '.')
+			{
+				if (it->is_directory(error))
+					it.disable_recursion_pending();
+				continue;
+			}
+
+			Entry entry;
+			entry.path = fs::relative(it->path(), root, error).generic_string();
+			if (HasAssetExtension(extensions, entry.path) && StatFile(it->path(), entry.size, entry.modified))
+				result.entries.push_back(std::move(entry));
+		}
+		std::sort(result.entries.begin(), result.entries.end(), [](const Entry& a, const Entry& b) { return a.path < b.path; });
+
+		std::lock_guard<std::mutex> lock(m_ResultMutex);
+		m_ScanResults.push_back(std::move(result));
+		m_InFlight--;
+		m_ResultCondition.notify_all();
+	});
+}
+
+void AssetBrowser::QueueImport(Entry& entry)
+{
+	entry.state = EntryState::Indexing;
+	m_ImportsInFlight++;
+	{
+		std::lock_guard<std::mutex> lock(m_ResultMutex);
+		m_InFlight++;
+	}
+
+	int generation = m_Generation;
+	std::string root = m_Root;
+	Entry copy = entry;
+	copy.thumbnailSlot = -1;
+	copy.thumbnailLoading = false;
+	ThreadPool::Get().Submit([this, generation, root, copy]()
+	{
+		ImportResult result;
+		result.generation = generation;
+		result.entry = copy;
+		Entry& entry = result.entry;
+
+		// the fast preset and no GL: only the numbers and the silhouette are needed
+		Model model(root + "/" + copy.path, false, ModelLoader::Auto, ImportPreset::FastPreview, ModelStorage::CpuOnly);
+		entry.loadMilliseconds = static_cast<float>(model.loadMilliseconds);
+		if (!model.errorMessage.empty() || model.meshes.empty())
+			entry.state = EntryState::Failed;
+		else
+		{
+			entry.state = EntryState::Indexed;
+			entry.meshes = static_cast<unsigned int>(model.meshes.size());
+			entry.vertices = model.GetVertexCount();
+			entry.triangles = model.GetIndexCount() / 3;
+			entry.textures = static_cast<unsigned int>(model.textures_loaded.size());
+			entry.hasThumbnail = false;
+
+			if (RenderThumbnail(model, result.thumbnail))
+			{
+				std::string thumbnailPath = GetThumbnailPath(root, entry);
+				std::error_code error;
+				fs::create_directories(fs::path(thumbnailPath).parent_path(), error);
+				std::ofstream file(thumbnailPath, std::ios::binary);
+				file.write(reinterpret_cast<const char*>(result.thumbnail.data()), result.thumbnail.size());
+				entry.hasThumbnail = static_cast<bool>(file);
+			}
+		}
+
+		std::lock_guard<std::mutex> lock(m_ResultMutex);
+		m_ImportResults.push_back(std::move(result));
+		m_InFlight--;
+		m_ResultCondition.notify_all();
+	});
+}
+
+void AssetBrowser::QueueThumbnailLoad(Entry& entry)
+{
+	entry.thumbnailLoading = true;
+	m_ThumbnailLoadsInFlight++;
+	{
+		std::lock_guard<std::mutex> lock(m_ResultMutex);
+		m_InFlight++;
+	}
+
+	ThumbnailResult request;
+	request.generation = m_Generation;
+	request.path = entry.path;
+	request.modified = entry.modified;
+	std::string thumbnailPath = GetThumbnailPath(m_Root, entry);
+	ThreadPool::Get().Submit([this, request, thumbnailPath]() mutable
+	{
+		std::ifstream file(thumbnailPath, std::ios::binary);
+		request.pixels.resize(THUMBNAIL_BYTES);
+		file.read(reinterpret_cast<char*>(request.pixels.data()), request.pixels.size());
+		if (!file)
+			request.pixels.clear();
+
+		std::lock_guard<std::mutex> lock(m_ResultMutex);
+		m_ThumbnailResults.push_back(std::move(request));
+		m_InFlight--;
+		m_ResultCondition.notify_all();
+	});
+}
+
+void AssetBrowser::QueueIndexSave()
+{
+	m_IndexDirty = false;
+	m_LastIndexSave = std::chrono::steady_clock::now();
+	{
+		std::lock_guard<std::mutex> lock(m_ResultMutex);
+		m_InFlight++;
+	}
+
+	std::string root = m_Root;
+	std::vector<Entry> snapshot = m_Entries;
+	ThreadPool::Get().Submit([this, root, snapshot = std::move(snapshot)]()
+	{
+		{
+			std::lock_guard<std::mutex> fileLock(m_IndexFileMutex);
+			WriteIndex(GetIndexPath(root), root, snapshot);
+		}
+
+		std::lock_guard<std::mutex> lock(m_ResultMutex);
+		m_InFlight--;
+		m_ResultCondition.notify_all();
+	});
+}
+
+void AssetBrowser::ApplyScan(ScanResult& result)
+{
+	if (result.generation != m_Generation)
+		return;
+
+	if (result.fromCache)
+	{
+		// the scan may have been quicker than reading the index
+		if (!m_Entries.empty())
+			return;
+		m_Entries = std::move(result.entries);
+		RebuildLookup();
+		return;
+	}
+
+	m_Scanning = false;
+	// unchanged files keep their metadata, thumbnail slot and running import
+	for (Entry& entry : result.entries)
+	{
+		auto found = m_Lookup.find(entry.path);
+		if (found == m_Lookup.end())
+			continue;
+		Entry& previous = m_Entries[found->second];
+		if (previous.size == entry.size && previous.modified == entry.modified)
+			entry = previous;
+	}
+	m_Entries = std::move(result.entries);
+	RebuildLookup();
+	m_IndexDirty = true;
+
+	if (m_RescanRequested)
+	{
+		m_RescanRequested = false;
+		QueueScan();
+	}
+}
+
+void AssetBrowser::ApplyChanges(const std::vector<std::string>& changedPaths)
+{
+	bool rescan = false;
+	bool structural = false;
+	std::vector<bool> removed(m_Entries.size(), false);
+	for (const std::string& path : changedPaths)
+	{
+		if (IsHiddenPath(path))
+			continue;
+
+		fs::path full = fs::path(m_Root) / path;
+		std::error_code error;
+		if (fs::is_directory(full, error))
+		{
+			// a directory was created or moved in, its content is unknown
+			rescan = true;
+			continue;
+		}
+
+		uint64_t size = 0;
+		int64_t modified = 0;
+		bool exists = IsAssetFile(path) && StatFile(full, size, modified);
+		auto found = m_Lookup.find(path);
+		if (found != m_Lookup.end())
+		{
+			Entry& entry = m_Entries[found->second];
+			if (!exists)
+			{
+				removed[found->second] = true;
+				structural = true;
+				continue;
+			}
+			if (entry.size == size && entry.modified == modified)
+				continue;
+
+			// a running import notices the new modification time and is dropped
+			if (entry.state == EntryState::Indexed || entry.state == EntryState::Failed)
+				m_IndexedCount--;
+			ReleaseThumbnail(entry);
+			entry.size = size;
+			entry.modified = modified;
+			entry.state = EntryState::Unindexed;
+			entry.hasThumbnail = false;
+			m_BackgroundCursor = 0;
+			m_IndexDirty = true;
+		}
+		else if (exists)
+		{
+			Entry entry;
+			entry.path = path;
+			entry.size = size;
+			entry.modified = modified;
+			m_Entries.push_back(entry);
+			removed.push_back(false);
+			structural = true;
+		}
+		else
+		{
+			// a deleted or moved away directory shows up as a path some entries start with
+			std::string prefix = path + "/";
+			auto first = std::lower_bound(m_Entries.begin(), m_Entries.end(), prefix, [](const Entry& entry, const std::string& value) { return entry.path < value; });
+			if (first != m_Entries.end() && first->path.compare(0, prefix.size(), prefix) == 0)
+				rescan = true;
+		}
+	}
+
+	if (structural)
+	{
+		std::vector<Entry> entries;
+		entries.reserve(m_Entries.size());
+		for (size_t i = 0; i < m_Entries.size(); i++)
+		{
+			if (!removed[i])
+				entries.push_back(std::move(m_Entries[i]));
+		}
+		std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.path < b.path; });
+		m_Entries = std::move(entries);
+		RebuildLookup();
+		m_IndexDirty = true;
+	}
+	if (rescan)
+		QueueScan();
+}
+
+void AssetBrowser::RebuildLookup()
+{
+	m_Lookup.clear();
+	m_Lookup.reserve(m_Entries.size());
+	m_IndexedCount = 0;
+	std::fill(m_SlotOwners.begin(), m_SlotOwners.end(), -1);
+	for (size_t i = 0; i < m_Entries.size(); i++)
+	{
+		Entry& entry = m_Entries[i];
+		m_Lookup[entry.path] = static_cast<int>(i);
+		if (entry.state == EntryState::Indexed || entry.state == EntryState::Failed)
+			m_IndexedCount++;
+		if (entry.thumbnailSlot >= 0)
+			m_SlotOwners[entry.thumbnailSlot] = static_cast<int>(i);
+	}
+
+	// atlas cells and visible rows referred to indices of the old vector
+	m_Visible.clear();
+	m_BackgroundCursor = 0;
+	m_FilterDirty = true;
+}
+
+void AssetBrowser::UploadThumbnail(Entry& entry, const std::vector<unsigned char>& pixels)
+{
+	// a free cell, otherwise the least recently drawn one that was not on screen last frame
+	int slot = -1;
+	for (int i = 0; i < ATLAS_SLOTS; i++)
+	{
+		if (m_SlotOwners[i] < 0)
+		{
+			slot = i;
+			break;
+		}
+		if (m_SlotLastUsed[i] + 1 < m_Frame && (slot < 0 || m_SlotLastUsed[i] < m_SlotLastUsed[slot]))
+			slot = i;
+	}
+	if (slot < 0)
+		return;
+	if (m_SlotOwners[slot] >= 0)
+		m_Entries[m_SlotOwners[slot]].thumbnailSlot = -1;
+
+	if (!m_Atlas)
+	{
+		m_Atlas = GLTexture::Create();
+		glBindTexture(GL_TEXTURE_2D, m_Atlas.Get());
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, ATLAS_SIZE, ATLAS_SIZE, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		m_MemoryId = MemoryTracker::Get().Register(MemoryCategory::Texture, "asset browser thumbnails", 0,
+			MemoryTracker::TextureBytes(ATLAS_SIZE, ATLAS_SIZE, 4, false));
+	}
+
+	glBindTexture(GL_TEXTURE_2D, m_Atlas.Get());
+	glTexSubImage2D(GL_TEXTURE_2D, 0, (slot % THUMBNAILS_PER_ROW) * THUMBNAIL_SIZE, (slot / THUMBNAILS_PER_ROW) * THUMBNAIL_SIZE,
+		THUMBNAIL_SIZE, THUMBNAIL_SIZE, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	entry.thumbnailSlot = slot;
+	m_SlotOwners[slot] = static_cast<int>(&entry - m_Entries.data());
+	m_SlotLastUsed[slot] = m_Frame;
+}
+
+void AssetBrowser::ReleaseThumbnail(Entry& entry)
+{
+	if (entry.thumbnailSlot < 0)
+		return;
+	m_SlotOwners[entry.thumbnailSlot] = -1;
+	entry.thumbnailSlot = -1;
+}
+
+void AssetBrowser::UpdateFilter()
+{
+	m_Filtered.clear();
+	m_Filtered.reserve(m_Entries.size());
+	for (size_t i = 0; i < m_Entries.size(); i++)
+	{
+		if (m_Filter.empty() || ToLower(m_Entries[i].path).find(m_Filter) != std::string::npos)
+			m_Filtered.push_back(static_cast<int>(i));
+	}
+	m_FilterDirty = false;
+}
+
+bool AssetBrowser::IsAssetFile(const std::string& path) const
+{
+	return HasAssetExtension(m_Extensions, path);
+}
+
+std::vector<AssetBrowser::Entry> AssetBrowser::ReadIndex(const std::string& indexPath, const std::string& root)
+{
+	std::vector<Entry> entries;
+	std::ifstream file(indexPath, std::ios::binary);
+	if (!file)
+		return entries;
+
+	char magic[4];
+	uint32_t version = 0, rootLength = 0, count = 0;
+	file.read(magic, sizeof(magic));
+	file.read(reinterpret_cast<char*>(&version), sizeof(version));
+	file.read(reinterpret_cast<char*>(&rootLength), sizeof(rootLength));
+	if (!file || std::memcmp(magic, INDEX_MAGIC, sizeof(magic)) != 0 || version != INDEX_VERSION || rootLength != root.size())
+		return entries;
+	std::string storedRoot(rootLength, '\0');
+	file.read(&storedRoot[0], rootLength);
+	file.read(reinterpret_cast<char*>(&count), sizeof(count));
+	// two roots with the same hash
+	if (!file || storedRoot != root)
+		return entries;
+
+	entries.reserve(count);
+	for (uint32_t i = 0; i < count; i++)
+	{
+		Entry entry;
+		uint32_t pathLength = 0;
+		uint8_t state = 0, hasThumbnail = 0;
+		file.read(reinterpret_cast<char*>(&pathLength), sizeof(pathLength));
+		if (!file || pathLength == 0 || pathLength > 4096)
+			break;
+		entry.path.resize(pathLength);
+		file.read(&entry.path[0], pathLength);
+		file.read(reinterpret_cast<char*>(&entry.size), sizeof(entry.size));
+		file.read(reinterpret_cast<char*>(&entry.modified), sizeof(entry.modified));
+		file.read(reinterpret_cast<char*>(&state), sizeof(state));
+		file.read(reinterpret_cast<char*>(&hasThumbnail), sizeof(hasThumbnail));
+		file.read(reinterpret_cast<char*>(&entry.meshes), sizeof(entry.meshes));
+		file.read(reinterpret_cast<char*>(&entry.vertices), sizeof(entry.vertices));
+		file.read(reinterpret_cast<char*>(&entry.triangles), sizeof(entry.triangles));
+		file.read(reinterpret_cast<char*>(&entry.textures), sizeof(entry.textures));
+		file.read(reinterpret_cast<char*>(&entry.loadMilliseconds), sizeof(entry.loadMilliseconds));
+		if (!file)
+			break;
+		entry.state = state == static_cast<uint8_t>(EntryState::Indexed) || state == static_cast<uint8_t>(EntryState::Failed)
+			? static_cast<EntryState>(state) : EntryState::Unindexed;
+		entry.hasThumbnail = hasThumbnail != 0;
+		entries.push_back(std::move(entry));
+	}
+	// a truncated index is thrown away as a whole, the scan rebuilds it
+	if (entries.size() != count)
+		entries.clear();
+	return entries;
+}
+
+bool AssetBrowser::WriteIndex(const std::string& indexPath, const std::string& root, const std::vector<Entry>& entries)
+{
+	std::error_code error;
+	fs::create_directories(fs::path(indexPath).parent_path(), error);
+	// written next to the index and renamed over it, a crash never leaves half an index behind
+	std::string temporaryPath = indexPath + ".tmp";
+	{
+		std::ofstream file(temporaryPath, std::ios::binary);
+		if (!file)
+		{
+			std::cout << "ERROR::BROWSER::INDEX_NOT_WRITABLE: " << indexPath << std::endl;
+			return false;
+		}
+
+		uint32_t rootLength = static_cast<uint32_t>(root.size());
+		uint32_t count = static_cast<uint32_t>(entries.size());
+		file.write(INDEX_MAGIC, sizeof(INDEX_MAGIC));
+		file.write(reinterpret_cast<const char*>(&INDEX_VERSION), sizeof(INDEX_VERSION));
+		file.write(reinterpret_cast<const char*>(&rootLength), sizeof(rootLength));
+		file.write(root.data(), rootLength);
+		file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+		for (const Entry& entry : entries)
+		{
+			uint32_t pathLength = static_cast<uint32_t>(entry.path.size());
+			// an import that is still running is repeated next time
+			uint8_t state = static_cast<uint8_t>(entry.state == EntryState::Indexing ? EntryState::Unindexed : entry.state);
+			uint8_t hasThumbnail = entry.hasThumbnail ? 1 : 0;
+			file.write(reinterpret_cast<const char*>(&pathLength), sizeof(pathLength));
+			file.write(entry.path.data(), pathLength);
+			file.write(reinterpret_cast<const char*>(&entry.size), sizeof(entry.size));
+			file.write(reinterpret_cast<const char*>(&entry.modified), sizeof(entry.modified));
+			file.write(reinterpret_cast<const char*>(&state), sizeof(state));
+			file.write(reinterpret_cast<const char*>(&hasThumbnail), sizeof(hasThumbnail));
+			file.write(reinterpret_cast<const char*>(&entry.meshes), sizeof(entry.meshes));
+			file.write(reinterpret_cast<const char*>(&entry.vertices), sizeof(entry.vertices));
+			file.write(reinterpret_cast<const char*>(&entry.triangles), sizeof(entry.triangles));
+			file.write(reinterpret_cast<const char*>(&entry.textures), sizeof(entry.textures));
+			file.write(reinterpret_cast<const char*>(&entry.loadMilliseconds), sizeof(entry.loadMilliseconds));
+		}
+		if (!file)
+		{
+			std::cout << "ERROR::BROWSER::INDEX_NOT_WRITABLE: " << indexPath << std::endl;
+			return false;
+		}
+	}
+
+	fs::rename(temporaryPath, indexPath, error);
+	return !error;
+}
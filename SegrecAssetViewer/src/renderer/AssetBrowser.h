@@ -0,0 +1,156 @@
+#ifndef ASSETBROWSER_H
+#define ASSETBROWSER_H
+
+#include <glad/glad.h>
+
+#include "DirectoryWatcher.h"
+#include "GLResource.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// browser panel over every asset below a project directory.
+// the file list comes from a background scan and is kept current by a DirectoryWatcher. metadata and a software
+// rendered thumbnail are produced by importing each asset on the thread pool, visible rows first, and cached on disk
+// keyed by path, size and modification time, so reopening a library only imports what changed since the last run.
+// the list is virtualised: only visible rows are submitted and only their thumbnails are kept in the GL atlas.
+class AssetBrowser
+{
+public:
+	enum class EntryState
+	{
+		Unindexed,
+		Indexing,
+		Indexed,
+		Failed
+	};
+
+	struct Entry
+	{
+		// relative to the root, '/' separators
+		std::string path;
+		uint64_t size = 0;
+		int64_t modified = 0;
+		EntryState state = EntryState::Unindexed;
+		unsigned int meshes = 0, vertices = 0, triangles = 0, textures = 0;
+		float loadMilliseconds = 0.0f;
+		bool hasThumbnail = false;
+		// cell in the thumbnail atlas, -1 while not uploaded
+		int thumbnailSlot = -1;
+		bool thumbnailLoading = false;
+	};
+
+	AssetBrowser();
+	~AssetBrowser();
+
+	AssetBrowser(const AssetBrowser&) = delete;
+	AssetBrowser& operator=(const AssetBrowser&) = delete;
+
+	// switches to another project directory, the cached index shows up first and the scan corrects it
+	void Open(const std::string& directory);
+	const std::string& GetRoot() const;
+
+	// applies finished background work and queues more, call once per frame from the render thread
+	void Update();
+
+	// browser window, returns true and sets openedPath (absolute) when an asset was double-clicked
+	bool Draw(bool* open, std::string& openedPath);
+
+	size_t GetEntryCount() const;
+	size_t GetIndexedCount() const;
+	bool IsScanning() const;
+
+private:
+	struct ScanResult
+	{
+		int generation = 0;
+		// entries read from the index file are shown before the scan, the scan result replaces them
+		bool fromCache = false;
+		std::vector<Entry> entries;
+	};
+
+	struct ImportResult
+	{
+		int generation = 0;
+		Entry entry;
+		std::vector<unsigned char> thumbnail;
+	};
+
+	struct ThumbnailResult
+	{
+		int generation = 0;
+		std::string path;
+		int64_t modified = 0;
+		std::vector<unsigned char> pixels;
+	};
+
+	void QueueScan();
+	void QueueImport(Entry& entry);
+	void QueueThumbnailLoad(Entry& entry);
+	void QueueIndexSave();
+
+	void ApplyScan(ScanResult& result);
+	void ApplyChanges(const std::vector<std::string>& changedPaths);
+	void RebuildLookup();
+	void UploadThumbnail(Entry& entry, const std::vector<unsigned char>& pixels);
+	void ReleaseThumbnail(Entry& entry);
+	void UpdateFilter();
+
+	bool IsAssetFile(const std::string& path) const;
+
+	static std::vector<Entry> ReadIndex(const std::string& indexPath, const std::string& root);
+	static bool WriteIndex(const std::string& indexPath, const std::string& root, const std::vector<Entry>& entries);
+
+private:
+	std::string m_Root;
+	// bumped by Open, results of an older root are dropped
+	int m_Generation = 0;
+	std::unordered_set<std::string> m_Extensions;
+
+	std::vector<Entry> m_Entries;
+	std::unordered_map<std::string, int> m_Lookup;
+	size_t m_IndexedCount = 0;
+	size_t m_BackgroundCursor = 0;
+	bool m_Scanning = false;
+	bool m_RescanRequested = false;
+	bool m_IndexDirty = false;
+	std::chrono::steady_clock::time_point m_LastIndexSave;
+
+	DirectoryWatcher m_Watcher;
+
+	// filtered view over m_Entries, rebuilt when the filter or the entries change
+	char m_FilterBuffer[256] = {};
+	std::string m_Filter;
+	std::vector<int> m_Filtered;
+	bool m_FilterDirty = true;
+	std::string m_SelectedPath;
+	char m_RootBuffer[512] = {};
+	// entries submitted by the last Draw, indexed and given thumbnails first
+	std::vector<int> m_Visible;
+
+	GLTexture m_Atlas;
+	std::vector<int> m_SlotOwners;
+	std::vector<uint64_t> m_SlotLastUsed;
+	uint64_t m_Frame = 0;
+	int m_MemoryId = -1;
+
+	std::mutex m_ResultMutex;
+	std::condition_variable m_ResultCondition;
+	std::deque<ScanResult> m_ScanResults;
+	std::deque<ImportResult> m_ImportResults;
+	std::deque<ThumbnailResult> m_ThumbnailResults;
+	int m_InFlight = 0;
+	int m_ImportsInFlight = 0;
+	int m_ThumbnailLoadsInFlight = 0;
+	// index saves run on the pool, one at a time
+	std::mutex m_IndexFileMutex;
+};
+
+#endif // !ASSETBROWSER_H
@@ -0,0 +1,62 @@
+#include "CameraUniforms.h"
+
+#include <cstring>
+
+void CameraUniforms::Clear()
+{
+	m_Blocks.clear();
+}
+
+int CameraUniforms::Add(const Block& block)
+{
+	GpuBlock gpuBlock;
+	gpuBlock.view = block.view;
+	gpuBlock.projection = block.projection;
+	gpuBlock.viewPosition = glm::vec4(block.viewPosition, 1.0f);
+	gpuBlock.viewportSize = glm::vec4(block.viewportSize, 0.0f, 0.0f);
+	m_Blocks.push_back(gpuBlock);
+	return static_cast<int>(m_Blocks.size()) - 1;
+}
+
+void CameraUniforms::Upload()
+{
+	if (m_Blocks.empty())
+		return;
+
+	if (!m_Buffer)
+	{
+		m_Buffer = GLBuffer::Create();
+		GLint alignment = 256;
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+		alignment = alignment > 0 ? alignment : 256;
+		m_Stride = (static_cast<GLsizeiptr>(sizeof(GpuBlock)) + alignment - 1) / alignment * alignment;
+	}
+
+	GLsizeiptr size = m_Stride * static_cast<GLsizeiptr>(m_Blocks.size());
+	m_Staging.assign(static_cast<size_t>(size), 0);
+	for (size_t i = 0; i < m_Blocks.size(); i++)
+		std::memcpy(m_Staging.data() + i * m_Stride, &m_Blocks[i], sizeof(GpuBlock));
+
+	// orphaning the storage every frame, the previous frame's blocks may still be read by the GPU
+	glBindBuffer(GL_UNIFORM_BUFFER, m_Buffer.Get());
+	m_Capacity = size > m_Capacity ? size : m_Capacity;
+	glBufferData(GL_UNIFORM_BUFFER, m_Capacity, nullptr, GL_STREAM_DRAW);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, size, m_Staging.data());
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void CameraUniforms::Bind(int index) const
+{
+	if (index < 0 || index >= static_cast<int>(m_Blocks.size()) || !m_Buffer)
+		return;
+
+	glBindBufferRange(GL_UNIFORM_BUFFER, BINDING, m_Buffer.Get(), m_Stride * index, sizeof(GpuBlock));
+}
+
+void CameraUniforms::Set(const Block& block)
+{
+	Clear();
+	Add(block);
+	Upload();
+	Bind(0);
+}
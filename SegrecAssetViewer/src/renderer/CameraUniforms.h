@@ -0,0 +1,60 @@
+#ifndef CAMERAUNIFORMS_H
+#define CAMERAUNIFORMS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "GLResource.h"
+
+#include <vector>
+
+// the Camera uniform block of the scene shaders (view, projection, camera position, viewport size) for every viewport
+// drawn in a frame. all viewports are uploaded at once into one buffer, switching viewports only binds another range of it
+class CameraUniforms
+{
+public:
+	// binding point of the Camera block, Shader::BindUniformBlock maps every scene shader's block to it
+	static const GLuint BINDING = 0;
+
+	struct Block
+	{
+		glm::mat4 view;
+		glm::mat4 projection;
+		glm::vec3 viewPosition;
+		glm::vec2 viewportSize;
+	};
+
+	CameraUniforms() = default;
+	CameraUniforms(const CameraUniforms&) = delete;
+	CameraUniforms& operator=(const CameraUniforms&) = delete;
+
+	// drops the blocks of the previous frame
+	void Clear();
+	// returns the viewport's index for Bind
+	int Add(const Block& block);
+	// uploads the blocks added since Clear, call before the first Bind of the frame
+	void Upload();
+	void Bind(int index) const;
+	// Clear, Add, Upload and Bind of a frame with a single viewport
+	void Set(const Block& block);
+
+private:
+	// std140 layout of the block, vec3 and vec2 each take their own 16 bytes. the scene shaders declare the same
+	// Camera block and read the range bound for the viewport being drawn
+	struct GpuBlock
+	{
+		glm::mat4 view;
+		glm::mat4 projection;
+		glm::vec4 viewPosition;
+		glm::vec4 viewportSize;
+	};
+
+	GLBuffer m_Buffer;
+	std::vector<GpuBlock> m_Blocks;
+	// bytes between two blocks in the buffer, at least GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+	GLsizeiptr m_Stride = 0;
+	GLsizeiptr m_Capacity = 0;
+	std::vector<unsigned char> m_Staging;
+};
+
+#endif // !CAMERAUNIFORMS_H
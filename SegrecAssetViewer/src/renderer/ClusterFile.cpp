@@ -0,0 +1,202 @@
+#include "ClusterFile.h"
+
+#include "Model.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cfloat>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+namespace
+{
+	const char MAGIC[8] = { 'S', 'G', 'C', 'L', 'U', 'S', 'T', 0 };
+
+	// spreads the lower 10 bits so that two zero bits follow each one
+	uint32_t ExpandBits(uint32_t value)
+	{
+		value = (value * 0x00010001u) & 0xFF0000FFu;
+		value = (value * 0x00000101u) & 0x0F00F00Fu;
+		value = (value * 0x00000011u) & 0xC30C30C3u;
+		value = (value * 0x00000005u) & 0x49249249u;
+		return value;
+	}
+
+	uint32_t MortonCode(const glm::vec3& normalized)
+	{
+		glm::vec3 cell = glm::clamp(normalized * 1024.0f, glm::vec3(0.0f), glm::vec3(1023.0f));
+		return (ExpandBits(static_cast<uint32_t>(cell.x)) << 2) | (ExpandBits(static_cast<uint32_t>(cell.y)) << 1)
+			| ExpandBits(static_cast<uint32_t>(cell.z));
+	}
+
+	void ToClusterVertex(const Vertex& vertex, ClusterVertex& out)
+	{
+		std::memcpy(out.position, &vertex.Position[0], sizeof(out.position));
+		std::memcpy(out.normal, &vertex.Normal[0], sizeof(out.normal));
+		std::memcpy(out.texCoords, &vertex.TexCoords[0], sizeof(out.texCoords));
+		std::memcpy(out.tangent, &vertex.Tangent[0], sizeof(out.tangent));
+		std::memcpy(out.bitangent, &vertex.Bitangent[0], sizeof(out.bitangent));
+	}
+}
+
+bool ClusterFile::CanLoad(const std::string& path)
+{
+	std::string extension = std::filesystem::path(path).extension().string();
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+	return extension == ".clusters";
+}
+
+size_t ClusterFile::DataBytes(const ClusterRecord& record)
+{
+	size_t indexBytes = static_cast<size_t>(record.triangleCount) * 3 * sizeof(uint16_t);
+	return record.vertexCount * sizeof(ClusterVertex) + ((indexBytes + 3) & ~static_cast<size_t>(3));
+}
+
+bool ClusterFile::Build(Model& model, const std::string& outputPath)
+{
+	std::ofstream file(outputPath, std::ios::binary);
+	if (!file)
+	{
+		std::cout << "ERROR::CLUSTERS::OPEN_FAILED " << outputPath << std::endl;
+		return false;
+	}
+
+	ClusterFileHeader header = {};
+	std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = VERSION;
+	header.meshCount = static_cast<uint32_t>(model.meshes.size());
+	glm::vec3 fileMin(FLT_MAX), fileMax(-FLT_MAX);
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	uint64_t offset = sizeof(header);
+
+	std::vector<ClusterRecord> records;
+	std::vector<ClusterVertex> clusterVertices;
+	std::vector<uint16_t> clusterIndices;
+	std::vector<unsigned int> usedVertices;
+	for (size_t meshIndex = 0; meshIndex < model.meshes.size(); meshIndex++)
+	{
+		Mesh& mesh = model.meshes[meshIndex];
+		const std::vector<Vertex>& vertices = mesh.vertices;
+		const std::vector<unsigned int>& indices = mesh.indices;
+		size_t triangleCount = indices.size() / 3;
+		if (triangleCount == 0)
+			continue;
+
+		glm::vec3 meshMin(FLT_MAX), meshMax(-FLT_MAX);
+		for (const Vertex& vertex : vertices)
+		{
+			meshMin = glm::min(meshMin, vertex.Position);
+			meshMax = glm::max(meshMax, vertex.Position);
+		}
+		fileMin = glm::min(fileMin, meshMin);
+		fileMax = glm::max(fileMax, meshMax);
+		glm::vec3 extent = glm::max(meshMax - meshMin, glm::vec3(1e-6f));
+
+		// triangles sorted along a space filling curve, consecutive runs of them make compact clusters
+		std::vector<std::pair<uint32_t, uint32_t>> order(triangleCount);
+		for (size_t t = 0; t < triangleCount; t++)
+		{
+			glm::vec3 centroid = (vertices[indices[t * 3]].Position + vertices[indices[t * 3 + 1]].Position + vertices[indices[t * 3 + 2]].Position) / 3.0f;
+			order[t] = { MortonCode((centroid - meshMin) / extent), static_cast<uint32_t>(t) };
+		}
+		std::sort(order.begin(), order.end());
+
+		// mesh vertex -> cluster vertex, reset after every cluster through usedVertices
+		std::vector<int> remap(vertices.size(), -1);
+		auto flush = [&]()
+		{
+			if (clusterIndices.empty())
+				return;
+
+			glm::vec3 clusterMin(FLT_MAX), clusterMax(-FLT_MAX);
+			for (unsigned int v : usedVertices)
+			{
+				clusterMin = glm::min(clusterMin, vertices[v].Position);
+				clusterMax = glm::max(clusterMax, vertices[v].Position);
+			}
+			glm::vec3 center = (clusterMin + clusterMax) * 0.5f;
+			float radius = 0.0f;
+			clusterVertices.resize(usedVertices.size());
+			for (size_t i = 0; i < usedVertices.size(); i++)
+			{
+				const Vertex& vertex = vertices[usedVertices[i]];
+				radius = std::max(radius, glm::length(vertex.Position - center));
+				ToClusterVertex(vertex, clusterVertices[i]);
+				remap[usedVertices[i]] = -1;
+			}
+
+			ClusterRecord record = {};
+			record.center[0] = center.x;
+			record.center[1] = center.y;
+			record.center[2] = center.z;
+			record.radius = radius;
+			record.offset = offset;
+			record.mesh = static_cast<uint32_t>(meshIndex);
+			record.vertexCount = static_cast<uint16_t>(usedVertices.size());
+			record.triangleCount = static_cast<uint16_t>(clusterIndices.size() / 3);
+
+			if (clusterIndices.size() % 2 != 0)
+				clusterIndices.push_back(0);
+			file.write(reinterpret_cast<const char*>(clusterVertices.data()), clusterVertices.size() * sizeof(ClusterVertex));
+			file.write(reinterpret_cast<const char*>(clusterIndices.data()), clusterIndices.size() * sizeof(uint16_t));
+			offset += DataBytes(record);
+
+			header.vertexCount += record.vertexCount;
+			header.triangleCount += record.triangleCount;
+			records.push_back(record);
+			usedVertices.clear();
+			clusterIndices.clear();
+		};
+
+		for (const auto& entry : order)
+		{
+			const unsigned int* triangle = &indices[static_cast<size_t>(entry.second) * 3];
+			int newVertices = 0;
+			for (int corner = 0; corner < 3; corner++)
+			{
+				if (remap[triangle[corner]] < 0)
+					newVertices++;
+			}
+			// a corner used twice is counted twice, the limit only gets stricter
+			if (clusterIndices.size() / 3 >= MAX_TRIANGLES || usedVertices.size() + newVertices > MAX_VERTICES)
+				flush();
+
+			for (int corner = 0; corner < 3; corner++)
+			{
+				int& local = remap[triangle[corner]];
+				if (local < 0)
+				{
+					local = static_cast<int>(usedVertices.size());
+					usedVertices.push_back(triangle[corner]);
+				}
+				clusterIndices.push_back(static_cast<uint16_t>(local));
+			}
+		}
+		flush();
+
+		// the source mesh isn't needed anymore, large scans are converted one mesh at a time
+		mesh.ReleaseCpuData();
+	}
+
+	header.clusterCount = records.size();
+	header.tableOffset = offset;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		header.boundsMin[axis] = records.empty() ? 0.0f : fileMin[axis];
+		header.boundsMax[axis] = records.empty() ? 0.0f : fileMax[axis];
+	}
+	file.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(ClusterRecord));
+	file.seekp(0);
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+	if (!file)
+	{
+		std::cout << "ERROR::CLUSTERS::WRITE_FAILED " << outputPath << std::endl;
+		return false;
+	}
+	return true;
+}
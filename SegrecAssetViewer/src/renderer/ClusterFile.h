@@ -0,0 +1,65 @@
+#ifndef CLUSTERFILE_H
+#define CLUSTERFILE_H
+
+#include <cstdint>
+#include <string>
+
+class Model;
+
+// streamed geometry on disk: [header][cluster data...][cluster table].
+// every mesh is split into clusters of at most MAX_TRIANGLES triangles using at most MAX_VERTICES vertices, so any cluster
+// fits the same fixed-size slot of the GPU pool. cluster data is its vertices (ClusterVertex) followed by 16-bit local
+// indices, padded to 4 bytes. clusters follow the Morton order of their triangles, neighbours share file pages.
+// the table is small enough to stay in memory, the data is memory mapped and only touched for clusters being paged in.
+struct ClusterFileHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t meshCount;
+	uint64_t clusterCount;
+	uint64_t vertexCount;
+	uint64_t triangleCount;
+	uint64_t tableOffset;
+	float boundsMin[3];
+	float boundsMax[3];
+};
+
+struct ClusterRecord
+{
+	// bounding sphere in model space
+	float center[3];
+	float radius;
+	// file offset of the vertices, the indices follow them
+	uint64_t offset;
+	uint32_t mesh;
+	uint16_t vertexCount;
+	uint16_t triangleCount;
+};
+
+// the layout of the default shaders' attributes 0-4, bone data is not streamed
+struct ClusterVertex
+{
+	float position[3];
+	float normal[3];
+	float texCoords[2];
+	float tangent[3];
+	float bitangent[3];
+};
+
+class ClusterFile
+{
+public:
+	static const int MAX_VERTICES = 256;
+	static const int MAX_TRIANGLES = 128;
+	static const uint32_t VERSION = 1;
+
+	// .clusters files are opened by the streamer instead of being imported
+	static bool CanLoad(const std::string& path);
+	// writes the meshes of a CpuOnly model as a cluster file. each mesh's CPU data is dropped once it is written,
+	// so converting needs little more memory than the import itself
+	static bool Build(Model& model, const std::string& outputPath);
+	// bytes of a cluster's data in the file
+	static size_t DataBytes(const ClusterRecord& record);
+};
+
+#endif // !CLUSTERFILE_H
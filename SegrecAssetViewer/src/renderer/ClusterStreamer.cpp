@@ -0,0 +1,384 @@
+#include "ClusterStreamer.h"
+
+#include "MemoryTracker.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+
+namespace
+{
+	const size_t SLOT_VERTEX_BYTES = ClusterFile::MAX_VERTICES * sizeof(ClusterVertex);
+	const size_t SLOT_INDEX_BYTES = ClusterFile::MAX_TRIANGLES * 3 * sizeof(uint16_t);
+	// page-ins queued at once, a short queue keeps the order following the camera
+	const int MAX_IN_FLIGHT = 64;
+
+	// planes of the view frustum from a model to clip matrix, in model space
+	void ExtractPlanes(const glm::mat4& m, glm::vec4 planes[6])
+	{
+		glm::vec4 rows[4];
+		for (int i = 0; i < 4; i++)
+			rows[i] = glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+		planes[0] = rows[3] + rows[0];
+		planes[1] = rows[3] - rows[0];
+		planes[2] = rows[3] + rows[1];
+		planes[3] = rows[3] - rows[1];
+		planes[4] = rows[3] + rows[2];
+		planes[5] = rows[3] - rows[2];
+		for (int i = 0; i < 6; i++)
+			planes[i] /= glm::length(glm::vec3(planes[i]));
+	}
+}
+
+ClusterStreamer::ClusterStreamer()
+{
+}
+
+ClusterStreamer::~ClusterStreamer()
+{
+	// load jobs read the mapping and post back to this object
+	WaitForLoads();
+	ReleasePool();
+}
+
+bool ClusterStreamer::Open(const std::string& path, std::string& error)
+{
+	if (!m_File.Open(path))
+	{
+		error = "could not open " + path;
+		return false;
+	}
+
+	const unsigned char* data = m_File.GetData();
+	size_t size = m_File.GetSize();
+	if (size < sizeof(ClusterFileHeader))
+	{
+		error = "not a cluster file";
+		return false;
+	}
+	std::memcpy(&m_Header, data, sizeof(ClusterFileHeader));
+	if (std::strncmp(m_Header.magic, "SGCLUST", 8) != 0 || m_Header.version != ClusterFile::VERSION)
+	{
+		error = "not a cluster file or an unsupported version";
+		return false;
+	}
+	if (m_Header.tableOffset > size || (size - m_Header.tableOffset) / sizeof(ClusterRecord) < m_Header.clusterCount)
+	{
+		error = "truncated cluster table";
+		return false;
+	}
+
+	// the table is copied out, the mapping only has to be touched again for cluster data
+	m_Records.resize(m_Header.clusterCount);
+	std::memcpy(m_Records.data(), data + m_Header.tableOffset, m_Records.size() * sizeof(ClusterRecord));
+	for (const ClusterRecord& record : m_Records)
+	{
+		if (record.vertexCount > ClusterFile::MAX_VERTICES || record.triangleCount > ClusterFile::MAX_TRIANGLES
+			|| record.offset > m_Header.tableOffset || m_Header.tableOffset - record.offset < ClusterFile::DataBytes(record))
+		{
+			error = "corrupt cluster record";
+			m_Records.clear();
+			return false;
+		}
+	}
+	m_States.assign(m_Records.size(), ClusterState());
+	m_Stats.clusters = m_Records.size();
+	m_Name = std::filesystem::path(path).filename().string();
+	return true;
+}
+
+void ClusterStreamer::SetBudget(size_t bytes)
+{
+	if (bytes == m_Budget)
+		return;
+	m_Budget = bytes;
+
+	// the pool is created again in the next Update, everything is paged in from scratch
+	WaitForLoads();
+	ReleasePool();
+	m_Results.clear();
+	m_States.assign(m_Records.size(), ClusterState());
+}
+
+size_t ClusterStreamer::GetBudget() const
+{
+	return m_Budget;
+}
+
+void ClusterStreamer::CreatePool()
+{
+	size_t slotBytes = SLOT_VERTEX_BYTES + SLOT_INDEX_BYTES;
+	m_SlotCount = static_cast<int>(std::min<size_t>(std::max<size_t>(m_Budget / slotBytes, 1), std::max<size_t>(m_Records.size(), 1)));
+	m_FreeSlots.resize(m_SlotCount);
+	// popped from the back, slot 0 is used first
+	for (int i = 0; i < m_SlotCount; i++)
+		m_FreeSlots[i] = m_SlotCount - 1 - i;
+	m_SlotOwners.assign(m_SlotCount, -1);
+
+	m_VAO = GLVertexArray::Create();
+	m_VertexBuffer = GLBuffer::Create();
+	m_IndexBuffer = GLBuffer::Create();
+	glBindVertexArray(m_VAO.Get());
+	glBindBuffer(GL_ARRAY_BUFFER, m_VertexBuffer.Get());
+	glBufferData(GL_ARRAY_BUFFER, m_SlotCount * SLOT_VERTEX_BYTES, nullptr, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_IndexBuffer.Get());
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_SlotCount * SLOT_INDEX_BYTES, nullptr, GL_DYNAMIC_DRAW);
+
+	const GLsizei stride = sizeof(ClusterVertex);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(ClusterVertex, position));
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(ClusterVertex, normal));
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(ClusterVertex, texCoords));
+	glEnableVertexAttribArray(3);
+	glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(ClusterVertex, tangent));
+	glEnableVertexAttribArray(4);
+	glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(ClusterVertex, bitangent));
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	m_MemoryId = MemoryTracker::Get().Register(MemoryCategory::Mesh, "cluster pool " + m_Name,
+		m_Records.size() * (sizeof(ClusterRecord) + sizeof(ClusterState)), m_SlotCount * slotBytes);
+}
+
+void ClusterStreamer::ReleasePool()
+{
+	m_VAO.Reset();
+	m_VertexBuffer.Reset();
+	m_IndexBuffer.Reset();
+	m_FreeSlots.clear();
+	m_SlotOwners.clear();
+	m_SlotCount = 0;
+	m_DrawCounts.clear();
+	m_DrawOffsets.clear();
+	m_DrawBaseVertices.clear();
+	if (m_MemoryId >= 0)
+		MemoryTracker::Get().Unregister(m_MemoryId);
+	m_MemoryId = -1;
+}
+
+void ClusterStreamer::WaitForLoads()
+{
+	std::unique_lock<std::mutex> lock(m_ResultMutex);
+	m_ResultCondition.wait(lock, [this]() { return m_InFlight == 0; });
+}
+
+void ClusterStreamer::Request(uint32_t cluster, int slot)
+{
+	ClusterState& state = m_States[cluster];
+	state.residency = Residency::Loading;
+	state.slot = slot;
+	m_SlotOwners[slot] = cluster;
+	{
+		std::lock_guard<std::mutex> lock(m_ResultMutex);
+		m_InFlight++;
+	}
+
+	// touching the mapping faults the pages in, that disk read happens on the pool instead of the render thread
+	const unsigned char* source = m_File.GetData() + m_Records[cluster].offset;
+	size_t bytes = ClusterFile::DataBytes(m_Records[cluster]);
+	ThreadPool::Get().Submit([this, cluster, source, bytes]()
+	{
+		LoadResult result;
+		result.cluster = cluster;
+		result.data.assign(source, source + bytes);
+		std::lock_guard<std::mutex> lock(m_ResultMutex);
+		m_Results.push_back(std::move(result));
+		m_InFlight--;
+		m_ResultCondition.notify_all();
+	});
+}
+
+void ClusterStreamer::Upload(const LoadResult& result)
+{
+	ClusterState& state = m_States[result.cluster];
+	const ClusterRecord& record = m_Records[result.cluster];
+	size_t vertexBytes = record.vertexCount * sizeof(ClusterVertex);
+
+	// uploads go through the copy target, the element buffer binding belongs to the VAO
+	glBindBuffer(GL_COPY_WRITE_BUFFER, m_VertexBuffer.Get());
+	glBufferSubData(GL_COPY_WRITE_BUFFER, state.slot * SLOT_VERTEX_BYTES, vertexBytes, result.data.data());
+	glBindBuffer(GL_COPY_WRITE_BUFFER, m_IndexBuffer.Get());
+	glBufferSubData(GL_COPY_WRITE_BUFFER, state.slot * SLOT_INDEX_BYTES, record.triangleCount * 3 * sizeof(uint16_t), result.data.data() + vertexBytes);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	state.residency = Residency::Resident;
+	m_Stats.uploadedBytes += result.data.size();
+	m_Stats.pageIns++;
+}
+
+void ClusterStreamer::Update(const glm::mat4& modelToClip, const glm::vec3& viewPosition, size_t uploadBudget)
+{
+	auto start = std::chrono::steady_clock::now();
+	if (m_Records.empty())
+		return;
+	if (!m_VertexBuffer)
+		CreatePool();
+	m_Frame++;
+
+	// finished page-ins
+	m_Stats.uploadedBytes = 0;
+	while (m_Stats.uploadedBytes < uploadBudget)
+	{
+		LoadResult result;
+		{
+			std::lock_guard<std::mutex> lock(m_ResultMutex);
+			if (m_Results.empty())
+				break;
+			result = std::move(m_Results.front());
+			m_Results.pop_front();
+		}
+		Upload(result);
+	}
+
+	// frustum test and ranking by size over distance, which is the projected size up to a constant
+	glm::vec4 planes[6];
+	ExtractPlanes(modelToClip, planes);
+	ThreadPool::Get().ParallelFor(0, m_Records.size(), 4096, [this, &planes, &viewPosition](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			const ClusterRecord& record = m_Records[i];
+			glm::vec3 center(record.center[0], record.center[1], record.center[2]);
+			float priority = -1.0f;
+			bool inside = true;
+			for (int p = 0; p < 6 && inside; p++)
+				inside = glm::dot(glm::vec3(planes[p]), center) + planes[p].w > -record.radius;
+			if (inside)
+			{
+				float distance = std::max(glm::length(center - viewPosition) - record.radius, record.radius * 0.01f + 1e-6f);
+				priority = record.radius / distance;
+			}
+			m_States[i].priority = priority;
+		}
+	});
+
+	m_Visible.clear();
+	for (uint32_t i = 0; i < m_States.size(); i++)
+	{
+		if (m_States[i].priority >= 0.0f)
+		{
+			m_States[i].lastVisibleFrame = m_Frame;
+			m_Visible.push_back(i);
+		}
+	}
+
+	// the pool holds the highest ranked visible clusters, the rest waits until the camera gets closer
+	size_t wanted = std::min(m_Visible.size(), static_cast<size_t>(m_SlotCount));
+	std::partial_sort(m_Visible.begin(), m_Visible.begin() + wanted, m_Visible.end(),
+		[this](uint32_t a, uint32_t b) { return m_States[a].priority > m_States[b].priority; });
+	for (size_t i = 0; i < wanted; i++)
+		m_States[m_Visible[i]].wantedFrame = m_Frame;
+
+	// resident clusters outside the wanted set, the ones seen longest ago go first
+	m_Evictable.clear();
+	for (int64_t owner : m_SlotOwners)
+	{
+		if (owner >= 0 && m_States[owner].residency == Residency::Resident && m_States[owner].wantedFrame != m_Frame)
+			m_Evictable.push_back(static_cast<uint32_t>(owner));
+	}
+	std::sort(m_Evictable.begin(), m_Evictable.end(), [this](uint32_t a, uint32_t b)
+	{
+		if (m_States[a].lastVisibleFrame != m_States[b].lastVisibleFrame)
+			return m_States[a].lastVisibleFrame < m_States[b].lastVisibleFrame;
+		return m_States[a].priority < m_States[b].priority;
+	});
+
+	int inFlight;
+	{
+		std::lock_guard<std::mutex> lock(m_ResultMutex);
+		inFlight = m_InFlight;
+	}
+	size_t nextEvictable = 0;
+	for (size_t i = 0; i < wanted && inFlight < MAX_IN_FLIGHT; i++)
+	{
+		uint32_t cluster = m_Visible[i];
+		if (m_States[cluster].residency != Residency::Unloaded)
+			continue;
+
+		int slot;
+		if (!m_FreeSlots.empty())
+		{
+			slot = m_FreeSlots.back();
+			m_FreeSlots.pop_back();
+		}
+		else if (nextEvictable < m_Evictable.size())
+		{
+			ClusterState& evicted = m_States[m_Evictable[nextEvictable++]];
+			slot = evicted.slot;
+			evicted.residency = Residency::Unloaded;
+			evicted.slot = -1;
+			m_Stats.evictions++;
+		}
+		else
+			break;
+
+		Request(cluster, slot);
+		inFlight++;
+	}
+
+	// draw list of everything visible that is on the GPU
+	m_DrawCounts.clear();
+	m_DrawOffsets.clear();
+	m_DrawBaseVertices.clear();
+	m_Stats.drawnTriangles = 0;
+	for (uint32_t cluster : m_Visible)
+	{
+		const ClusterState& state = m_States[cluster];
+		if (state.residency != Residency::Resident)
+			continue;
+		m_DrawCounts.push_back(m_Records[cluster].triangleCount * 3);
+		m_DrawOffsets.push_back(reinterpret_cast<const void*>(state.slot * SLOT_INDEX_BYTES));
+		m_DrawBaseVertices.push_back(state.slot * ClusterFile::MAX_VERTICES);
+		m_Stats.drawnTriangles += m_Records[cluster].triangleCount;
+	}
+
+	m_Stats.visible = m_Visible.size();
+	m_Stats.drawn = m_DrawCounts.size();
+	m_Stats.slots = m_SlotCount;
+	m_Stats.resident = 0;
+	m_Stats.loading = 0;
+	for (int64_t owner : m_SlotOwners)
+	{
+		if (owner >= 0 && m_States[owner].residency == Residency::Resident)
+			m_Stats.resident++;
+		else if (owner >= 0)
+			m_Stats.loading++;
+	}
+	m_Stats.updateMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void ClusterStreamer::Draw() const
+{
+	if (m_DrawCounts.empty())
+		return;
+
+	glBindVertexArray(m_VAO.Get());
+	glMultiDrawElementsBaseVertex(GL_TRIANGLES, m_DrawCounts.data(), GL_UNSIGNED_SHORT, m_DrawOffsets.data(),
+		static_cast<GLsizei>(m_DrawCounts.size()), m_DrawBaseVertices.data());
+	glBindVertexArray(0);
+}
+
+const ClusterStreamer::Stats& ClusterStreamer::GetStats() const
+{
+	return m_Stats;
+}
+
+uint64_t ClusterStreamer::GetVertexCount() const
+{
+	return m_Header.vertexCount;
+}
+
+uint64_t ClusterStreamer::GetTriangleCount() const
+{
+	return m_Header.triangleCount;
+}
+
+uint32_t ClusterStreamer::GetMeshCount() const
+{
+	return m_Header.meshCount;
+}
@@ -0,0 +1,126 @@
+#ifndef CLUSTERSTREAMER_H
+#define CLUSTERSTREAMER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "ClusterFile.h"
+#include "GLResource.h"
+#include "MappedFile.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// draws a cluster file larger than system or video memory. the file is memory mapped and the GPU holds a fixed pool of
+// cluster slots sized by the memory budget. every frame the clusters in the view frustum are ranked by their projected size,
+// the highest ranked ones that fit the pool are paged in (read from the mapping on the thread pool, uploaded under a per
+// frame byte budget) and the least recently visible ones make room for them. all resident visible clusters are drawn with
+// one glMultiDrawElementsBaseVertex call.
+class ClusterStreamer
+{
+public:
+	struct Stats
+	{
+		size_t clusters = 0;
+		size_t visible = 0;
+		// visible and resident, the rest of the visible clusters is missing this frame
+		size_t drawn = 0;
+		size_t resident = 0;
+		size_t loading = 0;
+		size_t slots = 0;
+		uint64_t drawnTriangles = 0;
+		size_t uploadedBytes = 0;       // this frame
+		uint64_t pageIns = 0;           // since the file was opened
+		uint64_t evictions = 0;
+		double updateMilliseconds = 0.0;
+	};
+
+	ClusterStreamer();
+	~ClusterStreamer();
+
+	ClusterStreamer(const ClusterStreamer&) = delete;
+	ClusterStreamer& operator=(const ClusterStreamer&) = delete;
+
+	bool Open(const std::string& path, std::string& error);
+
+	// GPU bytes of the slot pool, changing it drops every resident cluster
+	void SetBudget(size_t bytes);
+	size_t GetBudget() const;
+
+	// decides residency for this frame's view, call once per frame from the render thread before drawing.
+	// modelToClip is projection * view * model, viewPosition the camera in model space
+	void Update(const glm::mat4& modelToClip, const glm::vec3& viewPosition, size_t uploadBudget = 16 * 1024 * 1024);
+	// draws the resident clusters visible in the last Update with the bound shader
+	void Draw() const;
+
+	const Stats& GetStats() const;
+	uint64_t GetVertexCount() const;
+	uint64_t GetTriangleCount() const;
+	uint32_t GetMeshCount() const;
+
+private:
+	enum class Residency : uint8_t
+	{
+		Unloaded,
+		Loading,
+		Resident
+	};
+
+	struct ClusterState
+	{
+		Residency residency = Residency::Unloaded;
+		int slot = -1;
+		// negative when outside the frustum
+		float priority = -1.0f;
+		uint32_t lastVisibleFrame = 0;
+		uint32_t wantedFrame = 0;
+	};
+
+	struct LoadResult
+	{
+		uint32_t cluster = 0;
+		std::vector<unsigned char> data;
+	};
+
+	void CreatePool();
+	void ReleasePool();
+	void WaitForLoads();
+	void Request(uint32_t cluster, int slot);
+	void Upload(const LoadResult& result);
+
+private:
+	MappedFile m_File;
+	std::string m_Name;
+	ClusterFileHeader m_Header = {};
+	std::vector<ClusterRecord> m_Records;
+	std::vector<ClusterState> m_States;
+
+	size_t m_Budget = 512 * 1024 * 1024;
+	int m_SlotCount = 0;
+	std::vector<int> m_FreeSlots;
+	// cluster in each slot, -1 when free
+	std::vector<int64_t> m_SlotOwners;
+	GLVertexArray m_VAO;
+	GLBuffer m_VertexBuffer;
+	GLBuffer m_IndexBuffer;
+	int m_MemoryId = -1;
+
+	uint32_t m_Frame = 0;
+	std::vector<uint32_t> m_Visible;
+	std::vector<uint32_t> m_Evictable;
+	std::vector<GLsizei> m_DrawCounts;
+	std::vector<const void*> m_DrawOffsets;
+	std::vector<GLint> m_DrawBaseVertices;
+	Stats m_Stats;
+
+	std::mutex m_ResultMutex;
+	std::condition_variable m_ResultCondition;
+	std::deque<LoadResult> m_Results;
+	int m_InFlight = 0;
+};
+
+#endif // !CLUSTERSTREAMER_H
@@ -0,0 +1,282 @@
+#include "ClusteredLighting.h"
+
+#include "MemoryTracker.h"
+#include "Simd.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+
+namespace
+{
+	static_assert((ClusteredLighting::TILES_X * ClusteredLighting::TILES_Y) % 4 == 0, "froxels of a slice are tested four at a time");
+
+	// bytes of a buffer with at least one element, an empty buffer can't back a buffer texture
+	template<typename T>
+	size_t BufferBytes(const std::vector<T>& values)
+	{
+		return std::max<size_t>(values.size(), 1) * sizeof(T);
+	}
+
+	template<typename T>
+	void UploadBuffer(const GLBuffer& buffer, const std::vector<T>& values)
+	{
+		glBindBuffer(GL_TEXTURE_BUFFER, buffer.Get());
+		// orphaned every time, a previous view of the frame may still be reading the old lists
+		glBufferData(GL_TEXTURE_BUFFER, BufferBytes(values), nullptr, GL_STREAM_DRAW);
+		if (!values.empty())
+			glBufferSubData(GL_TEXTURE_BUFFER, 0, values.size() * sizeof(T), values.data());
+	}
+
+	void CreateBufferTexture(GLBuffer& buffer, GLTexture& texture, GLenum format)
+	{
+		buffer = GLBuffer::Create();
+		glBindBuffer(GL_TEXTURE_BUFFER, buffer.Get());
+		glBufferData(GL_TEXTURE_BUFFER, 16, nullptr, GL_STREAM_DRAW);
+		texture = GLTexture::Create();
+		glBindTexture(GL_TEXTURE_BUFFER, texture.Get());
+		glTexBuffer(GL_TEXTURE_BUFFER, format, buffer.Get());
+		glBindTexture(GL_TEXTURE_BUFFER, 0);
+		glBindBuffer(GL_TEXTURE_BUFFER, 0);
+	}
+
+	// sphere around the lit part of a spot light's cone, smaller than its range sphere for narrow cones
+	void SpotBounds(const SceneLight& light, glm::vec3& center, float& radius)
+	{
+		glm::vec3 direction = glm::normalize(light.direction);
+		float angle = glm::radians(std::clamp(light.outerAngle, 0.0f, 89.0f));
+		if (angle > glm::radians(45.0f))
+		{
+			center = light.position + direction * (light.range * std::cos(angle));
+			radius = light.range * std::sin(angle);
+		}
+		else
+		{
+			radius = light.range / (2.0f * std::cos(angle));
+			center = light.position + direction * radius;
+		}
+	}
+}
+
+ClusteredLighting::ClusteredLighting()
+{
+	for (std::vector<float>& bounds : m_Bounds)
+		bounds.resize(CLUSTER_COUNT);
+	m_Grid.resize(CLUSTER_COUNT * 2);
+
+	CreateBufferTexture(m_LightBuffer, m_LightTexture, GL_RGBA32F);
+	CreateBufferTexture(m_GridBuffer, m_GridTexture, GL_RG32UI);
+	CreateBufferTexture(m_IndexBuffer, m_IndexTexture, GL_R32UI);
+	m_MemoryId = MemoryTracker::Get().Register(MemoryCategory::RenderTarget, "clustered lights", 0, 0);
+}
+
+ClusteredLighting::~ClusteredLighting()
+{
+	if (m_MemoryId >= 0)
+		MemoryTracker::Get().Unregister(m_MemoryId);
+}
+
+std::vector<SceneLight>& ClusteredLighting::GetLights()
+{
+	return m_Lights;
+}
+
+const std::vector<SceneLight>& ClusteredLighting::GetLights() const
+{
+	return m_Lights;
+}
+
+void ClusteredLighting::BuildClusterBounds(const glm::mat4& projection)
+{
+	m_BoundsProjection = projection;
+	// clip planes of a perspective projection
+	m_Near = projection[3][2] / (projection[2][2] - 1.0f);
+	m_Far = projection[3][2] / (projection[2][2] + 1.0f);
+
+	// view space x and y of the tile corners at a depth of 1, a froxel scales its tile to the ends of its slice
+	glm::mat4 inverseProjection = glm::inverse(projection);
+	std::vector<glm::vec2> corners((TILES_X + 1) * (TILES_Y + 1));
+	for (int y = 0; y <= TILES_Y; y++)
+	{
+		for (int x = 0; x <= TILES_X; x++)
+		{
+			glm::vec4 point = inverseProjection * glm::vec4(2.0f * x / TILES_X - 1.0f, 2.0f * y / TILES_Y - 1.0f, -1.0f, 1.0f);
+			corners[y * (TILES_X + 1) + x] = glm::vec2(point) / -point.z;
+		}
+	}
+
+	for (int slice = 0; slice < SLICES; slice++)
+	{
+		float sliceNear = m_Near * std::pow(m_Far / m_Near, static_cast<float>(slice) / SLICES);
+		float sliceFar = m_Near * std::pow(m_Far / m_Near, static_cast<float>(slice + 1) / SLICES);
+		for (int y = 0; y < TILES_Y; y++)
+		{
+			for (int x = 0; x < TILES_X; x++)
+			{
+				glm::vec2 minimum(FLT_MAX), maximum(-FLT_MAX);
+				for (int corner = 0; corner < 4; corner++)
+				{
+					glm::vec2 ray = corners[(y + corner / 2) * (TILES_X + 1) + x + corner % 2];
+					minimum = glm::min(minimum, glm::min(ray * sliceNear, ray * sliceFar));
+					maximum = glm::max(maximum, glm::max(ray * sliceNear, ray * sliceFar));
+				}
+				int cluster = (slice * TILES_Y + y) * TILES_X + x;
+				m_Bounds[0][cluster] = minimum.x;
+				m_Bounds[1][cluster] = minimum.y;
+				m_Bounds[2][cluster] = -sliceFar;
+				m_Bounds[3][cluster] = maximum.x;
+				m_Bounds[4][cluster] = maximum.y;
+				m_Bounds[5][cluster] = -sliceNear;
+			}
+		}
+	}
+}
+
+void ClusteredLighting::TestSlices(const glm::vec3& center, float radius, int firstSlice, int lastSlice, uint32_t light)
+{
+	const int tilesPerSlice = TILES_X * TILES_Y;
+	float radiusSquared = radius * radius;
+	for (int slice = firstSlice; slice <= lastSlice; slice++)
+	{
+		int first = slice * tilesPerSlice;
+#if SIMD_SSE2
+		// squared distance from the sphere's center to four froxel boxes at once
+		__m128 cx = _mm_set1_ps(center.x), cy = _mm_set1_ps(center.y), cz = _mm_set1_ps(center.z);
+		__m128 limit = _mm_set1_ps(radiusSquared);
+		__m128 zero = _mm_setzero_ps();
+		for (int cluster = first; cluster < first + tilesPerSlice; cluster += 4)
+		{
+			__m128 dx = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&m_Bounds[0][cluster]), cx), _mm_sub_ps(cx, _mm_loadu_ps(&m_Bounds[3][cluster]))), zero);
+			__m128 dy = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&m_Bounds[1][cluster]), cy), _mm_sub_ps(cy, _mm_loadu_ps(&m_Bounds[4][cluster]))), zero);
+			__m128 dz = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&m_Bounds[2][cluster]), cz), _mm_sub_ps(cz, _mm_loadu_ps(&m_Bounds[5][cluster]))), zero);
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+			int mask = _mm_movemask_ps(_mm_cmple_ps(distance, limit));
+			for (; mask != 0; mask &= mask - 1)
+			{
+				int lane = 0;
+				while (!(mask & (1 << lane)))
+					lane++;
+				m_PairClusters.push_back(static_cast<uint32_t>(cluster + lane));
+				m_PairLights.push_back(light);
+			}
+		}
+#else
+		for (int cluster = first; cluster < first + tilesPerSlice; cluster++)
+		{
+			float distance = 0.0f;
+			for (int axis = 0; axis < 3; axis++)
+			{
+				float d = std::max(std::max(m_Bounds[axis][cluster] - center[axis], center[axis] - m_Bounds[axis + 3][cluster]), 0.0f);
+				distance += d * d;
+			}
+			if (distance <= radiusSquared)
+			{
+				m_PairClusters.push_back(static_cast<uint32_t>(cluster));
+				m_PairLights.push_back(light);
+			}
+		}
+#endif
+	}
+}
+
+void ClusteredLighting::Update(const glm::mat4& view, const glm::mat4& projection)
+{
+	auto start = std::chrono::steady_clock::now();
+	if (projection != m_BoundsProjection)
+		BuildClusterBounds(projection);
+
+	m_Stats = Stats();
+	m_Stats.lights = m_Lights.size();
+	m_PairClusters.clear();
+	m_PairLights.clear();
+	m_LightData.resize(m_Lights.size() * 4);
+	float sliceScale = SLICES / std::log(m_Far / m_Near);
+	for (size_t i = 0; i < m_Lights.size(); i++)
+	{
+		const SceneLight& light = m_Lights[i];
+		glm::vec3 direction = glm::length(light.direction) > 0.0f ? glm::normalize(light.direction) : glm::vec3(0.0f, -1.0f, 0.0f);
+		bool spot = light.type == LightType::Spot;
+		float outer = glm::radians(std::clamp(light.outerAngle, 0.0f, 89.0f));
+		float inner = glm::radians(std::clamp(light.innerAngle, 0.0f, std::clamp(light.outerAngle, 0.0f, 89.0f)));
+		m_LightData[i * 4] = glm::vec4(light.position, std::max(light.range, 0.001f));
+		m_LightData[i * 4 + 1] = glm::vec4(light.color * light.intensity, spot ? 1.0f : 0.0f);
+		m_LightData[i * 4 + 2] = glm::vec4(direction, std::cos(outer));
+		m_LightData[i * 4 + 3] = glm::vec4(std::cos(inner), 0.0f, 0.0f, 0.0f);
+
+		glm::vec3 center = light.position;
+		float radius = light.range;
+		if (spot)
+			SpotBounds(light, center, radius);
+		if (radius <= 0.0f || light.intensity <= 0.0f)
+			continue;
+
+		// only the depth slices the sphere overlaps are tested
+		glm::vec3 viewCenter = glm::vec3(view * glm::vec4(center, 1.0f));
+		float depthNear = -viewCenter.z - radius;
+		float depthFar = -viewCenter.z + radius;
+		if (depthFar < m_Near || depthNear > m_Far)
+			continue;
+		int firstSlice = static_cast<int>(std::log(std::max(depthNear, m_Near) / m_Near) * sliceScale);
+		int lastSlice = static_cast<int>(std::log(std::min(depthFar, m_Far) / m_Near) * sliceScale);
+		size_t before = m_PairClusters.size();
+		TestSlices(viewCenter, radius, std::clamp(firstSlice, 0, SLICES - 1), std::clamp(lastSlice, 0, SLICES - 1), static_cast<uint32_t>(i));
+		if (m_PairClusters.size() > before)
+			m_Stats.visible++;
+	}
+
+	// counting sort of the pairs into contiguous per froxel lists
+	std::fill(m_Grid.begin(), m_Grid.end(), 0u);
+	for (uint32_t cluster : m_PairClusters)
+		m_Grid[cluster * 2 + 1]++;
+	uint32_t offset = 0;
+	for (int cluster = 0; cluster < CLUSTER_COUNT; cluster++)
+	{
+		m_Grid[cluster * 2] = offset;
+		offset += m_Grid[cluster * 2 + 1];
+		m_Stats.maxPerCluster = std::max<size_t>(m_Stats.maxPerCluster, m_Grid[cluster * 2 + 1]);
+		m_Grid[cluster * 2 + 1] = 0;
+	}
+	m_Indices.resize(m_PairClusters.size());
+	for (size_t i = 0; i < m_PairClusters.size(); i++)
+	{
+		uint32_t* list = &m_Grid[m_PairClusters[i] * 2];
+		m_Indices[list[0] + list[1]++] = m_PairLights[i];
+	}
+	m_Stats.assignments = m_Indices.size();
+
+	Upload();
+	m_Stats.buildMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void ClusteredLighting::Upload()
+{
+	UploadBuffer(m_LightBuffer, m_LightData);
+	UploadBuffer(m_GridBuffer, m_Grid);
+	UploadBuffer(m_IndexBuffer, m_Indices);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+	MemoryTracker::Get().Update(m_MemoryId, 0, BufferBytes(m_LightData) + BufferBytes(m_Grid) + BufferBytes(m_Indices));
+}
+
+void ClusteredLighting::Apply(const Shader& shader, unsigned int firstUnit) const
+{
+	glActiveTexture(GL_TEXTURE0 + firstUnit);
+	glBindTexture(GL_TEXTURE_BUFFER, m_LightTexture.Get());
+	glActiveTexture(GL_TEXTURE0 + firstUnit + 1);
+	glBindTexture(GL_TEXTURE_BUFFER, m_GridTexture.Get());
+	glActiveTexture(GL_TEXTURE0 + firstUnit + 2);
+	glBindTexture(GL_TEXTURE_BUFFER, m_IndexTexture.Get());
+	glActiveTexture(GL_TEXTURE0);
+
+	shader.SetInt("lightData", firstUnit);
+	shader.SetInt("clusterLights", firstUnit + 1);
+	shader.SetInt("lightIndices", firstUnit + 2);
+	shader.SetInt("lightCount", static_cast<int>(m_Lights.size()));
+	shader.SetVec3("clusterCounts", static_cast<float>(TILES_X), static_cast<float>(TILES_Y), static_cast<float>(SLICES));
+	shader.SetVec2("clusterDepth", m_Near, SLICES / std::log(m_Far / m_Near));
+}
+
+const ClusteredLighting::Stats& ClusteredLighting::GetStats() const
+{
+	return m_Stats;
+}
@@ -0,0 +1,106 @@
+#ifndef CLUSTEREDLIGHTING_H
+#define CLUSTEREDLIGHTING_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "GLResource.h"
+#include "Shader.h"
+
+#include <cstdint>
+#include <vector>
+
+enum class LightType : uint8_t
+{
+	Point,
+	Spot
+};
+
+struct SceneLight
+{
+	LightType type = LightType::Point;
+	glm::vec3 position = glm::vec3(0.0f);
+	// spot lights only, normalized when uploaded
+	glm::vec3 direction = glm::vec3(0.0f, -1.0f, 0.0f);
+	glm::vec3 color = glm::vec3(1.0f);
+	float intensity = 1.0f;
+	// the light fades out to nothing at this distance
+	float range = 2.0f;
+	// cone half angles in degrees
+	float innerAngle = 20.0f;
+	float outerAngle = 30.0f;
+};
+
+// point and spot lights of the lit shaders, any number of them. every frame the view frustum is cut into a grid of
+// froxels (screen tiles times exponential depth slices) and each light's bounding sphere is tested against the froxels
+// of the depth slices it overlaps, four at a time. the light lists of all froxels are uploaded as buffer textures,
+// a fragment only shades the lights of its own froxel
+class ClusteredLighting
+{
+public:
+	static const int TILES_X = 16;
+	static const int TILES_Y = 9;
+	static const int SLICES = 24;
+	static const int CLUSTER_COUNT = TILES_X * TILES_Y * SLICES;
+
+	struct Stats
+	{
+		size_t lights = 0;
+		// lights touching at least one froxel
+		size_t visible = 0;
+		size_t assignments = 0;
+		size_t maxPerCluster = 0;
+		double buildMilliseconds = 0.0;
+	};
+
+	ClusteredLighting();
+	~ClusteredLighting();
+
+	ClusteredLighting(const ClusteredLighting&) = delete;
+	ClusteredLighting& operator=(const ClusteredLighting&) = delete;
+
+	std::vector<SceneLight>& GetLights();
+	const std::vector<SceneLight>& GetLights() const;
+
+	// assigns the lights to the froxels of this camera and uploads the lists, call once per drawn view.
+	// the grid follows the near and far planes of the projection
+	void Update(const glm::mat4& view, const glm::mat4& projection);
+	// binds the light, froxel and index buffers to firstUnit and the two units after it
+	void Apply(const Shader& shader, unsigned int firstUnit) const;
+
+	const Stats& GetStats() const;
+
+private:
+	void BuildClusterBounds(const glm::mat4& projection);
+	void TestSlices(const glm::vec3& center, float radius, int firstSlice, int lastSlice, uint32_t light);
+	void Upload();
+
+private:
+	std::vector<SceneLight> m_Lights;
+
+	// view space bounds of every froxel (x fastest, then y, then the depth slice), one array per component
+	std::vector<float> m_Bounds[6];
+	glm::mat4 m_BoundsProjection = glm::mat4(0.0f);
+	float m_Near = 0.1f;
+	float m_Far = 100.0f;
+
+	// (froxel, light) pairs of the current view, sorted into per froxel lists by counting
+	std::vector<uint32_t> m_PairClusters;
+	std::vector<uint32_t> m_PairLights;
+	std::vector<uint32_t> m_Grid;
+	std::vector<uint32_t> m_Indices;
+	std::vector<glm::vec4> m_LightData;
+
+	// per light texels, (offset, count) per froxel and the light indices of all lists
+	GLBuffer m_LightBuffer;
+	GLBuffer m_GridBuffer;
+	GLBuffer m_IndexBuffer;
+	GLTexture m_LightTexture;
+	GLTexture m_GridTexture;
+	GLTexture m_IndexTexture;
+	int m_MemoryId = -1;
+
+	Stats m_Stats;
+};
+
+#endif // !CLUSTEREDLIGHTING_H
@@ -0,0 +1,254 @@
+#include "DynamicResolution.h"
+
+#include "MemoryTracker.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+namespace
+{
+	const int SAMPLES = 4;
+	// part of the target frame time left unused so small spikes don't drop the scale right away
+	const float HEADROOM = 0.95f;
+	// the scale drops fast when over budget and recovers slowly, a single cheap frame doesn't make it oscillate
+	const float DECREASE_RATE = 0.5f;
+	const float INCREASE_RATE = 0.1f;
+	const float MIN_STEP = 0.01f;
+}
+
+DynamicResolution::DynamicResolution()
+{
+	for (Timing& timing : m_Timings)
+		glGenQueries(StampCount, timing.queries);
+	m_EmptyVertexArray = GLVertexArray::Create();
+}
+
+DynamicResolution::~DynamicResolution()
+{
+	for (Timing& timing : m_Timings)
+		glDeleteQueries(StampCount, timing.queries);
+	if (m_MemoryId >= 0)
+		MemoryTracker::Get().Unregister(m_MemoryId);
+}
+
+void DynamicResolution::SetEnabled(bool enabled)
+{
+	m_Enabled = enabled;
+}
+
+bool DynamicResolution::IsEnabled() const
+{
+	return m_Enabled;
+}
+
+void DynamicResolution::SetTargetFrameMilliseconds(float milliseconds)
+{
+	m_TargetMilliseconds = std::max(milliseconds, 1.0f);
+}
+
+float DynamicResolution::GetTargetFrameMilliseconds() const
+{
+	return m_TargetMilliseconds;
+}
+
+void DynamicResolution::SetSharpness(float sharpness)
+{
+	m_Sharpness = std::clamp(sharpness, 0.0f, 1.0f);
+}
+
+void DynamicResolution::SetMinimumScale(float scale)
+{
+	m_MinimumScale = std::clamp(scale, 0.1f, 1.0f);
+	m_Scale = std::max(m_Scale, m_MinimumScale);
+}
+
+void DynamicResolution::BeginFrame()
+{
+	Timing& timing = m_Timings[m_TimingIndex];
+	if (timing.pending)
+		ReadTiming(timing);
+
+	glQueryCounter(timing.queries[FrameStart], GL_TIMESTAMP);
+	timing.frame = m_FrameCount++;
+	timing.scene = false;
+	m_SceneBegun = false;
+}
+
+void DynamicResolution::EndFrame()
+{
+	Timing& timing = m_Timings[m_TimingIndex];
+	glQueryCounter(timing.queries[FrameEnd], GL_TIMESTAMP);
+	timing.pending = true;
+	m_TimingIndex = (m_TimingIndex + 1) % TIMING_FRAMES;
+}
+
+void DynamicResolution::ReadTiming(Timing& timing)
+{
+	// the slot was used TIMING_FRAMES frames ago, its results are there without waiting
+	GLuint64 stamps[StampCount] = {};
+	for (int i = 0; i < StampCount; i++)
+	{
+		if (i == SceneStart || i == SceneEnd)
+		{
+			if (!timing.scene)
+				continue;
+		}
+		glGetQueryObjectui64v(timing.queries[i], GL_QUERY_RESULT, &stamps[i]);
+	}
+	timing.pending = false;
+	m_GpuTimingFrame = static_cast<int64_t>(timing.frame);
+
+	m_GpuFrameMilliseconds = static_cast<float>(stamps[FrameEnd] - stamps[FrameStart]) / 1.0e6f;
+	if (!timing.scene)
+		return;
+	m_GpuSceneMilliseconds = static_cast<float>(stamps[SceneEnd] - stamps[SceneStart]) / 1.0e6f;
+	if (m_Enabled)
+		UpdateScale(m_GpuFrameMilliseconds, m_GpuSceneMilliseconds, timing.scale);
+}
+
+void DynamicResolution::UpdateScale(float frameMilliseconds, float sceneMilliseconds, float scale)
+{
+	if (sceneMilliseconds <= 0.0f)
+		return;
+
+	// only the scene scales, with the pixel count. whatever else the frame costs (shadows, ImGui) stays
+	float fixedMilliseconds = std::max(frameMilliseconds - sceneMilliseconds, 0.0f);
+	float budget = std::max(m_TargetMilliseconds * HEADROOM - fixedMilliseconds, m_TargetMilliseconds * 0.1f);
+	float desired = std::clamp(scale * std::sqrt(budget / sceneMilliseconds), m_MinimumScale, 1.0f);
+
+	if (std::abs(desired - m_Scale) < MIN_STEP)
+		return;
+	float rate = desired < m_Scale ? DECREASE_RATE : INCREASE_RATE;
+	m_Scale = std::clamp(m_Scale + (desired - m_Scale) * rate, m_MinimumScale, 1.0f);
+}
+
+void DynamicResolution::CreateTarget(int width, int height)
+{
+	m_ColorBuffer = GLRenderbuffer::Create();
+	glBindRenderbuffer(GL_RENDERBUFFER, m_ColorBuffer.Get());
+	glRenderbufferStorageMultisample(GL_RENDERBUFFER, SAMPLES, GL_RGBA8, width, height);
+	m_DepthBuffer = GLRenderbuffer::Create();
+	glBindRenderbuffer(GL_RENDERBUFFER, m_DepthBuffer.Get());
+	glRenderbufferStorageMultisample(GL_RENDERBUFFER, SAMPLES, GL_DEPTH24_STENCIL8, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	m_MultisampleFramebuffer = GLFramebuffer::Create();
+	glBindFramebuffer(GL_FRAMEBUFFER, m_MultisampleFramebuffer.Get());
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_ColorBuffer.Get());
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_DepthBuffer.Get());
+
+	m_ResolveTexture = GLTexture::Create();
+	glBindTexture(GL_TEXTURE_2D, m_ResolveTexture.Get());
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	m_ResolveFramebuffer = GLFramebuffer::Create();
+	glBindFramebuffer(GL_FRAMEBUFFER, m_ResolveFramebuffer.Get());
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_ResolveTexture.Get(), 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	m_Width = width;
+	m_Height = height;
+
+	if (m_MemoryId >= 0)
+		MemoryTracker::Get().Unregister(m_MemoryId);
+	const size_t pixels = static_cast<size_t>(width) * height;
+	m_MemoryId = MemoryTracker::Get().Register(MemoryCategory::RenderTarget, "dynamic resolution target (MSAA 4x)", 0,
+		pixels * (4 + 4) * SAMPLES + pixels * 4);
+}
+
+void DynamicResolution::BeginScene(int windowWidth, int windowHeight)
+{
+	windowWidth = std::max(windowWidth, 1);
+	windowHeight = std::max(windowHeight, 1);
+	if (windowWidth != m_Width || windowHeight != m_Height)
+		CreateTarget(windowWidth, windowHeight);
+
+	m_RenderWidth = std::max(static_cast<int>(windowWidth * m_Scale + 0.5f), 1);
+	m_RenderHeight = std::max(static_cast<int>(windowHeight * m_Scale + 0.5f), 1);
+
+	Timing& timing = m_Timings[m_TimingIndex];
+	glQueryCounter(timing.queries[SceneStart], GL_TIMESTAMP);
+	timing.scale = m_Scale;
+	m_SceneBegun = true;
+
+	glBindFramebuffer(GL_FRAMEBUFFER, m_MultisampleFramebuffer.Get());
+	glViewport(0, 0, m_RenderWidth, m_RenderHeight);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
+void DynamicResolution::EndScene(const Shader& upscaleShader)
+{
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, m_MultisampleFramebuffer.Get());
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_ResolveFramebuffer.Get());
+	glBlitFramebuffer(0, 0, m_RenderWidth, m_RenderHeight, 0, 0, m_RenderWidth, m_RenderHeight, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(0, 0, m_Width, m_Height);
+
+	GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+	glDisable(GL_DEPTH_TEST);
+	glDepthMask(GL_FALSE);
+
+	upscaleShader.Use();
+	upscaleShader.SetInt("source", 0);
+	upscaleShader.SetVec2("sourceScale", m_RenderWidth / static_cast<float>(m_Width), m_RenderHeight / static_cast<float>(m_Height));
+	upscaleShader.SetVec2("sourceTexel", 1.0f / m_Width, 1.0f / m_Height);
+	upscaleShader.SetFloat("sharpness", m_Sharpness);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, m_ResolveTexture.Get());
+	glBindVertexArray(m_EmptyVertexArray.Get());
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glBindVertexArray(0);
+
+	glDepthMask(GL_TRUE);
+	if (depthTest)
+		glEnable(GL_DEPTH_TEST);
+
+	if (m_SceneBegun)
+	{
+		Timing& timing = m_Timings[m_TimingIndex];
+		glQueryCounter(timing.queries[SceneEnd], GL_TIMESTAMP);
+		timing.scene = true;
+	}
+}
+
+float DynamicResolution::GetScale() const
+{
+	return m_Scale;
+}
+
+int DynamicResolution::GetRenderWidth() const
+{
+	return m_RenderWidth;
+}
+
+int DynamicResolution::GetRenderHeight() const
+{
+	return m_RenderHeight;
+}
+
+float DynamicResolution::GetGpuFrameMilliseconds() const
+{
+	return m_GpuFrameMilliseconds;
+}
+
+float DynamicResolution::GetGpuSceneMilliseconds() const
+{
+	return m_GpuSceneMilliseconds;
+}
+
+uint64_t DynamicResolution::GetFrameCount() const
+{
+	return m_FrameCount;
+}
+
+int64_t DynamicResolution::GetGpuTimingFrame() const
+{
+	return m_GpuTimingFrame;
+}
@@ -0,0 +1,102 @@
+#ifndef DYNAMICRESOLUTION_H
+#define DYNAMICRESOLUTION_H
+
+#include <glad/glad.h>
+
+#include "GLResource.h"
+#include "Shader.h"
+
+#include <cstdint>
+
+// renders the scene into an offscreen multisampled target and upscales it to the window, ImGui stays at native resolution.
+// the target is allocated at window size and the scene only uses a scaled viewport of it, so scale changes cost nothing.
+// GPU timestamps of every frame (read back a few frames later, never waited for) drive the scale towards a target frame time.
+class DynamicResolution
+{
+public:
+	DynamicResolution();
+	~DynamicResolution();
+
+	DynamicResolution(const DynamicResolution&) = delete;
+	DynamicResolution& operator=(const DynamicResolution&) = delete;
+
+	void SetEnabled(bool enabled);
+	bool IsEnabled() const;
+	void SetTargetFrameMilliseconds(float milliseconds);
+	float GetTargetFrameMilliseconds() const;
+	// 0 is plain bilinear
+	void SetSharpness(float sharpness);
+	void SetMinimumScale(float scale);
+
+	// start and end of everything the GPU does in a frame, timed even when disabled
+	void BeginFrame();
+	void EndFrame();
+
+	// binds the offscreen target with the scaled viewport and clears it
+	void BeginScene(int windowWidth, int windowHeight);
+	// resolves the scene and upscales it into the default framebuffer (bound afterwards with the window viewport)
+	void EndScene(const Shader& upscaleShader);
+
+	// scale of the next scene, per axis
+	float GetScale() const;
+	int GetRenderWidth() const;
+	int GetRenderHeight() const;
+	// latest GPU timings, a few frames old
+	float GetGpuFrameMilliseconds() const;
+	float GetGpuSceneMilliseconds() const;
+	// frames begun so far, and the frame (counted the same way from 0) the latest GPU timings belong to, -1 before the first
+	uint64_t GetFrameCount() const;
+	int64_t GetGpuTimingFrame() const;
+
+private:
+	enum Stamp
+	{
+		FrameStart,
+		SceneStart,
+		SceneEnd,
+		FrameEnd,
+		StampCount
+	};
+
+	struct Timing
+	{
+		GLuint queries[StampCount] = {};
+		uint64_t frame = 0;
+		float scale = 1.0f;
+		bool pending = false;
+		bool scene = false;
+	};
+
+	void CreateTarget(int width, int height);
+	void ReadTiming(Timing& timing);
+	void UpdateScale(float frameMilliseconds, float sceneMilliseconds, float scale);
+
+private:
+	bool m_Enabled = false;
+	float m_TargetMilliseconds = 16.0f;
+	float m_Sharpness = 0.5f;
+	float m_MinimumScale = 0.5f;
+	float m_Scale = 1.0f;
+
+	int m_Width = 0, m_Height = 0;
+	int m_RenderWidth = 0, m_RenderHeight = 0;
+	GLFramebuffer m_MultisampleFramebuffer;
+	GLRenderbuffer m_ColorBuffer;
+	GLRenderbuffer m_DepthBuffer;
+	GLFramebuffer m_ResolveFramebuffer;
+	GLTexture m_ResolveTexture;
+	GLVertexArray m_EmptyVertexArray;
+	int m_MemoryId = -1;
+
+	// results are read when a slot comes around again, by then the GPU finished that frame
+	static const int TIMING_FRAMES = 4;
+	Timing m_Timings[TIMING_FRAMES];
+	int m_TimingIndex = 0;
+	bool m_SceneBegun = false;
+	float m_GpuFrameMilliseconds = 0.0f;
+	float m_GpuSceneMilliseconds = 0.0f;
+	uint64_t m_FrameCount = 0;
+	int64_t m_GpuTimingFrame = -1;
+};
+
+#endif // !DYNAMICRESOLUTION_H
@@ -0,0 +1,214 @@
+#include "Environment.h"
+
+#include "MemoryTracker.h"
+#include "ThreadPool.h"
+
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+	const IBLBakeSettings BAKE_SETTINGS;
+	const int BRDF_LUT_SIZE = 128;
+	const int BRDF_LUT_SAMPLES = 512;
+}
+
+Environment::Environment()
+{
+	for (int i = 0; i < 9; i++)
+		m_IrradianceSH[i] = glm::vec3(0.0f);
+
+	float vertices[] = {
+		-1.0f,  1.0f, -1.0f,  -1.0f, -1.0f, -1.0f,   1.0f, -1.0f, -1.0f,   1.0f, -1.0f, -1.0f,   1.0f,  1.0f, -1.0f,  -1.0f,  1.0f, -1.0f,
+		-1.0f, -1.0f,  1.0f,  -1.0f, -1.0f, -1.0f,  -1.0f,  1.0f, -1.0f,  -1.0f,  1.0f, -1.0f,  -1.0f,  1.0f,  1.0f,  -1.0f, -1.0f,  1.0f,
+		 1.0f, -1.0f, -1.0f,   1.0f, -1.0f,  1.0f,   1.0f,  1.0f,  1.0f,   1.0f,  1.0f,  1.0f,   1.0f,  1.0f, -1.0f,   1.0f, -1.0f, -1.0f,
+		-1.0f, -1.0f,  1.0f,  -1.0f,  1.0f,  1.0f,   1.0f,  1.0f,  1.0f,   1.0f,  1.0f,  1.0f,   1.0f, -1.0f,  1.0f,  -1.0f, -1.0f,  1.0f,
+		-1.0f,  1.0f, -1.0f,   1.0f,  1.0f, -1.0f,   1.0f,  1.0f,  1.0f,   1.0f,  1.0f,  1.0f,  -1.0f,  1.0f,  1.0f,  -1.0f,  1.0f, -1.0f,
+		-1.0f, -1.0f, -1.0f,  -1.0f, -1.0f,  1.0f,   1.0f, -1.0f, -1.0f,   1.0f, -1.0f, -1.0f,  -1.0f, -1.0f,  1.0f,   1.0f, -1.0f,  1.0f
+	};
+
+	m_SkyboxVAO = GLVertexArray::Create();
+	m_SkyboxVBO = GLBuffer::Create();
+	glBindVertexArray(m_SkyboxVAO.Get());
+	glBindBuffer(GL_ARRAY_BUFFER, m_SkyboxVBO.Get());
+	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), &vertices, GL_STATIC_DRAW);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+	glBindVertexArray(0);
+
+	// filter across cube face edges, otherwise the rough mips show seams
+	glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+}
+
+Environment::~Environment()
+{
+	if (m_MemoryId >= 0)
+		MemoryTracker::Get().Unregister(m_MemoryId);
+}
+
+void Environment::Load(const std::string& path)
+{
+	if (path == m_Path || path == m_PendingPath)
+		return;
+
+	m_PendingPath = path;
+	m_Pending = ThreadPool::Get().Submit([path]() { return BakeOrReadCache(path); });
+}
+
+void Environment::Update()
+{
+	if (!m_Pending.valid() || m_Pending.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		return;
+
+	BakeResult result = m_Pending.get();
+	m_PendingPath.clear();
+	if (!result.valid)
+		return;
+
+	if (!m_BrdfLut)
+		LoadBrdfLut();
+	Upload(result);
+	std::cout << "Environment " << (result.fromCache ? "loaded from cache: " : "baked: ") << result.path << std::endl;
+}
+
+void Environment::Apply(const Shader& shader, unsigned int prefilterUnit, unsigned int brdfUnit, bool enabled, float intensity) const
+{
+	bool useIBL = enabled && IsReady();
+	shader.SetInt("useIBL", useIBL);
+	if (!useIBL)
+		return;
+
+	shader.SetFloat("environmentIntensity", intensity);
+	shader.SetFloat("prefilterMaxLod", static_cast<float>(m_MipCount - 1));
+	shader.SetVec3Array("irradianceSH", m_IrradianceSH, 9);
+
+	glActiveTexture(GL_TEXTURE0 + prefilterUnit);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, m_PrefilterMap.Get());
+	glActiveTexture(GL_TEXTURE0 + brdfUnit);
+	glBindTexture(GL_TEXTURE_2D, m_BrdfLut.Get());
+	glActiveTexture(GL_TEXTURE0);
+}
+
+void Environment::DrawSkybox(const Shader& skyboxShader, const glm::mat4& view, const glm::mat4& projection, float intensity, float blur) const
+{
+	if (!IsReady())
+		return;
+
+	// drawn last with the depth of the far plane, only uncovered pixels get shaded
+	glDepthFunc(GL_LEQUAL);
+	glDisable(GL_CULL_FACE);
+
+	skyboxShader.Use();
+	skyboxShader.SetMat4("view", glm::mat4(glm::mat3(view)));
+	skyboxShader.SetMat4("projection", projection);
+	skyboxShader.SetFloat("environmentIntensity", intensity);
+	skyboxShader.SetFloat("skyboxLod", blur * (m_MipCount - 1));
+	skyboxShader.SetInt("environmentMap", 0);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, m_PrefilterMap.Get());
+	glBindVertexArray(m_SkyboxVAO.Get());
+	glDrawArrays(GL_TRIANGLES, 0, 36);
+	glBindVertexArray(0);
+
+	glEnable(GL_CULL_FACE);
+	glDepthFunc(GL_LESS);
+}
+
+bool Environment::IsReady() const
+{
+	return m_PrefilterMap && m_BrdfLut;
+}
+
+bool Environment::IsLoading() const
+{
+	return m_Pending.valid();
+}
+
+const std::string& Environment::GetPath() const
+{
+	return m_Path;
+}
+
+Environment::BakeResult Environment::BakeOrReadCache(const std::string& path)
+{
+	BakeResult result;
+	result.path = path;
+
+	std::string cachePath = IBLBaker::GetCachePath(path, BAKE_SETTINGS);
+	if (IBLBaker::ReadCache(cachePath, result.maps))
+	{
+		result.valid = true;
+		result.fromCache = true;
+		return result;
+	}
+
+	std::vector<float> pixels;
+	int width, height;
+	if (!IBLBaker::LoadEquirect(path, pixels, width, height))
+		return result;
+
+	result.maps = IBLBaker::Bake(pixels, width, height, BAKE_SETTINGS);
+	IBLBaker::WriteCache(cachePath, result.maps);
+	result.valid = true;
+	return result;
+}
+
+void Environment::Upload(const BakeResult& result)
+{
+	if (!m_PrefilterMap)
+		m_PrefilterMap = GLTexture::Create();
+
+	m_MipCount = static_cast<int>(result.maps.specularMips.size());
+	glBindTexture(GL_TEXTURE_CUBE_MAP, m_PrefilterMap.Get());
+	for (int level = 0; level < m_MipCount; level++)
+	{
+		const CubeMapData& mip = result.maps.specularMips[level];
+		size_t faceFloats = static_cast<size_t>(mip.faceSize) * mip.faceSize * 3;
+		for (int face = 0; face < 6; face++)
+			glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, level, GL_RGB16F, mip.faceSize, mip.faceSize, 0, GL_RGB, GL_FLOAT, &mip.texels[face * faceFloats]);
+	}
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_BASE_LEVEL, 0);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, m_MipCount - 1);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+
+	for (int i = 0; i < 9; i++)
+		m_IrradianceSH[i] = result.maps.irradianceSH[i];
+	m_Path = result.path;
+
+	// RGB16F is padded to 8 bytes per texel by most drivers
+	size_t gpuBytes = MemoryTracker::TextureBytes(BRDF_LUT_SIZE, BRDF_LUT_SIZE, 4, false);
+	for (const CubeMapData& mip : result.maps.specularMips)
+		gpuBytes += static_cast<size_t>(6) * mip.faceSize * mip.faceSize * 8;
+	if (m_MemoryId < 0)
+		m_MemoryId = MemoryTracker::Get().Register(MemoryCategory::Environment, "environment maps + BRDF LUT", 0, gpuBytes);
+	else
+		MemoryTracker::Get().Update(m_MemoryId, 0, gpuBytes);
+}
+
+void Environment::LoadBrdfLut()
+{
+	// the LUT does not depend on the environment, it is baked once and read from the cache afterwards
+	std::string cachePath = IBLBaker::GetBrdfLutCachePath(BRDF_LUT_SIZE, BRDF_LUT_SAMPLES);
+	std::vector<float> lut;
+	if (!IBLBaker::ReadBrdfLut(cachePath, BRDF_LUT_SIZE, lut))
+	{
+		lut = IBLBaker::BakeBrdfLut(BRDF_LUT_SIZE, BRDF_LUT_SAMPLES);
+		IBLBaker::WriteBrdfLut(cachePath, BRDF_LUT_SIZE, lut);
+	}
+
+	m_BrdfLut = GLTexture::Create();
+	glBindTexture(GL_TEXTURE_2D, m_BrdfLut.Get());
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16F, BRDF_LUT_SIZE, BRDF_LUT_SIZE, 0, GL_RG, GL_FLOAT, lut.data());
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
@@ -0,0 +1,66 @@
+#ifndef ENVIRONMENT_H
+#define ENVIRONMENT_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "GLResource.h"
+#include "IBLBaker.h"
+#include "Shader.h"
+
+#include <future>
+#include <memory>
+#include <string>
+
+// HDR environment used for the skybox and image based lighting.
+// baking runs on the thread pool, results are cached on disk so switching back to an environment is instant.
+class Environment
+{
+public:
+	Environment();
+	~Environment();
+
+	Environment(const Environment&) = delete;
+	Environment& operator=(const Environment&) = delete;
+
+	// starts loading an equirect environment in the background, a previous load still running is dropped
+	void Load(const std::string& path);
+	// uploads finished bakes, call once per frame from the render thread
+	void Update();
+
+	// sets the IBL uniforms of a lit shader and binds the maps to the given texture units
+	void Apply(const Shader& shader, unsigned int prefilterUnit, unsigned int brdfUnit, bool enabled, float intensity) const;
+	void DrawSkybox(const Shader& skyboxShader, const glm::mat4& view, const glm::mat4& projection, float intensity, float blur) const;
+
+	bool IsReady() const;
+	bool IsLoading() const;
+	const std::string& GetPath() const;
+
+private:
+	struct BakeResult
+	{
+		std::string path;
+		IBLMaps maps;
+		bool valid = false;
+		bool fromCache = false;
+	};
+
+	static BakeResult BakeOrReadCache(const std::string& path);
+	void Upload(const BakeResult& result);
+	void LoadBrdfLut();
+
+private:
+	std::future<BakeResult> m_Pending;
+	std::string m_PendingPath;
+	std::string m_Path;
+
+	GLTexture m_PrefilterMap;
+	GLTexture m_BrdfLut;
+	GLVertexArray m_SkyboxVAO;
+	GLBuffer m_SkyboxVBO;
+	int m_MipCount = 0;
+	int m_MemoryId = -1;
+	glm::vec3 m_IrradianceSH[9];
+};
+
+#endif // !ENVIRONMENT_H
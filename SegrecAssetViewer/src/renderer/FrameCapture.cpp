@@ -0,0 +1,432 @@
+#include "FrameCapture.h"
+
+#include "ImageWriter.h"
+#include "MemoryTracker.h"
+#include "ThreadPool.h"
+
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <iostream>
+
+namespace
+{
+	// readbacks in flight, a frame is mapped two frames after it was rendered
+	const int READBACK_RING_SIZE = 3;
+	const int MAX_SAMPLES = 4;
+	const GLuint64 FENCE_TIMEOUT_NS = 1000000000ull;
+
+	int BytesPerPixel(CaptureFormat format)
+	{
+		return format == CaptureFormat::Exr ? 8 : 4;
+	}
+
+	std::string TimeStamp()
+	{
+		std::time_t now = std::time(nullptr);
+		std::tm local = {};
+#ifdef _WIN32
+		localtime_s(&local, &now);
+#else
+		localtime_r(&now, &local);
+#endif
+		char text[32];
+		std::strftime(text, sizeof(text), "%Y%m%d_%H%M%S", &local);
+		return text;
+	}
+}
+
+FrameCapture::~FrameCapture()
+{
+	Stop();
+	Finish();
+	if (m_MemoryId >= 0)
+		MemoryTracker::Get().Unregister(m_MemoryId);
+}
+
+bool FrameCapture::Start(const CaptureSettings& settings)
+{
+	// the previous capture is written completely first, its encodes use the old target size
+	Stop();
+	Finish();
+
+	GLint maxSize = 0, maxTextureSize = 0;
+	glGetIntegerv(GL_MAX_RENDERBUFFER_SIZE, &maxSize);
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+	maxSize = std::min(maxSize, maxTextureSize);
+	if (settings.width < 16 || settings.height < 16 || settings.width > maxSize || settings.height > maxSize)
+	{
+		std::cout << "ERROR::CAPTURE::INVALID_SIZE " << settings.width << "x" << settings.height << " (maximum " << maxSize << ")" << std::endl;
+		return false;
+	}
+
+	m_Settings = settings;
+	if (!m_MultisampleFramebuffer || m_TargetWidth != settings.width || m_TargetHeight != settings.height || m_TargetFormat != settings.format)
+	{
+		if (!CreateTargets())
+			return false;
+	}
+
+	std::string directory = settings.directory + "/" + TimeStamp();
+	std::string unique = directory;
+	for (int suffix = 2; std::filesystem::exists(unique); suffix++)
+		unique = directory + "_" + std::to_string(suffix);
+
+	std::error_code error;
+	std::filesystem::create_directories(unique, error);
+	if (error)
+	{
+		std::cout << "ERROR::CAPTURE::DIRECTORY_NOT_CREATED " << unique << ": " << error.message() << std::endl;
+		return false;
+	}
+
+	m_OutputDirectory = unique;
+	m_CapturedFrames = 0;
+	{
+		std::lock_guard<std::mutex> lock(m_EncodeMutex);
+		m_WrittenFrames = 0;
+		m_FailedFrames = 0;
+		m_EncodeMilliseconds = 0.0;
+	}
+	m_Capturing = true;
+	return true;
+}
+
+void FrameCapture::Stop()
+{
+	m_Capturing = false;
+}
+
+bool FrameCapture::IsCapturing() const
+{
+	return m_Capturing;
+}
+
+bool FrameCapture::IsBusy() const
+{
+	if (m_Capturing)
+		return true;
+	for (const Readback& readback : m_Ring)
+	{
+		if (readback.fence)
+			return true;
+	}
+	std::lock_guard<std::mutex> lock(m_EncodeMutex);
+	return m_EncodesInFlight > 0;
+}
+
+bool FrameCapture::CreateTargets()
+{
+	const int width = m_Settings.width, height = m_Settings.height;
+	// 8 bits are enough for what is displayed, EXR keeps the values above 1
+	const GLenum colorFormat = m_Settings.format == CaptureFormat::Exr ? GL_RGBA16F : GL_RGBA8;
+
+	GLint maxSamples = 0;
+	glGetIntegerv(GL_MAX_SAMPLES, &maxSamples);
+	const int samples = std::max(1, std::min(MAX_SAMPLES, static_cast<int>(maxSamples)));
+
+	m_ColorBuffer = GLRenderbuffer::Create();
+	glBindRenderbuffer(GL_RENDERBUFFER, m_ColorBuffer.Get());
+	glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, colorFormat, width, height);
+	m_DepthBuffer = GLRenderbuffer::Create();
+	glBindRenderbuffer(GL_RENDERBUFFER, m_DepthBuffer.Get());
+	glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_DEPTH24_STENCIL8, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	m_MultisampleFramebuffer = GLFramebuffer::Create();
+	glBindFramebuffer(GL_FRAMEBUFFER, m_MultisampleFramebuffer.Get());
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_ColorBuffer.Get());
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_DepthBuffer.Get());
+	bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+
+	m_ResolveTexture = GLTexture::Create();
+	glBindTexture(GL_TEXTURE_2D, m_ResolveTexture.Get());
+	glTexImage2D(GL_TEXTURE_2D, 0, colorFormat, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	m_ResolveFramebuffer = GLFramebuffer::Create();
+	glBindFramebuffer(GL_FRAMEBUFFER, m_ResolveFramebuffer.Get());
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_ResolveTexture.Get(), 0);
+	complete = complete && glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	if (!complete)
+	{
+		std::cout << "ERROR::CAPTURE::FRAMEBUFFER_INCOMPLETE " << width << "x" << height << std::endl;
+		m_MultisampleFramebuffer.Reset();
+		m_ResolveFramebuffer.Reset();
+		m_ColorBuffer.Reset();
+		m_DepthBuffer.Reset();
+		m_ResolveTexture.Reset();
+		m_TargetWidth = m_TargetHeight = 0;
+		return false;
+	}
+
+	m_TargetWidth = width;
+	m_TargetHeight = height;
+	m_TargetFormat = m_Settings.format;
+
+	const size_t frameBytes = GetFrameBytes();
+	m_Ring.clear();
+	m_Ring.resize(READBACK_RING_SIZE);
+	m_RingHead = 0;
+	for (Readback& readback : m_Ring)
+	{
+		readback.buffer = GLBuffer::Create();
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer.Get());
+		glBufferData(GL_PIXEL_PACK_BUFFER, frameBytes, nullptr, GL_STREAM_READ);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	{
+		std::lock_guard<std::mutex> lock(m_EncodeMutex);
+		m_FreeBuffers.clear();
+	}
+
+	if (m_MemoryId >= 0)
+		MemoryTracker::Get().Unregister(m_MemoryId);
+	const size_t pixels = static_cast<size_t>(width) * height;
+	const size_t colorBytes = BytesPerPixel(m_TargetFormat);
+	const size_t gpuBytes = pixels * (colorBytes + 4) * samples + pixels * colorBytes + frameBytes * READBACK_RING_SIZE;
+	m_MemoryId = MemoryTracker::Get().Register(MemoryCategory::RenderTarget, "Frame capture " + std::to_string(width) + "x" + std::to_string(height), 0, gpuBytes);
+	return true;
+}
+
+size_t FrameCapture::GetFrameBytes() const
+{
+	return static_cast<size_t>(m_TargetWidth) * m_TargetHeight * BytesPerPixel(m_TargetFormat);
+}
+
+void FrameCapture::BeginFrame()
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, m_MultisampleFramebuffer.Get());
+	glViewport(0, 0, m_TargetWidth, m_TargetHeight);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
+void FrameCapture::EndFrame(int windowWidth, int windowHeight)
+{
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, m_MultisampleFramebuffer.Get());
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_ResolveFramebuffer.Get());
+	glBlitFramebuffer(0, 0, m_TargetWidth, m_TargetHeight, 0, 0, m_TargetWidth, m_TargetHeight, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+
+	if (m_Capturing)
+	{
+		// the ring is full only when the CPU falls behind by more than its size, then the oldest frame is waited for
+		Readback& readback = m_Ring[m_RingHead];
+		if (readback.fence)
+			Collect(readback, true);
+
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, m_ResolveFramebuffer.Get());
+		glReadBuffer(GL_COLOR_ATTACHMENT0);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer.Get());
+		glPixelStorei(GL_PACK_ALIGNMENT, 4);
+		glReadPixels(0, 0, m_TargetWidth, m_TargetHeight, GL_RGBA, m_TargetFormat == CaptureFormat::Exr ? GL_HALF_FLOAT : GL_UNSIGNED_BYTE, nullptr);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		readback.frame = m_CapturedFrames++;
+		m_RingHead = (m_RingHead + 1) % READBACK_RING_SIZE;
+
+		if (m_Settings.frameCount > 0 && m_CapturedFrames >= m_Settings.frameCount)
+			m_Capturing = false;
+	}
+
+	// show the captured frame fitted into the window
+	float scale = std::min(windowWidth / static_cast<float>(m_TargetWidth), windowHeight / static_cast<float>(m_TargetHeight));
+	int width = static_cast<int>(m_TargetWidth * scale), height = static_cast<int>(m_TargetHeight * scale);
+	int x = (windowWidth - width) / 2, y = (windowHeight - height) / 2;
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, m_ResolveFramebuffer.Get());
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	glBlitFramebuffer(0, 0, m_TargetWidth, m_TargetHeight, x, y, x + width, y + height, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(0, 0, windowWidth, windowHeight);
+}
+
+void FrameCapture::Update()
+{
+	// oldest first, later readbacks can't be done before an earlier one
+	for (int i = 0; i < static_cast<int>(m_Ring.size()); i++)
+	{
+		Readback& readback = m_Ring[(m_RingHead + i) % m_Ring.size()];
+		if (readback.fence && !Collect(readback, false))
+			break;
+	}
+}
+
+void FrameCapture::Finish()
+{
+	for (int i = 0; i < static_cast<int>(m_Ring.size()); i++)
+	{
+		Readback& readback = m_Ring[(m_RingHead + i) % m_Ring.size()];
+		if (readback.fence)
+			Collect(readback, true);
+	}
+
+	std::unique_lock<std::mutex> lock(m_EncodeMutex);
+	m_EncodeCondition.wait(lock, [this]() { return m_EncodesInFlight == 0; });
+}
+
+bool FrameCapture::Collect(Readback& readback, bool wait)
+{
+	GLenum status = glClientWaitSync(readback.fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, wait ? FENCE_TIMEOUT_NS : 0);
+	while (wait && status == GL_TIMEOUT_EXPIRED)
+		status = glClientWaitSync(readback.fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT_NS);
+	if (status == GL_TIMEOUT_EXPIRED)
+		return false;
+
+	glDeleteSync(readback.fence);
+	readback.fence = nullptr;
+	if (status == GL_WAIT_FAILED)
+	{
+		std::cout << "ERROR::CAPTURE::FENCE_FAILED frame " << readback.frame << std::endl;
+		std::lock_guard<std::mutex> lock(m_EncodeMutex);
+		m_FailedFrames++;
+		return true;
+	}
+
+	// the encoders are the bottleneck at high resolutions, pixel copies wait here instead of piling up in memory
+	const size_t frameBytes = GetFrameBytes();
+	const int maxEncodes = std::max(2, static_cast<int>(ThreadPool::Get().GetThreadCount()) * 2);
+	std::vector<unsigned char> pixels;
+	{
+		std::unique_lock<std::mutex> lock(m_EncodeMutex);
+		m_EncodeCondition.wait(lock, [this, maxEncodes]() { return m_EncodesInFlight < maxEncodes; });
+		if (!m_FreeBuffers.empty())
+		{
+			pixels = std::move(m_FreeBuffers.back());
+			m_FreeBuffers.pop_back();
+		}
+		m_EncodesInFlight++;
+	}
+	pixels.resize(frameBytes);
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer.Get());
+	const void* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, frameBytes, GL_MAP_READ_BIT);
+	bool mappedOk = mapped != nullptr;
+	if (mappedOk)
+	{
+		std::memcpy(pixels.data(), mapped, frameBytes);
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	if (!mappedOk)
+	{
+		std::cout << "ERROR::CAPTURE::MAP_FAILED frame " << readback.frame << std::endl;
+		std::lock_guard<std::mutex> lock(m_EncodeMutex);
+		m_FreeBuffers.push_back(std::move(pixels));
+		m_EncodesInFlight--;
+		m_FailedFrames++;
+		m_EncodeCondition.notify_all();
+		return true;
+	}
+
+	char name[32];
+	std::snprintf(name, sizeof(name), "/frame_%05d%s", readback.frame, m_TargetFormat == CaptureFormat::Exr ? ".exr" : ".png");
+	std::string path = m_OutputDirectory + name;
+	const int width = m_TargetWidth, height = m_TargetHeight;
+	const CaptureFormat format = m_TargetFormat;
+	ThreadPool::Get().Submit([this, path, width, height, format, pixels = std::move(pixels)]() mutable
+	{
+		Encode(path, width, height, format, std::move(pixels));
+	});
+	return true;
+}
+
+void FrameCapture::Encode(const std::string& path, int width, int height, CaptureFormat format, std::vector<unsigned char> pixels)
+{
+	auto start = std::chrono::steady_clock::now();
+	const size_t count = static_cast<size_t>(width) * height;
+	bool written;
+	if (format == CaptureFormat::Exr)
+	{
+		// the shaders write display referred colour, EXR is expected to hold linear values
+		std::vector<float> rgb(count * 3);
+		const unsigned short* half = reinterpret_cast<const unsigned short*>(pixels.data());
+		for (size_t i = 0; i < count; i++)
+		{
+			for (int c = 0; c < 3; c++)
+				rgb[i * 3 + c] = std::pow(std::max(glm::unpackHalf1x16(half[i * 4 + c]), 0.0f), 2.2f);
+		}
+		written = ImageWriter::WriteExr(path, width, height, rgb.data(), true);
+	}
+	else
+	{
+		// drop alpha in place, the window is opaque anyway
+		for (size_t i = 1; i < count; i++)
+		{
+			pixels[i * 3 + 0] = pixels[i * 4 + 0];
+			pixels[i * 3 + 1] = pixels[i * 4 + 1];
+			pixels[i * 3 + 2] = pixels[i * 4 + 2];
+		}
+		written = ImageWriter::WritePng(path, width, height, 3, pixels.data(), true);
+	}
+	double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	if (!written)
+		std::cout << "ERROR::CAPTURE::FILE_NOT_WRITTEN " << path << std::endl;
+
+	std::lock_guard<std::mutex> lock(m_EncodeMutex);
+	if (written)
+		m_WrittenFrames++;
+	else
+		m_FailedFrames++;
+	m_EncodeMilliseconds += milliseconds;
+	m_FreeBuffers.push_back(std::move(pixels));
+	m_EncodesInFlight--;
+	m_EncodeCondition.notify_all();
+}
+
+float FrameCapture::GetAspect() const
+{
+	return m_Settings.width / static_cast<float>(m_Settings.height);
+}
+
+int FrameCapture::GetCapturedFrames() const
+{
+	return m_CapturedFrames;
+}
+
+int FrameCapture::GetWrittenFrames() const
+{
+	std::lock_guard<std::mutex> lock(m_EncodeMutex);
+	return m_WrittenFrames;
+}
+
+int FrameCapture::GetFailedFrames() const
+{
+	std::lock_guard<std::mutex> lock(m_EncodeMutex);
+	return m_FailedFrames;
+}
+
+int FrameCapture::GetEncodesInFlight() const
+{
+	std::lock_guard<std::mutex> lock(m_EncodeMutex);
+	return m_EncodesInFlight;
+}
+
+double FrameCapture::GetAverageEncodeMilliseconds() const
+{
+	std::lock_guard<std::mutex> lock(m_EncodeMutex);
+	int frames = m_WrittenFrames + m_FailedFrames;
+	return frames > 0 ? m_EncodeMilliseconds / frames : 0.0;
+}
+
+const std::string& FrameCapture::GetOutputDirectory() const
+{
+	return m_OutputDirectory;
+}
+
+const CaptureSettings& FrameCapture::GetSettings() const
+{
+	return m_Settings;
+}
@@ -0,0 +1,112 @@
+#ifndef FRAMECAPTURE_H
+#define FRAMECAPTURE_H
+
+#include <glad/glad.h>
+
+#include "GLResource.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+
+enum class CaptureFormat
+{
+	Png,    // 8-bit RGB as displayed
+	Exr     // half float RGB, linear (the display gamma is taken out again)
+};
+
+struct CaptureSettings
+{
+	int width = 1920;
+	int height = 1080;
+	CaptureFormat format = CaptureFormat::Png;
+	// 0 captures until Stop
+	int frameCount = 0;
+	// every capture gets a time stamped directory below this one
+	std::string directory = "captures";
+};
+
+// renders the scene into an offscreen multisampled target of any size and reads every frame back through a ring
+// of pixel buffers. a frame's readback is only mapped once its fence signalled, frames later, so the GPU never
+// waits for the CPU. encoding runs on the thread pool, the render thread only copies the mapped pixels.
+class FrameCapture
+{
+public:
+	FrameCapture() = default;
+	~FrameCapture();
+
+	FrameCapture(const FrameCapture&) = delete;
+	FrameCapture& operator=(const FrameCapture&) = delete;
+
+	bool Start(const CaptureSettings& settings);
+	// frames already rendered are still read back and written
+	void Stop();
+
+	// true while frames are rendered into the capture target
+	bool IsCapturing() const;
+	// true until the last captured frame is written
+	bool IsBusy() const;
+
+	// binds the capture target and its viewport, the scene is drawn into it instead of the window
+	void BeginFrame();
+	// resolves the frame, starts its readback and shows it letterboxed in the window (default framebuffer bound afterwards)
+	void EndFrame(int windowWidth, int windowHeight);
+	// collects finished readbacks, call once per frame from the render thread
+	void Update();
+	// blocks until every captured frame is written
+	void Finish();
+
+	float GetAspect() const;
+	// frames rendered so far, also the index of the next frame
+	int GetCapturedFrames() const;
+	int GetWrittenFrames() const;
+	int GetFailedFrames() const;
+	int GetEncodesInFlight() const;
+	double GetAverageEncodeMilliseconds() const;
+	const std::string& GetOutputDirectory() const;
+	const CaptureSettings& GetSettings() const;
+
+private:
+	struct Readback
+	{
+		GLBuffer buffer;
+		GLsync fence = nullptr;
+		int frame = -1;
+	};
+
+	bool CreateTargets();
+	// maps a finished readback, copies it out and queues the encode. wait blocks until the fence signalled
+	bool Collect(Readback& readback, bool wait);
+	void Encode(const std::string& path, int width, int height, CaptureFormat format, std::vector<unsigned char> pixels);
+	size_t GetFrameBytes() const;
+
+private:
+	CaptureSettings m_Settings;
+	std::string m_OutputDirectory;
+	bool m_Capturing = false;
+	int m_CapturedFrames = 0;
+
+	GLFramebuffer m_MultisampleFramebuffer;
+	GLRenderbuffer m_ColorBuffer;
+	GLRenderbuffer m_DepthBuffer;
+	GLFramebuffer m_ResolveFramebuffer;
+	GLTexture m_ResolveTexture;
+	int m_TargetWidth = 0, m_TargetHeight = 0;
+	CaptureFormat m_TargetFormat = CaptureFormat::Png;
+	int m_MemoryId = -1;
+
+	std::vector<Readback> m_Ring;
+	int m_RingHead = 0;
+
+	// encode jobs, their pixel buffers are recycled
+	mutable std::mutex m_EncodeMutex;
+	std::condition_variable m_EncodeCondition;
+	std::vector<std::vector<unsigned char>> m_FreeBuffers;
+	int m_EncodesInFlight = 0;
+	int m_WrittenFrames = 0;
+	int m_FailedFrames = 0;
+	double m_EncodeMilliseconds = 0.0;
+};
+
+#endif // !FRAMECAPTURE_H
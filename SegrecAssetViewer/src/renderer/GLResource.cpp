@@ -0,0 +1,134 @@
+#include "GLResource.h"
+
+GLDeletionQueue& GLDeletionQueue::Get()
+{
+	static GLDeletionQueue queue;
+	return queue;
+}
+
+void GLDeletionQueue::Enqueue(GLObjectType type, unsigned int id)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	if (m_Shutdown)
+		return;
+	m_Pending.emplace_back(type, id);
+}
+
+void GLDeletionQueue::OnCreated(GLObjectType type)
+{
+	m_LiveCounts[static_cast<int>(type)]++;
+}
+
+void GLDeletionQueue::EndFrame()
+{
+	std::vector<Object> ready;
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		if (!m_Pending.empty())
+		{
+			Batch batch;
+			batch.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+			batch.objects.swap(m_Pending);
+			m_Batches.push_back(std::move(batch));
+		}
+
+		// batches are fenced in order, the first one still running ends the scan
+		while (!m_Batches.empty())
+		{
+			Batch& batch = m_Batches.front();
+			GLenum status = glClientWaitSync(batch.fence, 0, 0);
+			if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+				break;
+
+			glDeleteSync(batch.fence);
+			ready.insert(ready.end(), batch.objects.begin(), batch.objects.end());
+			m_Batches.pop_front();
+		}
+	}
+	Delete(ready);
+}
+
+void GLDeletionQueue::Flush()
+{
+	std::vector<Object> objects;
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		for (Batch& batch : m_Batches)
+		{
+			glDeleteSync(batch.fence);
+			objects.insert(objects.end(), batch.objects.begin(), batch.objects.end());
+		}
+		m_Batches.clear();
+		objects.insert(objects.end(), m_Pending.begin(), m_Pending.end());
+		m_Pending.clear();
+	}
+
+	if (objects.empty())
+		return;
+	glFinish();
+	Delete(objects);
+}
+
+void GLDeletionQueue::Shutdown()
+{
+	Flush();
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	m_Shutdown = true;
+}
+
+int GLDeletionQueue::GetLiveCount(GLObjectType type) const
+{
+	return m_LiveCounts[static_cast<int>(type)];
+}
+
+int GLDeletionQueue::GetLiveCount() const
+{
+	int count = 0;
+	for (int i = 0; i < static_cast<int>(GLObjectType::Count); i++)
+		count += m_LiveCounts[i];
+	return count;
+}
+
+size_t GLDeletionQueue::GetPendingCount() const
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	size_t count = m_Pending.size();
+	for (const Batch& batch : m_Batches)
+		count += batch.objects.size();
+	return count;
+}
+
+void GLDeletionQueue::Delete(const std::vector<Object>& objects)
+{
+	for (const Object& object : objects)
+	{
+		unsigned int id = object.second;
+		switch (object.first)
+		{
+		case GLObjectType::Buffer:       glDeleteBuffers(1, &id); break;
+		case GLObjectType::VertexArray:  glDeleteVertexArrays(1, &id); break;
+		case GLObjectType::Texture:      glDeleteTextures(1, &id); break;
+		case GLObjectType::Framebuffer:  glDeleteFramebuffers(1, &id); break;
+		case GLObjectType::Renderbuffer: glDeleteRenderbuffers(1, &id); break;
+		case GLObjectType::Program:      glDeleteProgram(id); break;
+		default: continue;
+		}
+		m_LiveCounts[static_cast<int>(object.first)]--;
+	}
+}
+
+unsigned int GLCreateObject(GLObjectType type)
+{
+	unsigned int id = 0;
+	switch (type)
+	{
+	case GLObjectType::Buffer:       glGenBuffers(1, &id); break;
+	case GLObjectType::VertexArray:  glGenVertexArrays(1, &id); break;
+	case GLObjectType::Texture:      glGenTextures(1, &id); break;
+	case GLObjectType::Framebuffer:  glGenFramebuffers(1, &id); break;
+	case GLObjectType::Renderbuffer: glGenRenderbuffers(1, &id); break;
+	case GLObjectType::Program:      id = glCreateProgram(); break;
+	default: break;
+	}
+	return id;
+}
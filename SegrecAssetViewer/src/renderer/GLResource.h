@@ -0,0 +1,127 @@
+#ifndef GLRESOURCE_H
+#define GLRESOURCE_H
+
+#include <glad/glad.h>
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+enum class GLObjectType
+{
+	Buffer,
+	VertexArray,
+	Texture,
+	Framebuffer,
+	Renderbuffer,
+	Program,
+	Count
+};
+
+// GL objects released by handles are deleted here instead of in the destructor.
+// a frame's deletions wait behind a fence until the GPU finished the commands that may still use them,
+// and handles can be dropped on any thread, the glDelete* calls always happen on the render thread.
+class GLDeletionQueue
+{
+public:
+	static GLDeletionQueue& Get();
+
+	// thread safe
+	void Enqueue(GLObjectType type, unsigned int id);
+	void OnCreated(GLObjectType type);
+
+	// fences this frame's deletions and deletes the batches the GPU is done with, call after SwapBuffers
+	void EndFrame();
+	// waits for the GPU and deletes everything queued
+	void Flush();
+	// flushes and ignores handles released afterwards, their objects go away with the context
+	void Shutdown();
+
+	int GetLiveCount(GLObjectType type) const;
+	int GetLiveCount() const;
+	size_t GetPendingCount() const;
+
+private:
+	GLDeletionQueue() = default;
+
+	typedef std::pair<GLObjectType, unsigned int> Object;
+	struct Batch
+	{
+		GLsync fence = nullptr;
+		std::vector<Object> objects;
+	};
+
+	void Delete(const std::vector<Object>& objects);
+
+private:
+	mutable std::mutex m_Mutex;
+	std::vector<Object> m_Pending;
+	std::deque<Batch> m_Batches;
+	std::atomic<int> m_LiveCounts[static_cast<int>(GLObjectType::Count)] = {};
+	bool m_Shutdown = false;
+};
+
+// glGen*/glCreate* for one object of the given type
+unsigned int GLCreateObject(GLObjectType type);
+
+// move-only owner of a single GL object name
+template<GLObjectType Type>
+class GLHandle
+{
+public:
+	GLHandle() = default;
+	// takes ownership of an existing object
+	explicit GLHandle(unsigned int id)
+		: m_ID(id)
+	{
+		if (m_ID != 0)
+			GLDeletionQueue::Get().OnCreated(Type);
+	}
+	~GLHandle() { Reset(); }
+
+	GLHandle(const GLHandle&) = delete;
+	GLHandle& operator=(const GLHandle&) = delete;
+
+	GLHandle(GLHandle&& other) noexcept
+		: m_ID(other.m_ID)
+	{
+		other.m_ID = 0;
+	}
+
+	GLHandle& operator=(GLHandle&& other) noexcept
+	{
+		if (this != &other)
+		{
+			Reset();
+			m_ID = other.m_ID;
+			other.m_ID = 0;
+		}
+		return *this;
+	}
+
+	static GLHandle Create() { return GLHandle(GLCreateObject(Type)); }
+
+	void Reset()
+	{
+		if (m_ID != 0)
+			GLDeletionQueue::Get().Enqueue(Type, m_ID);
+		m_ID = 0;
+	}
+
+	unsigned int Get() const { return m_ID; }
+	explicit operator bool() const { return m_ID != 0; }
+
+private:
+	unsigned int m_ID = 0;
+};
+
+typedef GLHandle<GLObjectType::Buffer> GLBuffer;
+typedef GLHandle<GLObjectType::VertexArray> GLVertexArray;
+typedef GLHandle<GLObjectType::Texture> GLTexture;
+typedef GLHandle<GLObjectType::Framebuffer> GLFramebuffer;
+typedef GLHandle<GLObjectType::Renderbuffer> GLRenderbuffer;
+typedef GLHandle<GLObjectType::Program> GLProgram;
+
+#endif // !GLRESOURCE_H
@@ -0,0 +1,317 @@
+#include "GeometryDiff.h"
+
+#include "MemoryTracker.h"
+#include "MeshBVH.h"
+#include "Model.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+namespace
+{
+	// vertices per query job, consecutive vertices seed each other's search radius within one
+	const size_t QUERY_GRAIN = 4096;
+	// the search radius from the previous vertex is widened by this factor against rounding
+	const float RADIUS_SLACK = 1.0001f;
+	// distances below this share of the reference's bounds diagonal count as unchanged
+	const float UNCHANGED_TOLERANCE = 1e-6f;
+
+	// distance of every point to the surface in the BVH, signed by the side of the closest triangle. consecutive vertices
+	// are mostly neighbours, so the previous distance plus the step between the two bounds the next search and prunes
+	// most of the tree. points without any triangle in reach (non-finite positions) get 0
+	void QueryDistances(const MeshBVH& bvh, const std::vector<glm::vec3>& points, bool sign, std::vector<float>& distances)
+	{
+		distances.resize(points.size());
+		ThreadPool::Get().ParallelFor(0, points.size(), QUERY_GRAIN, [&](size_t begin, size_t end)
+		{
+			float previous = -1.0f;
+			glm::vec3 previousPoint(0.0f);
+			for (size_t i = begin; i < end; i++)
+			{
+				const glm::vec3& point = points[i];
+				PointHit hit;
+				bool found = false;
+				if (previous >= 0.0f)
+				{
+					float radius = (previous + glm::length(point - previousPoint)) * RADIUS_SLACK + FLT_MIN;
+					found = bvh.ClosestPoint(point, radius, hit);
+				}
+				if (!found)
+					found = bvh.ClosestPoint(point, FLT_MAX, hit);
+				if (!found)
+				{
+					distances[i] = 0.0f;
+					continue;
+				}
+				distances[i] = sign && glm::dot(point - hit.position, hit.normal) < 0.0f ? -hit.distance : hit.distance;
+				previous = hit.distance;
+				previousPoint = point;
+			}
+		});
+	}
+
+	// value below which the share q of the sorted values lies, reorders the values
+	float Percentile(std::vector<float>& values, float q)
+	{
+		if (values.empty())
+			return 0.0f;
+		size_t index = std::min(values.size() - 1, static_cast<size_t>(q * (values.size() - 1) + 0.5f));
+		std::nth_element(values.begin(), values.begin() + index, values.end());
+		return values[index];
+	}
+}
+
+GeometryDiff::Surface GeometryDiff::FromModel(Model& model)
+{
+	Surface surface;
+	surface.positions.reserve(model.GetVertexCount());
+	surface.indices.reserve(model.GetIndexCount());
+	for (Mesh& mesh : model.meshes)
+	{
+		bool released = !mesh.HasCpuData();
+		if (released)
+			mesh.EnsureCpuData();
+
+		unsigned int offset = static_cast<unsigned int>(surface.positions.size());
+		surface.meshOffsets.push_back(offset);
+		for (const Vertex& vertex : mesh.vertices)
+			surface.positions.push_back(vertex.Position);
+		for (unsigned int index : mesh.indices)
+			surface.indices.push_back(offset + index);
+
+		if (released)
+			mesh.ReleaseCpuData();
+	}
+	return surface;
+}
+
+GeometryDiff::Result GeometryDiff::Compute(const Surface& compared, const Surface& reference)
+{
+	Result result;
+	Stats& stats = result.stats;
+	stats.vertices = compared.positions.size();
+	stats.triangles = compared.indices.size() / 3;
+	stats.referenceVertices = reference.positions.size();
+	stats.referenceTriangles = reference.indices.size() / 3;
+
+	auto start = std::chrono::steady_clock::now();
+	MeshBVH referenceBvh, comparedBvh;
+	referenceBvh.Build(reference.positions, reference.indices);
+	comparedBvh.Build(compared.positions, compared.indices);
+	stats.buildMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	if (referenceBvh.IsEmpty() || comparedBvh.IsEmpty())
+	{
+		result.error = referenceBvh.IsEmpty() ? "the reference has no triangles" : "the compared model has no triangles";
+		return result;
+	}
+
+	start = std::chrono::steady_clock::now();
+	QueryDistances(referenceBvh, compared.positions, true, result.distances);
+	std::vector<float> reverse;
+	QueryDistances(comparedBvh, reference.positions, false, reverse);
+	stats.queryMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	stats.referenceDiagonal = glm::length(referenceBvh.GetBoundsMax() - referenceBvh.GetBoundsMin());
+	float tolerance = stats.referenceDiagonal * UNCHANGED_TOLERANCE;
+	std::vector<float> magnitudes(result.distances.size());
+	double sum = 0.0, sumSquares = 0.0, signedSum = 0.0;
+	size_t unchanged = 0;
+	stats.minSigned = FLT_MAX;
+	stats.maxSigned = -FLT_MAX;
+	for (size_t i = 0; i < result.distances.size(); i++)
+	{
+		float distance = result.distances[i];
+		magnitudes[i] = std::fabs(distance);
+		sum += magnitudes[i];
+		sumSquares += static_cast<double>(distance) * distance;
+		signedSum += distance;
+		stats.minSigned = std::min(stats.minSigned, distance);
+		stats.maxSigned = std::max(stats.maxSigned, distance);
+		stats.maxDistance = std::max(stats.maxDistance, magnitudes[i]);
+		if (magnitudes[i] <= tolerance)
+			unchanged++;
+	}
+	double count = static_cast<double>(std::max<size_t>(magnitudes.size(), 1));
+	stats.meanDistance = static_cast<float>(sum / count);
+	stats.rmsDistance = static_cast<float>(std::sqrt(sumSquares / count));
+	stats.meanSigned = static_cast<float>(signedSum / count);
+	stats.unchanged = static_cast<float>(unchanged / count);
+	stats.p50 = Percentile(magnitudes, 0.5f);
+	stats.p95 = Percentile(magnitudes, 0.95f);
+	stats.p99 = Percentile(magnitudes, 0.99f);
+
+	double reverseSum = 0.0;
+	for (float distance : reverse)
+	{
+		stats.reverseMaxDistance = std::max(stats.reverseMaxDistance, distance);
+		reverseSum += distance;
+	}
+	stats.reverseMeanDistance = static_cast<float>(reverseSum / std::max<size_t>(reverse.size(), 1));
+	stats.hausdorff = std::max(stats.maxDistance, stats.reverseMaxDistance);
+	return result;
+}
+
+glm::vec3 GeometryDiff::DiffColor(float t)
+{
+	const glm::vec3 neutral(0.85f);
+	t = std::clamp(t, -1.0f, 1.0f);
+	if (t < 0.0f)
+		return glm::mix(neutral, glm::vec3(0.05f, 0.25f, 0.95f), -t);
+	return glm::mix(neutral, glm::vec3(0.95f, 0.1f, 0.05f), t);
+}
+
+GeometryDiff::GeometryDiff()
+{
+}
+
+GeometryDiff::~GeometryDiff()
+{
+	if (m_Job.valid())
+		m_Job.wait();
+	if (m_MemoryId >= 0)
+		MemoryTracker::Get().Unregister(m_MemoryId);
+}
+
+void GeometryDiff::Start(Model& compared, unsigned int generation, const std::string& referencePath, ImportPreset preset)
+{
+	std::shared_ptr<Request> request = std::make_shared<Request>();
+	request->compared = FromModel(compared);
+	request->generation = generation;
+	request->referencePath = referencePath;
+	request->preset = preset;
+
+	if (IsBusy())
+		m_Pending = std::move(request);
+	else
+		Launch(std::move(request));
+}
+
+void GeometryDiff::Launch(std::shared_ptr<Request> request)
+{
+	m_Running = request;
+	m_Job = ThreadPool::Get().Submit([request]()
+	{
+		Model reference(request->referencePath, false, ModelLoader::Auto, request->preset, ModelStorage::CpuOnly);
+		if (!reference.errorMessage.empty())
+		{
+			Result failed;
+			failed.error = reference.errorMessage;
+			return failed;
+		}
+		return Compute(request->compared, FromModel(reference));
+	});
+}
+
+bool GeometryDiff::Update()
+{
+	if (!m_Job.valid() || m_Job.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		return false;
+
+	Result result = m_Job.get();
+	std::shared_ptr<Request> request = std::move(m_Running);
+	// a newer request makes this one outdated
+	if (m_Pending)
+	{
+		Launch(std::move(m_Pending));
+		return false;
+	}
+
+	if (!result.error.empty())
+	{
+		std::cout << "ERROR::GEOMETRY_DIFF::" << result.error << " " << request->referencePath << std::endl;
+		m_Error = result.error;
+		return false;
+	}
+
+	// one float per vertex, fetched by vertex index in the difference shader
+	GLint maxTexels = 0;
+	glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+	if (result.distances.size() > static_cast<size_t>(maxTexels))
+	{
+		m_Error = "too many vertices for a buffer texture (" + std::to_string(maxTexels) + ")";
+		std::cout << "ERROR::GEOMETRY_DIFF::" << m_Error << std::endl;
+		return false;
+	}
+	if (!m_Buffer)
+	{
+		m_Buffer = GLBuffer::Create();
+		m_Texture = GLTexture::Create();
+		m_MemoryId = MemoryTracker::Get().Register(MemoryCategory::Mesh, "Geometry diff", 0, 0);
+	}
+	glBindBuffer(GL_TEXTURE_BUFFER, m_Buffer.Get());
+	glBufferData(GL_TEXTURE_BUFFER, std::max<size_t>(result.distances.size(), 1) * sizeof(float), nullptr, GL_STATIC_DRAW);
+	if (!result.distances.empty())
+		glBufferSubData(GL_TEXTURE_BUFFER, 0, result.distances.size() * sizeof(float), result.distances.data());
+	glBindTexture(GL_TEXTURE_BUFFER, m_Texture.Get());
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_R32F, m_Buffer.Get());
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+	MemoryTracker::Get().Update(m_MemoryId, 0, result.distances.size() * sizeof(float));
+
+	m_Stats = result.stats;
+	m_ReferencePath = request->referencePath;
+	m_MeshOffsets = request->compared.meshOffsets;
+	m_VertexCount = request->compared.positions.size();
+	m_Generation = request->generation;
+	m_Error.clear();
+	m_HasResult = true;
+	return true;
+}
+
+bool GeometryDiff::IsBusy() const
+{
+	return m_Job.valid();
+}
+
+bool GeometryDiff::HasResult() const
+{
+	return m_HasResult;
+}
+
+bool GeometryDiff::Matches(const Model& model, unsigned int generation) const
+{
+	if (!m_HasResult || generation != m_Generation || model.meshes.size() != m_MeshOffsets.size())
+		return false;
+	for (size_t i = 0; i < model.meshes.size(); i++)
+	{
+		size_t end = i + 1 < m_MeshOffsets.size() ? m_MeshOffsets[i + 1] : m_VertexCount;
+		if (model.meshes[i].GetVertexCount() != end - m_MeshOffsets[i])
+			return false;
+	}
+	return true;
+}
+
+const GeometryDiff::Stats& GeometryDiff::GetStats() const
+{
+	return m_Stats;
+}
+
+const std::string& GeometryDiff::GetReferencePath() const
+{
+	return m_ReferencePath;
+}
+
+const std::string& GeometryDiff::GetError() const
+{
+	return m_Error;
+}
+
+void GeometryDiff::Apply(const Shader& shader, unsigned int unit, float range) const
+{
+	glActiveTexture(GL_TEXTURE0 + unit);
+	glBindTexture(GL_TEXTURE_BUFFER, m_Texture.Get());
+	glActiveTexture(GL_TEXTURE0);
+	shader.SetInt("distances", unit);
+	// without a result, or with a range of 0, the model is drawn in the neutral colour
+	shader.SetFloat("distanceRange", m_HasResult ? std::max(range, 0.0f) : 0.0f);
+	shader.SetInt("vertexOffset", 0);
+}
+
+void GeometryDiff::SetMesh(const Shader& shader, size_t mesh) const
+{
+	shader.SetInt("vertexOffset", mesh < m_MeshOffsets.size() ? static_cast<int>(m_MeshOffsets[mesh]) : 0);
+}
@@ -0,0 +1,142 @@
+#ifndef GEOMETRYDIFF_H
+#define GEOMETRYDIFF_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "GLResource.h"
+#include "Shader.h"
+
+#include <cstddef>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+class Model;
+enum class ImportPreset;
+
+// geometric difference between two versions of an asset: the signed distance from every vertex of the compared model
+// to the surface of the reference, and the other way round for the symmetric Hausdorff distance. both surfaces get a
+// BVH, the closest point queries run in parallel on the thread pool. distances are in model units, negative is behind
+// the closest reference triangle (inside a closed surface). where a vertex or edge of the reference is closest, the side
+// comes from one of the triangles sharing it, which can be the wrong one next to slivers. shown as a heat map on the
+// compared model
+class GeometryDiff
+{
+public:
+	// every mesh of a model as one indexed triangle list, in model space
+	struct Surface
+	{
+		std::vector<glm::vec3> positions;
+		std::vector<unsigned int> indices;
+		// first vertex of every mesh in positions
+		std::vector<unsigned int> meshOffsets;
+	};
+
+	struct Stats
+	{
+		size_t vertices = 0;
+		size_t triangles = 0;
+		size_t referenceVertices = 0;
+		size_t referenceTriangles = 0;
+		// the larger of the two one-sided distances
+		float hausdorff = 0.0f;
+		// compared vertices to the reference surface, unsigned
+		float maxDistance = 0.0f;
+		float meanDistance = 0.0f;
+		float rmsDistance = 0.0f;
+		float p50 = 0.0f;
+		float p95 = 0.0f;
+		float p99 = 0.0f;
+		float minSigned = 0.0f;
+		float maxSigned = 0.0f;
+		float meanSigned = 0.0f;
+		// reference vertices to the compared surface
+		float reverseMaxDistance = 0.0f;
+		float reverseMeanDistance = 0.0f;
+		// share of the compared vertices on the reference surface, within a millionth of its bounds diagonal
+		float unchanged = 0.0f;
+		float referenceDiagonal = 0.0f;
+		double buildMilliseconds = 0.0;
+		double queryMilliseconds = 0.0;
+	};
+
+	struct Result
+	{
+		Stats stats;
+		// signed distance per vertex of the compared surface
+		std::vector<float> distances;
+		// empty unless the comparison failed
+		std::string error;
+	};
+
+	// copies the positions and indices of every mesh, meshes without their CPU copy are read back (render thread)
+	static Surface FromModel(Model& model);
+	// builds both BVHs and measures both directions on the thread pool, blocks the caller
+	static Result Compute(const Surface& compared, const Surface& reference);
+
+	// colour of the heat map for a distance over the range, blue inside, light grey on the surface, red outside.
+	// the same ramp as the difference shader
+	static glm::vec3 DiffColor(float t);
+
+	GeometryDiff();
+	~GeometryDiff();
+
+	GeometryDiff(const GeometryDiff&) = delete;
+	GeometryDiff& operator=(const GeometryDiff&) = delete;
+
+	// copies the compared model (render thread), imports the reference without GL and compares them in the background.
+	// generation is the caller's count of models loaded, see Matches. a request while one is running replaces any waiting
+	// one, the running result is dropped when another waits
+	void Start(Model& compared, unsigned int generation, const std::string& referencePath, ImportPreset preset);
+	// uploads a finished comparison, returns true when a new result arrived. call once per frame from the render thread
+	bool Update();
+
+	bool IsBusy() const;
+	bool HasResult() const;
+	// the result was computed for this load of the model, the generation passed to Start. a reload with the same topology
+	// gets another generation, the mesh and vertex counts are only checked as a guard
+	bool Matches(const Model& model, unsigned int generation) const;
+	const Stats& GetStats() const;
+	const std::string& GetReferencePath() const;
+	// the message of the last failed comparison
+	const std::string& GetError() const;
+
+	// binds the distances to the unit and sets the shader's sampler and the distance at the ends of the ramp, see SetMesh
+	void Apply(const Shader& shader, unsigned int unit, float range) const;
+	// first distance of the model's mesh
+	void SetMesh(const Shader& shader, size_t mesh) const;
+
+private:
+	struct Request
+	{
+		Surface compared;
+		unsigned int generation = 0;
+		std::string referencePath;
+		ImportPreset preset;
+	};
+
+	void Launch(std::shared_ptr<Request> request);
+
+private:
+	std::future<Result> m_Job;
+	// shared with the job, the request a finished job belongs to
+	std::shared_ptr<Request> m_Running;
+	// replaces any waiting one, started once the running job is done
+	std::shared_ptr<Request> m_Pending;
+
+	GLBuffer m_Buffer;
+	GLTexture m_Texture;
+	bool m_HasResult = false;
+	Stats m_Stats;
+	std::string m_ReferencePath;
+	std::string m_Error;
+	// first vertex of every mesh of the compared model, and the vertex count after the last
+	std::vector<unsigned int> m_MeshOffsets;
+	size_t m_VertexCount = 0;
+	unsigned int m_Generation = 0;
+	int m_MemoryId = -1;
+};
+
+#endif // !GEOMETRYDIFF_H
@@ -0,0 +1,746 @@
+#include "GltfLoader.h"
+
+#include "Json.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory>
+
+namespace
+{
+	const uint32_t GLB_MAGIC = 0x46546C67;  // "glTF"
+	const uint32_t GLB_CHUNK_JSON = 0x4E4F534A;
+	const uint32_t GLB_CHUNK_BIN = 0x004E4942;
+
+	const int COMPONENT_BYTE = 5120;
+	const int COMPONENT_UNSIGNED_BYTE = 5121;
+	const int COMPONENT_SHORT = 5122;
+	const int COMPONENT_UNSIGNED_SHORT = 5123;
+	const int COMPONENT_UNSIGNED_INT = 5125;
+	const int COMPONENT_FLOAT = 5126;
+
+	const int MODE_TRIANGLES = 4;
+	const int MAX_NODE_DEPTH = 256;
+
+	struct BufferData
+	{
+		const unsigned char* data = nullptr;
+		size_t size = 0;
+	};
+
+	// strided view of one accessor inside a mapped buffer, bounds are checked when it is resolved
+	struct Accessor
+	{
+		const unsigned char* data = nullptr;
+		size_t count = 0;
+		size_t stride = 0;
+		int componentType = 0;
+		int components = 0;
+		bool normalized = false;
+	};
+
+	struct Primitive
+	{
+		Accessor position, normal, texCoord, tangent, joints, weights, indices;
+		bool hasNormal = false, hasTexCoord = false, hasTangent = false, hasJoints = false, hasWeights = false, hasIndices = false;
+	};
+
+	struct Document
+	{
+		JsonValue json;
+		std::vector<BufferData> buffers;
+		std::vector<std::unique_ptr<MappedFile>> files;
+		std::string directory;
+		std::string namePrefix;
+		bool upload = true;
+		int skippedPrimitives = 0;
+		// material textures by glTF texture index and slot
+		std::map<std::pair<int, TextureType>, Texture> textures;
+		// embedded images by image index, copied out of the mapping once however many textures use them
+		std::map<int, std::shared_ptr<const EmbeddedTexture>> images;
+	};
+
+	uint32_t ReadU32(const unsigned char* p)
+	{
+		uint32_t value;
+		std::memcpy(&value, p, sizeof(value));
+		return value;
+	}
+
+	int ComponentSize(int componentType)
+	{
+		switch (componentType)
+		{
+		case COMPONENT_BYTE:
+		case COMPONENT_UNSIGNED_BYTE: return 1;
+		case COMPONENT_SHORT:
+		case COMPONENT_UNSIGNED_SHORT: return 2;
+		case COMPONENT_UNSIGNED_INT:
+		case COMPONENT_FLOAT: return 4;
+		default: return 0;
+		}
+	}
+
+	int ComponentCount(const std::string& type)
+	{
+		if (type == "SCALAR") return 1;
+		if (type == "VEC2") return 2;
+		if (type == "VEC3") return 3;
+		if (type == "VEC4") return 4;
+		if (type == "MAT2") return 4;
+		if (type == "MAT3") return 9;
+		if (type == "MAT4") return 16;
+		return 0;
+	}
+
+	// non-negative integer member, fractional or negative values are rejected
+	bool ReadSize(const JsonValue& value, size_t fallback, size_t& out)
+	{
+		if (value.IsNull())
+		{
+			out = fallback;
+			return true;
+		}
+		double number = value.AsNumber(-1.0);
+		if (!(number >= 0.0) || number > 9.0e15 || std::floor(number) != number)
+			return false;
+		out = static_cast<size_t>(number);
+		return true;
+	}
+
+	std::string DecodeUri(const std::string& uri)
+	{
+		std::string out;
+		for (size_t i = 0; i < uri.size(); i++)
+		{
+			if (uri[i] == '%' && i + 2 < uri.size() && std::isxdigit(static_cast<unsigned char>(uri[i + 1])) && std::isxdigit(static_cast<unsigned char>(uri[i + 2])))
+			{
+				out += static_cast<char>(std::stoi(uri.substr(i + 1, 2), nullptr, 16));
+				i += 2;
+			}
+			else
+				out += uri[i];
+		}
+		return out;
+	}
+
+	bool ResolveAccessor(const Document& document, int index, Accessor& out)
+	{
+		const JsonValue& accessor = document.json["accessors"][static_cast<size_t>(index)];
+		// sparse accessors and accessors without a view (all zeros) are left to Assimp
+		if (index < 0 || !accessor.IsObject() || accessor.Has("sparse") || !accessor.Has("bufferView"))
+			return false;
+
+		int viewIndex = accessor["bufferView"].AsInt(-1);
+		const JsonValue& view = document.json["bufferViews"][static_cast<size_t>(viewIndex)];
+		int bufferIndex = view["buffer"].AsInt(-1);
+		if (viewIndex < 0 || !view.IsObject() || bufferIndex < 0 || bufferIndex >= static_cast<int>(document.buffers.size()))
+			return false;
+
+		out.componentType = accessor["componentType"].AsInt();
+		out.components = ComponentCount(accessor["type"].AsString());
+		out.normalized = accessor["normalized"].AsBool();
+		size_t componentSize = ComponentSize(out.componentType);
+		size_t elementSize = componentSize * out.components;
+		if (elementSize == 0)
+			return false;
+
+		size_t viewOffset, viewLength, accessorOffset;
+		if (!ReadSize(accessor["count"], 0, out.count) || !ReadSize(view["byteStride"], elementSize, out.stride) ||
+			!ReadSize(view["byteOffset"], 0, viewOffset) || !ReadSize(view["byteLength"], 0, viewLength) || !ReadSize(accessor["byteOffset"], 0, accessorOffset))
+			return false;
+
+		const BufferData& buffer = document.buffers[bufferIndex];
+		if (out.stride < elementSize || viewOffset > buffer.size || viewLength > buffer.size - viewOffset)
+			return false;
+		// the last element has to end inside the view, checked without overflowing on hostile counts
+		if (out.count > 0 && (accessorOffset > viewLength || viewLength - accessorOffset < elementSize ||
+			out.count - 1 > (viewLength - accessorOffset - elementSize) / out.stride))
+			return false;
+
+		out.data = buffer.data + viewOffset + accessorOffset;
+		return true;
+	}
+
+	float ReadComponent(const unsigned char* p, int componentType, bool normalized)
+	{
+		switch (componentType)
+		{
+		case COMPONENT_FLOAT:
+		{
+			float value;
+			std::memcpy(&value, p, sizeof(value));
+			return value;
+		}
+		case COMPONENT_UNSIGNED_BYTE:
+			return normalized ? *p / 255.0f : static_cast<float>(*p);
+		case COMPONENT_BYTE:
+		{
+			int8_t value = static_cast<int8_t>(*p);
+			return normalized ? std::max(value / 127.0f, -1.0f) : static_cast<float>(value);
+		}
+		case COMPONENT_UNSIGNED_SHORT:
+		{
+			uint16_t value;
+			std::memcpy(&value, p, sizeof(value));
+			return normalized ? value / 65535.0f : static_cast<float>(value);
+		}
+		case COMPONENT_SHORT:
+		{
+			int16_t value;
+			std::memcpy(&value, p, sizeof(value));
+			return normalized ? std::max(value / 32767.0f, -1.0f) : static_cast<float>(value);
+		}
+		case COMPONENT_UNSIGNED_INT:
+		{
+			uint32_t value;
+			std::memcpy(&value, p, sizeof(value));
+			return static_cast<float>(value);
+		}
+		default:
+			return 0.0f;
+		}
+	}
+
+	uint32_t ReadIndex(const Accessor& indices, size_t i)
+	{
+		const unsigned char* p = indices.data + i * indices.stride;
+		switch (indices.componentType)
+		{
+		case COMPONENT_UNSIGNED_BYTE: return *p;
+		case COMPONENT_UNSIGNED_SHORT:
+		{
+			uint16_t value;
+			std::memcpy(&value, p, sizeof(value));
+			return value;
+		}
+		default:
+			return ReadU32(p);
+		}
+	}
+
+	bool IsAttribute(const Accessor& accessor, int components, bool allowNormalizedIntegers, size_t count)
+	{
+		if (accessor.components != components || accessor.count != count)
+			return false;
+		if (accessor.componentType == COMPONENT_FLOAT)
+			return true;
+		return allowNormalizedIntegers && accessor.normalized &&
+			(accessor.componentType == COMPONENT_UNSIGNED_BYTE || accessor.componentType == COMPONENT_UNSIGNED_SHORT);
+	}
+
+	// single pass over all attribute streams, each vertex is assembled on the stack and written out whole,
+	// so mapped (write-combined) GL memory only sees sequential full writes
+	void InterleaveVertices(const Primitive& primitive, Vertex* out)
+	{
+		const Accessor& position = primitive.position;
+		for (size_t i = 0; i < position.count; i++)
+		{
+			Vertex vertex;
+			std::memset(&vertex, 0, sizeof(vertex));
+
+			std::memcpy(&vertex.Position, position.data + i * position.stride, sizeof(glm::vec3));
+			if (primitive.hasNormal)
+				std::memcpy(&vertex.Normal, primitive.normal.data + i * primitive.normal.stride, sizeof(glm::vec3));
+
+			if (primitive.hasTexCoord)
+			{
+				const Accessor& uv = primitive.texCoord;
+				const unsigned char* p = uv.data + i * uv.stride;
+				if (uv.componentType == COMPONENT_FLOAT)
+					std::memcpy(&vertex.TexCoords, p, sizeof(glm::vec2));
+				else
+				{
+					int size = ComponentSize(uv.componentType);
+					vertex.TexCoords = glm::vec2(ReadComponent(p, uv.componentType, true), ReadComponent(p + size, uv.componentType, true));
+				}
+			}
+
+			if (primitive.hasTangent)
+			{
+				float tangent[4];
+				std::memcpy(tangent, primitive.tangent.data + i * primitive.tangent.stride, sizeof(tangent));
+				vertex.Tangent = glm::vec3(tangent[0], tangent[1], tangent[2]);
+				// w holds the handedness of the bitangent
+				vertex.Bitangent = glm::cross(vertex.Normal, vertex.Tangent) * (tangent[3] < 0.0f ? -1.0f : 1.0f);
+			}
+
+			if (primitive.hasJoints && primitive.hasWeights)
+			{
+				const unsigned char* joints = primitive.joints.data + i * primitive.joints.stride;
+				const unsigned char* weights = primitive.weights.data + i * primitive.weights.stride;
+				int jointSize = ComponentSize(primitive.joints.componentType);
+				int weightSize = ComponentSize(primitive.weights.componentType);
+				for (int j = 0; j < MAX_BONE_INFLUENCE; j++)
+				{
+					vertex.m_BoneIDs[j] = static_cast<int>(ReadComponent(joints + j * jointSize, primitive.joints.componentType, false));
+					vertex.m_Weights[j] = ReadComponent(weights + j * weightSize, primitive.weights.componentType, primitive.weights.normalized);
+				}
+			}
+
+			std::memcpy(out + i, &vertex, sizeof(Vertex));
+		}
+	}
+
+	bool ValidateIndices(const Accessor& indices, size_t vertexCount)
+	{
+		for (size_t i = 0; i < indices.count; i++)
+		{
+			if (ReadIndex(indices, i) >= vertexCount)
+				return false;
+		}
+		return true;
+	}
+
+	void ConvertIndices(const Primitive& primitive, unsigned int* out)
+	{
+		if (!primitive.hasIndices)
+		{
+			for (size_t i = 0; i < primitive.position.count; i++)
+				out[i] = static_cast<unsigned int>(i);
+			return;
+		}
+		for (size_t i = 0; i < primitive.indices.count; i++)
+			out[i] = ReadIndex(primitive.indices, i);
+	}
+
+	// fills a freshly created buffer through a write-only mapping, a staging copy is only used if mapping fails
+	template<typename Fill>
+	void FillBuffer(const GLBuffer& buffer, size_t bytes, Fill fill)
+	{
+		glBindBuffer(GL_COPY_WRITE_BUFFER, buffer.Get());
+		glBufferData(GL_COPY_WRITE_BUFFER, bytes, nullptr, GL_STATIC_DRAW);
+		void* mapped = glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+		if (mapped)
+		{
+			fill(mapped);
+			// GL_FALSE means the store got lost while mapped (mode switch etc.), it is written again below
+			if (glUnmapBuffer(GL_COPY_WRITE_BUFFER) == GL_TRUE)
+			{
+				glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+				return;
+			}
+		}
+
+		std::vector<unsigned char> staging(bytes);
+		fill(staging.data());
+		glBufferSubData(GL_COPY_WRITE_BUFFER, 0, bytes, staging.data());
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	}
+
+	void ComputeNormals(std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices)
+	{
+		for (Vertex& vertex : vertices)
+			vertex.Normal = glm::vec3(0.0f);
+		// area weighted face normals, like aiProcess_GenSmoothNormals for shared vertices
+		for (size_t i = 0; i + 2 < indices.size(); i += 3)
+		{
+			Vertex& a = vertices[indices[i]];
+			Vertex& b = vertices[indices[i + 1]];
+			Vertex& c = vertices[indices[i + 2]];
+			glm::vec3 normal = glm::cross(b.Position - a.Position, c.Position - a.Position);
+			a.Normal += normal;
+			b.Normal += normal;
+			c.Normal += normal;
+		}
+		for (Vertex& vertex : vertices)
+		{
+			float length = glm::length(vertex.Normal);
+			vertex.Normal = length > 0.0f ? vertex.Normal / length : glm::vec3(0.0f, 1.0f, 0.0f);
+		}
+	}
+
+	void ComputeTangents(std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices)
+	{
+		for (Vertex& vertex : vertices)
+		{
+			vertex.Tangent = glm::vec3(0.0f);
+			vertex.Bitangent = glm::vec3(0.0f);
+		}
+		for (size_t i = 0; i + 2 < indices.size(); i += 3)
+		{
+			Vertex& a = vertices[indices[i]];
+			Vertex& b = vertices[indices[i + 1]];
+			Vertex& c = vertices[indices[i + 2]];
+			glm::vec3 edge1 = b.Position - a.Position, edge2 = c.Position - a.Position;
+			glm::vec2 uv1 = b.TexCoords - a.TexCoords, uv2 = c.TexCoords - a.TexCoords;
+			float determinant = uv1.x * uv2.y - uv2.x * uv1.y;
+			if (std::fabs(determinant) < 1e-12f)
+				continue;
+
+			float r = 1.0f / determinant;
+			glm::vec3 tangent = (edge1 * uv2.y - edge2 * uv1.y) * r;
+			glm::vec3 bitangent = (edge2 * uv1.x - edge1 * uv2.x) * r;
+			a.Tangent += tangent; b.Tangent += tangent; c.Tangent += tangent;
+			a.Bitangent += bitangent; b.Bitangent += bitangent; c.Bitangent += bitangent;
+		}
+		for (Vertex& vertex : vertices)
+		{
+			const glm::vec3& n = vertex.Normal;
+			glm::vec3 t = vertex.Tangent - n * glm::dot(n, vertex.Tangent);
+			if (glm::dot(t, t) < 1e-12f)
+				t = glm::cross(n, std::fabs(n.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f));
+			t = glm::normalize(t);
+			float handedness = glm::dot(glm::cross(n, t), vertex.Bitangent) < 0.0f ? -1.0f : 1.0f;
+			vertex.Tangent = t;
+			vertex.Bitangent = glm::cross(n, t) * handedness;
+		}
+	}
+
+	// the image behind a texture index: a file next to the document, or a buffer view (GLB) named like Assimp names
+	// embedded images. base64 images are left out
+	bool ResolveTexture(Document& document, int index, TextureType type, Texture& out)
+	{
+		const JsonValue& texture = document.json["textures"][static_cast<size_t>(index)];
+		int imageIndex = texture["source"].AsInt(-1);
+		const JsonValue& image = document.json["images"][static_cast<size_t>(imageIndex)];
+		if (index < 0 || imageIndex < 0 || !image.IsObject())
+			return false;
+
+		out.id = 0;
+		out.type = type;
+		if (image.Has("uri"))
+		{
+			const std::string& uri = image["uri"].AsString();
+			if (uri.compare(0, 5, "data:") == 0)
+				return false;
+			out.path = DecodeUri(uri);
+			return true;
+		}
+
+		out.path = "*" + std::to_string(imageIndex);
+		auto copied = document.images.find(imageIndex);
+		if (copied != document.images.end())
+		{
+			out.embedded = copied->second;
+			return true;
+		}
+
+		int viewIndex = image["bufferView"].AsInt(-1);
+		const JsonValue& view = document.json["bufferViews"][static_cast<size_t>(viewIndex)];
+		int bufferIndex = view["buffer"].AsInt(-1);
+		size_t offset, length;
+		if (viewIndex < 0 || !view.IsObject() || bufferIndex < 0 || bufferIndex >= static_cast<int>(document.buffers.size()) ||
+			!ReadSize(view["byteOffset"], 0, offset) || !ReadSize(view["byteLength"], 0, length))
+			return false;
+		const BufferData& buffer = document.buffers[bufferIndex];
+		if (offset > buffer.size || length > buffer.size - offset)
+			return false;
+
+		std::shared_ptr<EmbeddedTexture> embedded = std::make_shared<EmbeddedTexture>();
+		embedded->bytes.assign(buffer.data + offset, buffer.data + offset + length);
+		out.embedded = document.images[imageIndex] = std::move(embedded);
+		return true;
+	}
+
+	// base colour and normal map of the primitive's material. the metallic-roughness texture keeps roughness in green
+	// next to metalness and is not a roughness map, it is left out
+	std::vector<Texture> MaterialTextures(Document& document, const JsonValue& primitive)
+	{
+		std::vector<Texture> textures;
+		const JsonValue& material = document.json["materials"][static_cast<size_t>(primitive["material"].AsInt(-1))];
+		if (!material.IsObject())
+			return textures;
+
+		const std::pair<int, TextureType> slots[] = {
+			{ material["pbrMetallicRoughness"]["baseColorTexture"]["index"].AsInt(-1), TextureType::Diffuse },
+			{ material["normalTexture"]["index"].AsInt(-1), TextureType::Normal },
+		};
+		for (const std::pair<int, TextureType>& slot : slots)
+		{
+			if (slot.first < 0)
+				continue;
+			auto found = document.textures.find(slot);
+			if (found == document.textures.end())
+			{
+				Texture texture;
+				if (!ResolveTexture(document, slot.first, slot.second, texture))
+					continue;
+				found = document.textures.emplace(slot, std::move(texture)).first;
+			}
+			textures.push_back(found->second);
+		}
+		return textures;
+	}
+
+	bool LoadPrimitive(Document& document, const JsonValue& json, const std::string& name, std::vector<Mesh>& meshes)
+	{
+		if (json["mode"].AsInt(MODE_TRIANGLES) != MODE_TRIANGLES)
+		{
+			// points and lines have no place in the lit view, Assimp's meshes of them are not drawn sensibly either
+			document.skippedPrimitives++;
+			return true;
+		}
+
+		const JsonValue& attributes = json["attributes"];
+		Primitive primitive;
+		if (!ResolveAccessor(document, attributes["POSITION"].AsInt(-1), primitive.position) || primitive.position.componentType != COMPONENT_FLOAT ||
+			primitive.position.components != 3 || primitive.position.count == 0)
+			return false;
+		size_t vertexCount = primitive.position.count;
+
+		// optional attributes of an unsupported type send the whole file to Assimp
+		if (attributes.Has("NORMAL") && !(primitive.hasNormal = ResolveAccessor(document, attributes["NORMAL"].AsInt(-1), primitive.normal) &&
+			IsAttribute(primitive.normal, 3, false, vertexCount)))
+			return false;
+		if (attributes.Has("TEXCOORD_0") && !(primitive.hasTexCoord = ResolveAccessor(document, attributes["TEXCOORD_0"].AsInt(-1), primitive.texCoord) &&
+			IsAttribute(primitive.texCoord, 2, true, vertexCount)))
+			return false;
+		if (attributes.Has("TANGENT") && !(primitive.hasTangent = ResolveAccessor(document, attributes["TANGENT"].AsInt(-1), primitive.tangent) &&
+			IsAttribute(primitive.tangent, 4, false, vertexCount)))
+			return false;
+		if (attributes.Has("JOINTS_0") && !(primitive.hasJoints = ResolveAccessor(document, attributes["JOINTS_0"].AsInt(-1), primitive.joints) &&
+			primitive.joints.components == 4 && primitive.joints.count == vertexCount &&
+			(primitive.joints.componentType == COMPONENT_UNSIGNED_BYTE || primitive.joints.componentType == COMPONENT_UNSIGNED_SHORT)))
+			return false;
+		if (attributes.Has("WEIGHTS_0") && !(primitive.hasWeights = ResolveAccessor(document, attributes["WEIGHTS_0"].AsInt(-1), primitive.weights) &&
+			IsAttribute(primitive.weights, 4, true, vertexCount)))
+			return false;
+
+		size_t indexCount = vertexCount;
+		if (json.Has("indices"))
+		{
+			Accessor& indices = primitive.indices;
+			if (!ResolveAccessor(document, json["indices"].AsInt(-1), indices) || indices.components != 1 ||
+				(indices.componentType != COMPONENT_UNSIGNED_BYTE && indices.componentType != COMPONENT_UNSIGNED_SHORT && indices.componentType != COMPONENT_UNSIGNED_INT))
+				return false;
+			if (!ValidateIndices(indices, vertexCount))
+			{
+				std::cout << "ERROR::GLTF::INDEX_OUT_OF_RANGE " << name << std::endl;
+				return false;
+			}
+			primitive.hasIndices = true;
+			indexCount = indices.count;
+		}
+		if (indexCount == 0 || indexCount % 3 != 0 || vertexCount > UINT32_MAX || indexCount > UINT32_MAX)
+			return false;
+
+		// normals or tangents have to be generated: the vertices are built in system memory first
+		if (!document.upload || !primitive.hasNormal || (primitive.hasTexCoord && !primitive.hasTangent))
+		{
+			std::vector<Vertex> vertices(vertexCount);
+			InterleaveVertices(primitive, vertices.data());
+			std::vector<unsigned int> indices(indexCount);
+			ConvertIndices(primitive, indices.data());
+			if (!primitive.hasNormal)
+				ComputeNormals(vertices, indices);
+			if (primitive.hasTexCoord && !primitive.hasTangent)
+				ComputeTangents(vertices, indices);
+			meshes.emplace_back(std::move(vertices), std::move(indices), MaterialTextures(document, json), name, document.upload);
+			return true;
+		}
+
+		GLVertexArray vao = GLVertexArray::Create();
+		GLBuffer vbo = GLBuffer::Create();
+		GLBuffer ebo = GLBuffer::Create();
+
+		FillBuffer(vbo, vertexCount * sizeof(Vertex), [&primitive](void* out) { InterleaveVertices(primitive, static_cast<Vertex*>(out)); });
+
+		const Accessor& indices = primitive.indices;
+		if (primitive.hasIndices && indices.componentType == COMPONENT_UNSIGNED_INT && indices.stride == sizeof(unsigned int))
+		{
+			// already in the layout GL wants, straight from the mapping
+			glBindBuffer(GL_COPY_WRITE_BUFFER, ebo.Get());
+			glBufferData(GL_COPY_WRITE_BUFFER, indexCount * sizeof(unsigned int), indices.data, GL_STATIC_DRAW);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		}
+		else
+			FillBuffer(ebo, indexCount * sizeof(unsigned int), [&primitive](void* out) { ConvertIndices(primitive, static_cast<unsigned int*>(out)); });
+
+		meshes.emplace_back(std::move(vao), std::move(vbo), std::move(ebo), static_cast<unsigned int>(vertexCount), static_cast<unsigned int>(indexCount), name);
+		meshes.back().textures = MaterialTextures(document, json);
+		return true;
+	}
+
+	bool LoadMesh(Document& document, int index, std::vector<Mesh>& meshes)
+	{
+		const JsonValue& mesh = document.json["meshes"][static_cast<size_t>(index)];
+		if (index < 0 || !mesh.IsObject())
+			return false;
+
+		const JsonValue& primitives = mesh["primitives"];
+		std::string name = document.namePrefix + ": " + (mesh["name"].IsString() ? mesh["name"].AsString() : "mesh " + std::to_string(index));
+		for (size_t i = 0; i < primitives.Size(); i++)
+		{
+			std::string primitiveName = primitives.Size() > 1 ? name + " [" + std::to_string(i) + "]" : name;
+			if (!LoadPrimitive(document, primitives[i], primitiveName, meshes))
+				return false;
+		}
+		return true;
+	}
+
+	bool LoadNode(Document& document, int index, int depth, std::vector<Mesh>& meshes)
+	{
+		const JsonValue& node = document.json["nodes"][static_cast<size_t>(index)];
+		if (index < 0 || !node.IsObject() || depth > MAX_NODE_DEPTH)
+			return false;
+
+		if (node.Has("mesh") && !LoadMesh(document, node["mesh"].AsInt(-1), meshes))
+			return false;
+
+		const JsonValue& children = node["children"];
+		for (size_t i = 0; i < children.Size(); i++)
+		{
+			if (!LoadNode(document, children[i].AsInt(-1), depth + 1, meshes))
+				return false;
+		}
+		return true;
+	}
+
+	bool OpenDocument(const std::string& path, Document& document)
+	{
+		document.files.push_back(std::make_unique<MappedFile>());
+		MappedFile& file = *document.files.back();
+		if (!file.Open(path))
+		{
+			std::cout << "ERROR::GLTF::FILE_NOT_SUCCESSFULLY_READ " << path << std::endl;
+			return false;
+		}
+
+		const unsigned char* data = file.GetData();
+		size_t size = file.GetSize();
+		const char* jsonText = reinterpret_cast<const char*>(data);
+		size_t jsonLength = size;
+		BufferData binaryChunk;
+
+		bool binary = size >= 12 && ReadU32(data) == GLB_MAGIC;
+		if (binary)
+		{
+			uint32_t version = ReadU32(data + 4);
+			size_t length = std::min<size_t>(ReadU32(data + 8), size);
+			if (version != 2 || length < 20 || ReadU32(data + 16) != GLB_CHUNK_JSON || ReadU32(data + 12) > length - 20)
+			{
+				std::cout << "ERROR::GLTF::INVALID_GLB " << path << std::endl;
+				return false;
+			}
+
+			jsonText = reinterpret_cast<const char*>(data + 20);
+			jsonLength = ReadU32(data + 12);
+			// chunks are 4-byte aligned
+			size_t binaryOffset = 20 + ((jsonLength + 3) & ~static_cast<size_t>(3));
+			if (binaryOffset + 8 <= length && ReadU32(data + binaryOffset + 4) == GLB_CHUNK_BIN)
+			{
+				binaryChunk.data = data + binaryOffset + 8;
+				binaryChunk.size = std::min<size_t>(ReadU32(data + binaryOffset), length - binaryOffset - 8);
+			}
+		}
+
+		std::string error;
+		if (!JsonValue::Parse(jsonText, jsonLength, document.json, error))
+		{
+			std::cout << "ERROR::GLTF::JSON " << error << std::endl;
+			return false;
+		}
+
+		if (document.json["asset"]["version"].AsString().compare(0, 1, "2") != 0)
+		{
+			std::cout << "GLTF: only glTF 2.0 is loaded natively" << std::endl;
+			return false;
+		}
+		if (document.json["extensionsRequired"].Size() > 0)
+		{
+			std::cout << "GLTF: required extension " << document.json["extensionsRequired"][static_cast<size_t>(0)].AsString() << " is not supported natively" << std::endl;
+			return false;
+		}
+
+		const JsonValue& buffers = document.json["buffers"];
+		for (size_t i = 0; i < buffers.Size(); i++)
+		{
+			const JsonValue& buffer = buffers[i];
+			size_t byteLength;
+			if (!ReadSize(buffer["byteLength"], 0, byteLength))
+				return false;
+
+			BufferData resolved;
+			if (!buffer.Has("uri"))
+			{
+				// only the first buffer of a GLB may live in the binary chunk
+				if (i != 0 || !binaryChunk.data)
+					return false;
+				resolved = binaryChunk;
+			}
+			else
+			{
+				const std::string& uri = buffer["uri"].AsString();
+				if (uri.compare(0, 5, "data:") == 0)
+				{
+					std::cout << "GLTF: embedded base64 buffers are not loaded natively" << std::endl;
+					return false;
+				}
+
+				document.files.push_back(std::make_unique<MappedFile>());
+				MappedFile& external = *document.files.back();
+				if (!external.Open(document.directory + '/' + DecodeUri(uri)))
+				{
+					std::cout << "ERROR::GLTF::BUFFER_NOT_FOUND " << uri << std::endl;
+					return false;
+				}
+				resolved.data = external.GetData();
+				resolved.size = external.GetSize();
+			}
+
+			if (resolved.size < byteLength)
+			{
+				std::cout << "ERROR::GLTF::BUFFER_TOO_SHORT " << i << std::endl;
+				return false;
+			}
+			resolved.size = byteLength;
+			document.buffers.push_back(resolved);
+		}
+		return true;
+	}
+}
+
+bool GltfLoader::CanLoad(const std::string& path)
+{
+	size_t dot = path.find_last_of('.');
+	if (dot == std::string::npos)
+		return false;
+
+	std::string extension = path.substr(dot + 1);
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+	return extension == "gltf" || extension == "glb";
+}
+
+bool GltfLoader::Load(const std::string& path, const std::string& namePrefix, std::vector<Mesh>& meshes, bool upload)
+{
+	Document document;
+	size_t slash = path.find_last_of("/\\");
+	document.directory = slash == std::string::npos ? "." : path.substr(0, slash);
+	document.namePrefix = namePrefix;
+	document.upload = upload;
+	if (!OpenDocument(path, document))
+		return false;
+
+	size_t firstMesh = meshes.size();
+	bool loaded = true;
+	const JsonValue& scenes = document.json["scenes"];
+	if (scenes.Size() > 0)
+	{
+		const JsonValue& scene = scenes[static_cast<size_t>(document.json["scene"].AsInt(0))];
+		const JsonValue& nodes = scene["nodes"];
+		for (size_t i = 0; i < nodes.Size() && loaded; i++)
+			loaded = LoadNode(document, nodes[i].AsInt(-1), 0, meshes);
+	}
+	else
+	{
+		// a file without scenes is a mesh library, everything is loaded
+		for (size_t i = 0; i < document.json["meshes"].Size() && loaded; i++)
+			loaded = LoadMesh(document, static_cast<int>(i), meshes);
+	}
+
+	if (!loaded)
+	{
+		meshes.erase(meshes.begin() + firstMesh, meshes.end());
+		return false;
+	}
+	if (document.skippedPrimitives > 0)
+		std::cout << "GLTF: skipped " << document.skippedPrimitives << " point/line primitives" << std::endl;
+	return true;
+}
@@ -0,0 +1,24 @@
+#ifndef GLTFLOADER_H
+#define GLTFLOADER_H
+
+#include "Mesh.h"
+
+#include <string>
+#include <vector>
+
+// native glTF 2.0 / GLB import that skips Assimp's scene graph.
+// the file is memory mapped, each primitive is interleaved from its accessors straight into a mapped GL buffer
+// and tightly packed 32-bit indices are uploaded from the mapping without a copy.
+// files using something the loader does not handle (sparse or compressed data, base64 buffers, required
+// extensions) make Load return false, Model then falls back to Assimp.
+class GltfLoader
+{
+public:
+	static bool CanLoad(const std::string& path);
+	// appends one mesh per triangle primitive, nodes of the default scene are visited in the same order as Model::processNode.
+	// the meshes reference their material's base colour and normal images, no GL textures are created for them.
+	// upload = false builds every mesh in system memory and creates no GL objects
+	static bool Load(const std::string& path, const std::string& namePrefix, std::vector<Mesh>& meshes, bool upload = true);
+};
+
+#endif // !GLTFLOADER_H
@@ -0,0 +1,241 @@
+#include "HotReloader.h"
+
+#include "ThreadPool.h"
+
+#include <cstdio>
+#include <iostream>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+	// quiet time before a changed file is read, saving from an editor or exporter is rarely a single write
+	const auto SETTLE_TIME = std::chrono::milliseconds(300);
+
+	std::string Normalize(const std::string& path)
+	{
+		std::error_code error;
+		fs::path normalized = fs::weakly_canonical(fs::absolute(path, error), error);
+		return error ? fs::path(path).generic_string() : normalized.generic_string();
+	}
+}
+
+void HotReloader::SetEnabled(bool enabled)
+{
+	m_Enabled = enabled;
+	if (!enabled)
+	{
+		m_Watchers.clear();
+		m_Pending.clear();
+		m_PaletteEntries = 0;
+	}
+	else if (!m_AssetPath.empty())
+		Watch(m_AssetPath);
+}
+
+bool HotReloader::IsEnabled() const
+{
+	return m_Enabled;
+}
+
+void HotReloader::WatchAsset(Model& model, const std::string& path, ModelLoader loader, ImportPreset preset,
+	const std::vector<uint64_t>* hashes)
+{
+	// a reload still running is dropped (it may use another preset), its job only holds a CPU copy
+	m_Import = std::future<Import>();
+	m_ImportAgain = false;
+	// a streamed file is mapped while it is drawn, rewriting it can't be picked up safely
+	std::string normalized = model.GetStreamer() ? std::string() : Normalize(path);
+	if (normalized != m_AssetPath)
+	{
+		m_Stamps.erase(m_AssetPath);
+		m_Status.clear();
+	}
+
+	m_AssetPath = normalized;
+	m_Loader = loader;
+	m_Preset = preset;
+	m_MeshHashes.clear();
+	m_HashesStale = false;
+	if (m_AssetPath.empty())
+		return;
+
+	// only reloads compare against the hashes, nothing to hash while they are off
+	if (hashes)
+		m_MeshHashes = *hashes;
+	else if (m_Enabled)
+		m_MeshHashes = model.ComputeMeshHashes();
+	else
+		m_HashesStale = true;
+	if (m_Enabled)
+		Watch(m_AssetPath);
+	ReadStamp(m_AssetPath, m_Stamps[m_AssetPath]);
+}
+
+void HotReloader::Watch(const std::string& file)
+{
+	if (m_Stamps.find(file) == m_Stamps.end())
+		ReadStamp(file, m_Stamps[file]);
+
+	std::string directory = fs::path(file).parent_path().generic_string();
+	if (m_Watchers.find(directory) != m_Watchers.end())
+		return;
+
+	// the directories are not scanned recursively, a texture folder next to a large library costs nothing
+	std::unique_ptr<DirectoryWatcher> watcher = std::make_unique<DirectoryWatcher>();
+	if (!watcher->Start(directory, false))
+		std::cout << "ERROR::HOT_RELOAD::WATCH_FAILED " << directory << std::endl;
+	m_Watchers[directory] = std::move(watcher);
+}
+
+bool HotReloader::Update(std::unique_ptr<Model>& model, TexturePalette& palette)
+{
+	auto now = std::chrono::steady_clock::now();
+	if (m_Enabled)
+	{
+		// the asset was loaded while hot reload was off
+		if (m_HashesStale && model)
+		{
+			m_MeshHashes = model->ComputeMeshHashes();
+			m_HashesStale = false;
+		}
+
+		// textures added since the last frame are watched too
+		for (; m_PaletteEntries < palette.GetEntryCount(); m_PaletteEntries++)
+		{
+			const TexturePalette::Entry& entry = palette.GetEntry(static_cast<int>(m_PaletteEntries));
+			// embedded images change with the asset, which is watched already
+			if (entry.embedded)
+				continue;
+			Watch(Normalize(entry.path));
+			// packed entries also depend on their occlusion and metalness maps
+			for (const std::string& source : entry.sources)
+			{
+				if (!source.empty())
+					Watch(Normalize(source));
+			}
+		}
+
+		for (auto& [directory, watcher] : m_Watchers)
+		{
+			std::vector<std::string> changedPaths;
+			bool overflowed = false;
+			watcher->Poll(changedPaths, overflowed);
+			for (const std::string& changed : changedPaths)
+			{
+				std::string file = directory + "/" + changed;
+				if (m_Stamps.find(file) != m_Stamps.end())
+					m_Pending[file] = now;
+			}
+			// lost events: every watched file of the directory is compared against its stamp
+			if (overflowed)
+			{
+				for (const auto& stamp : m_Stamps)
+				{
+					if (fs::path(stamp.first).parent_path().generic_string() == directory)
+						m_Pending[stamp.first] = now;
+				}
+			}
+		}
+
+		for (auto it = m_Pending.begin(); it != m_Pending.end();)
+		{
+			if (now - it->second < SETTLE_TIME)
+			{
+				++it;
+				continue;
+			}
+
+			std::string file = it->first;
+			it = m_Pending.erase(it);
+
+			// touched or saved without changes, or deleted (a save by rename shows up as a new file right after)
+			FileStamp stamp;
+			FileStamp& known = m_Stamps[file];
+			if (!ReadStamp(file, stamp) || (stamp.size == known.size && stamp.time == known.time))
+				continue;
+			known = stamp;
+
+			if (file == m_AssetPath)
+			{
+				if (m_Import.valid())
+					m_ImportAgain = true;
+				else
+					StartImport();
+			}
+			else if (palette.Reload(file) > 0)
+				m_Status = "Reloaded texture " + fs::path(file).filename().string();
+		}
+	}
+
+	if (!m_Import.valid() || m_Import.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		return false;
+
+	Import result = m_Import.get();
+	if (m_ImportAgain)
+	{
+		// already outdated, the newer version is imported instead
+		m_ImportAgain = false;
+		StartImport();
+		return false;
+	}
+	if (!result.model->errorMessage.empty())
+	{
+		// usually a file caught halfway through being written, the next save triggers another reload
+		m_Status = "Reload failed, keeping the previous version: " + result.model->errorMessage;
+		std::cout << "ERROR::HOT_RELOAD::IMPORT_FAILED " << m_AssetPath << ": " << result.model->errorMessage << std::endl;
+		return false;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	unsigned int uploaded = result.model->AdoptGpuData(*model, result.hashes, m_MeshHashes);
+	double swapMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	result.model->loadMilliseconds = result.milliseconds;
+	m_MeshHashes = std::move(result.hashes);
+	model = std::move(result.model);
+
+	char status[160];
+	std::snprintf(status, sizeof(status), "Reloaded: %u of %zu meshes uploaded, import %.1f ms, swap %.1f ms", uploaded,
+		model->meshes.size(), result.milliseconds, swapMilliseconds);
+	m_Status = status;
+	return true;
+}
+
+void HotReloader::StartImport()
+{
+	std::string path = m_AssetPath;
+	ModelLoader loader = m_Loader;
+	ImportPreset preset = m_Preset;
+	m_Status = "Reloading " + fs::path(path).filename().string() + "...";
+	m_Import = ThreadPool::Get().Submit([path, loader, preset]()
+	{
+		Import result;
+		auto start = std::chrono::steady_clock::now();
+		result.model = std::make_unique<Model>(path, false, loader, preset, ModelStorage::CpuOnly);
+		if (result.model->errorMessage.empty())
+			result.hashes = result.model->ComputeMeshHashes();
+		result.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		return result;
+	});
+}
+
+bool HotReloader::IsReloading() const
+{
+	return m_Import.valid();
+}
+
+const std::string& HotReloader::GetStatus() const
+{
+	return m_Status;
+}
+
+bool HotReloader::ReadStamp(const std::string& path, FileStamp& stamp)
+{
+	std::error_code error;
+	stamp.size = fs::file_size(path, error);
+	if (error)
+		return false;
+	stamp.time = fs::last_write_time(path, error);
+	return !error;
+}
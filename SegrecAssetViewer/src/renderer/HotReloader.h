@@ -0,0 +1,88 @@
+#ifndef HOTRELOADER_H
+#define HOTRELOADER_H
+
+#include "DirectoryWatcher.h"
+#include "Model.h"
+#include "TexturePalette.h"
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <future>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// watches the loaded asset and the palette textures and reloads whatever changed on disk.
+// the asset is imported again on the thread pool without touching GL, then compared mesh by mesh against the one on screen:
+// meshes with the same content keep their GL buffers, only changed ones are uploaded, and the model is swapped in one frame.
+// textures are decoded again by the palette and replace their layer in place.
+class HotReloader
+{
+public:
+	HotReloader() = default;
+
+	HotReloader(const HotReloader&) = delete;
+	HotReloader& operator=(const HotReloader&) = delete;
+
+	void SetEnabled(bool enabled);
+	bool IsEnabled() const;
+
+	// the model just loaded from path becomes the one reloads are compared against, call after every load.
+	// hashes of its meshes can be passed when the import job already computed them, otherwise they are computed while
+	// hot reload is enabled (a readback for meshes without their CPU copy) and put off until it is enabled
+	void WatchAsset(Model& model, const std::string& path, ModelLoader loader, ImportPreset preset,
+		const std::vector<uint64_t>* hashes = nullptr);
+
+	// picks up changes, starts reloads and swaps finished ones in, call once per frame from the render thread.
+	// model has to hold the asset passed to WatchAsset, returns true when it was replaced
+	bool Update(std::unique_ptr<Model>& model, TexturePalette& palette);
+
+	bool IsReloading() const;
+	// result of the last reload, for the UI
+	const std::string& GetStatus() const;
+
+private:
+	struct FileStamp
+	{
+		uintmax_t size = 0;
+		std::filesystem::file_time_type time;
+	};
+
+	struct Import
+	{
+		std::unique_ptr<Model> model;
+		std::vector<uint64_t> hashes;
+		double milliseconds = 0.0;
+	};
+
+	void Watch(const std::string& file);
+	void StartImport();
+	static bool ReadStamp(const std::string& path, FileStamp& stamp);
+
+private:
+	bool m_Enabled = true;
+
+	std::string m_AssetPath;
+	ModelLoader m_Loader = ModelLoader::Auto;
+	ImportPreset m_Preset = ImportPreset::FullQuality;
+	std::vector<uint64_t> m_MeshHashes;
+	// m_MeshHashes don't belong to the model on screen yet, computed on the first update with hot reload enabled
+	bool m_HashesStale = false;
+
+	// one non-recursive watcher per directory holding a watched file
+	std::unordered_map<std::string, std::unique_ptr<DirectoryWatcher>> m_Watchers;
+	// watched files (normalized absolute paths) with size and time of the version on screen
+	std::unordered_map<std::string, FileStamp> m_Stamps;
+	// files with events, handled once they stay quiet for a moment (editors write in several steps)
+	std::unordered_map<std::string, std::chrono::steady_clock::time_point> m_Pending;
+	size_t m_PaletteEntries = 0;
+
+	std::future<Import> m_Import;
+	// the asset changed again while it was being imported
+	bool m_ImportAgain = false;
+	std::string m_Status;
+};
+
+#endif // !HOTRELOADER_H
@@ -0,0 +1,615 @@
+#include "IBLBaker.h"
+
+#include "Simd.h"
+#include "ThreadPool.h"
+
+#include <stb_image.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+
+namespace
+{
+	const float PI = 3.14159265359f;
+	const char CACHE_DIRECTORY[] = "cache/ibl";
+	const uint32_t CACHE_VERSION = 1;
+	const char CACHE_MAGIC[4] = { 'S', 'I', 'B', 'L' };
+
+	// direction through texel coordinates s, t in [-1, 1] of a cube face, OpenGL cube map conventions
+	glm::vec3 FaceDirection(int face, float s, float t)
+	{
+		glm::vec3 dir;
+		switch (face)
+		{
+		case 0:  dir = glm::vec3(1.0f, -t, -s); break;
+		case 1:  dir = glm::vec3(-1.0f, -t, s); break;
+		case 2:  dir = glm::vec3(s, 1.0f, t); break;
+		case 3:  dir = glm::vec3(s, -1.0f, -t); break;
+		case 4:  dir = glm::vec3(s, -t, 1.0f); break;
+		default: dir = glm::vec3(-s, -t, -1.0f); break;
+		}
+		return glm::normalize(dir);
+	}
+
+	// inverse of FaceDirection, s and t are returned in [0, 1]
+	void DirectionToFace(float x, float y, float z, int& face, float& s, float& t)
+	{
+		float ax = std::fabs(x), ay = std::fabs(y), az = std::fabs(z);
+		float ma, sc, tc;
+		if (ax >= ay && ax >= az)
+		{
+			face = x > 0.0f ? 0 : 1;
+			ma = ax;
+			sc = x > 0.0f ? -z : z;
+			tc = -y;
+		}
+		else if (ay >= az)
+		{
+			face = y > 0.0f ? 2 : 3;
+			ma = ay;
+			sc = x;
+			tc = y > 0.0f ? z : -z;
+		}
+		else
+		{
+			face = z > 0.0f ? 4 : 5;
+			ma = az;
+			sc = z > 0.0f ? x : -x;
+			tc = -y;
+		}
+		s = 0.5f * (sc / ma + 1.0f);
+		t = 0.5f * (tc / ma + 1.0f);
+	}
+
+	glm::vec3 SampleEquirect(const std::vector<float>& pixels, int width, int height, const glm::vec3& dir)
+	{
+		float u = std::atan2(dir.z, dir.x) / (2.0f * PI) + 0.5f;
+		float v = std::acos(std::clamp(dir.y, -1.0f, 1.0f)) / PI;
+
+		float fx = u * width - 0.5f;
+		float fy = std::clamp(v * height - 0.5f, 0.0f, static_cast<float>(height - 1));
+		int x0 = static_cast<int>(std::floor(fx));
+		int y0 = static_cast<int>(fy);
+		float tx = fx - x0;
+		float ty = fy - y0;
+		int y1 = std::min(y0 + 1, height - 1);
+		// the horizontal axis wraps around
+		int x1 = ((x0 + 1) % width + width) % width;
+		x0 = (x0 % width + width) % width;
+
+		auto texel = [&](int x, int y) { const float* p = &pixels[(static_cast<size_t>(y) * width + x) * 3]; return glm::vec3(p[0], p[1], p[2]); };
+		glm::vec3 top = glm::mix(texel(x0, y0), texel(x1, y0), tx);
+		glm::vec3 bottom = glm::mix(texel(x0, y1), texel(x1, y1), tx);
+		return glm::mix(top, bottom, ty);
+	}
+
+	glm::vec3 SampleFace(const CubeMapData& mip, int face, float s, float t)
+	{
+		int size = mip.faceSize;
+		float fx = std::clamp(s * size - 0.5f, 0.0f, static_cast<float>(size - 1));
+		float fy = std::clamp(t * size - 0.5f, 0.0f, static_cast<float>(size - 1));
+		int x0 = static_cast<int>(fx);
+		int y0 = static_cast<int>(fy);
+		int x1 = std::min(x0 + 1, size - 1);
+		int y1 = std::min(y0 + 1, size - 1);
+		float tx = fx - x0;
+		float ty = fy - y0;
+
+		const float* base = &mip.texels[static_cast<size_t>(face) * size * size * 3];
+		auto texel = [&](int x, int y) { const float* p = base + (static_cast<size_t>(y) * size + x) * 3; return glm::vec3(p[0], p[1], p[2]); };
+		glm::vec3 top = glm::mix(texel(x0, y0), texel(x1, y0), tx);
+		glm::vec3 bottom = glm::mix(texel(x0, y1), texel(x1, y1), tx);
+		return glm::mix(top, bottom, ty);
+	}
+
+	glm::vec3 SampleCube(const std::vector<CubeMapData>& pyramid, float x, float y, float z, float lod)
+	{
+		int face;
+		float s, t;
+		DirectionToFace(x, y, z, face, s, t);
+
+		lod = std::clamp(lod, 0.0f, static_cast<float>(pyramid.size() - 1));
+		int level = static_cast<int>(lod);
+		float blend = lod - level;
+		glm::vec3 color = SampleFace(pyramid[level], face, s, t);
+		if (blend > 0.0f && level + 1 < static_cast<int>(pyramid.size()))
+			color = glm::mix(color, SampleFace(pyramid[level + 1], face, s, t), blend);
+		return color;
+	}
+
+	CubeMapData Downsample(const CubeMapData& source)
+	{
+		CubeMapData mip;
+		mip.faceSize = std::max(source.faceSize / 2, 1);
+		mip.texels.resize(static_cast<size_t>(6) * mip.faceSize * mip.faceSize * 3);
+
+		int src = source.faceSize;
+		int dst = mip.faceSize;
+		ThreadPool::Get().ParallelFor(0, static_cast<size_t>(6) * dst, 16, [&](size_t begin, size_t end)
+		{
+			for (size_t row = begin; row < end; row++)
+			{
+				size_t face = row / dst;
+				size_t y = row % dst;
+				const float* srcFace = &source.texels[face * src * src * 3];
+				float* out = &mip.texels[(face * dst * dst + y * dst) * 3];
+				for (int x = 0; x < dst; x++)
+				{
+					const float* a = srcFace + ((y * 2) * src + x * 2) * 3;
+					const float* b = srcFace + ((y * 2 + 1) * src + x * 2) * 3;
+					for (int c = 0; c < 3; c++)
+						out[x * 3 + c] = 0.25f * (a[c] + a[c + 3] + b[c] + b[c + 3]);
+				}
+			}
+		});
+		return mip;
+	}
+
+	float RadicalInverse(uint32_t bits)
+	{
+		bits = (bits << 16u) | (bits >> 16u);
+		bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+		bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+		bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+		bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+		return static_cast<float>(bits) * 2.3283064365386963e-10f;
+	}
+
+	// GGX sample directions for N = V = R in tangent space, shared by every texel of one roughness level.
+	// stored as structure of arrays padded to a multiple of 4, padding has zero weight.
+	struct PrefilterSamples
+	{
+		std::vector<float> x, y, z, weight, lod;
+	};
+
+	PrefilterSamples BuildPrefilterSamples(float roughness, int sampleCount, int sourceSize, int sourceMipCount)
+	{
+		PrefilterSamples samples;
+		float a = roughness * roughness;
+		float a2 = a * a;
+		float texelSolidAngle = 4.0f * PI / (6.0f * sourceSize * sourceSize);
+
+		for (int i = 0; i < sampleCount; i++)
+		{
+			float xi0 = static_cast<float>(i) / sampleCount;
+			float xi1 = RadicalInverse(static_cast<uint32_t>(i));
+
+			float phi = 2.0f * PI * xi0;
+			float cosTheta = std::sqrt((1.0f - xi1) / (1.0f + (a2 - 1.0f) * xi1));
+			float sinTheta = std::sqrt(1.0f - cosTheta * cosTheta);
+			glm::vec3 h(sinTheta * std::cos(phi), sinTheta * std::sin(phi), cosTheta);
+			glm::vec3 l = 2.0f * h.z * h - glm::vec3(0.0f, 0.0f, 1.0f);
+			if (l.z <= 0.0f)
+				continue;
+
+			// pick the source mip whose texel matches the solid angle covered by the sample
+			float d = (cosTheta * cosTheta) * (a2 - 1.0f) + 1.0f;
+			float D = a2 / (PI * d * d);
+			float pdf = D * 0.25f;
+			float sampleSolidAngle = 1.0f / (sampleCount * pdf + 0.0001f);
+			float lod = roughness == 0.0f ? 0.0f : 0.5f * std::log2(sampleSolidAngle / texelSolidAngle) + 1.0f;
+
+			samples.x.push_back(l.x);
+			samples.y.push_back(l.y);
+			samples.z.push_back(l.z);
+			samples.weight.push_back(l.z);
+			samples.lod.push_back(std::clamp(lod, 0.0f, static_cast<float>(sourceMipCount - 1)));
+		}
+
+		while (samples.x.size() % 4 != 0)
+		{
+			samples.x.push_back(0.0f);
+			samples.y.push_back(0.0f);
+			samples.z.push_back(1.0f);
+			samples.weight.push_back(0.0f);
+			samples.lod.push_back(0.0f);
+		}
+		return samples;
+	}
+
+	glm::vec3 PrefilterTexel(const std::vector<CubeMapData>& source, const PrefilterSamples& samples, const glm::vec3& n)
+	{
+		glm::vec3 up = std::fabs(n.z) < 0.999f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+		glm::vec3 tangent = glm::normalize(glm::cross(up, n));
+		glm::vec3 bitangent = glm::cross(n, tangent);
+
+		size_t count = samples.x.size();
+		alignas(16) float dx[4], dy[4], dz[4];
+		glm::vec3 color(0.0f);
+		float totalWeight = 0.0f;
+
+		for (size_t i = 0; i < count; i += 4)
+		{
+			// rotate 4 tangent space samples into world space at once, the cube fetches stay scalar
+#if SIMD_SSE2
+			__m128 lx = _mm_loadu_ps(&samples.x[i]);
+			__m128 ly = _mm_loadu_ps(&samples.y[i]);
+			__m128 lz = _mm_loadu_ps(&samples.z[i]);
+			_mm_store_ps(dx, _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(tangent.x), lx), _mm_mul_ps(_mm_set1_ps(bitangent.x), ly)), _mm_mul_ps(_mm_set1_ps(n.x), lz)));
+			_mm_store_ps(dy, _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(tangent.y), lx), _mm_mul_ps(_mm_set1_ps(bitangent.y), ly)), _mm_mul_ps(_mm_set1_ps(n.y), lz)));
+			_mm_store_ps(dz, _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(tangent.z), lx), _mm_mul_ps(_mm_set1_ps(bitangent.z), ly)), _mm_mul_ps(_mm_set1_ps(n.z), lz)));
+#else
+			for (int j = 0; j < 4; j++)
+			{
+				dx[j] = tangent.x * samples.x[i + j] + bitangent.x * samples.y[i + j] + n.x * samples.z[i + j];
+				dy[j] = tangent.y * samples.x[i + j] + bitangent.y * samples.y[i + j] + n.y * samples.z[i + j];
+				dz[j] = tangent.z * samples.x[i + j] + bitangent.z * samples.y[i + j] + n.z * samples.z[i + j];
+			}
+#endif
+			for (int j = 0; j < 4; j++)
+			{
+				float weight = samples.weight[i + j];
+				if (weight <= 0.0f)
+					continue;
+				color += SampleCube(source, dx[j], dy[j], dz[j], samples.lod[i + j]) * weight;
+				totalWeight += weight;
+			}
+		}
+		return totalWeight > 0.0f ? color / totalWeight : color;
+	}
+
+	void ProjectSH(const CubeMapData& mip, glm::vec3 sh[9])
+	{
+		std::mutex mutex;
+		glm::vec3 total[9];
+		float totalSolidAngle = 0.0f;
+		for (int i = 0; i < 9; i++)
+			total[i] = glm::vec3(0.0f);
+
+		int size = mip.faceSize;
+		ThreadPool::Get().ParallelFor(0, 6, 1, [&](size_t begin, size_t end)
+		{
+			glm::vec3 partial[9];
+			float partialSolidAngle = 0.0f;
+			for (int i = 0; i < 9; i++)
+				partial[i] = glm::vec3(0.0f);
+
+			for (size_t face = begin; face < end; face++)
+			{
+				for (int y = 0; y < size; y++)
+				{
+					for (int x = 0; x < size; x++)
+					{
+						float s = 2.0f * (x + 0.5f) / size - 1.0f;
+						float t = 2.0f * (y + 0.5f) / size - 1.0f;
+						float solidAngle = 4.0f / (size * size * std::pow(1.0f + s * s + t * t, 1.5f));
+						glm::vec3 d = FaceDirection(static_cast<int>(face), s, t);
+						const float* p = &mip.texels[((face * size + y) * size + x) * 3];
+						glm::vec3 radiance = glm::vec3(p[0], p[1], p[2]) * solidAngle;
+
+						partial[0] += radiance * 0.282095f;
+						partial[1] += radiance * (0.488603f * d.y);
+						partial[2] += radiance * (0.488603f * d.z);
+						partial[3] += radiance * (0.488603f * d.x);
+						partial[4] += radiance * (1.092548f * d.x * d.y);
+						partial[5] += radiance * (1.092548f * d.y * d.z);
+						partial[6] += radiance * (0.315392f * (3.0f * d.z * d.z - 1.0f));
+						partial[7] += radiance * (1.092548f * d.x * d.z);
+						partial[8] += radiance * (0.546274f * (d.x * d.x - d.y * d.y));
+						partialSolidAngle += solidAngle;
+					}
+				}
+			}
+
+			std::lock_guard<std::mutex> lock(mutex);
+			for (int i = 0; i < 9; i++)
+				total[i] += partial[i];
+			totalSolidAngle += partialSolidAngle;
+		});
+
+		// the texel solid angles are approximate, renormalise to the full sphere.
+		// cosine lobe convolution per band (PI, 2PI/3, PI/4) and the 1/PI of the Lambert BRDF folded in.
+		float normalisation = 4.0f * PI / totalSolidAngle;
+		const float band[9] = { 1.0f, 2.0f / 3.0f, 2.0f / 3.0f, 2.0f / 3.0f, 0.25f, 0.25f, 0.25f, 0.25f, 0.25f };
+		for (int i = 0; i < 9; i++)
+			sh[i] = total[i] * normalisation * band[i];
+	}
+
+	uint64_t HashBytes(const void* data, size_t size, uint64_t hash = 14695981039346656037ull)
+	{
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	std::string HashToFileName(uint64_t hash, const char* extension)
+	{
+		std::ostringstream name;
+		name << CACHE_DIRECTORY << '/' << std::hex << std::setw(16) << std::setfill('0') << hash << extension;
+		return name.str();
+	}
+}
+
+bool IBLBaker::LoadEquirect(const std::string& path, std::vector<float>& pixels, int& width, int& height)
+{
+	int channels;
+	float* data = stbi_loadf(path.c_str(), &width, &height, &channels, 3);
+	if (!data)
+	{
+		std::cout << "ERROR::IBL::ENVIRONMENT_FAILED_TO_LOAD: " << path << std::endl;
+		return false;
+	}
+
+	pixels.assign(data, data + static_cast<size_t>(width) * height * 3);
+	stbi_image_free(data);
+	return true;
+}
+
+IBLMaps IBLBaker::Bake(const std::vector<float>& pixels, int width, int height, const IBLBakeSettings& settings)
+{
+	// equirect -> cube pyramid, the base face keeps roughly the texel density of the source
+	int baseSize = 32;
+	while (baseSize * 2 <= width / 4 && baseSize < 512)
+		baseSize *= 2;
+
+	std::vector<CubeMapData> source(1);
+	source[0].faceSize = baseSize;
+	source[0].texels.resize(static_cast<size_t>(6) * baseSize * baseSize * 3);
+	ThreadPool::Get().ParallelFor(0, static_cast<size_t>(6) * baseSize, 8, [&](size_t begin, size_t end)
+	{
+		for (size_t row = begin; row < end; row++)
+		{
+			int face = static_cast<int>(row / baseSize);
+			int y = static_cast<int>(row % baseSize);
+			float* out = &source[0].texels[row * baseSize * 3];
+			for (int x = 0; x < baseSize; x++)
+			{
+				glm::vec3 dir = FaceDirection(face, 2.0f * (x + 0.5f) / baseSize - 1.0f, 2.0f * (y + 0.5f) / baseSize - 1.0f);
+				glm::vec3 color = SampleEquirect(pixels, width, height, dir);
+				out[x * 3 + 0] = color.r;
+				out[x * 3 + 1] = color.g;
+				out[x * 3 + 2] = color.b;
+			}
+		}
+	});
+	while (source.back().faceSize > 1)
+		source.push_back(Downsample(source.back()));
+
+	IBLMaps maps;
+
+	// diffuse irradiance from a small mip, 32x32 per face is plenty for 3 SH bands
+	size_t shLevel = 0;
+	while (shLevel + 1 < source.size() && source[shLevel].faceSize > 32)
+		shLevel++;
+	ProjectSH(source[shLevel], maps.irradianceSH);
+
+	// specular, one mip per roughness level
+	int faceSize = std::min(settings.faceSize, baseSize);
+	int mipCount = 1;
+	while ((faceSize >> mipCount) >= std::max(settings.smallestMipSize, 1))
+		mipCount++;
+
+	for (int level = 0; level < mipCount; level++)
+	{
+		CubeMapData mip;
+		mip.faceSize = faceSize >> level;
+		mip.texels.resize(static_cast<size_t>(6) * mip.faceSize * mip.faceSize * 3);
+
+		float roughness = mipCount > 1 ? static_cast<float>(level) / (mipCount - 1) : 0.0f;
+		PrefilterSamples samples;
+		if (level > 0)
+			samples = BuildPrefilterSamples(roughness, settings.sampleCount, baseSize, static_cast<int>(source.size()));
+		float baseLod = std::log2(static_cast<float>(baseSize) / mip.faceSize);
+
+		int size = mip.faceSize;
+		ThreadPool::Get().ParallelFor(0, static_cast<size_t>(6) * size, 4, [&](size_t begin, size_t end)
+		{
+			for (size_t row = begin; row < end; row++)
+			{
+				int face = static_cast<int>(row / size);
+				int y = static_cast<int>(row % size);
+				float* out = &mip.texels[row * size * 3];
+				for (int x = 0; x < size; x++)
+				{
+					glm::vec3 n = FaceDirection(face, 2.0f * (x + 0.5f) / size - 1.0f, 2.0f * (y + 0.5f) / size - 1.0f);
+					glm::vec3 color = level == 0 ? SampleCube(source, n.x, n.y, n.z, baseLod) : PrefilterTexel(source, samples, n);
+					out[x * 3 + 0] = color.r;
+					out[x * 3 + 1] = color.g;
+					out[x * 3 + 2] = color.b;
+				}
+			}
+		});
+		maps.specularMips.push_back(std::move(mip));
+	}
+
+	return maps;
+}
+
+std::vector<float> IBLBaker::BakeBrdfLut(int size, int sampleCount)
+{
+	// sample azimuths and the uniform random numbers do not depend on roughness, share them between texels
+	int paddedCount = (sampleCount + 3) & ~3;
+	std::vector<float> cosPhi(paddedCount), sinPhi(paddedCount), xi(paddedCount), valid(paddedCount);
+	for (int i = 0; i < paddedCount; i++)
+	{
+		float phi = 2.0f * PI * static_cast<float>(i) / sampleCount;
+		cosPhi[i] = std::cos(phi);
+		sinPhi[i] = std::sin(phi);
+		xi[i] = RadicalInverse(static_cast<uint32_t>(i));
+		valid[i] = i < sampleCount ? 1.0f : 0.0f;
+	}
+
+	std::vector<float> lut(static_cast<size_t>(size) * size * 2);
+	ThreadPool::Get().ParallelFor(0, size, 4, [&](size_t begin, size_t end)
+	{
+		for (size_t y = begin; y < end; y++)
+		{
+			float roughness = (y + 0.5f) / size;
+			float a = roughness * roughness;
+			float a2 = a * a;
+			float k = a * 0.5f;
+
+			for (int x = 0; x < size; x++)
+			{
+				float NdotV = (x + 0.5f) / size;
+				float vx = std::sqrt(1.0f - NdotV * NdotV);
+				float vz = NdotV;
+				float gv = NdotV / (NdotV * (1.0f - k) + k);
+				float A = 0.0f, B = 0.0f;
+
+#if SIMD_SSE2
+				const __m128 one = _mm_set1_ps(1.0f);
+				const __m128 zero = _mm_setzero_ps();
+				__m128 sumA = zero, sumB = zero;
+				for (int i = 0; i < paddedCount; i += 4)
+				{
+					__m128 u = _mm_loadu_ps(&xi[i]);
+					__m128 cosTheta = _mm_sqrt_ps(_mm_div_ps(_mm_sub_ps(one, u), _mm_add_ps(one, _mm_mul_ps(_mm_set1_ps(a2 - 1.0f), u))));
+					__m128 sinTheta = _mm_sqrt_ps(_mm_max_ps(_mm_sub_ps(one, _mm_mul_ps(cosTheta, cosTheta)), zero));
+					__m128 hx = _mm_mul_ps(sinTheta, _mm_loadu_ps(&cosPhi[i]));
+					__m128 hz = cosTheta;
+					__m128 VdotH = _mm_max_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(vx), hx), _mm_mul_ps(_mm_set1_ps(vz), hz)), zero);
+					__m128 NdotL = _mm_sub_ps(_mm_mul_ps(_mm_mul_ps(_mm_set1_ps(2.0f), VdotH), hz), _mm_set1_ps(vz));
+					__m128 mask = _mm_and_ps(_mm_cmpgt_ps(NdotL, zero), _mm_cmpgt_ps(_mm_loadu_ps(&valid[i]), zero));
+
+					__m128 gl = _mm_div_ps(NdotL, _mm_add_ps(_mm_mul_ps(NdotL, _mm_set1_ps(1.0f - k)), _mm_set1_ps(k)));
+					__m128 gVis = _mm_div_ps(_mm_mul_ps(_mm_mul_ps(gl, _mm_set1_ps(gv)), VdotH), _mm_mul_ps(_mm_max_ps(hz, _mm_set1_ps(1e-6f)), _mm_set1_ps(NdotV)));
+					__m128 f = _mm_sub_ps(one, VdotH);
+					__m128 f2 = _mm_mul_ps(f, f);
+					__m128 fc = _mm_mul_ps(_mm_mul_ps(f2, f2), f);
+
+					gVis = _mm_and_ps(gVis, mask);
+					sumA = _mm_add_ps(sumA, _mm_mul_ps(_mm_sub_ps(one, fc), gVis));
+					sumB = _mm_add_ps(sumB, _mm_mul_ps(fc, gVis));
+				}
+				alignas(16) float partA[4], partB[4];
+				_mm_store_ps(partA, sumA);
+				_mm_store_ps(partB, sumB);
+				A = partA[0] + partA[1] + partA[2] + partA[3];
+				B = partB[0] + partB[1] + partB[2] + partB[3];
+#else
+				for (int i = 0; i < sampleCount; i++)
+				{
+					float cosTheta = std::sqrt((1.0f - xi[i]) / (1.0f + (a2 - 1.0f) * xi[i]));
+					float sinTheta = std::sqrt(std::max(1.0f - cosTheta * cosTheta, 0.0f));
+					float hx = sinTheta * cosPhi[i];
+					float hz = cosTheta;
+					float VdotH = std::max(vx * hx + vz * hz, 0.0f);
+					float NdotL = 2.0f * VdotH * hz - vz;
+					if (NdotL <= 0.0f)
+						continue;
+
+					float gl = NdotL / (NdotL * (1.0f - k) + k);
+					float gVis = gl * gv * VdotH / (std::max(hz, 1e-6f) * NdotV);
+					float fc = std::pow(1.0f - VdotH, 5.0f);
+					A += (1.0f - fc) * gVis;
+					B += fc * gVis;
+				}
+#endif
+				lut[(y * size + x) * 2 + 0] = A / sampleCount;
+				lut[(y * size + x) * 2 + 1] = B / sampleCount;
+			}
+		}
+	});
+	return lut;
+}
+
+std::string IBLBaker::GetCachePath(const std::string& sourcePath, const IBLBakeSettings& settings)
+{
+	std::error_code error;
+	std::filesystem::path absolute = std::filesystem::absolute(sourcePath, error);
+	std::string key = absolute.generic_string();
+	uint64_t fileSize = static_cast<uint64_t>(std::filesystem::file_size(absolute, error));
+	int64_t modified = static_cast<int64_t>(std::filesystem::last_write_time(absolute, error).time_since_epoch().count());
+
+	uint64_t hash = HashBytes(key.data(), key.size());
+	hash = HashBytes(&fileSize, sizeof(fileSize), hash);
+	hash = HashBytes(&modified, sizeof(modified), hash);
+	hash = HashBytes(&settings.faceSize, sizeof(settings.faceSize), hash);
+	hash = HashBytes(&settings.smallestMipSize, sizeof(settings.smallestMipSize), hash);
+	hash = HashBytes(&settings.sampleCount, sizeof(settings.sampleCount), hash);
+	hash = HashBytes(&CACHE_VERSION, sizeof(CACHE_VERSION), hash);
+	return HashToFileName(hash, ".ibl");
+}
+
+std::string IBLBaker::GetBrdfLutCachePath(int size, int sampleCount)
+{
+	std::ostringstream name;
+	name << CACHE_DIRECTORY << "/brdf_lut_" << size << '_' << sampleCount << '_' << CACHE_VERSION << ".bin";
+	return name.str();
+}
+
+bool IBLBaker::ReadCache(const std::string& cachePath, IBLMaps& maps)
+{
+	std::ifstream file(cachePath, std::ios::binary);
+	if (!file)
+		return false;
+
+	char magic[4];
+	uint32_t version = 0, faceSize = 0, mipCount = 0;
+	file.read(magic, sizeof(magic));
+	file.read(reinterpret_cast<char*>(&version), sizeof(version));
+	file.read(reinterpret_cast<char*>(&faceSize), sizeof(faceSize));
+	file.read(reinterpret_cast<char*>(&mipCount), sizeof(mipCount));
+	if (!file || std::memcmp(magic, CACHE_MAGIC, sizeof(magic)) != 0 || version != CACHE_VERSION || mipCount == 0 || mipCount > 16)
+		return false;
+
+	file.read(reinterpret_cast<char*>(maps.irradianceSH), sizeof(maps.irradianceSH));
+	maps.specularMips.resize(mipCount);
+	for (uint32_t level = 0; level < mipCount; level++)
+	{
+		CubeMapData& mip = maps.specularMips[level];
+		mip.faceSize = std::max<int>(faceSize >> level, 1);
+		mip.texels.resize(static_cast<size_t>(6) * mip.faceSize * mip.faceSize * 3);
+		file.read(reinterpret_cast<char*>(mip.texels.data()), mip.texels.size() * sizeof(float));
+	}
+	return static_cast<bool>(file);
+}
+
+bool IBLBaker::WriteCache(const std::string& cachePath, const IBLMaps& maps)
+{
+	if (maps.specularMips.empty())
+		return false;
+
+	std::error_code error;
+	std::filesystem::create_directories(std::filesystem::path(cachePath).parent_path(), error);
+	std::ofstream file(cachePath, std::ios::binary);
+	if (!file)
+	{
+		std::cout << "ERROR::IBL::CACHE_NOT_WRITABLE: " << cachePath << std::endl;
+		return false;
+	}
+
+	uint32_t faceSize = static_cast<uint32_t>(maps.specularMips[0].faceSize);
+	uint32_t mipCount = static_cast<uint32_t>(maps.specularMips.size());
+	file.write(CACHE_MAGIC, sizeof(CACHE_MAGIC));
+	file.write(reinterpret_cast<const char*>(&CACHE_VERSION), sizeof(CACHE_VERSION));
+	file.write(reinterpret_cast<const char*>(&faceSize), sizeof(faceSize));
+	file.write(reinterpret_cast<const char*>(&mipCount), sizeof(mipCount));
+	file.write(reinterpret_cast<const char*>(maps.irradianceSH), sizeof(maps.irradianceSH));
+	for (const CubeMapData& mip : maps.specularMips)
+		file.write(reinterpret_cast<const char*>(mip.texels.data()), mip.texels.size() * sizeof(float));
+	return static_cast<bool>(file);
+}
+
+bool IBLBaker::ReadBrdfLut(const std::string& cachePath, int size, std::vector<float>& lut)
+{
+	std::ifstream file(cachePath, std::ios::binary);
+	if (!file)
+		return false;
+
+	lut.resize(static_cast<size_t>(size) * size * 2);
+	file.read(reinterpret_cast<char*>(lut.data()), lut.size() * sizeof(float));
+	return static_cast<bool>(file);
+}
+
+bool IBLBaker::WriteBrdfLut(const std::string& cachePath, int size, const std::vector<float>& lut)
+{
+	std::error_code error;
+	std::filesystem::create_directories(std::filesystem::path(cachePath).parent_path(), error);
+	std::ofstream file(cachePath, std::ios::binary);
+	file.write(reinterpret_cast<const char*>(lut.data()), static_cast<size_t>(size) * size * 2 * sizeof(float));
+	return static_cast<bool>(file);
+}
@@ -0,0 +1,53 @@
+#ifndef IBLBAKER_H
+#define IBLBAKER_H
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+// cube faces are stored in OpenGL order (+X, -X, +Y, -Y, +Z, -Z), every texel as 3 floats (RGB)
+struct CubeMapData
+{
+	int faceSize = 0;
+	std::vector<float> texels;
+};
+
+struct IBLMaps
+{
+	// specular mip m is prefiltered for roughness m / (mipCount - 1), mip 0 doubles as the skybox
+	std::vector<CubeMapData> specularMips;
+	// irradiance as 9 SH coefficients, already convolved with the cosine lobe and divided by PI
+	glm::vec3 irradianceSH[9];
+};
+
+struct IBLBakeSettings
+{
+	int faceSize = 256;
+	int smallestMipSize = 8;
+	int sampleCount = 128;
+};
+
+class IBLBaker
+{
+public:
+	// loads an equirectangular image (.hdr or LDR) as linear RGB floats
+	static bool LoadEquirect(const std::string& path, std::vector<float>& pixels, int& width, int& height);
+
+	// converts the equirect to a cube pyramid and runs SH projection and GGX prefiltering on the shared thread pool
+	static IBLMaps Bake(const std::vector<float>& pixels, int width, int height, const IBLBakeSettings& settings);
+
+	// split-sum BRDF lookup table, RG floats, x = NdotV, y = roughness
+	static std::vector<float> BakeBrdfLut(int size, int sampleCount);
+
+	// cache file name derived from the source path, its size, its modification time and the bake settings
+	static std::string GetCachePath(const std::string& sourcePath, const IBLBakeSettings& settings);
+	static std::string GetBrdfLutCachePath(int size, int sampleCount);
+
+	static bool ReadCache(const std::string& cachePath, IBLMaps& maps);
+	static bool WriteCache(const std::string& cachePath, const IBLMaps& maps);
+	static bool ReadBrdfLut(const std::string& cachePath, int size, std::vector<float>& lut);
+	static bool WriteBrdfLut(const std::string& cachePath, int size, const std::vector<float>& lut);
+};
+
+#endif // !IBLBAKER_H
@@ -1,12 +1,101 @@
 #include "Mesh.h"
 
-Mesh::Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures)
+#include "MemoryTracker.h"
+
+#include <cstring>
+
+namespace
+{
+    // 8 bytes per step, hashing has to keep up with reimporting large meshes
+    uint64_t HashWords(const void* data, size_t size, uint64_t hash)
+    {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        size_t words = size / 8;
+        for (size_t i = 0; i < words; i++)
+        {
+            uint64_t word;
+            std::memcpy(&word, bytes + i * 8, 8);
+            hash = (hash ^ word) * 0x9E3779B97F4A7C15ull;
+            hash ^= hash >> 29;
+        }
+        for (size_t i = words * 8; i < size; i++)
+            hash = (hash ^ bytes[i]) * 1099511628211ull;
+        return hash ^ size;
+    }
+
+    const char* TEXTURE_TYPE_NAMES[] = { "texture_diffuse", "texture_roughness", "texture_normal", "texture_height" };
+}
+
+const char* GetTextureTypeName(TextureType type)
+{
+    return TEXTURE_TYPE_NAMES[static_cast<int>(type)];
+}
+
+Mesh::Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures, const std::string& name, bool upload)
+{
+    this->vertices = std::move(vertices);
+    this->indices = std::move(indices);
+    this->textures = std::move(textures);
+    this->name = name;
+
+    if (upload)
+        SetUpMesh();
+    else
+    {
+        m_VertexCount = static_cast<unsigned int>(this->vertices.size());
+        m_IndexCount = static_cast<unsigned int>(this->indices.size());
+    }
+}
+
+Mesh::Mesh(GLVertexArray vao, GLBuffer vbo, GLBuffer ebo, unsigned int vertexCount, unsigned int indexCount, const std::string& name)
+    : name(name), VAO(std::move(vao)), VBO(std::move(vbo)), EBO(std::move(ebo)),
+      m_VertexCount(vertexCount), m_IndexCount(indexCount), m_CpuDataReleased(true)
 {
-    this->vertices = vertices;
-    this->indices = indices;
-    this->textures = textures;
+    glBindVertexArray(VAO.Get());
+    glBindBuffer(GL_ARRAY_BUFFER, VBO.Get());
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO.Get());
+    SetUpAttributes();
+    glBindVertexArray(0);
 
-    SetUpMesh();
+    UpdateMemoryUsage();
+}
+
+Mesh::~Mesh()
+{
+    // the buffers are released by their handles through the deletion queue
+    if (m_MemoryId >= 0)
+        MemoryTracker::Get().Unregister(m_MemoryId);
+}
+
+Mesh::Mesh(Mesh&& other) noexcept
+    : vertices(std::move(other.vertices)), indices(std::move(other.indices)), textures(std::move(other.textures)), name(std::move(other.name)),
+      VAO(std::move(other.VAO)), VBO(std::move(other.VBO)), EBO(std::move(other.EBO)),
+      m_VertexCount(other.m_VertexCount), m_IndexCount(other.m_IndexCount), m_CpuDataReleased(other.m_CpuDataReleased), m_MemoryId(other.m_MemoryId)
+{
+    other.m_MemoryId = -1;
+}
+
+Mesh& Mesh::operator=(Mesh&& other) noexcept
+{
+    if (this == &other)
+        return *this;
+
+    if (m_MemoryId >= 0)
+        MemoryTracker::Get().Unregister(m_MemoryId);
+
+    vertices = std::move(other.vertices);
+    indices = std::move(other.indices);
+    textures = std::move(other.textures);
+    name = std::move(other.name);
+    VAO = std::move(other.VAO);
+    VBO = std::move(other.VBO);
+    EBO = std::move(other.EBO);
+    m_VertexCount = other.m_VertexCount;
+    m_IndexCount = other.m_IndexCount;
+    m_CpuDataReleased = other.m_CpuDataReleased;
+    m_MemoryId = other.m_MemoryId;
+    other.m_MemoryId = -1;
+    return *this;
 }
 
 void Mesh::Draw(Shader& shader)
@@ -29,25 +118,107 @@ void Mesh::Draw(Shader& shader)
     //}
     glActiveTexture(GL_TEXTURE0);
 
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+    glBindVertexArray(VAO.Get());
+    glDrawElements(GL_TRIANGLES, m_IndexCount, GL_UNSIGNED_INT, 0);
+    glBindVertexArray(0);
+}
+
+void Mesh::ReleaseCpuData()
+{
+    if (m_CpuDataReleased)
+        return;
+
+    // swap with empty vectors, clear() would keep the capacity
+    std::vector<Vertex>().swap(vertices);
+    std::vector<unsigned int>().swap(indices);
+    m_CpuDataReleased = true;
+    UpdateMemoryUsage();
+}
+
+void Mesh::EnsureCpuData()
+{
+    if (!m_CpuDataReleased)
+        return;
+
+    vertices.resize(m_VertexCount);
+    indices.resize(m_IndexCount);
+
+    glBindBuffer(GL_ARRAY_BUFFER, VBO.Get());
+    glGetBufferSubData(GL_ARRAY_BUFFER, 0, vertices.size() * sizeof(Vertex), vertices.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // the element buffer is part of the VAO state, bind the VAO instead of unbinding it from there
+    glBindVertexArray(VAO.Get());
+    glGetBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, indices.size() * sizeof(unsigned int), indices.data());
     glBindVertexArray(0);
+
+    m_CpuDataReleased = false;
+    UpdateMemoryUsage();
+}
+
+bool Mesh::HasCpuData() const
+{
+    return !m_CpuDataReleased;
+}
+
+uint64_t Mesh::ComputeContentHash() const
+{
+    if (m_CpuDataReleased)
+        return 0;
+
+    uint64_t hash = HashWords(name.data(), name.size(), 14695981039346656037ull);
+    hash = HashWords(vertices.data(), vertices.size() * sizeof(Vertex), hash);
+    hash = HashWords(indices.data(), indices.size() * sizeof(unsigned int), hash);
+    // 0 means unknown
+    return hash == 0 ? 1 : hash;
+}
+
+unsigned int Mesh::GetVertexCount() const
+{
+    return m_VertexCount;
+}
+
+unsigned int Mesh::GetIndexCount() const
+{
+    return m_IndexCount;
+}
+
+void Mesh::UpdateMemoryUsage()
+{
+    size_t cpuBytes = vertices.capacity() * sizeof(Vertex) + indices.capacity() * sizeof(unsigned int);
+    size_t gpuBytes = static_cast<size_t>(m_VertexCount) * sizeof(Vertex) + static_cast<size_t>(m_IndexCount) * sizeof(unsigned int);
+    if (m_MemoryId < 0)
+        m_MemoryId = MemoryTracker::Get().Register(MemoryCategory::Mesh, name.empty() ? "mesh" : name, cpuBytes, gpuBytes);
+    else
+        MemoryTracker::Get().Update(m_MemoryId, cpuBytes, gpuBytes);
 }
 
 void Mesh::SetUpMesh()
 {
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glGenBuffers(1, &EBO);
+    m_VertexCount = static_cast<unsigned int>(vertices.size());
+    m_IndexCount = static_cast<unsigned int>(indices.size());
 
-    glBindVertexArray(VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    VAO = GLVertexArray::Create();
+    VBO = GLBuffer::Create();
+    EBO = GLBuffer::Create();
+
+    glBindVertexArray(VAO.Get());
+    glBindBuffer(GL_ARRAY_BUFFER, VBO.Get());
 
     glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO.Get());
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
 
+    SetUpAttributes();
+
+    glBindVertexArray(0);
+
+    UpdateMemoryUsage();
+}
+
+void Mesh::SetUpAttributes()
+{
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
 
@@ -61,7 +232,5 @@ void Mesh::SetUpMesh()
     glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
 
     glEnableVertexAttribArray(4);
-    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
-
-    glBindVertexArray(0);
+    glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
 }
\ No newline at end of file
@@ -6,8 +6,11 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include "GLResource.h"
 #include "Shader.h"
 
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -30,11 +33,35 @@ struct Vertex {
     float m_Weights[MAX_BONE_INFLUENCE];
 };
 
+// material slot of a texture, an enum so copying a Texture doesn't allocate a name
+enum class TextureType : uint8_t
+{
+    Diffuse,
+    Roughness,
+    Normal,
+    Height,
+    Count
+};
+
+// "texture_diffuse", "texture_roughness", ... as written to reports
+const char* GetTextureTypeName(TextureType type);
+
+// an image stored inside a model file (FBX, GLB), copied out of the importer: the encoded file,
+// or tightly packed RGBA8 texels when width and height are set
+struct EmbeddedTexture
+{
+    std::vector<unsigned char> bytes;
+    int width = 0;
+    int height = 0;
+};
+
 struct Texture
 {
     unsigned int id;
-    std::string type;
+    TextureType type;
     std::string path;
+    // set for images stored inside the model file, the texture palette decodes them from here
+    std::shared_ptr<const EmbeddedTexture> embedded;
 };
 
 class Mesh
@@ -43,15 +70,49 @@ public:
     std::vector<Vertex>       vertices;
     std::vector<unsigned int> indices;
     std::vector<Texture>      textures;
+    std::string               name;
 
-    Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures);
+    // upload = false keeps the mesh in system memory only (headless tools), such a mesh is never drawn
+    Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures, const std::string& name = "", bool upload = true);
+    // adopts buffers that were filled in place (vertices in the Vertex layout, 32-bit indices),
+    // there is no system memory copy until EnsureCpuData
+    Mesh(GLVertexArray vao, GLBuffer vbo, GLBuffer ebo, unsigned int vertexCount, unsigned int indexCount, const std::string& name = "");
+    ~Mesh();
+
+    // the GL buffers are owned by the mesh, it can be moved but not copied
+    Mesh(Mesh&& other) noexcept;
+    Mesh& operator=(Mesh&& other) noexcept;
 
     void Draw(Shader& shader);
 
+    // drops the system memory copy of vertices and indices, the GL buffers keep the geometry
+    void ReleaseCpuData();
+    // reads vertices and indices back from the GL buffers if they were released (render thread only)
+    void EnsureCpuData();
+    bool HasCpuData() const;
+
+    // hash of name, vertices and indices, equal hashes mean the GL buffers can be shared. needs the CPU data (0 without)
+    uint64_t ComputeContentHash() const;
+
+    unsigned int GetVertexCount() const;
+    unsigned int GetIndexCount() const;
+
 public:
-    unsigned int VAO, VBO, EBO;
+    GLVertexArray VAO;
+    GLBuffer VBO, EBO;
 
     void SetUpMesh();
+
+private:
+    // vertex attribute layout of the bound VAO and GL_ARRAY_BUFFER
+    void SetUpAttributes();
+    void UpdateMemoryUsage();
+
+private:
+    unsigned int m_VertexCount = 0;
+    unsigned int m_IndexCount = 0;
+    bool m_CpuDataReleased = false;
+    int m_MemoryId = -1;
 };
 
 #endif // !MESH_H
\ No newline at end of file
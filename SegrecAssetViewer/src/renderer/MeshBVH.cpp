@@ -0,0 +1,916 @@
+#include "MeshBVH.h"
+
+#include "Simd.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+#include <mutex>
+
+namespace
+{
+	const uint32_t LEAF_SIZE = 4;
+	const int BIN_COUNT = 16;
+	// ranges above this split their scans and subtrees across the pool
+	const uint32_t PARALLEL_THRESHOLD = 65536;
+	const size_t SCAN_GRAIN = 16384;
+	// deeper splits take the median, which bounds the tree depth and with it the traversal stack
+	const int MAX_SAH_DEPTH = 48;
+	const int STACK_SIZE = 256;
+
+	struct Bounds
+	{
+		glm::vec3 min = glm::vec3(FLT_MAX);
+		glm::vec3 max = glm::vec3(-FLT_MAX);
+
+		// per component, glm's vector min/max goes through a function pointer and does not inline well
+		void Grow(const glm::vec3& point)
+		{
+			for (int axis = 0; axis < 3; axis++)
+			{
+				min[axis] = std::min(min[axis], point[axis]);
+				max[axis] = std::max(max[axis], point[axis]);
+			}
+		}
+
+		void Grow(const Bounds& other)
+		{
+			for (int axis = 0; axis < 3; axis++)
+			{
+				min[axis] = std::min(min[axis], other.min[axis]);
+				max[axis] = std::max(max[axis], other.max[axis]);
+			}
+		}
+
+		// half the surface area, the factor cancels out in the SAH
+		float Area() const
+		{
+			if (min.x > max.x)
+				return 0.0f;
+			glm::vec3 size = max - min;
+			return size.x * size.y + size.y * size.z + size.z * size.x;
+		}
+	};
+
+	struct BuildNode
+	{
+		Bounds bounds;
+		// leaf: first entry in the triangle order, inner: left child (the right one follows it)
+		uint32_t first = 0;
+		// 0 for inner nodes
+		uint32_t count = 0;
+	};
+
+	struct Bin
+	{
+		Bounds bounds;
+		uint32_t count = 0;
+	};
+
+	// leaves are tested four triangles at a time, so the SAH counts blocks instead of triangles
+	float BlockCount(uint32_t count)
+	{
+		return static_cast<float>((count + LEAF_SIZE - 1) / LEAF_SIZE);
+	}
+
+	// zero length edges of degenerate triangles project onto their start point
+	const float MIN_EDGE_SQUARED = 1e-30f;
+
+	// closest point of the triangle v0, v0 + e1, v0 + e2: the projection onto its plane when that falls inside,
+	// otherwise the closest point of the nearest edge. DistanceBlock does the same on four triangles
+	glm::vec3 ClosestOnTriangle(const glm::vec3& point, const glm::vec3& v0, const glm::vec3& e1, const glm::vec3& e2)
+	{
+		glm::vec3 w = point - v0;
+		float d00 = glm::dot(e1, e1), d01 = glm::dot(e1, e2), d11 = glm::dot(e2, e2);
+		float d20 = glm::dot(w, e1), d21 = glm::dot(w, e2);
+		// barycentrics of the projection scaled by the denominator, which is the squared length of e1 x e2
+		float denominator = d00 * d11 - d01 * d01;
+		float u = d11 * d20 - d01 * d21;
+		float v = d00 * d21 - d01 * d20;
+		if (denominator > 0.0f && u >= 0.0f && v >= 0.0f && u + v <= denominator)
+			return v0 + (e1 * u + e2 * v) / denominator;
+
+		glm::vec3 starts[3] = { v0, v0, v0 + e1 };
+		glm::vec3 edges[3] = { e1, e2, e2 - e1 };
+		glm::vec3 closest = v0;
+		float closestSquared = FLT_MAX;
+		for (int i = 0; i < 3; i++)
+		{
+			float t = std::clamp(glm::dot(point - starts[i], edges[i]) / std::max(glm::dot(edges[i], edges[i]), MIN_EDGE_SQUARED), 0.0f, 1.0f);
+			glm::vec3 candidate = starts[i] + edges[i] * t;
+			float squared = glm::dot(point - candidate, point - candidate);
+			if (squared < closestSquared)
+			{
+				closestSquared = squared;
+				closest = candidate;
+			}
+		}
+		return closest;
+	}
+
+#if SIMD_SSE2
+	__m128 Dot(__m128 ax, __m128 ay, __m128 az, __m128 bx, __m128 by, __m128 bz)
+	{
+		return _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by)), _mm_mul_ps(az, bz));
+	}
+
+	// squared distance from the start of the segment offset by s to the segment along d, sd and dd are s.d and d.d
+	__m128 SegmentDistanceSquared(__m128 sx, __m128 sy, __m128 sz, __m128 dx, __m128 dy, __m128 dz, __m128 sd, __m128 dd)
+	{
+		__m128 t = _mm_div_ps(sd, _mm_max_ps(dd, _mm_set1_ps(MIN_EDGE_SQUARED)));
+		t = _mm_min_ps(_mm_max_ps(t, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+		__m128 rx = _mm_sub_ps(sx, _mm_mul_ps(dx, t));
+		__m128 ry = _mm_sub_ps(sy, _mm_mul_ps(dy, t));
+		__m128 rz = _mm_sub_ps(sz, _mm_mul_ps(dz, t));
+		return Dot(rx, ry, rz, rx, ry, rz);
+	}
+#endif
+}
+
+// binned SAH build into a binary tree, collapsed into the 4-wide layout afterwards
+class BVHBuilder
+{
+public:
+	BVHBuilder(const std::vector<glm::vec3>& positions, const std::vector<unsigned int>& indices, MeshBVH& bvh)
+		: m_Positions(positions), m_Indices(indices), m_Bvh(bvh)
+	{
+	}
+
+	void Build()
+	{
+		size_t triangleCount = m_Indices.size() / 3;
+		m_TriangleBounds.resize(triangleCount);
+		m_Centroids.resize(triangleCount);
+		std::vector<char> valid(triangleCount, 0);
+		ThreadPool::Get().ParallelFor(0, triangleCount, SCAN_GRAIN, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				const unsigned int* triangle = &m_Indices[i * 3];
+				if (triangle[0] >= m_Positions.size() || triangle[1] >= m_Positions.size() || triangle[2] >= m_Positions.size())
+					continue;
+				Bounds bounds;
+				for (int corner = 0; corner < 3; corner++)
+					bounds.Grow(m_Positions[triangle[corner]]);
+				// NaN or infinite positions would break the bounds and the centroid ordering
+				glm::vec3 size = bounds.max - bounds.min;
+				if (!std::isfinite(size.x + size.y + size.z + bounds.min.x + bounds.min.y + bounds.min.z))
+					continue;
+				m_TriangleBounds[i] = bounds;
+				m_Centroids[i] = (bounds.min + bounds.max) * 0.5f;
+				valid[i] = 1;
+			}
+		});
+
+		m_Order.reserve(triangleCount);
+		for (size_t i = 0; i < triangleCount; i++)
+		{
+			if (valid[i])
+				m_Order.push_back(static_cast<uint32_t>(i));
+		}
+		if (m_Order.empty())
+			return;
+
+		// a binary tree with at least one triangle per leaf has fewer than 2n nodes
+		uint32_t count = static_cast<uint32_t>(m_Order.size());
+		m_Nodes.resize(static_cast<size_t>(count) * 2);
+		m_NodeCount = 1;
+		BuildRecursive(0, 0, count, 0);
+
+		m_Bvh.m_TriangleCount = count;
+		m_Bvh.m_BoundsMin = m_Nodes[0].bounds.min;
+		m_Bvh.m_BoundsMax = m_Nodes[0].bounds.max;
+		m_Bvh.m_Nodes.reserve(count / 3 + 1);
+		m_Bvh.m_Blocks.reserve(count / 2 + 1);
+		Collapse(0);
+	}
+
+private:
+	void BuildRecursive(uint32_t nodeIndex, uint32_t first, uint32_t count, int depth)
+	{
+		// the node array is never resized during the build, references stay valid across threads
+		BuildNode& node = m_Nodes[nodeIndex];
+		Bounds centroidBounds;
+		ComputeBounds(first, count, node.bounds, centroidBounds);
+		if (count <= LEAF_SIZE)
+		{
+			node.first = first;
+			node.count = count;
+			return;
+		}
+
+		glm::vec3 extent = centroidBounds.max - centroidBounds.min;
+		int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+		uint32_t leftCount = 0;
+		if (extent[axis] > 0.0f && depth < MAX_SAH_DEPTH)
+			leftCount = SplitSah(first, count, axis, centroidBounds);
+		if (leftCount == 0 || leftCount == count)
+		{
+			// coincident centroids or too deep, halve the range
+			leftCount = count / 2;
+			if (extent[axis] > 0.0f)
+			{
+				std::nth_element(m_Order.begin() + first, m_Order.begin() + first + leftCount, m_Order.begin() + first + count,
+					[this, axis](uint32_t a, uint32_t b) { return m_Centroids[a][axis] < m_Centroids[b][axis]; });
+			}
+		}
+
+		uint32_t left = m_NodeCount.fetch_add(2);
+		node.first = left;
+		node.count = 0;
+
+		auto buildChild = [&](size_t child)
+		{
+			if (child == 0)
+				BuildRecursive(left, first, leftCount, depth + 1);
+			else
+				BuildRecursive(left + 1, first + leftCount, count - leftCount, depth + 1);
+		};
+		if (count > PARALLEL_THRESHOLD)
+		{
+			ThreadPool::Get().ParallelFor(0, 2, 1, [&](size_t begin, size_t end)
+			{
+				for (size_t child = begin; child < end; child++)
+					buildChild(child);
+			});
+		}
+		else
+		{
+			buildChild(0);
+			buildChild(1);
+		}
+	}
+
+	void ComputeBounds(uint32_t first, uint32_t count, Bounds& bounds, Bounds& centroidBounds) const
+	{
+		auto scan = [this](size_t begin, size_t end, Bounds& outBounds, Bounds& outCentroids)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				uint32_t triangle = m_Order[i];
+				outBounds.Grow(m_TriangleBounds[triangle]);
+				outCentroids.Grow(m_Centroids[triangle]);
+			}
+		};
+
+		if (count <= PARALLEL_THRESHOLD)
+		{
+			scan(first, first + count, bounds, centroidBounds);
+			return;
+		}
+
+		std::mutex mutex;
+		ThreadPool::Get().ParallelFor(first, first + count, SCAN_GRAIN, [&](size_t begin, size_t end)
+		{
+			Bounds chunkBounds, chunkCentroids;
+			scan(begin, end, chunkBounds, chunkCentroids);
+			std::lock_guard<std::mutex> lock(mutex);
+			bounds.Grow(chunkBounds);
+			centroidBounds.Grow(chunkCentroids);
+		});
+	}
+
+	// partitions the range at the cheapest bin boundary, returns the size of the left side (0 if there is no valid split)
+	uint32_t SplitSah(uint32_t first, uint32_t count, int axis, const Bounds& centroidBounds)
+	{
+		float axisMin = centroidBounds.min[axis];
+		float scale = BIN_COUNT / (centroidBounds.max[axis] - axisMin);
+		if (!std::isfinite(scale))
+			return 0;
+		auto binOf = [this, axis, axisMin, scale](uint32_t triangle)
+		{
+			float bin = (m_Centroids[triangle][axis] - axisMin) * scale;
+			return bin > 0.0f ? std::min(static_cast<int>(bin), BIN_COUNT - 1) : 0;
+		};
+
+		Bin bins[BIN_COUNT];
+		auto fill = [&](size_t begin, size_t end, Bin* target)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				uint32_t triangle = m_Order[i];
+				Bin& bin = target[binOf(triangle)];
+				bin.bounds.Grow(m_TriangleBounds[triangle]);
+				bin.count++;
+			}
+		};
+		if (count <= PARALLEL_THRESHOLD)
+			fill(first, first + count, bins);
+		else
+		{
+			std::mutex mutex;
+			ThreadPool::Get().ParallelFor(first, first + count, SCAN_GRAIN, [&](size_t begin, size_t end)
+			{
+				Bin chunkBins[BIN_COUNT];
+				fill(begin, end, chunkBins);
+				std::lock_guard<std::mutex> lock(mutex);
+				for (int i = 0; i < BIN_COUNT; i++)
+				{
+					bins[i].bounds.Grow(chunkBins[i].bounds);
+					bins[i].count += chunkBins[i].count;
+				}
+			});
+		}
+
+		// sweep from the right, then from the left evaluating every boundary
+		float rightCost[BIN_COUNT];
+		Bounds accumulated;
+		uint32_t accumulatedCount = 0;
+		for (int i = BIN_COUNT - 1; i > 0; i--)
+		{
+			accumulated.Grow(bins[i].bounds);
+			accumulatedCount += bins[i].count;
+			rightCost[i] = accumulated.Area() * BlockCount(accumulatedCount);
+		}
+
+		int bestBin = -1;
+		float bestCost = FLT_MAX;
+		accumulated = Bounds();
+		accumulatedCount = 0;
+		for (int i = 0; i < BIN_COUNT - 1; i++)
+		{
+			accumulated.Grow(bins[i].bounds);
+			accumulatedCount += bins[i].count;
+			if (accumulatedCount == 0 || accumulatedCount == count)
+				continue;
+			float cost = accumulated.Area() * BlockCount(accumulatedCount) + rightCost[i + 1];
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestBin = i;
+			}
+		}
+		if (bestBin < 0)
+			return 0;
+
+		auto middle = std::partition(m_Order.begin() + first, m_Order.begin() + first + count,
+			[&binOf, bestBin](uint32_t triangle) { return binOf(triangle) <= bestBin; });
+		return static_cast<uint32_t>(middle - (m_Order.begin() + first));
+	}
+
+	// turns a binary node into a 4-wide node by pulling up grandchildren, returns its index
+	int32_t Collapse(uint32_t binaryIndex)
+	{
+		int32_t nodeIndex = static_cast<int32_t>(m_Bvh.m_Nodes.size());
+		m_Bvh.m_Nodes.emplace_back();
+
+		uint32_t children[4];
+		int childCount = 0;
+		const BuildNode& binary = m_Nodes[binaryIndex];
+		if (binary.count > 0)
+			children[childCount++] = binaryIndex;   // the whole tree is a single leaf
+		else
+		{
+			children[childCount++] = binary.first;
+			children[childCount++] = binary.first + 1;
+		}
+
+		// open the largest inner child until the node is full
+		while (childCount < 4)
+		{
+			int largest = -1;
+			float largestArea = -1.0f;
+			for (int i = 0; i < childCount; i++)
+			{
+				const BuildNode& child = m_Nodes[children[i]];
+				if (child.count == 0 && child.bounds.Area() > largestArea)
+				{
+					largest = i;
+					largestArea = child.bounds.Area();
+				}
+			}
+			if (largest < 0)
+				break;
+			uint32_t opened = m_Nodes[children[largest]].first;
+			children[largest] = opened;
+			children[childCount++] = opened + 1;
+		}
+
+		MeshBVH::Node node;
+		node.childCount = childCount;
+		for (int i = 0; i < 4; i++)
+		{
+			Bounds bounds;
+			node.children[i] = 0;
+			if (i < childCount)
+			{
+				const BuildNode& child = m_Nodes[children[i]];
+				bounds = child.bounds;
+				node.children[i] = child.count > 0 ? ~EmitBlock(child) : Collapse(children[i]);
+			}
+			for (int axis = 0; axis < 3; axis++)
+			{
+				node.bounds[axis][i] = bounds.min[axis];
+				node.bounds[axis + 3][i] = bounds.max[axis];
+			}
+		}
+		m_Bvh.m_Nodes[nodeIndex] = node;
+		return nodeIndex;
+	}
+
+	int32_t EmitBlock(const BuildNode& leaf)
+	{
+		MeshBVH::TriangleBlock block = {};
+		for (uint32_t lane = 0; lane < LEAF_SIZE; lane++)
+		{
+			block.ids[lane] = -1;
+			if (lane >= leaf.count)
+				continue;
+			uint32_t triangle = m_Order[leaf.first + lane];
+			const unsigned int* corners = &m_Indices[static_cast<size_t>(triangle) * 3];
+			glm::vec3 v0 = m_Positions[corners[0]];
+			glm::vec3 e1 = m_Positions[corners[1]] - v0;
+			glm::vec3 e2 = m_Positions[corners[2]] - v0;
+			for (int axis = 0; axis < 3; axis++)
+			{
+				block.v0[axis][lane] = v0[axis];
+				block.e1[axis][lane] = e1[axis];
+				block.e2[axis][lane] = e2[axis];
+			}
+			block.ids[lane] = static_cast<int32_t>(triangle);
+		}
+		m_Bvh.m_Blocks.push_back(block);
+		return static_cast<int32_t>(m_Bvh.m_Blocks.size() - 1);
+	}
+
+private:
+	const std::vector<glm::vec3>& m_Positions;
+	const std::vector<unsigned int>& m_Indices;
+	MeshBVH& m_Bvh;
+
+	std::vector<Bounds> m_TriangleBounds;
+	std::vector<glm::vec3> m_Centroids;
+	std::vector<uint32_t> m_Order;
+	std::vector<BuildNode> m_Nodes;
+	std::atomic<uint32_t> m_NodeCount{ 0 };
+};
+
+void MeshBVH::Build(const std::vector<glm::vec3>& positions, const std::vector<unsigned int>& indices)
+{
+	m_Nodes.clear();
+	m_Blocks.clear();
+	m_TriangleCount = 0;
+	m_BoundsMin = m_BoundsMax = glm::vec3(0.0f);
+
+	BVHBuilder builder(positions, indices, *this);
+	builder.Build();
+}
+
+bool MeshBVH::Intersect(const glm::vec3& origin, const glm::vec3& direction, float tMin, float tMax, RayHit& hit) const
+{
+	if (m_Nodes.empty())
+		return false;
+
+	// a zero component would divide by zero in the slab test, a tiny one keeps the math finite
+	glm::vec3 inverseDirection;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		float component = direction[axis];
+		if (std::fabs(component) < 1e-20f)
+			component = component < 0.0f ? -1e-20f : 1e-20f;
+		inverseDirection[axis] = 1.0f / component;
+	}
+
+	struct StackEntry
+	{
+		int32_t reference;
+		float distance;
+	};
+	StackEntry stack[STACK_SIZE];
+	int stackSize = 0;
+	stack[stackSize++] = { 0, tMin };
+
+	float closest = tMax;
+	int32_t hitBlock = -1;
+	int hitLane = 0;
+	glm::vec2 hitBarycentric(0.0f);
+	while (stackSize > 0)
+	{
+		StackEntry entry = stack[--stackSize];
+		if (entry.distance > closest)
+			continue;
+
+		if (entry.reference < 0)
+		{
+			int lane;
+			glm::vec2 barycentric;
+			if (IntersectBlock(m_Blocks[~entry.reference], origin, direction, tMin, closest, lane, barycentric))
+			{
+				hitBlock = ~entry.reference;
+				hitLane = lane;
+				hitBarycentric = barycentric;
+			}
+			continue;
+		}
+
+		const Node& node = m_Nodes[entry.reference];
+		float entries[4];
+		int mask = IntersectNode(node, origin, inverseDirection, tMin, closest, entries);
+		if (mask == 0)
+			continue;
+
+		// sorted far to near, the nearest child is popped first
+		int order[4];
+		int hits = 0;
+		for (int i = 0; i < 4; i++)
+		{
+			if (!(mask & (1 << i)))
+				continue;
+			int position = hits++;
+			while (position > 0 && entries[order[position - 1]] < entries[i])
+			{
+				order[position] = order[position - 1];
+				position--;
+			}
+			order[position] = i;
+		}
+		for (int i = 0; i < hits; i++)
+			stack[stackSize++] = { node.children[order[i]], entries[order[i]] };
+	}
+
+	if (hitBlock < 0)
+		return false;
+	FillHit(m_Blocks[hitBlock], hitLane, closest, hitBarycentric, hit);
+	return true;
+}
+
+bool MeshBVH::IntersectBruteForce(const glm::vec3& origin, const glm::vec3& direction, float tMin, float tMax, RayHit& hit) const
+{
+	float closest = tMax;
+	int32_t hitBlock = -1;
+	int hitLane = 0;
+	glm::vec2 hitBarycentric(0.0f);
+	for (size_t i = 0; i < m_Blocks.size(); i++)
+	{
+		int lane;
+		glm::vec2 barycentric;
+		if (IntersectBlock(m_Blocks[i], origin, direction, tMin, closest, lane, barycentric))
+		{
+			hitBlock = static_cast<int32_t>(i);
+			hitLane = lane;
+			hitBarycentric = barycentric;
+		}
+	}
+
+	if (hitBlock < 0)
+		return false;
+	FillHit(m_Blocks[hitBlock], hitLane, closest, hitBarycentric, hit);
+	return true;
+}
+
+bool MeshBVH::ClosestPoint(const glm::vec3& point, float maxDistance, PointHit& hit) const
+{
+	if (m_Nodes.empty())
+		return false;
+
+	struct StackEntry
+	{
+		int32_t reference;
+		float distanceSquared;
+	};
+	StackEntry stack[STACK_SIZE];
+	int stackSize = 0;
+	stack[stackSize++] = { 0, 0.0f };
+
+	// unused block lanes sit at FLT_MAX, an unbounded query must not reach them
+	float closestSquared = std::min(maxDistance * maxDistance, FLT_MAX);
+	int32_t hitBlock = -1;
+	int hitLane = 0;
+	while (stackSize > 0)
+	{
+		StackEntry entry = stack[--stackSize];
+		if (entry.distanceSquared >= closestSquared)
+			continue;
+
+		if (entry.reference < 0)
+		{
+			int lane;
+			if (DistanceBlock(m_Blocks[~entry.reference], point, closestSquared, lane))
+			{
+				hitBlock = ~entry.reference;
+				hitLane = lane;
+			}
+			continue;
+		}
+
+		const Node& node = m_Nodes[entry.reference];
+		float distances[4];
+		int mask = DistanceNode(node, point, closestSquared, distances);
+		if (mask == 0)
+			continue;
+
+		// sorted far to near, the nearest child is popped first and shrinks the radius for the others
+		int order[4];
+		int hits = 0;
+		for (int i = 0; i < 4; i++)
+		{
+			if (!(mask & (1 << i)))
+				continue;
+			int position = hits++;
+			while (position > 0 && distances[order[position - 1]] < distances[i])
+			{
+				order[position] = order[position - 1];
+				position--;
+			}
+			order[position] = i;
+		}
+		for (int i = 0; i < hits; i++)
+			stack[stackSize++] = { node.children[order[i]], distances[order[i]] };
+	}
+
+	if (hitBlock < 0)
+		return false;
+	const TriangleBlock& block = m_Blocks[hitBlock];
+	glm::vec3 v0(block.v0[0][hitLane], block.v0[1][hitLane], block.v0[2][hitLane]);
+	glm::vec3 e1(block.e1[0][hitLane], block.e1[1][hitLane], block.e1[2][hitLane]);
+	glm::vec3 e2(block.e2[0][hitLane], block.e2[1][hitLane], block.e2[2][hitLane]);
+	hit.triangle = static_cast<unsigned int>(block.ids[hitLane]);
+	hit.position = ClosestOnTriangle(point, v0, e1, e2);
+	hit.distance = glm::length(point - hit.position);
+	glm::vec3 normal = glm::cross(e1, e2);
+	float length = glm::length(normal);
+	hit.normal = length > 0.0f ? normal / length : glm::vec3(0.0f, 0.0f, 1.0f);
+	return true;
+}
+
+int MeshBVH::IntersectNode(const Node& node, const glm::vec3& origin, const glm::vec3& inverseDirection, float tMin, float closest, float entries[4])
+{
+	int validMask = (1 << node.childCount) - 1;
+#if SIMD_SSE2
+	__m128 entry = _mm_set1_ps(tMin);
+	__m128 exit = _mm_set1_ps(closest);
+	for (int axis = 0; axis < 3; axis++)
+	{
+		__m128 o = _mm_set1_ps(origin[axis]);
+		__m128 inverse = _mm_set1_ps(inverseDirection[axis]);
+		__m128 t0 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.bounds[axis]), o), inverse);
+		__m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.bounds[axis + 3]), o), inverse);
+		entry = _mm_max_ps(entry, _mm_min_ps(t0, t1));
+		exit = _mm_min_ps(exit, _mm_max_ps(t0, t1));
+	}
+	_mm_storeu_ps(entries, entry);
+	return _mm_movemask_ps(_mm_cmple_ps(entry, exit)) & validMask;
+#else
+	int mask = 0;
+	for (int i = 0; i < 4; i++)
+	{
+		float entry = tMin;
+		float exit = closest;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			float t0 = (node.bounds[axis][i] - origin[axis]) * inverseDirection[axis];
+			float t1 = (node.bounds[axis + 3][i] - origin[axis]) * inverseDirection[axis];
+			entry = std::max(entry, std::min(t0, t1));
+			exit = std::min(exit, std::max(t0, t1));
+		}
+		entries[i] = entry;
+		if (entry <= exit)
+			mask |= 1 << i;
+	}
+	return mask & validMask;
+#endif
+}
+
+bool MeshBVH::IntersectBlock(const TriangleBlock& block, const glm::vec3& origin, const glm::vec3& direction, float tMin, float& closest, int& lane, glm::vec2& barycentric)
+{
+	// Moller-Trumbore on four triangles, unused lanes have a zero determinant and never hit
+	float distances[4], us[4], vs[4];
+	int mask;
+#if SIMD_SSE2
+	__m128 dx = _mm_set1_ps(direction.x), dy = _mm_set1_ps(direction.y), dz = _mm_set1_ps(direction.z);
+	__m128 e1x = _mm_loadu_ps(block.e1[0]), e1y = _mm_loadu_ps(block.e1[1]), e1z = _mm_loadu_ps(block.e1[2]);
+	__m128 e2x = _mm_loadu_ps(block.e2[0]), e2y = _mm_loadu_ps(block.e2[1]), e2z = _mm_loadu_ps(block.e2[2]);
+
+	// p = d x e2
+	__m128 px = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+	__m128 py = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+	__m128 pz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+	__m128 determinant = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+	__m128 inverseDeterminant = _mm_div_ps(_mm_set1_ps(1.0f), determinant);
+
+	// s = o - v0
+	__m128 sx = _mm_sub_ps(_mm_set1_ps(origin.x), _mm_loadu_ps(block.v0[0]));
+	__m128 sy = _mm_sub_ps(_mm_set1_ps(origin.y), _mm_loadu_ps(block.v0[1]));
+	__m128 sz = _mm_sub_ps(_mm_set1_ps(origin.z), _mm_loadu_ps(block.v0[2]));
+	__m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, px), _mm_mul_ps(sy, py)), _mm_mul_ps(sz, pz)), inverseDeterminant);
+
+	// q = s x e1
+	__m128 qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+	__m128 qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+	__m128 qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+	__m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz)), inverseDeterminant);
+	__m128 t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), inverseDeterminant);
+
+	__m128 zero = _mm_setzero_ps();
+	__m128 hits = _mm_cmpneq_ps(determinant, zero);
+	hits = _mm_and_ps(hits, _mm_cmpge_ps(u, zero));
+	hits = _mm_and_ps(hits, _mm_cmpge_ps(v, zero));
+	hits = _mm_and_ps(hits, _mm_cmple_ps(_mm_add_ps(u, v), _mm_set1_ps(1.0f)));
+	hits = _mm_and_ps(hits, _mm_cmpge_ps(t, _mm_set1_ps(tMin)));
+	hits = _mm_and_ps(hits, _mm_cmplt_ps(t, _mm_set1_ps(closest)));
+	mask = _mm_movemask_ps(hits);
+	if (mask == 0)
+		return false;
+	_mm_storeu_ps(distances, t);
+	_mm_storeu_ps(us, u);
+	_mm_storeu_ps(vs, v);
+#else
+	mask = 0;
+	for (int i = 0; i < 4; i++)
+	{
+		glm::vec3 e1(block.e1[0][i], block.e1[1][i], block.e1[2][i]);
+		glm::vec3 e2(block.e2[0][i], block.e2[1][i], block.e2[2][i]);
+		glm::vec3 p = glm::cross(direction, e2);
+		float determinant = glm::dot(e1, p);
+		if (determinant == 0.0f)
+			continue;
+		float inverseDeterminant = 1.0f / determinant;
+		glm::vec3 s = origin - glm::vec3(block.v0[0][i], block.v0[1][i], block.v0[2][i]);
+		glm::vec3 q = glm::cross(s, e1);
+		us[i] = glm::dot(s, p) * inverseDeterminant;
+		vs[i] = glm::dot(direction, q) * inverseDeterminant;
+		distances[i] = glm::dot(e2, q) * inverseDeterminant;
+		if (us[i] >= 0.0f && vs[i] >= 0.0f && us[i] + vs[i] <= 1.0f && distances[i] >= tMin && distances[i] < closest)
+			mask |= 1 << i;
+	}
+	if (mask == 0)
+		return false;
+#endif
+
+	lane = -1;
+	for (int i = 0; i < 4; i++)
+	{
+		if ((mask & (1 << i)) && (lane < 0 || distances[i] < distances[lane]))
+			lane = i;
+	}
+	closest = distances[lane];
+	barycentric = glm::vec2(us[lane], vs[lane]);
+	return true;
+}
+
+int MeshBVH::DistanceNode(const Node& node, const glm::vec3& point, float closestSquared, float distances[4])
+{
+	int validMask = (1 << node.childCount) - 1;
+#if SIMD_SSE2
+	__m128 sum = _mm_setzero_ps();
+	__m128 zero = _mm_setzero_ps();
+	for (int axis = 0; axis < 3; axis++)
+	{
+		// outside the slab on either side, zero inside it
+		__m128 p = _mm_set1_ps(point[axis]);
+		__m128 below = _mm_sub_ps(_mm_loadu_ps(node.bounds[axis]), p);
+		__m128 above = _mm_sub_ps(p, _mm_loadu_ps(node.bounds[axis + 3]));
+		__m128 outside = _mm_max_ps(_mm_max_ps(below, above), zero);
+		sum = _mm_add_ps(sum, _mm_mul_ps(outside, outside));
+	}
+	_mm_storeu_ps(distances, sum);
+	return _mm_movemask_ps(_mm_cmplt_ps(sum, _mm_set1_ps(closestSquared))) & validMask;
+#else
+	int mask = 0;
+	for (int i = 0; i < 4; i++)
+	{
+		float sum = 0.0f;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			float outside = std::max(std::max(node.bounds[axis][i] - point[axis], point[axis] - node.bounds[axis + 3][i]), 0.0f);
+			sum += outside * outside;
+		}
+		distances[i] = sum;
+		if (sum < closestSquared)
+			mask |= 1 << i;
+	}
+	return mask & validMask;
+#endif
+}
+
+bool MeshBVH::DistanceBlock(const TriangleBlock& block, const glm::vec3& point, float& closestSquared, int& lane)
+{
+	float distances[4];
+	int mask;
+#if SIMD_SSE2
+	__m128 e1x = _mm_loadu_ps(block.e1[0]), e1y = _mm_loadu_ps(block.e1[1]), e1z = _mm_loadu_ps(block.e1[2]);
+	__m128 e2x = _mm_loadu_ps(block.e2[0]), e2y = _mm_loadu_ps(block.e2[1]), e2z = _mm_loadu_ps(block.e2[2]);
+	// w = p - v0
+	__m128 wx = _mm_sub_ps(_mm_set1_ps(point.x), _mm_loadu_ps(block.v0[0]));
+	__m128 wy = _mm_sub_ps(_mm_set1_ps(point.y), _mm_loadu_ps(block.v0[1]));
+	__m128 wz = _mm_sub_ps(_mm_set1_ps(point.z), _mm_loadu_ps(block.v0[2]));
+
+	__m128 d00 = Dot(e1x, e1y, e1z, e1x, e1y, e1z);
+	__m128 d01 = Dot(e1x, e1y, e1z, e2x, e2y, e2z);
+	__m128 d11 = Dot(e2x, e2y, e2z, e2x, e2y, e2z);
+	__m128 d20 = Dot(wx, wy, wz, e1x, e1y, e1z);
+	__m128 d21 = Dot(wx, wy, wz, e2x, e2y, e2z);
+	__m128 denominator = _mm_sub_ps(_mm_mul_ps(d00, d11), _mm_mul_ps(d01, d01));
+	__m128 u = _mm_sub_ps(_mm_mul_ps(d11, d20), _mm_mul_ps(d01, d21));
+	__m128 v = _mm_sub_ps(_mm_mul_ps(d00, d21), _mm_mul_ps(d01, d20));
+
+	// projection onto the plane, only used where it falls inside (degenerate lanes divide by zero and are masked)
+	__m128 zero = _mm_setzero_ps();
+	__m128 inside = _mm_cmpgt_ps(denominator, zero);
+	inside = _mm_and_ps(inside, _mm_cmpge_ps(u, zero));
+	inside = _mm_and_ps(inside, _mm_cmpge_ps(v, zero));
+	inside = _mm_and_ps(inside, _mm_cmple_ps(_mm_add_ps(u, v), denominator));
+	__m128 inverseDenominator = _mm_div_ps(_mm_set1_ps(1.0f), denominator);
+	u = _mm_mul_ps(u, inverseDenominator);
+	v = _mm_mul_ps(v, inverseDenominator);
+	__m128 rx = _mm_sub_ps(wx, _mm_add_ps(_mm_mul_ps(e1x, u), _mm_mul_ps(e2x, v)));
+	__m128 ry = _mm_sub_ps(wy, _mm_add_ps(_mm_mul_ps(e1y, u), _mm_mul_ps(e2y, v)));
+	__m128 rz = _mm_sub_ps(wz, _mm_add_ps(_mm_mul_ps(e1z, u), _mm_mul_ps(e2z, v)));
+	__m128 plane = Dot(rx, ry, rz, rx, ry, rz);
+
+	// the nearest of the three edges v0-v1, v0-v2 and v1-v2
+	__m128 edge = _mm_min_ps(SegmentDistanceSquared(wx, wy, wz, e1x, e1y, e1z, d20, d00),
+		SegmentDistanceSquared(wx, wy, wz, e2x, e2y, e2z, d21, d11));
+	__m128 sx = _mm_sub_ps(wx, e1x), sy = _mm_sub_ps(wy, e1y), sz = _mm_sub_ps(wz, e1z);
+	__m128 e3x = _mm_sub_ps(e2x, e1x), e3y = _mm_sub_ps(e2y, e1y), e3z = _mm_sub_ps(e2z, e1z);
+	edge = _mm_min_ps(edge, SegmentDistanceSquared(sx, sy, sz, e3x, e3y, e3z, Dot(sx, sy, sz, e3x, e3y, e3z), Dot(e3x, e3y, e3z, e3x, e3y, e3z)));
+
+	__m128 distance = _mm_or_ps(_mm_and_ps(inside, plane), _mm_andnot_ps(inside, edge));
+	// unused lanes (id -1) are never closer, neither are triangles without area: like rays they are skipped, they have
+	// no side to tell inside from outside
+	__m128 unused = _mm_castsi128_ps(_mm_cmplt_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(block.ids)), _mm_setzero_si128()));
+	unused = _mm_or_ps(unused, _mm_cmple_ps(denominator, zero));
+	distance = _mm_or_ps(_mm_and_ps(unused, _mm_set1_ps(FLT_MAX)), _mm_andnot_ps(unused, distance));
+	mask = _mm_movemask_ps(_mm_cmplt_ps(distance, _mm_set1_ps(closestSquared)));
+	if (mask == 0)
+		return false;
+	_mm_storeu_ps(distances, distance);
+#else
+	mask = 0;
+	for (int i = 0; i < 4; i++)
+	{
+		glm::vec3 v0(block.v0[0][i], block.v0[1][i], block.v0[2][i]);
+		glm::vec3 e1(block.e1[0][i], block.e1[1][i], block.e1[2][i]);
+		glm::vec3 e2(block.e2[0][i], block.e2[1][i], block.e2[2][i]);
+		float d01 = glm::dot(e1, e2);
+		if (block.ids[i] < 0 || glm::dot(e1, e1) * glm::dot(e2, e2) - d01 * d01 <= 0.0f)
+			continue;
+		glm::vec3 offset = point - ClosestOnTriangle(point, v0, e1, e2);
+		distances[i] = glm::dot(offset, offset);
+		if (distances[i] < closestSquared)
+			mask |= 1 << i;
+	}
+	if (mask == 0)
+		return false;
+#endif
+
+	lane = -1;
+	for (int i = 0; i < 4; i++)
+	{
+		if ((mask & (1 << i)) && (lane < 0 || distances[i] < distances[lane]))
+			lane = i;
+	}
+	closestSquared = distances[lane];
+	return true;
+}
+
+void MeshBVH::FillHit(const TriangleBlock& block, int lane, float distance, const glm::vec2& barycentric, RayHit& hit)
+{
+	glm::vec3 v0(block.v0[0][lane], block.v0[1][lane], block.v0[2][lane]);
+	glm::vec3 e1(block.e1[0][lane], block.e1[1][lane], block.e1[2][lane]);
+	glm::vec3 e2(block.e2[0][lane], block.e2[1][lane], block.e2[2][lane]);
+
+	hit.distance = distance;
+	hit.triangle = static_cast<unsigned int>(block.ids[lane]);
+	hit.barycentric = barycentric;
+	hit.vertices[0] = v0;
+	hit.vertices[1] = v0 + e1;
+	hit.vertices[2] = v0 + e2;
+	// interpolated on the triangle, more precise than origin + distance * direction far from the camera
+	hit.position = v0 + e1 * barycentric.x + e2 * barycentric.y;
+	glm::vec3 normal = glm::cross(e1, e2);
+	float length = glm::length(normal);
+	hit.normal = length > 0.0f ? normal / length : glm::vec3(0.0f, 0.0f, 1.0f);
+}
+
+bool MeshBVH::IsEmpty() const
+{
+	return m_Nodes.empty();
+}
+
+glm::vec3 MeshBVH::GetBoundsMin() const
+{
+	return m_BoundsMin;
+}
+
+glm::vec3 MeshBVH::GetBoundsMax() const
+{
+	return m_BoundsMax;
+}
+
+size_t MeshBVH::GetTriangleCount() const
+{
+	return m_TriangleCount;
+}
+
+size_t MeshBVH::GetNodeCount() const
+{
+	return m_Nodes.size();
+}
+
+size_t MeshBVH::GetMemoryBytes() const
+{
+	return m_Nodes.capacity() * sizeof(Node) + m_Blocks.capacity() * sizeof(TriangleBlock);
+}
@@ -0,0 +1,97 @@
+#ifndef MESHBVH_H
+#define MESHBVH_H
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct RayHit
+{
+	// ray parameter of the hit, in units of the (not necessarily normalized) ray direction
+	float distance = 0.0f;
+	unsigned int mesh = 0;
+	// index of the triangle in the mesh's index list (indices 3 * triangle .. 3 * triangle + 2)
+	unsigned int triangle = 0;
+	// weights of the second and third vertex
+	glm::vec2 barycentric = glm::vec2(0.0f);
+	glm::vec3 position = glm::vec3(0.0f);
+	glm::vec3 normal = glm::vec3(0.0f, 0.0f, 1.0f);
+	glm::vec3 vertices[3];
+};
+
+struct PointHit
+{
+	// to the closest point, not squared
+	float distance = 0.0f;
+	unsigned int triangle = 0;
+	glm::vec3 position = glm::vec3(0.0f);
+	// face normal of the closest triangle, the side of the query point tells inside from outside
+	glm::vec3 normal = glm::vec3(0.0f, 0.0f, 1.0f);
+};
+
+// bounding volume hierarchy over the triangles of one mesh, used for picking, measuring and geometric diffs.
+// built with binned SAH on the thread pool, then collapsed into 4-wide nodes so a single SSE slab test
+// covers all children of a node. leaves hold up to 4 triangles in SoA layout, tested together as well.
+class MeshBVH
+{
+public:
+	// indexed triangle list, the data is copied into the leaves so the inputs can be dropped afterwards
+	void Build(const std::vector<glm::vec3>& positions, const std::vector<unsigned int>& indices);
+
+	// closest hit with distance in [tMin, tMax], both sides of a triangle count
+	bool Intersect(const glm::vec3& origin, const glm::vec3& direction, float tMin, float tMax, RayHit& hit) const;
+	// tests every triangle, reference for validating the traversal
+	bool IntersectBruteForce(const glm::vec3& origin, const glm::vec3& direction, float tMin, float tMax, RayHit& hit) const;
+	// closest point on any triangle no further than maxDistance from the point, triangles without area don't count.
+	// a tight maxDistance (e.g. from a neighbouring query) prunes most of the tree
+	bool ClosestPoint(const glm::vec3& point, float maxDistance, PointHit& hit) const;
+
+	bool IsEmpty() const;
+	glm::vec3 GetBoundsMin() const;
+	glm::vec3 GetBoundsMax() const;
+	size_t GetTriangleCount() const;
+	size_t GetNodeCount() const;
+	size_t GetMemoryBytes() const;
+
+private:
+	// bounds of the four children as min x, y, z, max x, y, z rows
+	struct Node
+	{
+		float bounds[6][4];
+		// >= 0 is a node, < 0 is ~block
+		int32_t children[4];
+		int32_t childCount;
+	};
+
+	// first vertex and both edges of four triangles, unused lanes have zero edges and id -1
+	struct TriangleBlock
+	{
+		float v0[3][4];
+		float e1[3][4];
+		float e2[3][4];
+		int32_t ids[4];
+	};
+
+	friend class BVHBuilder;
+
+	// bit mask of the children whose bounds the ray enters before 'closest', entry distances per child
+	static int IntersectNode(const Node& node, const glm::vec3& origin, const glm::vec3& inverseDirection, float tMin, float closest, float entries[4]);
+	// shortens 'closest' and returns true if a triangle of the block is hit before it
+	static bool IntersectBlock(const TriangleBlock& block, const glm::vec3& origin, const glm::vec3& direction, float tMin, float& closest, int& lane, glm::vec2& barycentric);
+	static void FillHit(const TriangleBlock& block, int lane, float distance, const glm::vec2& barycentric, RayHit& hit);
+	// bit mask of the children whose bounds are closer than sqrt(closestSquared), squared distances per child
+	static int DistanceNode(const Node& node, const glm::vec3& point, float closestSquared, float distances[4]);
+	// shortens 'closestSquared' and returns true if a triangle of the block is closer
+	static bool DistanceBlock(const TriangleBlock& block, const glm::vec3& point, float& closestSquared, int& lane);
+
+private:
+	std::vector<Node> m_Nodes;
+	std::vector<TriangleBlock> m_Blocks;
+	glm::vec3 m_BoundsMin = glm::vec3(0.0f);
+	glm::vec3 m_BoundsMax = glm::vec3(0.0f);
+	size_t m_TriangleCount = 0;
+};
+
+#endif // !MESHBVH_H
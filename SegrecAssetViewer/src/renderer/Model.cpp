@@ -1,36 +1,411 @@
 #include "Model.h"
 
-Model::Model(std::string const& path, bool gamma)
-    : gammaCorrection(gamma)
+#include "AllocationCounter.h"
+#include "ClusterStreamer.h"
+#include "GltfLoader.h"
+#include "MemoryTracker.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <climits>
+#include <cstring>
+#include <memory>
+#include <unordered_map>
+
+namespace
+{
+    const unsigned int BASE_FLAGS = aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace;
+    const unsigned int CLEANUP_FLAGS = aiProcess_FindDegenerates | aiProcess_FindInvalidData | aiProcess_SortByPType;
+
+    // welding replaces aiProcess_JoinIdenticalVertices, which runs single threaded
+    const ImportSettings IMPORT_PRESETS[] = {
+        { "Fast preview", "fast", BASE_FLAGS, false, WeldSettings(), false },
+        { "Full quality", "full", BASE_FLAGS | CLEANUP_FLAGS, true, WeldSettings(), false },
+        { "Skinned", "skinned", BASE_FLAGS | CLEANUP_FLAGS | aiProcess_LimitBoneWeights, true, { 1e-5f, 1e-3f, 1e-5f, true }, true },
+    };
+
+    uint64_t HashBytes(const void* data, size_t size)
+    {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        uint64_t hash = 14695981039346656037ull;
+        size_t words = size / 8;
+        for (size_t i = 0; i < words; i++)
+        {
+            uint64_t word;
+            std::memcpy(&word, bytes + i * 8, 8);
+            hash = (hash ^ word) * 0x9E3779B97F4A7C15ull;
+            hash ^= hash >> 29;
+        }
+        for (size_t i = words * 8; i < size; i++)
+            hash = (hash ^ bytes[i]) * 1099511628211ull;
+        return hash;
+    }
+
+    // a compressed file when mHeight is 0, otherwise mWidth x mHeight texels
+    size_t EmbeddedBytes(const aiTexture* texture)
+    {
+        return texture->mHeight == 0 ? texture->mWidth : static_cast<size_t>(texture->mWidth) * texture->mHeight * sizeof(aiTexel);
+    }
+
+    // kept for the texture palette after the importer is gone: compressed files as they are, the palette decodes them on
+    // the thread pool. raw BGRA texels are swizzled to RGBA
+    std::shared_ptr<const EmbeddedTexture> CopyEmbedded(const aiTexture* texture)
+    {
+        std::shared_ptr<EmbeddedTexture> copy = std::make_shared<EmbeddedTexture>();
+        if (texture->mHeight == 0)
+        {
+            const unsigned char* bytes = reinterpret_cast<const unsigned char*>(texture->pcData);
+            copy->bytes.assign(bytes, bytes + texture->mWidth);
+            return copy;
+        }
+
+        copy->width = static_cast<int>(texture->mWidth);
+        copy->height = static_cast<int>(texture->mHeight);
+        size_t count = static_cast<size_t>(texture->mWidth) * texture->mHeight;
+        copy->bytes.resize(count * 4);
+        for (size_t i = 0; i < count; i++)
+        {
+            const aiTexel& texel = texture->pcData[i];
+            unsigned char* out = &copy->bytes[i * 4];
+            out[0] = texel.r;
+            out[1] = texel.g;
+            out[2] = texel.b;
+            out[3] = texel.a;
+        }
+        return copy;
+    }
+
+}
+
+const ImportSettings& GetImportSettings(ImportPreset preset)
+{
+    return IMPORT_PRESETS[static_cast<int>(preset)];
+}
+
+bool ParseImportPreset(const std::string& id, ImportPreset& preset)
+{
+    for (int i = 0; i < static_cast<int>(ImportPreset::Count); i++)
+    {
+        if (id == IMPORT_PRESETS[i].id)
+        {
+            preset = static_cast<ImportPreset>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+Model::Model(std::string const& path, bool gamma, ModelLoader loader, ImportPreset preset, ModelStorage storage)
+    : gammaCorrection(gamma), preset(preset), m_Storage(storage)
 {
-    loadModel(path);
+    AllocationCounter::ResetPeakResidentBytes();
+    AllocationScope allocations;
+    auto start = std::chrono::steady_clock::now();
+    loadModel(path, loader);
+    loadMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    importAllocations = allocations.GetAllocations();
+    importAllocatedBytes = allocations.GetBytes();
+    peakResidentBytes = AllocationCounter::GetPeakResidentBytes();
+    if (m_Storage == ModelStorage::Gpu)
+        BuildBVHsAsync();
+}
+
+Model::Model()
+    : gammaCorrection(false), preset(ImportPreset::FullQuality), m_Storage(ModelStorage::Gpu)
+{
+}
+
+Model::~Model()
+{
+    // the build job writes into m_BVHs
+    if (m_BVHBuild.valid())
+        m_BVHBuild.wait();
+    if (m_BVHMemoryId >= 0)
+        MemoryTracker::Get().Unregister(m_BVHMemoryId);
 }
 
 void Model::Draw(Shader& shader)
 {
+    if (m_Streamer)
+        m_Streamer->Draw();
     for (unsigned int i = 0; i < meshes.size(); i++)
         meshes[i].Draw(shader);
 }
 
-void Model::loadModel(std::string const& path)
+void Model::ReleaseCpuData()
 {
+    for (unsigned int i = 0; i < meshes.size(); i++)
+        meshes[i].ReleaseCpuData();
+}
+
+void Model::EnsureCpuData()
+{
+    for (unsigned int i = 0; i < meshes.size(); i++)
+        meshes[i].EnsureCpuData();
+}
+
+bool Model::HasCpuData() const
+{
+    for (unsigned int i = 0; i < meshes.size(); i++)
+    {
+        if (!meshes[i].HasCpuData())
+            return false;
+    }
+    return true;
+}
+
+unsigned int Model::GetVertexCount() const
+{
+    unsigned int count = m_Streamer ? static_cast<unsigned int>(std::min<uint64_t>(m_Streamer->GetVertexCount(), UINT_MAX)) : 0;
+    for (unsigned int i = 0; i < meshes.size(); i++)
+        count += meshes[i].GetVertexCount();
+    return count;
+}
+
+unsigned int Model::GetIndexCount() const
+{
+    unsigned int count = m_Streamer ? static_cast<unsigned int>(std::min<uint64_t>(m_Streamer->GetTriangleCount() * 3, UINT_MAX)) : 0;
+    for (unsigned int i = 0; i < meshes.size(); i++)
+        count += meshes[i].GetIndexCount();
+    return count;
+}
+
+std::vector<uint64_t> Model::ComputeMeshHashes()
+{
+    std::vector<bool> released(meshes.size());
+    for (size_t i = 0; i < meshes.size(); i++)
+    {
+        released[i] = !meshes[i].HasCpuData();
+        if (released[i])
+            meshes[i].EnsureCpuData();
+    }
+
+    std::vector<uint64_t> hashes(meshes.size());
+    ThreadPool::Get().ParallelFor(0, meshes.size(), 1, [this, &hashes](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; i++)
+            hashes[i] = meshes[i].ComputeContentHash();
+    });
+
+    for (size_t i = 0; i < meshes.size(); i++)
+    {
+        if (released[i])
+            meshes[i].ReleaseCpuData();
+    }
+    return hashes;
+}
+
+unsigned int Model::AdoptGpuData(Model& previous, const std::vector<uint64_t>& hashes, const std::vector<uint64_t>& previousHashes)
+{
+    // the previous model's BVH job only works on copies, its meshes can be taken right away
+    std::unordered_multimap<uint64_t, size_t> reusable;
+    for (size_t i = 0; i < previous.meshes.size() && i < previousHashes.size(); i++)
+    {
+        if (previousHashes[i] != 0)
+            reusable.emplace(previousHashes[i], i);
+    }
+
+    unsigned int uploaded = 0;
+    for (size_t i = 0; i < meshes.size(); i++)
+    {
+        auto found = i < hashes.size() && hashes[i] != 0 ? reusable.find(hashes[i]) : reusable.end();
+        if (found != reusable.end())
+        {
+            // the textures of the previous mesh belong to the previous model, this import's references stay
+            std::vector<Texture> textures = std::move(meshes[i].textures);
+            meshes[i] = std::move(previous.meshes[found->second]);
+            meshes[i].textures = std::move(textures);
+            reusable.erase(found);
+        }
+        else
+        {
+            meshes[i].SetUpMesh();
+            uploaded++;
+        }
+    }
+
+    m_Storage = ModelStorage::Gpu;
+    BuildBVHsAsync();
+    return uploaded;
+}
+
+bool Model::Raycast(const glm::vec3& origin, const glm::vec3& direction, RayHit& hit) const
+{
+    if (!IsPickingReady())
+        return false;
+
+    bool found = false;
+    float closest = FLT_MAX;
+    for (unsigned int i = 0; i < m_BVHs.size(); i++)
+    {
+        RayHit meshHit;
+        if (m_BVHs[i].Intersect(origin, direction, 0.0f, closest, meshHit))
+        {
+            closest = meshHit.distance;
+            meshHit.mesh = i;
+            hit = meshHit;
+            found = true;
+        }
+    }
+    return found;
+}
+
+bool Model::IsPickingReady() const
+{
+    return m_BVHBuild.valid() && m_BVHBuild.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+void Model::WaitForPicking() const
+{
+    if (m_BVHBuild.valid())
+        m_BVHBuild.wait();
+}
+
+const std::vector<MeshBVH>& Model::GetBVHs() const
+{
+    return m_BVHs;
+}
+
+double Model::GetBVHBuildMilliseconds() const
+{
+    return m_BVHBuildMilliseconds;
+}
+
+ClusterStreamer* Model::GetStreamer() const
+{
+    return m_Streamer.get();
+}
+
+void Model::BuildBVHsAsync()
+{
+    if (meshes.empty())
+        return;
+
+    // the job works on its own copy, the meshes may drop their CPU data right after loading
+    struct BVHInput
+    {
+        std::vector<glm::vec3> positions;
+        std::vector<unsigned int> indices;
+    };
+    auto inputs = std::make_shared<std::vector<BVHInput>>(meshes.size());
+    for (unsigned int i = 0; i < meshes.size(); i++)
+    {
+        Mesh& mesh = meshes[i];
+        // natively loaded glTF meshes have no CPU copy yet, it is read back once for the build
+        bool released = !mesh.HasCpuData();
+        if (released)
+            mesh.EnsureCpuData();
+
+        BVHInput& input = (*inputs)[i];
+        input.positions.resize(mesh.vertices.size());
+        for (size_t v = 0; v < mesh.vertices.size(); v++)
+            input.positions[v] = mesh.vertices[v].Position;
+        input.indices = mesh.indices;
+
+        if (released)
+            mesh.ReleaseCpuData();
+    }
+
+    m_BVHs.resize(meshes.size());
+    std::string name = fileName;
+    m_BVHBuild = ThreadPool::Get().Submit([this, inputs, name]()
+    {
+        auto start = std::chrono::steady_clock::now();
+        ThreadPool::Get().ParallelFor(0, inputs->size(), 1, [this, &inputs](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; i++)
+            {
+                m_BVHs[i].Build((*inputs)[i].positions, (*inputs)[i].indices);
+                (*inputs)[i] = BVHInput();
+            }
+        });
+        m_BVHBuildMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        size_t bytes = 0;
+        for (const MeshBVH& bvh : m_BVHs)
+            bytes += bvh.GetMemoryBytes();
+        m_BVHMemoryId = MemoryTracker::Get().Register(MemoryCategory::Picking, name, bytes, 0);
+    });
+}
+
+void Model::loadModel(std::string const& path, ModelLoader loader)
+{
+    // retrieve the directory path of the filepath
+    directory = path.substr(0, path.find_last_of('/'));
+    fileName = path.substr(path.find_last_of("/\\") + 1);
+
+    // cluster files are never loaded as a whole, only their table is read here
+    if (loader == ModelLoader::Auto && ClusterFile::CanLoad(path))
+    {
+        loaderName = "Cluster streaming";
+        if (m_Storage != ModelStorage::Gpu)
+        {
+            errorMessage = "cluster files can only be streamed for drawing";
+            return;
+        }
+        m_Streamer = std::make_unique<ClusterStreamer>();
+        if (!m_Streamer->Open(path, errorMessage))
+        {
+            std::cout << "ERROR::CLUSTERS:: " << errorMessage << std::endl;
+            m_Streamer.reset();
+            return;
+        }
+        importedVertexCount = GetVertexCount();
+        return;
+    }
+
+    // glTF goes straight from the mapped file into GL buffers, Assimp stays the fallback
+    if (loader == ModelLoader::Auto && GltfLoader::CanLoad(path))
+    {
+        if (GltfLoader::Load(path, fileName, meshes, m_Storage == ModelStorage::Gpu))
+        {
+            // glTF primitives are indexed by the exporter, there is nothing to weld
+            loaderName = "glTF (native)";
+            importedVertexCount = GetVertexCount();
+            // the primitives carry their material's maps, listed once like the Assimp path does
+            for (const Mesh& mesh : meshes)
+            {
+                for (const Texture& texture : mesh.textures)
+                {
+                    if (std::none_of(textures_loaded.begin(), textures_loaded.end(), [&texture](const Texture& loaded) { return loaded.path == texture.path; }))
+                        textures_loaded.push_back(texture);
+                }
+            }
+            return;
+        }
+        std::cout << "GLTF: falling back to Assimp for " << fileName << std::endl;
+    }
+    loaderName = "Assimp";
+
     // read file via ASSIMP
     Assimp::Importer importer;
-    const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+    const ImportSettings& settings = GetImportSettings(preset);
+    // degenerate triangles, points and lines are dropped instead of being drawn as broken triangles
+    importer.SetPropertyBool(AI_CONFIG_PP_FD_REMOVE, true);
+    importer.SetPropertyInteger(AI_CONFIG_PP_SBP_REMOVE, aiPrimitiveType_POINT | aiPrimitiveType_LINE);
+    importer.SetPropertyInteger(AI_CONFIG_PP_LBW_MAX_WEIGHTS, MAX_BONE_INFLUENCE);
+    const aiScene* scene = importer.ReadFile(path, settings.assimpFlags);
     // check for errors
     if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
     {
-        std::cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << std::endl;
+        errorMessage = importer.GetErrorString();
+        std::cout << "ERROR::ASSIMP:: " << errorMessage << std::endl;
         return;
     }
-    // retrieve the directory path of the filepath
-    directory = path.substr(0, path.find_last_of('/'));
+
+    hashEmbeddedTextures(scene);
 
     // process ASSIMP's root node recursively
-    processNode(scene->mRootNode, scene);
+    MonotonicArena arena;
+    meshes.reserve(scene->mNumMeshes);
+    processNode(scene->mRootNode, scene, arena);
+    m_EmbeddedImages.clear();
+    m_EmbeddedImages.shrink_to_fit();
 }
 
-void Model::processNode(aiNode* node, const aiScene* scene)
+void Model::processNode(aiNode* node, const aiScene* scene, MonotonicArena& arena)
 {
     // process each mesh located at the current node
     for (unsigned int i = 0; i < node->mNumMeshes; i++)
@@ -38,27 +413,36 @@ void Model::processNode(aiNode* node, const aiScene* scene)
         // the node object only contains indices to index the actual objects in the scene. 
         // the scene contains all the data, node is just to keep stuff organized (like relations between nodes).
         aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-        meshes.push_back(processMesh(mesh, scene));
+        meshes.push_back(processMesh(mesh, scene, arena));
+        arena.Reset();
     }
     // after we've processed all of the meshes (if any) we then recursively process each of the children nodes
     for (unsigned int i = 0; i < node->mNumChildren; i++)
     {
-        processNode(node->mChildren[i], scene);
+        processNode(node->mChildren[i], scene, arena);
     }
 
 }
 
-Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene)
+Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene, MonotonicArena& arena)
 {
-    // data to fill
+    // data to fill, sized up front. Triangulate leaves three indices per face
     std::vector<Vertex> vertices;
     std::vector<unsigned int> indices;
     std::vector<Texture> textures;
+    vertices.reserve(mesh->mNumVertices);
+    indices.reserve(static_cast<size_t>(mesh->mNumFaces) * 3);
 
     // walk through each of the mesh's vertices
     for (unsigned int i = 0; i < mesh->mNumVertices; i++)
     {
         Vertex vertex;
+        vertex.Normal = glm::vec3(0.0f);
+        for (int j = 0; j < MAX_BONE_INFLUENCE; j++)
+        {
+            vertex.m_BoneIDs[j] = -1;
+            vertex.m_Weights[j] = 0.0f;
+        }
         glm::vec3 vector; // we declare a placeholder vector since assimp uses its own vector class that doesn't directly convert to glm's vec3 class so we transfer the data to this placeholder glm::vec3 first.
         // positions
         vector.x = mesh->mVertices[i].x;
@@ -94,14 +478,19 @@ Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene)
             vertex.Bitangent = vector;
         }
         else
+        {
             vertex.TexCoords = glm::vec2(0.0f, 0.0f);
+            vertex.Tangent = glm::vec3(0.0f);
+            vertex.Bitangent = glm::vec3(0.0f);
+        }
 
         vertices.push_back(vertex);
     }
     // now wak through each of the mesh's faces (a face is a mesh its triangle) and retrieve the corresponding vertex indices.
     for (unsigned int i = 0; i < mesh->mNumFaces; i++)
     {
-        aiFace face = mesh->mFaces[i];
+        // a copy of the face would allocate its own index array
+        const aiFace& face = mesh->mFaces[i];
         // retrieve all indices of the face and store them in the indices vector
         for (unsigned int j = 0; j < face.mNumIndices; j++)
             indices.push_back(face.mIndices[j]);
@@ -115,26 +504,50 @@ Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene)
     // specular: texture_specularN
     // normal: texture_normalN
 
+    textures.reserve(material->GetTextureCount(aiTextureType_DIFFUSE) + material->GetTextureCount(aiTextureType_UNKNOWN)
+        + material->GetTextureCount(aiTextureType_HEIGHT) + material->GetTextureCount(aiTextureType_AMBIENT));
     // 1. diffuse maps
-    std::vector<Texture> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
-    textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
+    loadMaterialTextures(material, scene, aiTextureType_DIFFUSE, TextureType::Diffuse, textures);
     // 2. specular maps
-    std::vector<Texture> specularMaps = loadMaterialTextures(material, aiTextureType_UNKNOWN, "texture_roughness");
-    textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
+    loadMaterialTextures(material, scene, aiTextureType_UNKNOWN, TextureType::Roughness, textures);
     // 3. normal maps
-    std::vector<Texture> normalMaps = loadMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal");
-    textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
+    loadMaterialTextures(material, scene, aiTextureType_HEIGHT, TextureType::Normal, textures);
     // 4. height maps
-    std::vector<Texture> heightMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height");
-    textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
+    loadMaterialTextures(material, scene, aiTextureType_AMBIENT, TextureType::Height, textures);
 
     // return a mesh object created from the extracted mesh data
-    return Mesh(vertices, indices, textures);
+    // bone weights go into the first free influence slot, LimitBoneWeights keeps it to MAX_BONE_INFLUENCE
+    const ImportSettings& settings = GetImportSettings(preset);
+    if (settings.loadBones)
+    {
+        for (unsigned int i = 0; i < mesh->mNumBones; i++)
+        {
+            const aiBone* bone = mesh->mBones[i];
+            for (unsigned int j = 0; j < bone->mNumWeights; j++)
+            {
+                Vertex& vertex = vertices[bone->mWeights[j].mVertexId];
+                for (int k = 0; k < MAX_BONE_INFLUENCE; k++)
+                {
+                    if (vertex.m_BoneIDs[k] < 0)
+                    {
+                        vertex.m_BoneIDs[k] = static_cast<int>(i);
+                        vertex.m_Weights[k] = bone->mWeights[j].mWeight;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    importedVertexCount += static_cast<unsigned int>(vertices.size());
+    if (settings.weld)
+        VertexWelder::Weld(vertices, indices, settings.weldSettings, &arena);
+
+    return Mesh(std::move(vertices), std::move(indices), std::move(textures), fileName + ": " + mesh->mName.C_Str(), m_Storage == ModelStorage::Gpu);
 }
 
-std::vector<Texture> Model::loadMaterialTextures(aiMaterial* mat, aiTextureType type, std::string typeName)
+void Model::loadMaterialTextures(aiMaterial* mat, const aiScene* scene, aiTextureType type, TextureType textureType, std::vector<Texture>& textures)
 {
-    std::vector<Texture> textures;
     for (unsigned int i = 0; i < mat->GetTextureCount(type); i++)
     {
         aiString str;
@@ -153,61 +566,44 @@ std::vector<Texture> Model::loadMaterialTextures(aiMaterial* mat, aiTextureType
         if (!skip)
         {   // if texture hasn't been loaded already, load it
             Texture texture;
-            texture.id = TextureFromFile(str.C_Str(), this->directory, (typeName == "texture_diffuse" ? true : false));
-            texture.type = typeName;
+            texture.id = 0;
+            // files are only recorded, embedded images are copied once per content for the texture palette
+            std::pair<const aiTexture*, int> embedded = scene->GetEmbeddedTextureAndIndex(str.C_Str());
+            if (embedded.first && static_cast<size_t>(embedded.second) < m_EmbeddedImages.size())
+                texture.embedded = embeddedTexture(scene, static_cast<unsigned int>(embedded.second));
+            texture.type = textureType;
             texture.path = str.C_Str();
             textures.push_back(texture);
             textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecessary load duplicate textures.
         }
     }
-    return textures;
 }
 
-unsigned int TextureFromFile(const char* path, const std::string& directory, bool gamma)
+void Model::hashEmbeddedTextures(const aiScene* scene)
 {
-    std::string filename = std::string(path);
-    filename = directory + '/' + filename;
-
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
+    m_EmbeddedImages.assign(scene->mNumTextures, EmbeddedImage());
+    if (m_EmbeddedImages.empty())
+        return;
 
-    int width, height, nrComponents;
-    unsigned char* data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-    if (data)
+    ThreadPool::Get().ParallelFor(0, m_EmbeddedImages.size(), 1, [this, scene](size_t begin, size_t end)
     {
-        GLenum dataFormat;
-        GLenum internalFormat;
-        if (nrComponents == 1)
-        {
-            internalFormat = dataFormat = GL_RED;
-        }
-        else if (nrComponents == 3)
+        for (size_t i = begin; i < end; i++)
         {
-            dataFormat = GL_RGB;
-            internalFormat = gamma ? GL_SRGB : GL_RGB;
+            const aiTexture* texture = scene->mTextures[i];
+            m_EmbeddedImages[i].hash = HashBytes(texture->pcData, EmbeddedBytes(texture));
         }
-        else if (nrComponents == 4)
-        {
-            dataFormat = GL_RGBA;
-            internalFormat = gamma ? GL_SRGB_ALPHA : GL_RGBA;
-        }
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, dataFormat, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
+    });
 
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
-    }
-    else
-    {
-        std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
-    }
+    // duplicates point at the first image with their content, only that one is copied
+    std::unordered_map<uint64_t, unsigned int> firstWithHash;
+    for (unsigned int i = 0; i < m_EmbeddedImages.size(); i++)
+        m_EmbeddedImages[i].source = firstWithHash.emplace(m_EmbeddedImages[i].hash, i).first->second;
+}
 
-    return textureID;
-}
\ No newline at end of file
+std::shared_ptr<const EmbeddedTexture> Model::embeddedTexture(const aiScene* scene, unsigned int index)
+{
+    EmbeddedImage& image = m_EmbeddedImages[m_EmbeddedImages[index].source];
+    if (!image.copy)
+        image.copy = CopyEmbedded(scene->mTextures[m_EmbeddedImages[index].source]);
+    return image.copy;
+}
@@ -10,17 +10,62 @@
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
+#include "GLResource.h"
 #include "Mesh.h"
+#include "MeshBVH.h"
+#include "MonotonicArena.h"
 #include "Shader.h"
+#include "VertexWelder.h"
 
 #include <string>
 #include <fstream>
+#include <future>
+#include <memory>
 #include <sstream>
 #include <iostream>
 #include <map>
 #include <vector>
 
-unsigned int TextureFromFile(const char* path, const std::string& directory, bool gamma = false);
+class ClusterStreamer;
+
+// Auto takes the native loader for .gltf/.glb, the cluster streamer for .clusters and Assimp for everything else,
+// Assimp is also the glTF fallback
+enum class ModelLoader
+{
+    Auto,
+    Assimp
+};
+
+// CpuOnly imports without touching GL: no buffers or picking BVHs. neither storage creates textures, the materials only
+// record the referenced files and a copy of the embedded images, the texture palette loads them
+// used by headless tools that run on worker threads
+enum class ModelStorage
+{
+    Gpu,
+    CpuOnly
+};
+
+// named import setups, selectable with --preset and in the Asset panel
+enum class ImportPreset
+{
+    FastPreview,    // Assimp's basic steps, meshes stay de-indexed
+    FullQuality,    // cleanup steps plus vertex welding
+    Skinned,        // full quality with bone weights, welding keeps vertices with different skinning apart
+    Count
+};
+
+struct ImportSettings
+{
+    const char* name;     // shown in the UI
+    const char* id;       // command line value
+    unsigned int assimpFlags;
+    bool weld;
+    WeldSettings weldSettings;
+    bool loadBones;
+};
+
+const ImportSettings& GetImportSettings(ImportPreset preset);
+bool ParseImportPreset(const std::string& id, ImportPreset& preset);
 
 class Model
 {
@@ -29,25 +74,101 @@ public:
     std::vector<Texture> textures_loaded;	// stores all the textures loaded so far, optimization to make sure textures aren't loaded more than once.
     std::vector<Mesh>    meshes;
     std::string directory;
+    std::string fileName;
     bool gammaCorrection;
+    // loader that produced the meshes and how long loading and uploading took
+    std::string loaderName;
+    double loadMilliseconds = 0.0;
+    ImportPreset preset;
+    // vertex count as imported, before welding
+    unsigned int importedVertexCount = 0;
+    // heap allocations of the importing thread during loading (worker threads not included) and the process peak
+    // resident set afterwards. the peak is restarted for every import where the OS allows it, concurrent imports share it
+    uint64_t importAllocations = 0;
+    uint64_t importAllocatedBytes = 0;
+    size_t peakResidentBytes = 0;
+    // set when the file could not be imported
+    std::string errorMessage;
 
     // constructor, expects a filepath to a 3D model.
-    Model(std::string const& path, bool gamma = false);
+    Model(std::string const& path, bool gamma = false, ModelLoader loader = ModelLoader::Auto, ImportPreset preset = ImportPreset::FullQuality,
+        ModelStorage storage = ModelStorage::Gpu);
+    // a model without meshes, drawn while the real one is imported in the background
+    Model();
+    ~Model();
+
+    Model(const Model&) = delete;
+    Model& operator=(const Model&) = delete;
 
     // draws the model, and thus all its meshes
     void Draw(Shader& shader);
 
+    // drops or restores the system memory copy of every mesh, see Mesh::ReleaseCpuData
+    void ReleaseCpuData();
+    void EnsureCpuData();
+    bool HasCpuData() const;
+
+    unsigned int GetVertexCount() const;
+    unsigned int GetIndexCount() const;
+
+    // content hash per mesh, see Mesh::ComputeContentHash. released meshes are read back, which needs the render thread
+    std::vector<uint64_t> ComputeMeshHashes();
+    // turns a CpuOnly import into a drawable model (render thread). a mesh whose hash matches one of previous takes over
+    // its GL buffers, only the others are uploaded. returns the number of uploaded meshes
+    unsigned int AdoptGpuData(Model& previous, const std::vector<uint64_t>& hashes, const std::vector<uint64_t>& previousHashes);
+
+    // closest triangle under a model space ray, false while the BVHs are still building
+    bool Raycast(const glm::vec3& origin, const glm::vec3& direction, RayHit& hit) const;
+    bool IsPickingReady() const;
+    void WaitForPicking() const;
+    // one BVH per mesh, only valid once IsPickingReady returns true
+    const std::vector<MeshBVH>& GetBVHs() const;
+    double GetBVHBuildMilliseconds() const;
+
+    // set for .clusters files: there are no meshes, the geometry is paged in by the streamer, which needs
+    // an Update with the view every frame. such models can't be picked
+    ClusterStreamer* GetStreamer() const;
+
 private:
     // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
-    void loadModel(std::string const& path);
+    void loadModel(std::string const& path, ModelLoader loader);
 
     // processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
-    void processNode(aiNode* node, const aiScene* scene);
+    // arena holds the temporaries of one mesh at a time and is reset after each
+    void processNode(aiNode* node, const aiScene* scene, MonotonicArena& arena);
+
+    Mesh processMesh(aiMesh* mesh, const aiScene* scene, MonotonicArena& arena);
+
+    // images embedded in the file (aiScene::mTextures, referenced as "*0" or by file name), FBX and GLB carry them.
+    // they are hashed on the thread pool before the meshes are processed, images with the same content share one copy,
+    // made when a material first uses it
+    struct EmbeddedImage
+    {
+        uint64_t hash = 0;
+        // first image with the same content, the only one copied
+        unsigned int source = 0;
+        std::shared_ptr<const EmbeddedTexture> copy;
+    };
+    void hashEmbeddedTextures(const aiScene* scene);
+    std::shared_ptr<const EmbeddedTexture> embeddedTexture(const aiScene* scene, unsigned int index);
+
+    // copies the mesh positions and builds the picking BVHs on the thread pool
+    void BuildBVHsAsync();
+
+    ModelStorage m_Storage;
+
+    std::vector<MeshBVH> m_BVHs;
+    std::future<void> m_BVHBuild;
+    double m_BVHBuildMilliseconds = 0.0;
+    int m_BVHMemoryId = -1;
+
+    std::unique_ptr<ClusterStreamer> m_Streamer;
 
-    Mesh processMesh(aiMesh* mesh, const aiScene* scene);
+    // only while an Assimp scene is processed
+    std::vector<EmbeddedImage> m_EmbeddedImages;
 
-    // checks all material textures of a given type and loads the textures if they're not loaded yet.
-    // the required info is returned as a Texture struct.
-    std::vector<Texture> loadMaterialTextures(aiMaterial* mat, aiTextureType type, std::string typeName);
+    // checks all material textures of a given type and records the ones not seen yet.
+    // the required info is appended to textures as Texture structs.
+    void loadMaterialTextures(aiMaterial* mat, const aiScene* scene, aiTextureType type, TextureType textureType, std::vector<Texture>& textures);
 };
 #endif
\ No newline at end of file
@@ -0,0 +1,243 @@
+#include "ProgressiveAccumulator.h"
+
+#include "MemoryTracker.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	const int STILL_FRAMES = 8;
+	const float PI = 3.14159265359f;
+
+	// low discrepancy sequence, the samples cover the pixel and the light evenly at any count
+	float Halton(int index, int base)
+	{
+		float result = 0.0f;
+		float fraction = 1.0f / base;
+		while (index > 0)
+		{
+			result += fraction * (index % base);
+			index /= base;
+			fraction /= base;
+		}
+		return result;
+	}
+}
+
+ProgressiveAccumulator::ProgressiveAccumulator()
+{
+	m_EmptyVertexArray = GLVertexArray::Create();
+}
+
+ProgressiveAccumulator::~ProgressiveAccumulator()
+{
+	if (m_MemoryId >= 0)
+		MemoryTracker::Get().Unregister(m_MemoryId);
+}
+
+void ProgressiveAccumulator::SetEnabled(bool enabled)
+{
+	if (enabled != m_Enabled)
+		Reset();
+	m_Enabled = enabled;
+}
+
+bool ProgressiveAccumulator::IsEnabled() const
+{
+	return m_Enabled;
+}
+
+void ProgressiveAccumulator::SetMaxSamples(int samples)
+{
+	m_MaxSamples = std::max(samples, 1);
+}
+
+void ProgressiveAccumulator::SetLightSize(float degrees)
+{
+	if (degrees != m_LightSize)
+		Reset();
+	m_LightSize = std::clamp(degrees, 0.0f, 20.0f);
+}
+
+void ProgressiveAccumulator::Update(const glm::mat4& view, const glm::mat4& projection, const glm::mat4& model, const glm::vec3& lightDirection,
+	bool interacting, int width, int height)
+{
+	bool changed = interacting || width != m_Width || height != m_Height || view != m_View || projection != m_Projection
+		|| model != m_Model || lightDirection != m_LightDirection;
+	m_View = view;
+	m_Projection = projection;
+	m_Model = model;
+	m_LightDirection = lightDirection;
+
+	if (width != m_Width || height != m_Height)
+	{
+		// the targets follow lazily, a window being resized isn't sampled anyway
+		m_SampleFramebuffer.Reset();
+		m_AccumulationFramebuffer.Reset();
+		m_Width = width;
+		m_Height = height;
+	}
+
+	if (!m_Enabled || changed || width <= 0 || height <= 0)
+	{
+		Reset();
+		return;
+	}
+	if (m_StillFrames < STILL_FRAMES)
+	{
+		m_StillFrames++;
+		return;
+	}
+	m_Active = true;
+}
+
+void ProgressiveAccumulator::Reset()
+{
+	m_StillFrames = 0;
+	m_SampleCount = 0;
+	m_Active = false;
+}
+
+bool ProgressiveAccumulator::IsActive() const
+{
+	return m_Active;
+}
+
+bool ProgressiveAccumulator::IsConverged() const
+{
+	return m_Active && m_SampleCount >= m_MaxSamples;
+}
+
+int ProgressiveAccumulator::GetSampleCount() const
+{
+	return m_SampleCount;
+}
+
+int ProgressiveAccumulator::GetMaxSamples() const
+{
+	return m_MaxSamples;
+}
+
+glm::mat4 ProgressiveAccumulator::JitterProjection(const glm::mat4& projection) const
+{
+	// sub-pixel offset in clip space, the first sample sits in the pixel centre
+	int index = m_SampleCount + 1;
+	float x = Halton(index, 2) - 0.5f;
+	float y = Halton(index, 3) - 0.5f;
+	glm::mat4 jittered = projection;
+	jittered[2][0] += x * 2.0f / m_Width;
+	jittered[2][1] += y * 2.0f / m_Height;
+	return jittered;
+}
+
+glm::vec3 ProgressiveAccumulator::JitterLight(const glm::vec3& direction) const
+{
+	glm::vec3 center = glm::normalize(direction);
+	if (m_LightSize <= 0.0f)
+		return center;
+
+	// a point on the disk the light covers, seen from the scene
+	int index = m_SampleCount + 1;
+	float radius = std::sqrt(Halton(index, 5)) * std::tan(m_LightSize * PI / 180.0f);
+	float angle = 2.0f * PI * Halton(index, 7);
+	glm::vec3 up = std::abs(center.y) < 0.99f ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+	glm::vec3 tangent = glm::normalize(glm::cross(up, center));
+	glm::vec3 bitangent = glm::cross(center, tangent);
+	return glm::normalize(center + radius * (std::cos(angle) * tangent + std::sin(angle) * bitangent));
+}
+
+void ProgressiveAccumulator::CreateTargets(int width, int height)
+{
+	m_SampleTexture = GLTexture::Create();
+	glBindTexture(GL_TEXTURE_2D, m_SampleTexture.Get());
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	m_DepthBuffer = GLRenderbuffer::Create();
+	glBindRenderbuffer(GL_RENDERBUFFER, m_DepthBuffer.Get());
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	m_SampleFramebuffer = GLFramebuffer::Create();
+	glBindFramebuffer(GL_FRAMEBUFFER, m_SampleFramebuffer.Get());
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_SampleTexture.Get(), 0);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_DepthBuffer.Get());
+
+	// 32-bit floats, a 16-bit average stops moving long before the last samples
+	m_AccumulationTexture = GLTexture::Create();
+	glBindTexture(GL_TEXTURE_2D, m_AccumulationTexture.Get());
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, width, height, 0, GL_RGBA, GL_FLOAT, nullptr);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	m_AccumulationFramebuffer = GLFramebuffer::Create();
+	glBindFramebuffer(GL_FRAMEBUFFER, m_AccumulationFramebuffer.Get());
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_AccumulationTexture.Get(), 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	if (m_MemoryId >= 0)
+		MemoryTracker::Get().Unregister(m_MemoryId);
+	m_MemoryId = MemoryTracker::Get().Register(MemoryCategory::RenderTarget, "progressive accumulation", 0,
+		static_cast<size_t>(width) * height * (4 + 4 + 16));
+}
+
+void ProgressiveAccumulator::BeginSample()
+{
+	if (!m_SampleFramebuffer)
+		CreateTargets(m_Width, m_Height);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, m_SampleFramebuffer.Get());
+	glViewport(0, 0, m_Width, m_Height);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
+void ProgressiveAccumulator::EndSample(const Shader& accumulateShader)
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, m_AccumulationFramebuffer.Get());
+	glViewport(0, 0, m_Width, m_Height);
+
+	// running average: the new sample is weighted 1 / n, the first one replaces whatever was there
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_CONSTANT_ALPHA, GL_ONE_MINUS_CONSTANT_ALPHA);
+	glBlendColor(0.0f, 0.0f, 0.0f, 1.0f / (m_SampleCount + 1));
+
+	accumulateShader.Use();
+	accumulateShader.SetInt("source", 0);
+	accumulateShader.SetInt("present", 0);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, m_SampleTexture.Get());
+	DrawFullscreen();
+
+	glDisable(GL_BLEND);
+	m_SampleCount++;
+}
+
+void ProgressiveAccumulator::Present(const Shader& accumulateShader)
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(0, 0, m_Width, m_Height);
+
+	accumulateShader.Use();
+	accumulateShader.SetInt("source", 0);
+	accumulateShader.SetInt("present", 1);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, m_AccumulationTexture.Get());
+	DrawFullscreen();
+}
+
+void ProgressiveAccumulator::DrawFullscreen()
+{
+	GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+	glDisable(GL_DEPTH_TEST);
+	glDepthMask(GL_FALSE);
+
+	glBindVertexArray(m_EmptyVertexArray.Get());
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glBindVertexArray(0);
+
+	glDepthMask(GL_TRUE);
+	if (depthTest)
+		glEnable(GL_DEPTH_TEST);
+}
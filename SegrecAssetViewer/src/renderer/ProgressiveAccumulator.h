@@ -0,0 +1,81 @@
+#ifndef PROGRESSIVEACCUMULATOR_H
+#define PROGRESSIVEACCUMULATOR_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "GLResource.h"
+#include "Shader.h"
+
+// refines a still view over many frames: every frame renders one sample with a sub-pixel jittered projection and a light
+// direction jittered over the light's size into a single-sampled target, and a running average of the samples is kept in a
+// float buffer. the view converges to a supersampled image with soft shadows, any change starts it over.
+// while the view changes the normal (multisampled) path is used, so interaction costs nothing extra.
+class ProgressiveAccumulator
+{
+public:
+	ProgressiveAccumulator();
+	~ProgressiveAccumulator();
+
+	ProgressiveAccumulator(const ProgressiveAccumulator&) = delete;
+	ProgressiveAccumulator& operator=(const ProgressiveAccumulator&) = delete;
+
+	void SetEnabled(bool enabled);
+	bool IsEnabled() const;
+	void SetMaxSamples(int samples);
+	// angular radius of the light in degrees, 0 keeps shadows hard
+	void SetLightSize(float degrees);
+
+	// call once per frame with the unjittered matrices before anything is drawn. interacting (UI in use, assets or
+	// environments loading) starts over as well. decides whether this frame takes a sample
+	void Update(const glm::mat4& view, const glm::mat4& projection, const glm::mat4& model, const glm::vec3& lightDirection,
+		bool interacting, int width, int height);
+	// starts over, for changes Update can't see
+	void Reset();
+
+	// true when the accumulated image is shown this frame instead of the normal path
+	bool IsActive() const;
+	// true when all samples are taken, the scene doesn't have to be drawn anymore
+	bool IsConverged() const;
+	int GetSampleCount() const;
+	int GetMaxSamples() const;
+
+	glm::mat4 JitterProjection(const glm::mat4& projection) const;
+	glm::vec3 JitterLight(const glm::vec3& direction) const;
+
+	// binds the sample target with its viewport and clears it
+	void BeginSample();
+	// adds the sample to the running average
+	void EndSample(const Shader& accumulateShader);
+	// draws the average into the default framebuffer (bound afterwards)
+	void Present(const Shader& accumulateShader);
+
+private:
+	void CreateTargets(int width, int height);
+	void DrawFullscreen();
+
+private:
+	bool m_Enabled = true;
+	int m_MaxSamples = 256;
+	float m_LightSize = 1.5f;
+
+	// frames without any change before sampling starts, so pauses between drags don't flicker to the aliased first samples
+	int m_StillFrames = 0;
+	int m_SampleCount = 0;
+	bool m_Active = false;
+	glm::mat4 m_View = glm::mat4(0.0f);
+	glm::mat4 m_Projection = glm::mat4(0.0f);
+	glm::mat4 m_Model = glm::mat4(0.0f);
+	glm::vec3 m_LightDirection = glm::vec3(0.0f);
+
+	int m_Width = 0, m_Height = 0;
+	GLFramebuffer m_SampleFramebuffer;
+	GLTexture m_SampleTexture;
+	GLRenderbuffer m_DepthBuffer;
+	GLFramebuffer m_AccumulationFramebuffer;
+	GLTexture m_AccumulationTexture;
+	GLVertexArray m_EmptyVertexArray;
+	int m_MemoryId = -1;
+};
+
+#endif // !PROGRESSIVEACCUMULATOR_H
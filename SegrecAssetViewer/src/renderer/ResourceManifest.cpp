@@ -0,0 +1,92 @@
+#include "ResourceManifest.h"
+
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+	const char* PACKED_MATERIAL = "#define PACKED_MATERIAL\n";
+
+	const ShaderResource SHADERS[] = {
+		{ "lit", "res/shaders/vertex/default.shader", nullptr, "res/shaders/fragment/default.shader", nullptr },
+		{ "depth", "res/shaders/vertex/depth.shader", nullptr, "res/shaders/fragment/depth.shader", nullptr },
+		// wireframes come from per-triangle edge distances of a geometry shader, drawn in the same pass as the shading
+		{ "wireframe", "res/shaders/vertex/wireframe.shader", "res/shaders/geometry/wireframe.shader", "res/shaders/fragment/wireframe.shader", nullptr },
+		{ "shaded wireframe", "res/shaders/vertex/default.shader", "res/shaders/geometry/shaded_wireframe.shader", "res/shaders/fragment/default.shader", nullptr },
+		// the lit shaders reading packed ORM and two channel normal maps
+		{ "packed lit", "res/shaders/vertex/default.shader", nullptr, "res/shaders/fragment/default.shader", PACKED_MATERIAL },
+		{ "packed shaded wireframe", "res/shaders/vertex/default.shader", "res/shaders/geometry/shaded_wireframe.shader", "res/shaders/fragment/default.shader", PACKED_MATERIAL },
+		{ "unlit", "res/shaders/vertex/unlit.shader", nullptr, "res/shaders/fragment/unlit.shader", nullptr },
+		{ "skybox", "res/shaders/vertex/skybox.shader", nullptr, "res/shaders/fragment/skybox.shader", nullptr },
+		{ "upscale", "res/shaders/vertex/fullscreen.shader", nullptr, "res/shaders/fragment/upscale.shader", nullptr },
+		{ "accumulate", "res/shaders/vertex/fullscreen.shader", nullptr, "res/shaders/fragment/accumulate.shader", nullptr },
+		// analysis view modes: overdraw counts, triangle and texel density, per mesh draw cost
+		{ "analysis", "res/shaders/vertex/unlit.shader", "res/shaders/geometry/analysis.shader", "res/shaders/fragment/analysis.shader", nullptr },
+		{ "overdraw", "res/shaders/vertex/fullscreen.shader", nullptr, "res/shaders/fragment/overdraw.shader", nullptr },
+		// signed distance to a reference version of the asset, see GeometryDiff
+		{ "difference", "res/shaders/vertex/difference.shader", nullptr, "res/shaders/fragment/difference.shader", nullptr },
+	};
+
+	const ImageResource TEXTURES[] = {
+		{ "stone floor diffuse", "res/textures/stone_floor.jpg", true },
+		{ "stone floor roughness", "res/textures/stone_floor_roughness.jpg", false },
+		{ "barrel diffuse", "res/textures/T_ApetrolBarrel_diff_1k.jpg", true },
+		{ "barrel roughness", "res/textures/T_ApetrolBarrel_rough_1k.jpg", false },
+		{ "barrel normal", "res/textures/T_ApetrolBarrel_normal_gl_1k.jpg", false },
+		{ "debug diffuse", "res/textures/tex_DebugUVTiles.png", true },
+		{ "default roughness", "res/textures/T_DefaultRoughness.jpg", false },
+		{ "empty normal", "res/textures/T_EmptyNormal.jpg", false },
+	};
+
+	const ImageResource IMAGES[] = {
+		{ "window icon", "res/icons/segrec_logo_s.png", false },
+		{ "lit button", "res/icons/lit_button_icon.png", false },
+		{ "wireframe button", "res/icons/wireframe_button_icon.png", false },
+		{ "unlit button", "res/icons/unlit_button_icon.png", false },
+	};
+
+	template<typename T, size_t N>
+	const T* Find(const T (&resources)[N], const char* name)
+	{
+		for (const T& resource : resources)
+		{
+			if (std::strcmp(resource.name, name) == 0)
+				return &resource;
+		}
+		std::cout << "ERROR::RESOURCE_MANIFEST::UNKNOWN_RESOURCE " << name << std::endl;
+		return nullptr;
+	}
+}
+
+const ShaderResource* ResourceManifest::GetShaders(size_t& count)
+{
+	count = sizeof(SHADERS) / sizeof(SHADERS[0]);
+	return SHADERS;
+}
+
+const ImageResource* ResourceManifest::GetTextures(size_t& count)
+{
+	count = sizeof(TEXTURES) / sizeof(TEXTURES[0]);
+	return TEXTURES;
+}
+
+const ImageResource* ResourceManifest::GetImages(size_t& count)
+{
+	count = sizeof(IMAGES) / sizeof(IMAGES[0]);
+	return IMAGES;
+}
+
+const ShaderResource* ResourceManifest::FindShader(const char* name)
+{
+	return Find(SHADERS, name);
+}
+
+const ImageResource* ResourceManifest::FindTexture(const char* name)
+{
+	return Find(TEXTURES, name);
+}
+
+const ImageResource* ResourceManifest::FindImage(const char* name)
+{
+	return Find(IMAGES, name);
+}
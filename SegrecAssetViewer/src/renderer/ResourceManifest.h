@@ -0,0 +1,43 @@
+#ifndef RESOURCEMANIFEST_H
+#define RESOURCEMANIFEST_H
+
+#include <cstddef>
+
+// shader program made of the given stages, geometry and defines may be null
+struct ShaderResource
+{
+	const char* name;
+	const char* vertex;
+	const char* geometry;
+	const char* fragment;
+	// "#define NAME\n" lines, see Shader
+	const char* defines;
+};
+
+// image file, srgb for colour data
+struct ImageResource
+{
+	const char* name;
+	const char* path;
+	bool srgb;
+};
+
+// every file the viewer needs on its own, by name. nothing is loaded here: startup creates the shaders without compiling
+// them (they compile when first used), queues the material textures on the palette and decodes the icons on the thread
+// pool, so the window shows up before any of it is ready
+class ResourceManifest
+{
+public:
+	static const ShaderResource* GetShaders(size_t& count);
+	// material textures of the plane and the default asset, decoded into the texture palette
+	static const ImageResource* GetTextures(size_t& count);
+	// UI images, uploaded as plain 2D textures
+	static const ImageResource* GetImages(size_t& count);
+
+	// null and an error when the name isn't in the manifest
+	static const ShaderResource* FindShader(const char* name);
+	static const ImageResource* FindTexture(const char* name);
+	static const ImageResource* FindImage(const char* name);
+};
+
+#endif // !RESOURCEMANIFEST_H
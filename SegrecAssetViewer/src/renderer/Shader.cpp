@@ -1,108 +1,229 @@
 #include "Shader.h"
 
+#include "ResourceManifest.h"
+#include "StartupTimeline.h"
+
+#include <chrono>
 #include <string>
 #include <iostream>
 #include <fstream>
 #include <sstream>
 
-Shader::Shader(const char* vertexPath, const char* fragmentPath)
+namespace
 {
-	std::string vertexCode, fragmentCode;
-	std::ifstream vShaderFile, fShaderFile;
+	std::string ReadShaderFile(const char* path)
+	{
+		std::ifstream file;
+
+		// exceptions
+		file.exceptions(std::ifstream::failbit || std::ifstream::badbit);
+		try
+		{
+			file.open(path);
+			std::stringstream stream;
+			stream << file.rdbuf();
+			file.close();
+			return stream.str();
+		}
+		catch (const std::ifstream::failure& e)
+		{
+			std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULY_READ " << path << std::endl;
+		}
+		return std::string();
+	}
 
-	// exceptions
-	vShaderFile.exceptions(std::ifstream::failbit || std::ifstream::badbit);
-	fShaderFile.exceptions(std::ifstream::failbit || std::ifstream::badbit);
-	try
+	unsigned int CompileShader(GLenum type, const char* path, const char* stage, const char* defines)
 	{
-		vShaderFile.open(vertexPath);
-		fShaderFile.open(fragmentPath);
+		std::string code = ReadShaderFile(path);
+		if (defines)
+		{
+			size_t version = code.find("#version");
+			size_t lineEnd = version == std::string::npos ? std::string::npos : code.find('\n', version);
+			if (lineEnd != std::string::npos)
+				code.insert(lineEnd + 1, defines);
+		}
+		const char* source = code.c_str();
+
+		int success;
+		char infoLog[512];
+
+		unsigned int shader = glCreateShader(type);
+		glShaderSource(shader, 1, &source, 0);
+		glCompileShader(shader);
+		glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+		if (!success)
+		{
+			glGetShaderInfoLog(shader, 512, NULL, infoLog);
+			std::cout << "SHADER::" << stage << "::COMPILE_FAILED\n" << infoLog << std::endl;
+		}
+		return shader;
+	}
+}
 
-		std::stringstream vShaderStream, fShaderStream;
+Shader::Shader(const char* vertexPath, const char* fragmentPath)
+	: Shader(vertexPath, nullptr, fragmentPath)
+{
+}
 
-		vShaderStream << vShaderFile.rdbuf();
-		fShaderStream << fShaderFile.rdbuf();
+Shader::Shader(const char* vertexPath, const char* geometryPath, const char* fragmentPath)
+	: Shader(vertexPath, geometryPath, fragmentPath, nullptr)
+{
+}
 
-		vShaderFile.close();
-		fShaderFile.close();
+Shader::Shader(const char* vertexPath, const char* geometryPath, const char* fragmentPath, const char* defines)
+	: m_VertexPath(vertexPath), m_GeometryPath(geometryPath ? geometryPath : ""), m_FragmentPath(fragmentPath),
+	m_Defines(defines ? defines : "")
+{
+	Compile();
+}
 
-		vertexCode = vShaderStream.str();
-		fragmentCode = fShaderStream.str();
-	}
-	catch (std::ifstream::failure e)
+Shader::Shader(const ShaderResource* resource)
+{
+	// unknown names were reported by the manifest, the shader stays without a program
+	if (!resource)
 	{
-		std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULY_READ" << std::endl;
+		m_Compiled = true;
+		return;
 	}
-	const char* vShaderSource = vertexCode.c_str();
-	const char* fShaderSource = fragmentCode.c_str();
+	m_Name = resource->name;
+	m_VertexPath = resource->vertex;
+	m_GeometryPath = resource->geometry ? resource->geometry : "";
+	m_FragmentPath = resource->fragment;
+	m_Defines = resource->defines ? resource->defines : "";
+}
 
+void Shader::Compile() const
+{
+	m_Compiled = true;
+	auto start = std::chrono::steady_clock::now();
+	const char* defines = m_Defines.empty() ? nullptr : m_Defines.c_str();
+	unsigned int vertex = CompileShader(GL_VERTEX_SHADER, m_VertexPath.c_str(), "VERTEX", defines);
+	unsigned int geometry = m_GeometryPath.empty() ? 0 : CompileShader(GL_GEOMETRY_SHADER, m_GeometryPath.c_str(), "GEOMETRY", defines);
+	unsigned int fragment = CompileShader(GL_FRAGMENT_SHADER, m_FragmentPath.c_str(), "FRAGMENT", defines);
 
-	unsigned int vertex, fragment;
-	int success;
-	char infoLog[512];
+	m_Program = GLProgram::Create();
 
-	vertex = glCreateShader(GL_VERTEX_SHADER);
-	glShaderSource(vertex, 1, &vShaderSource, 0);
-	glCompileShader(vertex);
-	
-	glGetShaderiv(vertex, GL_COMPILE_STATUS, &success);
-	if (!success)
-	{
-		glGetShaderInfoLog(vertex, 512, NULL, infoLog);
-		std::cout << "SHADER::VERTEX::COMPILE_FAILED\n" << infoLog << std::endl;
-	}
+	glAttachShader(m_Program.Get(), vertex);
+	if (geometry)
+		glAttachShader(m_Program.Get(), geometry);
+	glAttachShader(m_Program.Get(), fragment);
+	glLinkProgram(m_Program.Get());
 
-	fragment = glCreateShader(GL_FRAGMENT_SHADER);
-	glShaderSource(fragment, 1, &fShaderSource, 0);
-	glCompileShader(fragment);
-	glGetShaderiv(fragment, GL_COMPILE_STATUS, &success);
+	int success;
+	glGetProgramiv(m_Program.Get(), GL_LINK_STATUS, &success);
 	if (!success)
 	{
-		glGetShaderInfoLog(fragment, 512, NULL, infoLog);
-		std::cout << "SHADER::FRAGMENT::COMPILE_FAILED\n" << infoLog << std::endl;
+		char infoLog[512];
+		glGetProgramInfoLog(m_Program.Get(), 512, NULL, infoLog);
+		std::cout << "SHADER::PROGRAM::LINK_FAILED\n" << infoLog << std::endl;
 	}
 
-	m_ID = glCreateProgram();
-
-	glAttachShader(m_ID, vertex);
-	glAttachShader(m_ID, fragment);
-	glLinkProgram(m_ID);
-
 	glDeleteShader(vertex);
+	if (geometry)
+		glDeleteShader(geometry);
 	glDeleteShader(fragment);
+
+	for (const auto& block : m_UniformBlocks)
+		BindUniformBlock(block.first.c_str(), block.second);
+	m_UniformBlocks.clear();
+
+	RunInitializer();
+
+	if (!m_Name.empty())
+		StartupTimeline::Get().Mark("shader " + m_Name, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+}
+
+void Shader::RunInitializer() const
+{
+	if (!m_Initializer || !m_Program)
+		return;
+
+	// the initializer sets uniforms of the bound program, whatever was bound before gets bound again
+	GLint previous = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previous);
+	glUseProgram(m_Program.Get());
+	m_Initializer(*this);
+	glUseProgram(previous);
+}
+
+unsigned int Shader::Program() const
+{
+	if (!m_Compiled)
+		Compile();
+	return m_Program.Get();
 }
 
 void Shader::Use() const
 {
-	glUseProgram(m_ID);
+	glUseProgram(Program());
 }
 
 unsigned int Shader::GetID() const
 {
-	return m_ID;
+	return Program();
+}
+
+void Shader::SetInitializer(std::function<void(const Shader&)> initializer)
+{
+	m_Initializer = std::move(initializer);
+	if (m_Compiled)
+		RunInitializer();
+}
+
+void Shader::EnsureCompiled() const
+{
+	if (!m_Compiled)
+		Compile();
+}
+
+bool Shader::IsCompiled() const
+{
+	return m_Compiled;
 }
 
 void Shader::SetInt(const char* name, int value) const
 {
-	glUniform1i(glGetUniformLocation(m_ID, name), value);
+	glUniform1i(glGetUniformLocation(Program(), name), value);
 }
 
 void Shader::SetFloat(const char* name, float value) const
 {
-	glUniform1f(glGetUniformLocation(m_ID, name), value);
+	glUniform1f(glGetUniformLocation(Program(), name), value);
+}
+
+void Shader::SetVec2(const char* name, float x, float y) const
+{
+	glUniform2f(glGetUniformLocation(Program(), name), x, y);
 }
 
-void Shader::SetVec3(const char* name, glm::vec3& value) const
+void Shader::SetVec3(const char* name, const glm::vec3& value) const
 {
-	glUniform3fv(glGetUniformLocation(m_ID, name), 1, &value[0]);
+	glUniform3fv(glGetUniformLocation(Program(), name), 1, &value[0]);
 }
 
 void Shader::SetVec3(const char* name, float x, float y, float z) const
 {
-	glUniform3f(glGetUniformLocation(m_ID, name), x, y, z);
+	glUniform3f(glGetUniformLocation(Program(), name), x, y, z);
+}
+
+void Shader::SetVec3Array(const char* name, const glm::vec3* values, int count) const
+{
+	glUniform3fv(glGetUniformLocation(Program(), name), count, &values[0][0]);
 }
 
-void Shader::SetMat4(const char* name, glm::mat4& mat) const
+void Shader::SetMat4(const char* name, const glm::mat4& mat) const
 {
-	glUniformMatrix4fv(glGetUniformLocation(m_ID, name), 1, GL_FALSE, &mat[0][0]);
-}
\ No newline at end of file
+	glUniformMatrix4fv(glGetUniformLocation(Program(), name), 1, GL_FALSE, &mat[0][0]);
+}
+
+void Shader::BindUniformBlock(const char* name, unsigned int binding) const
+{
+	if (!m_Compiled)
+	{
+		m_UniformBlocks.emplace_back(name, binding);
+		return;
+	}
+	GLuint index = glGetUniformBlockIndex(m_Program.Get(), name);
+	if (index != GL_INVALID_INDEX)
+		glUniformBlockBinding(m_Program.Get(), index, binding);
+}
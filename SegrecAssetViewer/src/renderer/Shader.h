@@ -4,21 +4,64 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include "GLResource.h"
+
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct ShaderResource;
+
 class Shader
 {
 public:
 	Shader(const char* vertexPath, const char* fragmentPath);
+	// geometryPath may be null
+	Shader(const char* vertexPath, const char* geometryPath, const char* fragmentPath);
+	// variant of the same sources, defines ("#define NAME\n" lines) go right after the #version line of every stage
+	Shader(const char* vertexPath, const char* geometryPath, const char* fragmentPath, const char* defines);
+	// a shader of the resource manifest, compiled the first time it is used instead of here. the compile time shows up
+	// in the startup timeline
+	explicit Shader(const ShaderResource* resource);
 	void Use() const;
 	unsigned int GetID() const;
 
+	// runs right after linking with the program in use, sets what stays the same for the program's lifetime (sampler units).
+	// a shader that is already compiled runs it right away
+	void SetInitializer(std::function<void(const Shader&)> initializer);
+	// compiles now if nothing used the shader yet, to spread compiling over idle frames
+	void EnsureCompiled() const;
+	bool IsCompiled() const;
+
 	void SetInt(const char* name, int value) const;
 	void SetFloat(const char* name, float value) const;
-	void SetVec3(const char* name, glm::vec3& value) const;
+	void SetVec2(const char* name, float x, float y) const;
+	void SetVec3(const char* name, const glm::vec3& value) const;
 	void SetVec3(const char* name, float x, float y, float z) const;
-	void SetMat4(const char* name, glm::mat4& mat) const;
+	void SetVec3Array(const char* name, const glm::vec3* values, int count) const;
+	void SetMat4(const char* name, const glm::mat4& mat) const;
+	// points the named uniform block at a binding point, shaders without the block are left as they are
+	void BindUniformBlock(const char* name, unsigned int binding) const;
 
 private:
-	unsigned int m_ID;
+	void Compile() const;
+	void RunInitializer() const;
+	// compiles on first use
+	unsigned int Program() const;
+
+private:
+	std::string m_Name;
+	std::string m_VertexPath;
+	std::string m_GeometryPath;
+	std::string m_FragmentPath;
+	std::string m_Defines;
+	std::function<void(const Shader&)> m_Initializer;
+	// applied when the program is linked
+	mutable std::vector<std::pair<std::string, unsigned int>> m_UniformBlocks;
+
+	mutable GLProgram m_Program;
+	mutable bool m_Compiled = false;
 };
 
 #endif // !SHADER_H
@@ -0,0 +1,741 @@
+#include "TexturePalette.h"
+
+#include "ImageKernels.h"
+#include "MemoryTracker.h"
+#include "ThreadPool.h"
+
+#include <stb_image.h>
+#include <imgui/imgui.h>
+
+#include <algorithm>
+#include <cctype>
+#include <climits>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+namespace
+{
+	const int THUMBNAIL_SIZE = 64;
+	const int ATLAS_SIZE = 1024;
+	const int THUMBNAILS_PER_ROW = ATLAS_SIZE / THUMBNAIL_SIZE;
+	const int THUMBNAILS_PER_ATLAS = THUMBNAILS_PER_ROW * THUMBNAILS_PER_ROW;
+	// pages of one size/format double in capacity, a single page stays below this many bytes
+	const size_t MAX_PAGE_BYTES = 256 * 1024 * 1024;
+	const int MAX_PAGE_LAYERS = 64;
+
+	int MipCount(int width, int height)
+	{
+		int levels = 1;
+		while ((width >> levels) > 0 || (height >> levels) > 0)
+			levels++;
+		return levels;
+	}
+
+	GLenum InternalFormat(int channels, bool srgb)
+	{
+		if (channels == 1)
+			return GL_R8;
+		if (channels == 2)
+			return GL_RG8;
+		return srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+	}
+
+	// grey files stay single channel when allowed, everything else is expanded to RGBA
+	bool LoadPixels(const std::string& path, bool allowGrey, std::vector<unsigned char>& pixels, int& width, int& height, int& channels)
+	{
+		int fileChannels = 0;
+		if (!stbi_info(path.c_str(), &width, &height, &fileChannels))
+			return false;
+		channels = (fileChannels == 1 && allowGrey) ? 1 : 4;
+
+		unsigned char* data = stbi_load(path.c_str(), &width, &height, &fileChannels, channels);
+		if (!data)
+			return false;
+		pixels.assign(data, data + static_cast<size_t>(width) * height * channels);
+		stbi_image_free(data);
+		return true;
+	}
+
+	// an image embedded in a model file, RGBA8 texels are taken as they are
+	bool LoadEmbedded(const EmbeddedTexture& image, bool allowGrey, std::vector<unsigned char>& pixels, int& width, int& height, int& channels)
+	{
+		if (image.width > 0 && image.height > 0)
+		{
+			if (image.bytes.size() < static_cast<size_t>(image.width) * image.height * 4)
+				return false;
+			width = image.width;
+			height = image.height;
+			channels = 4;
+			pixels = image.bytes;
+			return true;
+		}
+
+		if (image.bytes.empty() || image.bytes.size() > INT_MAX)
+			return false;
+		int size = static_cast<int>(image.bytes.size());
+		int fileChannels = 0;
+		if (!stbi_info_from_memory(image.bytes.data(), size, &width, &height, &fileChannels))
+			return false;
+		channels = (fileChannels == 1 && allowGrey) ? 1 : 4;
+
+		unsigned char* data = stbi_load_from_memory(image.bytes.data(), size, &width, &height, &fileChannels, channels);
+		if (!data)
+			return false;
+		pixels.assign(data, data + static_cast<size_t>(width) * height * channels);
+		stbi_image_free(data);
+		return true;
+	}
+
+	// the entry's own image comes from memory when it is embedded, every other path is a file
+	bool LoadSource(const TexturePalette::Entry& source, const std::string& path, bool allowGrey, std::vector<unsigned char>& pixels,
+		int& width, int& height, int& channels)
+	{
+		if (source.embedded && path == source.path)
+			return LoadEmbedded(*source.embedded, allowGrey, pixels, width, height, channels);
+		return LoadPixels(path, allowGrey, pixels, width, height, channels);
+	}
+
+	// roughness decides the size, occlusion and metalness of another size are left out
+	bool LoadOrm(const TexturePalette::Entry& source, std::vector<unsigned char>& pixels, int& width, int& height)
+	{
+		int channels;
+		std::vector<unsigned char> map;
+		if (!LoadSource(source, source.sources[1], false, map, width, height, channels))
+			return false;
+
+		size_t count = static_cast<size_t>(width) * height;
+		pixels.resize(count * 4);
+		// no occlusion, no metal
+		const unsigned char defaults[4] = { 255, 0, 0, 255 };
+		for (size_t i = 0; i < count; i++)
+			std::memcpy(&pixels[i * 4], defaults, 4);
+		ImageKernels::CopyChannel(map.data(), 0, pixels.data(), 1, count);
+
+		for (int slot : { 0, 2 })
+		{
+			if (source.sources[slot].empty())
+				continue;
+			int w, h;
+			if (!LoadPixels(source.sources[slot], false, map, w, h, channels) || w != width || h != height)
+			{
+				std::cout << "ORM source skipped (unreadable or not " << width << "x" << height << "): " << source.sources[slot] << std::endl;
+				continue;
+			}
+			ImageKernels::CopyChannel(map.data(), 0, pixels.data(), slot, count);
+		}
+		return true;
+	}
+
+	std::string ToLower(std::string text)
+	{
+		std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+		return text;
+	}
+}
+
+TexturePalette::TexturePalette()
+{
+}
+
+TexturePalette::~TexturePalette()
+{
+	// decode jobs post their results back to this object
+	{
+		std::unique_lock<std::mutex> lock(m_ResultMutex);
+		m_ResultCondition.wait(lock, [this]() { return m_InFlight == 0; });
+	}
+
+	for (int id : m_MemoryIds)
+		MemoryTracker::Get().Unregister(id);
+}
+
+int TexturePalette::Add(const std::string& path, bool srgb, bool resident)
+{
+	std::string key = path + (srgb ? "|srgb" : "|linear");
+	auto found = m_Lookup.find(key);
+	if (found != m_Lookup.end())
+	{
+		if (resident)
+			MakeResident(found->second);
+		return found->second;
+	}
+
+	int index = static_cast<int>(m_Entries.size());
+	Entry entry;
+	entry.path = path;
+	auto embedded = m_Embedded.find(path);
+	if (embedded != m_Embedded.end())
+		entry.embedded = embedded->second;
+	entry.srgb = srgb;
+	entry.wantResident = resident;
+	entry.state = resident ? EntryState::Queued : EntryState::Unloaded;
+	m_Entries.push_back(entry);
+	m_Lookup[key] = index;
+
+	if (resident)
+		QueueDecode(index, true, true);
+	return index;
+}
+
+int TexturePalette::AddEmbedded(const std::string& name, std::shared_ptr<const EmbeddedTexture> image, bool srgb, bool resident)
+{
+	// a model shares one copy between images with the same content, it is decoded once
+	for (const auto& known : m_Embedded)
+	{
+		if (known.second == image && known.first != name)
+			return Add(known.first, srgb, resident);
+	}
+
+	std::shared_ptr<const EmbeddedTexture>& known = m_Embedded[name];
+	if (known && known != image)
+	{
+		// every entry made from the old data, packed ones included, is decoded again from the new
+		for (size_t i = 0; i < m_Entries.size(); i++)
+		{
+			Entry& entry = m_Entries[i];
+			if (entry.path != name || entry.state == EntryState::Unloaded)
+				continue;
+			entry.embedded = image;
+			QueueDecode(static_cast<int>(i), entry.state == EntryState::Resident || entry.wantResident, true, true);
+		}
+	}
+	known = std::move(image);
+	return Add(name, srgb, resident);
+}
+
+void TexturePalette::AddDirectory(const std::string& directory)
+{
+	std::error_code error;
+	std::vector<std::string> files;
+	for (const auto& item : std::filesystem::directory_iterator(directory, error))
+	{
+		if (!item.is_regular_file())
+			continue;
+
+		std::string extension = ToLower(item.path().extension().string());
+		if (extension == ".png" || extension == ".jpg" || extension == ".jpeg" || extension == ".tga" || extension == ".bmp" || extension == ".psd")
+			files.push_back(item.path().generic_string());
+	}
+	if (error)
+		std::cout << "Texture directory could not be read: " << directory << std::endl;
+
+	std::sort(files.begin(), files.end());
+	for (const std::string& file : files)
+		Add(file, IsColorTexture(file), false);
+}
+
+void TexturePalette::MakeResident(int entry)
+{
+	Entry& e = m_Entries[entry];
+	if (e.wantResident)
+		return;
+
+	e.wantResident = true;
+	// an entry still decoding is requeued once its thumbnail arrives
+	if (e.state == EntryState::Thumbnail)
+		QueueDecode(entry, true, false);
+	else if (e.state == EntryState::Unloaded)
+	{
+		e.state = EntryState::Queued;
+		QueueDecode(entry, true, true);
+	}
+}
+
+int TexturePalette::Reload(const std::string& path)
+{
+	// entries can be added with relative paths, and once per colour space
+	std::error_code error;
+	std::filesystem::path changed = std::filesystem::weakly_canonical(path, error);
+	if (error)
+		return 0;
+
+	auto matches = [&](const std::string& file)
+	{
+		return !file.empty() && std::filesystem::weakly_canonical(file, error) == changed && !error;
+	};
+
+	int queued = 0;
+	for (size_t i = 0; i < m_Entries.size(); i++)
+	{
+		// packed entries depend on every map they were built from
+		Entry& entry = m_Entries[i];
+		if (entry.state == EntryState::Unloaded)
+			continue;
+		if (!matches(entry.path) && !matches(entry.sources[0]) && !matches(entry.sources[2]))
+			continue;
+
+		QueueDecode(static_cast<int>(i), entry.state == EntryState::Resident || entry.wantResident, true, true);
+		queued++;
+	}
+	return queued;
+}
+
+int TexturePalette::AddPackedOrm(int roughnessEntry)
+{
+	const char* occlusionTags[] = { "ao", "occlusion", "AO" };
+	const char* metalnessTags[] = { "metal", "metallic", "metalness" };
+	std::string roughness = m_Entries[roughnessEntry].path;
+	std::string occlusion = FindCompanion(roughness, occlusionTags, 3);
+	std::string metalness = FindCompanion(roughness, metalnessTags, 3);
+
+	std::string key = "orm|" + occlusion + "|" + roughness + "|" + metalness;
+	auto found = m_Lookup.find(key);
+	if (found != m_Lookup.end())
+		return found->second;
+
+	int index = static_cast<int>(m_Entries.size());
+	Entry entry;
+	entry.path = roughness;
+	entry.embedded = m_Entries[roughnessEntry].embedded;
+	entry.packing = Packing::Orm;
+	entry.sources[0] = occlusion;
+	entry.sources[1] = roughness;
+	entry.sources[2] = metalness;
+	entry.wantResident = true;
+	m_Entries.push_back(entry);
+	m_Lookup[key] = index;
+
+	QueueDecode(index, true, true);
+	return index;
+}
+
+int TexturePalette::AddPackedNormal(int normalEntry)
+{
+	std::string key = "normal_xy|" + m_Entries[normalEntry].path;
+	auto found = m_Lookup.find(key);
+	if (found != m_Lookup.end())
+		return found->second;
+
+	int index = static_cast<int>(m_Entries.size());
+	Entry entry;
+	entry.path = m_Entries[normalEntry].path;
+	entry.embedded = m_Entries[normalEntry].embedded;
+	entry.packing = Packing::NormalXY;
+	entry.wantResident = true;
+	m_Entries.push_back(entry);
+	m_Lookup[key] = index;
+
+	QueueDecode(index, true, true);
+	return index;
+}
+
+std::string TexturePalette::FindCompanion(const std::string& roughnessPath, const char* const* tags, int tagCount)
+{
+	// the tag replaces "roughness" or "rough" in the file name, the rest of the name and the extension stay
+	std::filesystem::path path(roughnessPath);
+	std::string name = path.filename().string();
+	std::string lower = ToLower(name);
+	size_t at = lower.find("roughness");
+	size_t length = 9;
+	if (at == std::string::npos)
+	{
+		at = lower.find("rough");
+		length = 5;
+	}
+	if (at == std::string::npos)
+		return std::string();
+
+	std::error_code error;
+	for (int i = 0; i < tagCount; i++)
+	{
+		std::filesystem::path candidate = path.parent_path() / (name.substr(0, at) + tags[i] + name.substr(at + length));
+		if (std::filesystem::is_regular_file(candidate, error))
+			return candidate.generic_string();
+	}
+	return std::string();
+}
+
+void TexturePalette::Update(size_t uploadBudget)
+{
+	size_t uploaded = 0;
+	while (uploaded < uploadBudget)
+	{
+		DecodedImage image;
+		{
+			std::lock_guard<std::mutex> lock(m_ResultMutex);
+			if (m_Results.empty())
+				break;
+			image = std::move(m_Results.front());
+			m_Results.pop_front();
+		}
+
+		for (const std::vector<unsigned char>& mip : image.mips)
+			uploaded += mip.size();
+		uploaded += image.thumbnail.size();
+		Upload(image);
+	}
+}
+
+void TexturePalette::Flush()
+{
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_ResultMutex);
+			m_ResultCondition.wait(lock, [this]() { return m_InFlight == 0 || !m_Results.empty(); });
+			if (m_InFlight == 0 && m_Results.empty())
+				return;
+		}
+		// uploads can queue follow-up decodes (thumbnail first, full texture later)
+		Update(static_cast<size_t>(-1));
+	}
+}
+
+void TexturePalette::BindMaterial(const Shader& shader, int diffuse, int roughness, int normal) const
+{
+	const int entries[3] = { diffuse, roughness, normal };
+	const char* layerNames[3] = { "material.diffuseLayer", "material.roughnessLayer", "material.normalLayer" };
+
+	for (int slot = 0; slot < 3; slot++)
+	{
+		if (!IsResident(entries[slot]))
+			continue;
+
+		const Entry& entry = m_Entries[entries[slot]];
+		glActiveTexture(GL_TEXTURE0 + slot);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, m_Pages[entry.page].texture.Get());
+		shader.SetFloat(layerNames[slot], static_cast<float>(entry.layer));
+	}
+	glActiveTexture(GL_TEXTURE0);
+}
+
+int TexturePalette::DrawGrid(int selected, float thumbnailSize)
+{
+	int clicked = -1;
+	ImGuiStyle& style = ImGui::GetStyle();
+	float cellWidth = thumbnailSize + style.FramePadding.x * 2.0f + style.ItemSpacing.x;
+	int columns = std::max(1, static_cast<int>((ImGui::GetContentRegionAvail().x + style.ItemSpacing.x) / cellWidth));
+	int rows = (static_cast<int>(m_Entries.size()) + columns - 1) / columns;
+
+	// only the visible rows are submitted, hundreds of entries cost the same as a screenful
+	ImGuiListClipper clipper;
+	clipper.Begin(rows, thumbnailSize + style.FramePadding.y * 2.0f + style.ItemSpacing.y);
+	while (clipper.Step())
+	{
+		for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++)
+		{
+			for (int column = 0; column < columns; column++)
+			{
+				int index = row * columns + column;
+				if (index >= static_cast<int>(m_Entries.size()))
+					break;
+
+				// an entry gets its thumbnail once its row is shown
+				Entry& entry = m_Entries[index];
+				if (entry.state == EntryState::Unloaded)
+				{
+					entry.state = EntryState::Queued;
+					QueueDecode(index, false, true);
+				}
+				if (column > 0)
+					ImGui::SameLine();
+
+				ImGui::PushID(index);
+				bool isSelected = index == selected;
+				if (isSelected)
+					ImGui::PushStyleColor(ImGuiCol_Button, style.Colors[ImGuiCol_ButtonActive]);
+
+				bool pressed;
+				if (entry.thumbnail >= 0)
+				{
+					int atlas = entry.thumbnail / THUMBNAILS_PER_ATLAS;
+					int cell = entry.thumbnail % THUMBNAILS_PER_ATLAS;
+					float cellUV = static_cast<float>(THUMBNAIL_SIZE) / ATLAS_SIZE;
+					ImVec2 uv0((cell % THUMBNAILS_PER_ROW) * cellUV, (cell / THUMBNAILS_PER_ROW) * cellUV);
+					ImVec2 uv1(uv0.x + cellUV, uv0.y + cellUV);
+					ImTextureRef ref((ImTextureID)(intptr_t)m_ThumbnailAtlases[atlas].Get());
+					pressed = ImGui::ImageButton("##thumbnail", ref, ImVec2(thumbnailSize, thumbnailSize), uv0, uv1);
+				}
+				else
+				{
+					pressed = ImGui::Button(entry.state == EntryState::Failed ? "failed" : "...", ImVec2(thumbnailSize + style.FramePadding.x * 2.0f, thumbnailSize + style.FramePadding.y * 2.0f));
+				}
+
+				if (isSelected)
+					ImGui::PopStyleColor();
+				if (ImGui::IsItemHovered())
+					ImGui::SetTooltip("%s\n%dx%d %s%s", entry.path.c_str(), entry.width, entry.height, entry.srgb ? "sRGB" : "linear",
+						entry.packing == Packing::Orm ? ", packed ORM" : (entry.packing == Packing::NormalXY ? ", normal XY" : ""));
+				if (pressed)
+					clicked = index;
+				ImGui::PopID();
+			}
+		}
+	}
+	clipper.End();
+	return clicked;
+}
+
+bool TexturePalette::IsResident(int entry) const
+{
+	return entry >= 0 && entry < static_cast<int>(m_Entries.size()) && m_Entries[entry].state == EntryState::Resident;
+}
+
+size_t TexturePalette::GetEntryCount() const
+{
+	return m_Entries.size();
+}
+
+const TexturePalette::Entry& TexturePalette::GetEntry(int entry) const
+{
+	return m_Entries[entry];
+}
+
+bool TexturePalette::IsColorTexture(const std::string& path)
+{
+	// data maps are stored linearly, everything else is treated as colour
+	std::string name = ToLower(std::filesystem::path(path).filename().string());
+	const char* dataMaps[] = { "rough", "normal", "metal", "_ao", "occlusion", "height", "disp", "_orm", "mask", "gloss" };
+	for (const char* tag : dataMaps)
+	{
+		if (name.find(tag) != std::string::npos)
+			return false;
+	}
+	return true;
+}
+
+void TexturePalette::QueueDecode(int entry, bool resident, bool thumbnail, bool reload)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_ResultMutex);
+		m_InFlight++;
+	}
+
+	// the job gets a copy, entries move when the vector grows
+	Entry source = m_Entries[entry];
+	ThreadPool::Get().Submit([this, entry, source, resident, thumbnail, reload]()
+	{
+		DecodedImage image = Decode(entry, source, resident, thumbnail);
+		image.reload = reload;
+		std::lock_guard<std::mutex> lock(m_ResultMutex);
+		m_Results.push_back(std::move(image));
+		m_InFlight--;
+		m_ResultCondition.notify_all();
+	});
+}
+
+TexturePalette::DecodedImage TexturePalette::Decode(int entry, const Entry& source, bool resident, bool thumbnail)
+{
+	DecodedImage image;
+	image.entry = entry;
+
+	// grey data maps stay single channel, everything else is expanded to RGBA. packed maps are assembled in RGBA
+	// and normals only lose their blue channel after the mips and the thumbnail are made
+	int width = 0, height = 0, channels = 4;
+	std::vector<unsigned char> pixels;
+	bool loaded = source.packing == Packing::Orm ? LoadOrm(source, pixels, width, height)
+		: LoadSource(source, source.path, !source.srgb && source.packing == Packing::None, pixels, width, height, channels);
+	if (!loaded)
+	{
+		image.failed = true;
+		return image;
+	}
+
+	image.width = width;
+	image.height = height;
+	image.channels = channels;
+
+	const unsigned char* data = pixels.data();
+	if (resident)
+	{
+		// the mip chain is built here with the SIMD box filter instead of glGenerateMipmap,
+		// which would regenerate every layer of the page
+		image.mips.push_back(std::move(pixels));
+		data = image.mips[0].data();
+		int w = width, h = height;
+		while (w > 1 || h > 1)
+		{
+			std::vector<unsigned char> next;
+			int nextWidth, nextHeight;
+			ImageKernels::DownsampleHalf(image.mips.back().data(), w, h, channels, next, nextWidth, nextHeight);
+			image.mips.push_back(std::move(next));
+			w = nextWidth;
+			h = nextHeight;
+		}
+	}
+
+	if (thumbnail)
+	{
+		// start from the first mip that already fits when the chain exists
+		const unsigned char* from = data;
+		int w = width, h = height;
+		for (size_t level = 0; level < image.mips.size() && (w > THUMBNAIL_SIZE || h > THUMBNAIL_SIZE); level++)
+		{
+			from = image.mips[level].data();
+			w = std::max(width >> level, 1);
+			h = std::max(height >> level, 1);
+		}
+		ImageKernels::MakeThumbnail(from, w, h, channels, THUMBNAIL_SIZE, image.thumbnail);
+	}
+
+	if (source.packing == Packing::NormalXY)
+	{
+		for (int level = 0; level < static_cast<int>(image.mips.size()); level++)
+		{
+			std::vector<unsigned char> packed(static_cast<size_t>(std::max(width >> level, 1)) * std::max(height >> level, 1) * 2);
+			ImageKernels::PackNormalXY(image.mips[level].data(), packed.data(), packed.size() / 2);
+			image.mips[level] = std::move(packed);
+		}
+		image.channels = 2;
+	}
+	return image;
+}
+
+void TexturePalette::Upload(DecodedImage& image)
+{
+	Entry& entry = m_Entries[image.entry];
+	if (image.failed && image.reload && entry.state != EntryState::Failed)
+	{
+		std::cout << "Texture reload failed, keeping the previous version: " << entry.path << std::endl;
+		return;
+	}
+	if (image.failed)
+	{
+		entry.state = EntryState::Failed;
+		std::cout << "Texture failed to load at path: " << entry.path << std::endl;
+		return;
+	}
+
+	bool sameLayout = entry.state == EntryState::Resident && entry.width == image.width && entry.height == image.height
+		&& entry.channels == image.channels;
+	entry.width = image.width;
+	entry.height = image.height;
+	entry.channels = image.channels;
+
+	// a reload overwrites the cell it already has
+	if (!image.thumbnail.empty() && (entry.thumbnail < 0 || image.reload))
+		UploadThumbnail(entry, image.thumbnail);
+
+	if (image.mips.empty())
+	{
+		entry.state = EntryState::Thumbnail;
+		if (entry.wantResident)
+			QueueDecode(image.entry, true, false);
+		return;
+	}
+
+	int layer;
+	int pageIndex;
+	if (image.reload && sameLayout)
+	{
+		// same size and format, the new mips replace the layer in place
+		pageIndex = entry.page;
+		layer = entry.layer;
+	}
+	else
+	{
+		if (image.reload && entry.state == EntryState::Resident)
+			m_Pages[entry.page].freeLayers.push_back(entry.layer);
+		pageIndex = AllocateLayer(image.width, image.height, image.channels, entry.srgb, layer);
+	}
+	const Page& page = m_Pages[pageIndex];
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, page.texture.Get());
+	for (int level = 0; level < page.levels && level < static_cast<int>(image.mips.size()); level++)
+	{
+		int w = std::max(image.width >> level, 1);
+		int h = std::max(image.height >> level, 1);
+		glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, w, h, 1, page.format, GL_UNSIGNED_BYTE, image.mips[level].data());
+	}
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	entry.page = pageIndex;
+	entry.layer = layer;
+	entry.state = EntryState::Resident;
+}
+
+void TexturePalette::UploadThumbnail(Entry& entry, const std::vector<unsigned char>& pixels)
+{
+	int slot = entry.thumbnail >= 0 ? entry.thumbnail : m_ThumbnailCount++;
+	int atlas = slot / THUMBNAILS_PER_ATLAS;
+	int cell = slot % THUMBNAILS_PER_ATLAS;
+	if (atlas >= static_cast<int>(m_ThumbnailAtlases.size()))
+	{
+		GLTexture texture = GLTexture::Create();
+		glBindTexture(GL_TEXTURE_2D, texture.Get());
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, ATLAS_SIZE, ATLAS_SIZE, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		m_ThumbnailAtlases.push_back(std::move(texture));
+		m_MemoryIds.push_back(MemoryTracker::Get().Register(MemoryCategory::Texture, "palette thumbnails " + std::to_string(atlas),
+			0, MemoryTracker::TextureBytes(ATLAS_SIZE, ATLAS_SIZE, 4, false)));
+	}
+
+	glBindTexture(GL_TEXTURE_2D, m_ThumbnailAtlases[atlas].Get());
+	glTexSubImage2D(GL_TEXTURE_2D, 0, (cell % THUMBNAILS_PER_ROW) * THUMBNAIL_SIZE, (cell / THUMBNAILS_PER_ROW) * THUMBNAIL_SIZE,
+		THUMBNAIL_SIZE, THUMBNAIL_SIZE, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	entry.thumbnail = slot;
+}
+
+int TexturePalette::AllocateLayer(int width, int height, int channels, bool srgb, int& layer)
+{
+	GLenum internalFormat = InternalFormat(channels, srgb);
+	GLenum format = channels == 1 ? GL_RED : (channels == 2 ? GL_RG : GL_RGBA);
+
+	// pages are never resized, a full page gets a bigger sibling instead of a copy
+	int lastCapacity = 0;
+	for (size_t i = 0; i < m_Pages.size(); i++)
+	{
+		Page& page = m_Pages[i];
+		if (page.width != width || page.height != height || page.internalFormat != internalFormat)
+			continue;
+
+		if (!page.freeLayers.empty())
+		{
+			layer = page.freeLayers.back();
+			page.freeLayers.pop_back();
+			return static_cast<int>(i);
+		}
+		if (page.layerCount < page.capacity)
+		{
+			layer = page.layerCount++;
+			return static_cast<int>(i);
+		}
+		lastCapacity = std::max(lastCapacity, page.capacity);
+	}
+
+	size_t layerBytes = static_cast<size_t>(width) * height * channels * 4 / 3;
+	int byteLimit = static_cast<int>(std::max<size_t>(MAX_PAGE_BYTES / std::max<size_t>(layerBytes, 1), 1));
+	int capacity = std::min({ lastCapacity > 0 ? lastCapacity * 2 : 2, MAX_PAGE_LAYERS, byteLimit });
+
+	Page page;
+	page.width = width;
+	page.height = height;
+	page.levels = MipCount(width, height);
+	page.internalFormat = internalFormat;
+	page.format = format;
+	page.capacity = capacity;
+	page.layerCount = 1;
+
+	page.texture = GLTexture::Create();
+	glBindTexture(GL_TEXTURE_2D_ARRAY, page.texture.Get());
+	for (int level = 0; level < page.levels; level++)
+		glTexImage3D(GL_TEXTURE_2D_ARRAY, level, internalFormat, std::max(width >> level, 1), std::max(height >> level, 1), capacity, 0, format, GL_UNSIGNED_BYTE, nullptr);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, page.levels - 1);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	if (channels == 1)
+	{
+		// grey maps read as (r, r, r, 1) like the RGB files they replace
+		GLint swizzle[4] = { GL_RED, GL_RED, GL_RED, GL_ONE };
+		glTexParameteriv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+	}
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+	std::string name = "palette page " + std::to_string(width) + "x" + std::to_string(height) + (channels == 1 ? " R8" : (channels == 2 ? " RG8" : (srgb ? " sRGB8_A8" : " RGBA8"))) +
+		" [" + std::to_string(capacity) + " layers]";
+	m_MemoryIds.push_back(MemoryTracker::Get().Register(MemoryCategory::Texture, name, 0, MemoryTracker::TextureBytes(width, height, channels, true) * capacity));
+
+	layer = 0;
+	m_Pages.push_back(std::move(page));
+	return static_cast<int>(m_Pages.size() - 1);
+}
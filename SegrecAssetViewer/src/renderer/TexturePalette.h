@@ -0,0 +1,144 @@
+#ifndef TEXTUREPALETTE_H
+#define TEXTUREPALETTE_H
+
+#include <glad/glad.h>
+
+#include "GLResource.h"
+#include "Mesh.h"
+#include "Shader.h"
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// material textures live in GL_TEXTURE_2D_ARRAY pages grouped by size and format, so swapping the
+// texture of a material slot only changes the page binding and the layer index.
+// decoding, mip generation and thumbnails run on the thread pool, uploads are spread over frames.
+class TexturePalette
+{
+public:
+	enum class EntryState
+	{
+		Unloaded,    // nothing decoded until the entry is made resident or shown in the grid
+		Queued,
+		Thumbnail,   // thumbnail uploaded, full texture not requested yet
+		Resident,    // full mip chain uploaded to a page
+		Failed
+	};
+
+	// entries built from other maps by the decode jobs
+	enum class Packing
+	{
+		None,
+		Orm,        // occlusion, roughness, metalness in RGB (sources in that order, missing ones are constant)
+		NormalXY    // two-channel RG8 normal, z is rebuilt in the shader
+	};
+
+	struct Entry
+	{
+		// the roughness or normal map for packed entries
+		std::string path;
+		Packing packing = Packing::None;
+		std::string sources[3];
+		// set when path names an image embedded in a model file instead of a file
+		std::shared_ptr<const EmbeddedTexture> embedded;
+		bool srgb = false;
+		bool wantResident = false;
+		EntryState state = EntryState::Queued;
+		int width = 0, height = 0, channels = 0;
+		int page = -1, layer = -1;
+		int thumbnail = -1;
+	};
+
+	TexturePalette();
+	~TexturePalette();
+
+	TexturePalette(const TexturePalette&) = delete;
+	TexturePalette& operator=(const TexturePalette&) = delete;
+
+	// adds a texture (or returns the existing entry), resident entries are uploaded in full, others only get a thumbnail
+	// once the grid shows them
+	int Add(const std::string& path, bool srgb, bool resident = true);
+	// Add for an image embedded in a model file, name stands in for its path from then on. adding the name again with other
+	// data decodes its entries again like Reload, so a model reloaded from the same file updates its textures in place
+	int AddEmbedded(const std::string& name, std::shared_ptr<const EmbeddedTexture> image, bool srgb, bool resident = true);
+	// adds every image of a directory as thumbnail only, colour space guessed from the file name
+	void AddDirectory(const std::string& directory);
+	// requests the full texture of an entry that only has a thumbnail
+	void MakeResident(int entry);
+	// ORM map from a roughness entry, occlusion and metalness maps next to it are found by name (_rough -> _ao, _metal...)
+	int AddPackedOrm(int roughnessEntry);
+	// two-channel copy of a normal map entry
+	int AddPackedNormal(int normalEntry);
+	// decodes every entry of a changed file again, the old texture stays bound until the new one is uploaded.
+	// a decode that fails (file still being written) keeps the old texture. returns the number of entries queued
+	int Reload(const std::string& path);
+
+	// uploads finished decodes until the byte budget is used, call once per frame from the render thread
+	void Update(size_t uploadBudget = 16 * 1024 * 1024);
+	// blocks until every queued decode is finished and uploaded
+	void Flush();
+
+	// binds the pages of the three material slots to units 0-2 and sets the layer uniforms
+	void BindMaterial(const Shader& shader, int diffuse, int roughness, int normal) const;
+
+	// thumbnail grid for ImGui, returns the clicked entry or -1
+	int DrawGrid(int selected, float thumbnailSize);
+
+	bool IsResident(int entry) const;
+	size_t GetEntryCount() const;
+	const Entry& GetEntry(int entry) const;
+
+	static bool IsColorTexture(const std::string& path);
+
+private:
+	struct Page
+	{
+		GLTexture texture;
+		int width = 0, height = 0, levels = 0;
+		GLenum internalFormat = 0, format = 0;
+		int layerCount = 0, capacity = 0;
+		// layers given up by reloads that changed size or format
+		std::vector<int> freeLayers;
+	};
+
+	struct DecodedImage
+	{
+		int entry = -1;
+		bool failed = false;
+		bool reload = false;
+		int width = 0, height = 0, channels = 0;
+		std::vector<std::vector<unsigned char>> mips;
+		std::vector<unsigned char> thumbnail;
+	};
+
+	void QueueDecode(int entry, bool resident, bool thumbnail, bool reload = false);
+	static DecodedImage Decode(int entry, const Entry& source, bool resident, bool thumbnail);
+	static std::string FindCompanion(const std::string& roughnessPath, const char* const* tags, int tagCount);
+
+	void Upload(DecodedImage& image);
+	void UploadThumbnail(Entry& entry, const std::vector<unsigned char>& pixels);
+	int AllocateLayer(int width, int height, int channels, bool srgb, int& layer);
+
+private:
+	std::vector<Entry> m_Entries;
+	std::unordered_map<std::string, int> m_Lookup;
+	// images added with AddEmbedded by name
+	std::unordered_map<std::string, std::shared_ptr<const EmbeddedTexture>> m_Embedded;
+	std::vector<Page> m_Pages;
+
+	std::vector<GLTexture> m_ThumbnailAtlases;
+	int m_ThumbnailCount = 0;
+	std::vector<int> m_MemoryIds;
+
+	std::mutex m_ResultMutex;
+	std::condition_variable m_ResultCondition;
+	std::deque<DecodedImage> m_Results;
+	int m_InFlight = 0;
+};
+
+#endif // !TEXTUREPALETTE_H
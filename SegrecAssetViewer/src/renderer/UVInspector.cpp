@@ -0,0 +1,537 @@
+#include "UVInspector.h"
+
+#include "AnalysisView.h"
+#include "MemoryTracker.h"
+#include "Mesh.h"
+#include "ThreadPool.h"
+
+#include <imgui/imgui.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <unordered_map>
+
+namespace
+{
+	const int RESOLUTION = UVInspector::RESOLUTION;
+	const int TILE_SIZE = UVInspector::TILE_SIZE;
+	const int TILES = RESOLUTION / TILE_SIZE;
+	// corners snap to 1/256 pixel, shared edges of neighbouring triangles evaluate to exactly the same values
+	const float SUBPIXEL = 256.0f;
+	// pixels closer than this to an edge of their triangle are drawn darker, in pixels
+	const double EDGE_WIDTH = 0.75;
+	// triangles per binning chunk
+	const size_t BIN_GRAIN = 16384;
+
+	const uint8_t FLIPPED = 1;
+	const uint8_t DEGENERATE = 2;
+	const uint8_t OUTSIDE = 4;
+
+	const char* MODE_NAMES[] = { "Islands", "Texel density" };
+
+	// RGBA8 in memory order
+	uint32_t PackColor(const glm::vec3& color, float alpha)
+	{
+		glm::vec3 scaled = glm::clamp(color, glm::vec3(0.0f), glm::vec3(1.0f)) * 255.0f + 0.5f;
+		return static_cast<uint32_t>(scaled.r) | (static_cast<uint32_t>(scaled.g) << 8) | (static_cast<uint32_t>(scaled.b) << 16)
+			| (static_cast<uint32_t>(alpha * 255.0f + 0.5f) << 24);
+	}
+
+	// golden ratio steps keep the hues of consecutive islands apart
+	glm::vec3 IslandColor(uint32_t island)
+	{
+		glm::vec3 color;
+		ImGui::ColorConvertHSVtoRGB(std::fmod(island * 0.618034f, 1.0f), 0.55f, 0.95f, color.r, color.g, color.b);
+		return color;
+	}
+
+	float Cross(const glm::vec2& a, const glm::vec2& b)
+	{
+		return a.x * b.y - a.y * b.x;
+	}
+
+	// a vertex is the same island vertex as another one with the same position and texture coordinates,
+	// unwelded imports repeat them per triangle
+	struct IslandKey
+	{
+		float values[5];
+
+		bool operator==(const IslandKey& other) const
+		{
+			return std::memcmp(values, other.values, sizeof(values)) == 0;
+		}
+	};
+
+	struct IslandKeyHash
+	{
+		size_t operator()(const IslandKey& key) const
+		{
+			uint64_t hash = 14695981039346656037ull;
+			for (float value : key.values)
+			{
+				uint32_t bits;
+				std::memcpy(&bits, &value, sizeof(bits));
+				hash = (hash ^ bits) * 1099511628211ull;
+			}
+			return static_cast<size_t>(hash);
+		}
+	};
+
+	uint32_t FindRoot(std::vector<uint32_t>& parents, uint32_t vertex)
+	{
+		while (parents[vertex] != vertex)
+		{
+			parents[vertex] = parents[parents[vertex]];
+			vertex = parents[vertex];
+		}
+		return vertex;
+	}
+
+	// which of the two triangles sharing an edge owns the pixel centres exactly on it. the triangles run along the
+	// edge in opposite directions, the rule holds for exactly one of d and -d
+	bool OwnsEdge(const glm::vec2& d)
+	{
+		return d.y < 0.0f || (d.y == 0.0f && d.x > 0.0f);
+	}
+}
+
+const char* GetUVOverlayModeName(UVOverlayMode mode)
+{
+	return MODE_NAMES[static_cast<int>(mode)];
+}
+
+UVInspector::UVInspector()
+{
+}
+
+UVInspector::~UVInspector()
+{
+	if (m_Job.valid())
+		m_Job.wait();
+	if (m_MemoryId >= 0)
+		MemoryTracker::Get().Unregister(m_MemoryId);
+}
+
+void UVInspector::Analyze(Mesh& mesh, int textureSize, UVOverlayMode mode)
+{
+	bool released = !mesh.HasCpuData();
+	if (released)
+		mesh.EnsureCpuData();
+
+	std::unique_ptr<Input> input = std::make_unique<Input>();
+	input->uvs.resize(mesh.vertices.size());
+	input->positions.resize(mesh.vertices.size());
+	for (size_t i = 0; i < mesh.vertices.size(); i++)
+	{
+		input->uvs[i] = mesh.vertices[i].TexCoords;
+		input->positions[i] = mesh.vertices[i].Position;
+	}
+	input->indices = mesh.indices;
+	input->textureSize = std::max(textureSize, 1);
+	input->mode = mode;
+
+	if (released)
+		mesh.ReleaseCpuData();
+
+	if (IsBusy())
+		m_Pending = std::move(input);
+	else
+		Start(std::move(input));
+}
+
+void UVInspector::Update()
+{
+	if (!m_Job.valid() || m_Job.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		return;
+
+	Result result = m_Job.get();
+	if (!m_Overlay)
+	{
+		m_Overlay = GLTexture::Create();
+		glBindTexture(GL_TEXTURE_2D, m_Overlay.Get());
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, RESOLUTION, RESOLUTION, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		// zoomed in, pixels stay pixels
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		m_MemoryId = MemoryTracker::Get().Register(MemoryCategory::Texture, "UV overlay", 0, MemoryTracker::TextureBytes(RESOLUTION, RESOLUTION, 4, false));
+	}
+	glBindTexture(GL_TEXTURE_2D, m_Overlay.Get());
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, RESOLUTION, RESOLUTION, GL_RGBA, GL_UNSIGNED_BYTE, result.pixels.data());
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	m_Stats = result.stats;
+	m_HasResult = true;
+	if (m_Pending)
+		Start(std::move(m_Pending));
+}
+
+bool UVInspector::IsBusy() const
+{
+	return m_Job.valid();
+}
+
+bool UVInspector::HasResult() const
+{
+	return m_HasResult;
+}
+
+const UVInspector::Stats& UVInspector::GetStats() const
+{
+	return m_Stats;
+}
+
+void UVInspector::Draw(float size) const
+{
+	ImVec2 origin = ImGui::GetCursorScreenPos();
+	ImVec2 end(origin.x + size, origin.y + size);
+	ImDrawList* drawList = ImGui::GetWindowDrawList();
+	drawList->AddRectFilled(origin, end, IM_COL32(30, 30, 30, 255));
+	for (int i = 1; i < 8; i++)
+	{
+		float offset = size * i / 8.0f;
+		drawList->AddLine(ImVec2(origin.x + offset, origin.y), ImVec2(origin.x + offset, end.y), IM_COL32(55, 55, 55, 255));
+		drawList->AddLine(ImVec2(origin.x, origin.y + offset), ImVec2(end.x, origin.y + offset), IM_COL32(55, 55, 55, 255));
+	}
+
+	if (m_HasResult)
+		ImGui::Image(ImTextureRef((ImTextureID)(intptr_t)m_Overlay.Get()), ImVec2(size, size));
+	else
+		ImGui::Dummy(ImVec2(size, size));
+	drawList->AddRect(origin, end, IM_COL32(200, 200, 200, 255));
+}
+
+void UVInspector::Start(std::unique_ptr<Input> input)
+{
+	std::shared_ptr<const Input> job(std::move(input));
+	m_Job = ThreadPool::Get().Submit([job]() { return Run(*job); });
+}
+
+UVInspector::Result UVInspector::Run(const Input& input)
+{
+	auto start = std::chrono::steady_clock::now();
+	Result result;
+	Stats& stats = result.stats;
+	stats.textureSize = input.textureSize;
+	result.pixels.assign(static_cast<size_t>(RESOLUTION) * RESOLUTION, 0);
+
+	const size_t triangleCount = input.indices.size() / 3;
+	const size_t vertexCount = input.uvs.size();
+	stats.triangles = triangleCount;
+	if (triangleCount == 0)
+		return result;
+
+	// corners in snapped pixel coordinates, signed UV area, texels per world unit (0 without area) and flags
+	std::vector<glm::vec2> corners(triangleCount * 3);
+	std::vector<float> uvAreas(triangleCount);
+	std::vector<float> surfaceAreas(triangleCount);
+	std::vector<float> densities(triangleCount);
+	std::vector<uint8_t> flags(triangleCount);
+	ThreadPool::Get().ParallelFor(0, triangleCount, 4096, [&](size_t begin, size_t end)
+	{
+		for (size_t t = begin; t < end; t++)
+		{
+			const unsigned int* triangle = &input.indices[t * 3];
+			if (triangle[0] >= vertexCount || triangle[1] >= vertexCount || triangle[2] >= vertexCount)
+			{
+				flags[t] = DEGENERATE;
+				continue;
+			}
+
+			uint8_t triangleFlags = 0;
+			glm::vec2 uv[3];
+			for (int corner = 0; corner < 3; corner++)
+			{
+				uv[corner] = input.uvs[triangle[corner]];
+				if (uv[corner].x < 0.0f || uv[corner].x > 1.0f || uv[corner].y < 0.0f || uv[corner].y > 1.0f)
+					triangleFlags |= OUTSIDE;
+				corners[t * 3 + corner] = glm::round(uv[corner] * static_cast<float>(RESOLUTION) * SUBPIXEL) / SUBPIXEL;
+			}
+
+			float uvArea = 0.5f * Cross(uv[1] - uv[0], uv[2] - uv[0]);
+			const glm::vec3& p0 = input.positions[triangle[0]];
+			float surfaceArea = 0.5f * glm::length(glm::cross(input.positions[triangle[1]] - p0, input.positions[triangle[2]] - p0));
+			if (std::abs(uvArea) < 1e-12f)
+				triangleFlags |= DEGENERATE;
+			else if (surfaceArea > 0.0f)
+				densities[t] = std::sqrt(std::abs(uvArea) / surfaceArea) * static_cast<float>(input.textureSize);
+
+			uvAreas[t] = uvArea;
+			surfaceAreas[t] = surfaceArea;
+			flags[t] = triangleFlags;
+		}
+	});
+
+	// flipped triangles wind against the majority, mirrored shells are usually the smaller part
+	size_t positive = 0, negative = 0;
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		if (flags[t] & DEGENERATE)
+			continue;
+		(uvAreas[t] > 0.0f ? positive : negative)++;
+	}
+	bool positiveMajority = positive >= negative;
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		if (!(flags[t] & DEGENERATE) && (uvAreas[t] > 0.0f) != positiveMajority)
+			flags[t] |= FLIPPED;
+		stats.flippedTriangles += (flags[t] & FLIPPED) ? 1 : 0;
+		stats.degenerateTriangles += (flags[t] & DEGENERATE) ? 1 : 0;
+		stats.outsideTriangles += (flags[t] & OUTSIDE) ? 1 : 0;
+	}
+
+	// texel density over the triangles that have one
+	std::vector<float> sorted;
+	sorted.reserve(triangleCount);
+	double weightedDensity = 0.0, weights = 0.0;
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		if (densities[t] <= 0.0f)
+			continue;
+		sorted.push_back(densities[t]);
+		weightedDensity += static_cast<double>(densities[t]) * surfaceAreas[t];
+		weights += surfaceAreas[t];
+	}
+	if (!sorted.empty())
+	{
+		auto percentile = [&sorted](float p)
+		{
+			auto nth = sorted.begin() + static_cast<size_t>(p * (sorted.size() - 1));
+			std::nth_element(sorted.begin(), nth, sorted.end());
+			return *nth;
+		};
+		stats.densityP10 = percentile(0.1f);
+		stats.densityMedian = percentile(0.5f);
+		stats.densityP90 = percentile(0.9f);
+		auto range = std::minmax_element(sorted.begin(), sorted.end());
+		stats.densityMin = *range.first;
+		stats.densityMax = *range.second;
+		stats.densityMean = static_cast<float>(weightedDensity / weights);
+	}
+
+	// islands: triangles connected through vertices that share position and texture coordinates
+	std::vector<uint32_t> parents(vertexCount);
+	{
+		std::unordered_map<IslandKey, uint32_t, IslandKeyHash> firstVertex;
+		firstVertex.reserve(vertexCount);
+		for (uint32_t v = 0; v < vertexCount; v++)
+		{
+			const glm::vec2& uv = input.uvs[v];
+			const glm::vec3& position = input.positions[v];
+			IslandKey key = { { uv.x, uv.y, position.x, position.y, position.z } };
+			parents[v] = firstVertex.emplace(key, v).first->second;
+		}
+	}
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		const unsigned int* triangle = &input.indices[t * 3];
+		if (triangle[0] >= vertexCount || triangle[1] >= vertexCount || triangle[2] >= vertexCount)
+			continue;
+		uint32_t root = FindRoot(parents, triangle[0]);
+		for (int corner = 1; corner < 3; corner++)
+		{
+			uint32_t other = FindRoot(parents, triangle[corner]);
+			if (other != root)
+				parents[other] = root;
+		}
+	}
+	std::vector<uint32_t> islandIds(vertexCount, UINT32_MAX);
+	std::vector<uint32_t> islands(triangleCount, 0);
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		unsigned int first = input.indices[t * 3];
+		if (first >= vertexCount)
+			continue;
+		uint32_t& id = islandIds[FindRoot(parents, first)];
+		if (id == UINT32_MAX)
+			id = static_cast<uint32_t>(stats.islands++);
+		islands[t] = id;
+	}
+
+	// binning: every chunk of triangles lists the tiles its bounding boxes touch, a counting sort groups them per tile
+	size_t chunkCount = std::min<size_t>(std::max<size_t>(triangleCount / BIN_GRAIN, 1), ThreadPool::Get().GetThreadCount() * 4 + 1);
+	std::vector<std::vector<std::pair<uint32_t, uint32_t>>> chunkPairs(chunkCount);
+	ThreadPool::Get().ParallelFor(0, chunkCount, 1, [&](size_t begin, size_t end)
+	{
+		for (size_t chunk = begin; chunk < end; chunk++)
+		{
+			size_t first = triangleCount * chunk / chunkCount;
+			size_t last = triangleCount * (chunk + 1) / chunkCount;
+			for (size_t t = first; t < last; t++)
+			{
+				if (flags[t] & DEGENERATE)
+					continue;
+				const glm::vec2* c = &corners[t * 3];
+				glm::vec2 low = glm::min(c[0], glm::min(c[1], c[2]));
+				glm::vec2 high = glm::max(c[0], glm::max(c[1], c[2]));
+				if (high.x < 0.0f || high.y < 0.0f || low.x >= RESOLUTION || low.y >= RESOLUTION)
+					continue;
+				int tileX0 = std::max(static_cast<int>(low.x), 0) / TILE_SIZE;
+				int tileY0 = std::max(static_cast<int>(low.y), 0) / TILE_SIZE;
+				int tileX1 = std::min(static_cast<int>(high.x), RESOLUTION - 1) / TILE_SIZE;
+				int tileY1 = std::min(static_cast<int>(high.y), RESOLUTION - 1) / TILE_SIZE;
+				for (int y = tileY0; y <= tileY1; y++)
+				{
+					for (int x = tileX0; x <= tileX1; x++)
+						chunkPairs[chunk].emplace_back(static_cast<uint32_t>(y * TILES + x), static_cast<uint32_t>(t));
+				}
+			}
+		}
+	});
+
+	std::vector<uint32_t> tileOffsets(TILES * TILES + 1, 0);
+	for (const auto& pairs : chunkPairs)
+	{
+		for (const auto& pair : pairs)
+			tileOffsets[pair.first + 1]++;
+	}
+	for (int tile = 0; tile < TILES * TILES; tile++)
+		tileOffsets[tile + 1] += tileOffsets[tile];
+	std::vector<uint32_t> tileTriangles(tileOffsets.back());
+	{
+		std::vector<uint32_t> cursors(tileOffsets.begin(), tileOffsets.end() - 1);
+		// chunks in order keep every tile's triangles in index order, the first triangle on a pixel is its owner
+		for (auto& pairs : chunkPairs)
+		{
+			for (const auto& pair : pairs)
+				tileTriangles[cursors[pair.first]++] = pair.second;
+			pairs = std::vector<std::pair<uint32_t, uint32_t>>();
+		}
+	}
+
+	// tiles are independent: a pixel keeps how many triangles cover it and the first of them
+	std::vector<std::vector<uint32_t>> tileOverlaps(TILES * TILES);
+	std::vector<uint32_t> coveredPixels(TILES * TILES, 0), overlapPixels(TILES * TILES, 0);
+	const float medianDensity = stats.densityMedian;
+	ThreadPool::Get().ParallelFor(0, TILES * TILES, 1, [&](size_t begin, size_t end)
+	{
+		uint16_t counts[TILE_SIZE * TILE_SIZE];
+		uint32_t owners[TILE_SIZE * TILE_SIZE];
+		uint8_t edges[TILE_SIZE * TILE_SIZE];
+		for (size_t tile = begin; tile < end; tile++)
+		{
+			if (tileOffsets[tile] == tileOffsets[tile + 1])
+				continue;
+
+			std::memset(counts, 0, sizeof(counts));
+			std::memset(edges, 0, sizeof(edges));
+			const int originX = static_cast<int>(tile % TILES) * TILE_SIZE;
+			const int originY = static_cast<int>(tile / TILES) * TILE_SIZE;
+			std::vector<uint32_t>& overlaps = tileOverlaps[tile];
+
+			for (uint32_t i = tileOffsets[tile]; i < tileOffsets[tile + 1]; i++)
+			{
+				uint32_t t = tileTriangles[i];
+				glm::vec2 a = corners[t * 3], b = corners[t * 3 + 1], c = corners[t * 3 + 2];
+				// counter-clockwise in pixel space from here on
+				if (Cross(b - a, c - a) < 0.0f)
+					std::swap(b, c);
+				const glm::vec2 vertices[3] = { a, b, c };
+
+				double edgeLengths[3];
+				bool owns[3];
+				for (int e = 0; e < 3; e++)
+				{
+					glm::vec2 d = vertices[(e + 1) % 3] - vertices[e];
+					edgeLengths[e] = std::max(std::sqrt(static_cast<double>(d.x) * d.x + static_cast<double>(d.y) * d.y), 1e-9);
+					owns[e] = OwnsEdge(d);
+				}
+
+				glm::vec2 low = glm::min(a, glm::min(b, c));
+				glm::vec2 high = glm::max(a, glm::max(b, c));
+				int x0 = std::max(static_cast<int>(std::floor(low.x)), originX);
+				int y0 = std::max(static_cast<int>(std::floor(low.y)), originY);
+				int x1 = std::min(static_cast<int>(std::ceil(high.x)), originX + TILE_SIZE - 1);
+				int y1 = std::min(static_cast<int>(std::ceil(high.y)), originY + TILE_SIZE - 1);
+				bool overlapped = false;
+				for (int y = y0; y <= y1; y++)
+				{
+					for (int x = x0; x <= x1; x++)
+					{
+						// pixel centres are on the subpixel grid too, every value below is exact in double
+						double px = x + 0.5, py = y + 0.5;
+						double distances[3];
+						bool inside = true;
+						for (int e = 0; e < 3 && inside; e++)
+						{
+							const glm::vec2& p = vertices[e];
+							const glm::vec2& q = vertices[(e + 1) % 3];
+							double w = (static_cast<double>(q.x) - p.x) * (py - p.y) - (static_cast<double>(q.y) - p.y) * (px - p.x);
+							inside = w > 0.0 || (w == 0.0 && owns[e]);
+							distances[e] = w / edgeLengths[e];
+						}
+						if (!inside)
+							continue;
+
+						int local = (y - originY) * TILE_SIZE + (x - originX);
+						if (counts[local] == 0)
+							owners[local] = t;
+						else
+						{
+							if (counts[local] == 1)
+								overlaps.push_back(owners[local]);
+							overlapped = true;
+						}
+						if (counts[local] < UINT16_MAX)
+							counts[local]++;
+						if (std::min(distances[0], std::min(distances[1], distances[2])) < EDGE_WIDTH)
+							edges[local] = 1;
+					}
+				}
+				if (overlapped)
+					overlaps.push_back(t);
+			}
+
+			std::sort(overlaps.begin(), overlaps.end());
+			overlaps.erase(std::unique(overlaps.begin(), overlaps.end()), overlaps.end());
+
+			for (int local = 0; local < TILE_SIZE * TILE_SIZE; local++)
+			{
+				if (counts[local] == 0)
+					continue;
+				coveredPixels[tile]++;
+				uint32_t owner = owners[local];
+				glm::vec3 color;
+				if (counts[local] > 1)
+				{
+					overlapPixels[tile]++;
+					color = glm::vec3(0.95f, 0.1f, 0.1f);
+				}
+				else if (flags[owner] & FLIPPED)
+					color = glm::vec3(0.9f, 0.2f, 0.9f);
+				else if (input.mode == UVOverlayMode::Islands)
+					color = IslandColor(islands[owner]);
+				else if (densities[owner] > 0.0f && medianDensity > 0.0f)
+					// the median in the middle of the ramp, a quarter of it blue and four times it red
+					color = AnalysisView::HeatColor(0.5f + 0.25f * std::log2(densities[owner] / medianDensity));
+				else
+					color = glm::vec3(0.5f);
+				if (edges[local])
+					color *= 0.55f;
+
+				int x = originX + local % TILE_SIZE;
+				int y = originY + local / TILE_SIZE;
+				result.pixels[static_cast<size_t>(y) * RESOLUTION + x] = PackColor(color, 0.85f);
+			}
+		}
+	});
+
+	std::vector<uint8_t> overlapping(triangleCount, 0);
+	size_t covered = 0, overlapped = 0;
+	for (int tile = 0; tile < TILES * TILES; tile++)
+	{
+		for (uint32_t t : tileOverlaps[tile])
+			overlapping[t] = 1;
+		covered += coveredPixels[tile];
+		overlapped += overlapPixels[tile];
+	}
+	stats.overlappingTriangles = static_cast<size_t>(std::count(overlapping.begin(), overlapping.end(), 1));
+	stats.coverage = static_cast<float>(covered) / (RESOLUTION * RESOLUTION);
+	stats.overlapCoverage = static_cast<float>(overlapped) / (RESOLUTION * RESOLUTION);
+	stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	return result;
+}
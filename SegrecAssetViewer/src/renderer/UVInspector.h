@@ -0,0 +1,111 @@
+#ifndef UVINSPECTOR_H
+#define UVINSPECTOR_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "GLResource.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <vector>
+
+class Mesh;
+
+enum class UVOverlayMode : int
+{
+	// every UV island in its own colour
+	Islands,
+	// texels per world unit of each triangle against the mesh median
+	TexelDensity,
+	Count
+};
+
+const char* GetUVOverlayModeName(UVOverlayMode mode);
+
+// UV layout of one mesh, rasterised on the CPU into an overlay of the 0-1 square. triangles are binned into tiles and
+// the tiles rasterised in parallel, each pixel keeps how many triangles cover it, so overlaps come out of the same pass.
+// flipped triangles wind against the mesh's majority. the analysis runs on the thread pool, the overlay is uploaded
+// once it is done
+class UVInspector
+{
+public:
+	static const int RESOLUTION = 1024;
+	static const int TILE_SIZE = 32;
+
+	struct Stats
+	{
+		size_t triangles = 0;
+		size_t islands = 0;
+		size_t overlappingTriangles = 0;
+		size_t flippedTriangles = 0;
+		// no UV area, not rasterised
+		size_t degenerateTriangles = 0;
+		// reaching outside the 0-1 square, only the part inside is rasterised
+		size_t outsideTriangles = 0;
+		// share of the 0-1 square covered at all and covered more than once
+		float coverage = 0.0f;
+		float overlapCoverage = 0.0f;
+		// texels per world unit at the texture size, over the triangles with UV and surface area.
+		// the mean is weighted by surface area
+		float densityMin = 0.0f;
+		float densityMax = 0.0f;
+		float densityMean = 0.0f;
+		float densityP10 = 0.0f;
+		float densityMedian = 0.0f;
+		float densityP90 = 0.0f;
+		int textureSize = 0;
+		double milliseconds = 0.0;
+	};
+
+	UVInspector();
+	~UVInspector();
+
+	UVInspector(const UVInspector&) = delete;
+	UVInspector& operator=(const UVInspector&) = delete;
+
+	// copies the mesh's texture coordinates, positions and indices and analyses them in the background (render thread,
+	// a mesh without its CPU copy is read back). a request while one is running replaces any waiting one
+	void Analyze(Mesh& mesh, int textureSize, UVOverlayMode mode);
+	// uploads a finished overlay, call once per frame from the render thread
+	void Update();
+
+	bool IsBusy() const;
+	bool HasResult() const;
+	const Stats& GetStats() const;
+	// the overlay over the 0-1 square with a grid, size x size pixels at the cursor
+	void Draw(float size) const;
+
+private:
+	struct Input
+	{
+		std::vector<glm::vec2> uvs;
+		std::vector<glm::vec3> positions;
+		std::vector<unsigned int> indices;
+		int textureSize = 0;
+		UVOverlayMode mode = UVOverlayMode::Islands;
+	};
+
+	struct Result
+	{
+		Stats stats;
+		// RESOLUTION x RESOLUTION RGBA8, rows from v = 0
+		std::vector<uint32_t> pixels;
+	};
+
+	void Start(std::unique_ptr<Input> input);
+	static Result Run(const Input& input);
+
+private:
+	std::future<Result> m_Job;
+	std::unique_ptr<Input> m_Pending;
+
+	GLTexture m_Overlay;
+	bool m_HasResult = false;
+	Stats m_Stats;
+	int m_MemoryId = -1;
+};
+
+#endif // !UVINSPECTOR_H
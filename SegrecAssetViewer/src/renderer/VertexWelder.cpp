@@ -0,0 +1,185 @@
+#include "VertexWelder.h"
+
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace
+{
+	// position (two words per axis), normal, uv, tangent, bitangent, bone ids, bone weights
+	const int KEY_WORDS = 6 + 3 + 2 + 3 + 3 + MAX_BONE_INFLUENCE * 2;
+	const size_t VERTEX_GRAIN = 16384;
+
+	struct WeldKey
+	{
+		int32_t words[KEY_WORDS];
+
+		bool operator==(const WeldKey& other) const
+		{
+			return std::memcmp(words, other.words, sizeof(words)) == 0;
+		}
+	};
+
+	// grid cell of a value, 64 bit so large scenes with a fine position grid do not saturate
+	int64_t Quantize(float value, float epsilon)
+	{
+		if (epsilon <= 0.0f)
+		{
+			// exact compare, -0 and 0 are the same value
+			if (value == 0.0f)
+				return 0;
+			int32_t bits;
+			std::memcpy(&bits, &value, sizeof(bits));
+			return bits;
+		}
+		const double limit = 4.0e18;
+		double snapped = std::floor(static_cast<double>(value) / epsilon + 0.5);
+		if (!(snapped >= -limit))
+			return static_cast<int64_t>(-limit);
+		return static_cast<int64_t>(std::min(snapped, limit));
+	}
+
+	void MakeKey(const Vertex& vertex, const WeldSettings& settings, WeldKey& key)
+	{
+		int32_t* word = key.words;
+		for (int i = 0; i < 3; i++)
+		{
+			int64_t cell = Quantize(vertex.Position[i], settings.positionEpsilon);
+			*word++ = static_cast<int32_t>(cell >> 32);
+			*word++ = static_cast<int32_t>(cell & 0xFFFFFFFF);
+		}
+		for (int i = 0; i < 3; i++)
+			*word++ = static_cast<int32_t>(Quantize(vertex.Normal[i], settings.normalEpsilon));
+		for (int i = 0; i < 2; i++)
+			*word++ = static_cast<int32_t>(Quantize(vertex.TexCoords[i], settings.texCoordEpsilon));
+		// mirrored UV islands share position, normal and uv but not the tangent frame
+		for (int i = 0; i < 3; i++)
+			*word++ = static_cast<int32_t>(Quantize(vertex.Tangent[i], settings.normalEpsilon));
+		for (int i = 0; i < 3; i++)
+			*word++ = static_cast<int32_t>(Quantize(vertex.Bitangent[i], settings.normalEpsilon));
+		for (int i = 0; i < MAX_BONE_INFLUENCE; i++)
+		{
+			*word++ = settings.compareSkin ? vertex.m_BoneIDs[i] : 0;
+			*word++ = settings.compareSkin ? static_cast<int32_t>(Quantize(vertex.m_Weights[i], 0.0f)) : 0;
+		}
+	}
+
+	uint64_t HashKey(const WeldKey& key)
+	{
+		uint64_t hash = 0xCBF29CE484222325ull;
+		for (int i = 0; i < KEY_WORDS; i++)
+		{
+			hash ^= static_cast<uint32_t>(key.words[i]);
+			hash *= 0x9E3779B97F4A7C15ull;
+			hash ^= hash >> 29;
+		}
+		return hash;
+	}
+}
+
+size_t VertexWelder::Weld(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices, const WeldSettings& settings,
+	std::pmr::memory_resource* scratch)
+{
+	size_t count = vertices.size();
+	if (count < 2)
+		return count;
+
+	ThreadPool& pool = ThreadPool::Get();
+	std::pmr::vector<WeldKey> keys(count, scratch);
+	std::pmr::vector<uint64_t> hashes(count, scratch);
+	pool.ParallelFor(0, count, VERTEX_GRAIN, [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			MakeKey(vertices[i], settings, keys[i]);
+			hashes[i] = HashKey(keys[i]);
+		}
+	});
+
+	// the top hash bits pick the partition, equal keys always land in the same one
+	int partitionBits = 0;
+	while ((size_t(1) << partitionBits) < pool.GetThreadCount() * 4 && partitionBits < 10 && (count >> partitionBits) > VERTEX_GRAIN)
+		partitionBits++;
+	size_t partitionCount = size_t(1) << partitionBits;
+	auto partitionOf = [partitionBits](uint64_t hash) { return partitionBits == 0 ? size_t(0) : static_cast<size_t>(hash >> (64 - partitionBits)); };
+
+	// counting sort by partition keeps the vertices of each partition in ascending order
+	std::pmr::vector<size_t> offsets(partitionCount + 1, 0, scratch);
+	for (size_t i = 0; i < count; i++)
+		offsets[partitionOf(hashes[i]) + 1]++;
+	for (size_t p = 0; p < partitionCount; p++)
+		offsets[p + 1] += offsets[p];
+	std::pmr::vector<uint32_t> order(count, scratch);
+	{
+		std::pmr::vector<size_t> cursor(offsets.begin(), offsets.end() - 1, scratch);
+		for (size_t i = 0; i < count; i++)
+			order[cursor[partitionOf(hashes[i])]++] = static_cast<uint32_t>(i);
+	}
+
+	// remap[i] is the first vertex with the same key, always <= i
+	std::pmr::vector<uint32_t> remap(count, scratch);
+	pool.ParallelFor(0, partitionCount, 1, [&](size_t begin, size_t end)
+	{
+		std::vector<uint32_t> table;
+		for (size_t p = begin; p < end; p++)
+		{
+			size_t size = offsets[p + 1] - offsets[p];
+			size_t capacity = 16;
+			while (capacity < size * 2)
+				capacity *= 2;
+			// open addressing, slots hold vertex index + 1
+			table.assign(capacity, 0);
+			size_t mask = capacity - 1;
+
+			for (size_t o = offsets[p]; o < offsets[p + 1]; o++)
+			{
+				uint32_t vertex = order[o];
+				size_t slot = static_cast<size_t>(hashes[vertex]) & mask;
+				while (true)
+				{
+					uint32_t stored = table[slot];
+					if (stored == 0)
+					{
+						table[slot] = vertex + 1;
+						remap[vertex] = vertex;
+						break;
+					}
+					if (hashes[stored - 1] == hashes[vertex] && keys[stored - 1] == keys[vertex])
+					{
+						remap[vertex] = stored - 1;
+						break;
+					}
+					slot = (slot + 1) & mask;
+				}
+			}
+		}
+	});
+
+	// compaction in the original order, a representative is always placed before the vertices merged into it
+	std::pmr::vector<uint32_t> newIndex(count, scratch);
+	size_t welded = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		if (remap[i] == i)
+		{
+			newIndex[i] = static_cast<uint32_t>(welded);
+			if (welded != i)
+				vertices[welded] = vertices[i];
+			welded++;
+		}
+		else
+			newIndex[i] = newIndex[remap[i]];
+	}
+	vertices.resize(welded);
+	vertices.shrink_to_fit();
+
+	pool.ParallelFor(0, indices.size(), VERTEX_GRAIN * 4, [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+			indices[i] = newIndex[indices[i]];
+	});
+	return welded;
+}
@@ -0,0 +1,31 @@
+#ifndef VERTEXWELDER_H
+#define VERTEXWELDER_H
+
+#include "Mesh.h"
+
+#include <memory_resource>
+#include <vector>
+
+struct WeldSettings
+{
+	// attributes are snapped to a grid of this size before they are compared, 0 only merges bit-identical values
+	float positionEpsilon = 1e-5f;
+	float normalEpsilon = 1e-3f;
+	float texCoordEpsilon = 1e-5f;
+	// bone ids and weights have to match too, off for static meshes whose skin data is unused
+	bool compareSkin = false;
+};
+
+// replacement for aiProcess_JoinIdenticalVertices that runs on the thread pool.
+// vertices are hashed on their quantized attributes and split into partitions by hash, each partition
+// is deduplicated on its own. the first vertex of every group survives, so the result does not depend on threading.
+class VertexWelder
+{
+public:
+	// merges matching vertices and rewrites the indices, returns the new vertex count.
+	// the keys, hashes and remap tables are allocated from scratch (an import passes its arena)
+	static size_t Weld(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices, const WeldSettings& settings,
+		std::pmr::memory_resource* scratch = std::pmr::get_default_resource());
+};
+
+#endif // !VERTEXWELDER_H
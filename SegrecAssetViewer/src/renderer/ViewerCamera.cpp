@@ -90,6 +90,26 @@ void ViewerCamera::SetFocus(bool isFocused)
 	firstMouse = true;
 }
 
+void ViewerCamera::GetOrbit(float& yaw, float& pitch, float& radius) const
+{
+	yaw = m_Yaw;
+	pitch = m_Pitch;
+	radius = m_Radius;
+}
+
+void ViewerCamera::SetOrbit(float yaw, float pitch, float radius)
+{
+	m_Yaw = yaw;
+	m_Pitch = pitch;
+	m_Radius = radius;
+	float camX = m_Radius * cos(glm::radians(m_Yaw)) * cos(glm::radians(m_Pitch));
+	float camY = m_Radius * sin(glm::radians(m_Pitch));
+	float camZ = m_Radius * sin(glm::radians(m_Yaw)) * cos(glm::radians(m_Pitch));
+	m_Position = glm::vec3(camX, camY, camZ);
+
+	UpdateVectors();
+}
+
 void ViewerCamera::UpdateVectors()
 {
 	glm::vec3 target = m_Target;
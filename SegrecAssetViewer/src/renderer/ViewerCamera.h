@@ -24,6 +24,9 @@ public:
 	float GetFOV() const;
 	glm::vec3 GetPosition() const;
 	void SetFocus(bool isFocused);
+	// orbit angles in degrees and distance to the target, saved and restored by session recordings
+	void GetOrbit(float& yaw, float& pitch, float& radius) const;
+	void SetOrbit(float yaw, float pitch, float radius);
 
 private:
 	void UpdateVectors();